@@ -0,0 +1,84 @@
+// host test of audio_mix and audio_channel_convert, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audio_mix.h"
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static int16_t sat16(int64_t x)
+{
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t)x);
+}
+
+static void test_mix(void)
+{
+    printf("mix, saturation, in place\n");
+    int16_t x[5] = { 1000, -32768, 32767, 20000, -20000 };
+    int16_t y[5] = { 1000, -1000, 1000, 20000, -20000 };
+    int16_t z[5];
+    audio_mix_input_t inputs[3] = { { x, AUDIO_MIX_GAIN_0DB }, { y, audio_mix_gain(50) }, { NULL, AUDIO_MIX_GAIN_0DB } };
+    audio_mix(z, inputs, 3, 5);
+    CHECK(z[0] == 1500 && z[1] == -32768 && z[2] == 32767 && z[3] == 30000 && z[4] == -30000);
+
+    // random inputs against a 64 bits sum, longer than one block, written over the first input
+    enum { N = 1000, INPUTS = 4 };
+    static int16_t in[INPUTS][N], ref[N];
+    audio_mix_input_t mix[INPUTS];
+    for(int k = 0; k < INPUTS; k++) {
+        for(int i = 0; i < N; i++) {
+            in[k][i] = rnd();
+        }
+        mix[k].data = in[k];
+        mix[k].gain = rnd() % (AUDIO_MIX_GAIN_MAX + 1);
+    }
+    for(int i = 0; i < N; i++) {
+        int64_t sum = 0;
+        for(int k = 0; k < INPUTS; k++) {
+            sum += ((int64_t)in[k][i] * mix[k].gain) >> 15;
+        }
+        ref[i] = sat16(sum);
+    }
+    audio_mix(in[0], mix, INPUTS, N);
+    int mismatch = 0;
+    for(int i = 0; i < N; i++) {
+        mismatch += abs(in[0][i] - ref[i]) > INPUTS;    // rounding of each product
+    }
+    CHECK(mismatch == 0);
+
+    CHECK(audio_mix_gain(100) == AUDIO_MIX_GAIN_0DB && audio_mix_gain(0) == 0 && audio_mix_gain(300) == AUDIO_MIX_GAIN_MAX);
+    int16_t g[3] = { 20000, -20000, 100 };
+    audio_mix_gain_apply(g, 3, audio_mix_gain(200));
+    CHECK(g[0] == 32767 && g[1] == -32768 && g[2] == 200);
+}
+
+static void test_channels(void)
+{
+    printf("channel convert in place\n");
+    int16_t m[6] = { 1, 2, 3 };
+    audio_channel_convert(m, 1, m, 2, 3);
+    CHECK(m[0] == 1 && m[1] == 1 && m[2] == 2 && m[3] == 2 && m[4] == 3 && m[5] == 3);
+    int16_t s[6] = { 10, 20, -32768, -32768, 32767, 32767 };
+    audio_channel_convert(s, 2, s, 1, 3);
+    CHECK(s[0] == 15 && s[1] == -32768 && s[2] == 32767);
+    int16_t c[4];
+    audio_channel_convert(m, 2, c, 2, 2);
+    CHECK(memcmp(c, m, sizeof(c)) == 0);
+}
+
+int main(void)
+{
+    test_mix();
+    test_channels();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+// host SNR, alias and throughput test of audio_resample, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "audio_resample.h"
+
+#define SKIP    (64)    // output frames dropped at both ends, filter start up
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+// least squares fit of the ideal tone, the rest is noise and distortion
+static double snr(const int16_t *y, int n, int stride, double f, int rate)
+{
+    double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+    for(int i = 0; i < n; i++) {
+        double s = sin(2 * M_PI * f * i / rate), c = cos(2 * M_PI * f * i / rate);
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        ys += y[i * stride] * s;
+        yc += y[i * stride] * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (ys * cc - yc * sc) / det, b = (yc * ss - ys * sc) / det;
+    double sig = 0, err = 0;
+    for(int i = 0; i < n; i++) {
+        double m = a * sin(2 * M_PI * f * i / rate) + b * cos(2 * M_PI * f * i / rate);
+        sig += m * m;
+        err += (y[i * stride] - m) * (y[i * stride] - m);
+    }
+    return 10 * log10(sig / err);
+}
+
+static void tone(int16_t *buf, int frames, int channels, double f, int rate)
+{
+    for(int i = 0; i < frames; i++) {
+        for(int c = 0; c < channels; c++) {
+            buf[i * channels + c] = (int16_t)lrint(30000 * sin(2 * M_PI * f * i / rate + c));
+        }
+    }
+}
+
+// one second of a tone inside both pass bands, fed and drained in random chunks
+static void test_snr(int in_rate, int out_rate, int channels)
+{
+    audio_resample_handle_t rs = audio_resample_create(in_rate, out_rate, channels);
+    CHECK(rs != NULL);
+    int frames = in_rate;
+    int16_t *in = malloc(frames * channels * sizeof(int16_t));
+    int cap = audio_resample_out_frames(rs, frames);
+    int16_t *out = malloc(cap * channels * sizeof(int16_t));
+    double f = 0.2 * (in_rate < out_rate ? in_rate : out_rate);
+    tone(in, frames, channels, f, in_rate);
+    int done = 0, produced = 0;
+    while(done < frames) {
+        int n = rnd() % 500 + 1;
+        if(n > frames - done) {
+            n = frames - done;
+        }
+        int room = rnd() % 400 + 1;
+        if(room > cap - produced) {
+            room = cap - produced;
+        }
+        produced += audio_resample_process(rs, in + done * channels, &n, out + produced * channels, room);
+        done += n;
+    }
+    CHECK(produced <= cap && produced >= cap - 2);
+    double db = 1000;
+    for(int c = 0; c < channels; c++) {
+        double s = snr(out + (SKIP * channels) + c, produced - 2 * SKIP, channels, f, out_rate);
+        db = s < db ? s : db;
+    }
+    if(channels == 1) {
+        printf("  %5d -> %5d, tone %5.0f Hz, SNR %.1f dB, delay %d\n", in_rate, out_rate, f, db, audio_resample_delay(rs));
+    }
+    CHECK(db > 70);
+
+    // downsampling attenuates a tone above the output nyquist
+    if(out_rate < in_rate && channels == 1 && 0.6 * out_rate < 0.5 * in_rate) {
+        audio_resample_reset(rs);
+        double fs = 0.6 * out_rate;
+        tone(in, frames, 1, fs, in_rate);
+        int n = frames;
+        int o = audio_resample_process(rs, in, &n, out, cap);
+        double e = 0;
+        for(int i = SKIP; i < o; i++) {
+            e += (double)out[i] * out[i];
+        }
+        double alias = 10 * log10(e / (o - SKIP) / (30000.0 * 30000 / 2));
+        printf("  %5d -> %5d, alias of %5.0f Hz %.1f dB\n", in_rate, out_rate, fs, alias);
+        CHECK(alias < -60);
+    }
+    free(in);
+    free(out);
+    audio_resample_destroy(rs);
+}
+
+static void test_rates(void)
+{
+    printf("SNR and alias, every pair of rates\n");
+    static const int rates[] = { 8000, 16000, 22050, 44100, 48000 };
+    for(int a = 0; a < 5; a++) {
+        for(int b = 0; b < 5; b++) {
+            if(a != b) {
+                test_snr(rates[a], rates[b], 1);
+                test_snr(rates[a], rates[b], 2);
+            }
+        }
+    }
+}
+
+static void test_pass_through(void)
+{
+    printf("pass through, invalid parameters\n");
+    audio_resample_handle_t rs = audio_resample_create(16000, 16000, 2);
+    CHECK(rs != NULL);
+    int16_t in[8] = { 1, 2, 3, 4, 5, 6, 7, 8 }, out[8];
+    int n = 4;
+    CHECK(audio_resample_process(rs, in, &n, out, 3) == 3 && n == 3 && memcmp(in, out, 6 * sizeof(int16_t)) == 0);
+    audio_resample_destroy(rs);
+    CHECK(audio_resample_create(4000, 16000, 1) == NULL);
+    CHECK(audio_resample_create(16000, 96000, 1) == NULL);
+    CHECK(audio_resample_create(16000, 48000, 3) == NULL);
+}
+
+static void bench(void)
+{
+    static const int pairs[][2] = { { 44100, 48000 }, { 48000, 16000 }, { 16000, 48000 }, { 22050, 44100 } };
+    static int16_t in[4096 * 2], out[16384 * 2];
+    for(int i = 0; i < 4096 * 2; i++) {
+        in[i] = rnd();
+    }
+    for(int p = 0; p < 4; p++) {
+        audio_resample_handle_t rs = audio_resample_create(pairs[p][0], pairs[p][1], 2);
+        long frames = 0;
+        clock_t t = clock();
+        while(clock() - t < CLOCKS_PER_SEC / 4) {
+            int n = 4096;
+            frames += audio_resample_process(rs, in, &n, out, 16384);
+        }
+        double s = (double)(clock() - t) / CLOCKS_PER_SEC;
+        printf("bench %5d -> %5d stereo: %.1f M output frames/s on one core\n", pairs[p][0], pairs[p][1], frames / s / 1e6);
+        audio_resample_destroy(rs);
+    }
+}
+
+int main(void)
+{
+    test_rates();
+    test_pass_through();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
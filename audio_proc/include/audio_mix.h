@@ -0,0 +1,37 @@
+#ifndef __AUDIO_MIX_H__
+#define __AUDIO_MIX_H__
+
+#include <stdint.h>
+
+// plain C without ESP-IDF dependencies, 16 bits interleaved PCM
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_MIX_GAIN_0DB          (1 << 15)   // Q15 unity gain
+#define AUDIO_MIX_GAIN_MAX          (2 << 15)   // larger gains are clamped to 2x
+
+typedef struct {
+    const int16_t   *data;  // NULL: input skipped
+    int32_t         gain;   // Q15
+} audio_mix_input_t;
+
+// Q15 gain of a volume in percent, 100 is 0dB, 0 ~ 200
+int32_t audio_mix_gain(int percent);
+
+// out = saturate(sum(inputs[i].data * inputs[i].gain)), all inputs hold samples samples with the
+// same rate and layout. out may be one of the inputs.
+void audio_mix(int16_t *out, const audio_mix_input_t *inputs, int count, int samples);
+
+// scale samples in place by a Q15 gain with saturation
+void audio_mix_gain_apply(int16_t *data, int samples, int32_t gain);
+
+// 1 <-> 2 channels: mono is copied to both channels, stereo is averaged.
+// out may equal in, frames frames are converted.
+void audio_channel_convert(const int16_t *in, int in_channels, int16_t *out, int out_channels, int frames);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __AUDIO_MIX_H__
@@ -0,0 +1,39 @@
+#ifndef __AUDIO_RESAMPLE_H__
+#define __AUDIO_RESAMPLE_H__
+
+#include <stdint.h>
+
+// plain C without ESP-IDF dependencies, 16 bits interleaved PCM
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_RESAMPLE_PHASES       (64)    // coefficient rows, positions in between are interpolated
+#define AUDIO_RESAMPLE_TAPS         (16)    // taps per output sample when upsampling
+#define AUDIO_RESAMPLE_MAX_TAPS     (96)    // downsampling widens the filter by the ratio, 48k -> 8k needs 96
+#define AUDIO_RESAMPLE_MIN_RATE     (8000)
+#define AUDIO_RESAMPLE_MAX_RATE     (48000)
+
+typedef struct audio_resample* audio_resample_handle_t;
+
+// Kaiser windowed sinc, low pass at 0.45 of the lower rate, any pair of rates in
+// [AUDIO_RESAMPLE_MIN_RATE, AUDIO_RESAMPLE_MAX_RATE] (8k/16k/22.05k/44.1k/48k...), channels 1 or 2.
+// Equal rates pass through. NULL if a parameter is out of range or out of memory.
+audio_resample_handle_t audio_resample_create(int in_rate, int out_rate, int channels);
+void audio_resample_destroy(audio_resample_handle_t handle);
+// drop the history, the next output starts from silence
+void audio_resample_reset(audio_resample_handle_t handle);
+
+// convert up to *in_frames frames into at most out_frames frames, *in_frames is set to the frames
+// consumed, returns the frames written. Call again with the rest while frames are consumed.
+int audio_resample_process(audio_resample_handle_t handle, const int16_t *in, int *in_frames, int16_t *out, int out_frames);
+// upper bound of the output frames for in_frames input frames
+int audio_resample_out_frames(audio_resample_handle_t handle, int in_frames);
+// delay of the filter in input frames
+int audio_resample_delay(audio_resample_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __AUDIO_RESAMPLE_H__
@@ -0,0 +1,83 @@
+#include "audio_mix.h"
+#include <stddef.h>
+
+#define AUDIO_MIX_BLOCK     (64)    // samples accumulated per pass over the inputs
+
+static inline int16_t _audio_mix_sat16(int32_t x)
+{
+    return (x > INT16_MAX) ? INT16_MAX : ((x < INT16_MIN) ? INT16_MIN : (int16_t)x);
+}
+
+static inline int32_t _audio_mix_gain_clamp(int32_t gain)
+{
+    return (gain < 0) ? 0 : ((gain > AUDIO_MIX_GAIN_MAX) ? AUDIO_MIX_GAIN_MAX : gain);
+}
+
+int32_t audio_mix_gain(int percent)
+{
+    return _audio_mix_gain_clamp((int32_t)percent * AUDIO_MIX_GAIN_0DB / 100);
+}
+
+void audio_mix(int16_t *out, const audio_mix_input_t *inputs, int count, int samples)
+{
+    int32_t acc[AUDIO_MIX_BLOCK];
+
+    // block wise so that out may alias an input, input by input inside a block
+    for (int base = 0; base < samples; base += AUDIO_MIX_BLOCK) {
+        int n = (samples - base < AUDIO_MIX_BLOCK) ? samples - base : AUDIO_MIX_BLOCK;
+        for (int i = 0; i < n; i++) {
+            acc[i] = 0;
+        }
+        for (int c = 0; c < count; c++) {
+            const int16_t *src = inputs[c].data;
+            if (src == NULL) {
+                continue;
+            }
+            src += base;
+            int32_t gain = _audio_mix_gain_clamp(inputs[c].gain);
+            if (gain == AUDIO_MIX_GAIN_0DB) {
+                for (int i = 0; i < n; i++) {
+                    acc[i] += src[i];
+                }
+            } else {
+                for (int i = 0; i < n; i++) {
+                    acc[i] += (src[i] * gain) >> 15; // |x| * 2x gain fits in 32 bits
+                }
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            out[base + i] = _audio_mix_sat16(acc[i]);
+        }
+    }
+}
+
+void audio_mix_gain_apply(int16_t *data, int samples, int32_t gain)
+{
+    gain = _audio_mix_gain_clamp(gain);
+    if (gain == AUDIO_MIX_GAIN_0DB) {
+        return;
+    }
+    for (int i = 0; i < samples; i++) {
+        data[i] = _audio_mix_sat16((data[i] * gain) >> 15);
+    }
+}
+
+void audio_channel_convert(const int16_t *in, int in_channels, int16_t *out, int out_channels, int frames)
+{
+    if (in_channels == 1 && out_channels == 2) {
+        // back to front so that out may equal in
+        for (int i = frames - 1; i >= 0; i--) {
+            int16_t x = in[i];
+            out[2 * i] = x;
+            out[2 * i + 1] = x;
+        }
+    } else if (in_channels == 2 && out_channels == 1) {
+        for (int i = 0; i < frames; i++) {
+            out[i] = (in[2 * i] + in[2 * i + 1]) >> 1;
+        }
+    } else if (in != out) {
+        for (int i = 0; i < frames * in_channels; i++) {
+            out[i] = in[i];
+        }
+    }
+}
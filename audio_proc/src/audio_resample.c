@@ -0,0 +1,192 @@
+#include "audio_resample.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define AUDIO_RESAMPLE_ONE          (1ULL << 32)    // one input frame in Q32
+#define AUDIO_RESAMPLE_PHASE_BITS   (6)             // log2(AUDIO_RESAMPLE_PHASES)
+#define AUDIO_RESAMPLE_CUTOFF       (0.45f)         // of the lower rate
+#define AUDIO_RESAMPLE_KAISER_BETA  (8.0f)
+
+struct audio_resample {
+    int         in_rate;
+    int         out_rate;
+    int         channels;
+    int         taps;
+    uint64_t    step;       // input frames per output frame, Q32
+    uint64_t    pos;        // position of the next output behind the filter center, Q32, >= ONE: needs input
+    int         hist_pos;   // oldest frame of the history window
+    int16_t     *coef;      // AUDIO_RESAMPLE_PHASES + 1 rows of taps, Q15, the last row closes the interpolation
+    int16_t     *hist;      // per channel 2 * taps, every frame is stored twice so a window is contiguous
+};
+
+// zeroth order modified Bessel function of the first kind, for the Kaiser window
+static float _audio_resample_i0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+        if (term < sum * 1e-9f) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static void _audio_resample_init_coef(audio_resample_handle_t handle)
+{
+    int taps = handle->taps;
+    float half = taps / 2.0f;
+    int rate = (handle->in_rate < handle->out_rate) ? handle->in_rate : handle->out_rate;
+    float fc = AUDIO_RESAMPLE_CUTOFF * rate / handle->in_rate;  // cycles per input frame
+    float i0_beta = _audio_resample_i0(AUDIO_RESAMPLE_KAISER_BETA);
+    float row[AUDIO_RESAMPLE_MAX_TAPS];
+
+    for (int p = 0; p <= AUDIO_RESAMPLE_PHASES; p++) {
+        float sum = 0.0f;
+        for (int k = 0; k < taps; k++) {
+            // distance of tap k (0: oldest) from the output position
+            float t = (half - 1 - k) + (float)p / AUDIO_RESAMPLE_PHASES;
+            float r = t / half;
+            float x = 2.0f * fc * t;
+            float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf((float)M_PI * x) / ((float)M_PI * x);
+            float win = (r <= -1.0f || r >= 1.0f) ? 0.0f : _audio_resample_i0(AUDIO_RESAMPLE_KAISER_BETA * sqrtf(1.0f - r * r)) / i0_beta;
+            row[k] = 2.0f * fc * sinc * win;
+            sum += row[k];
+        }
+        // unity DC gain per row, the rounding rest goes to the largest tap
+        int16_t *c = handle->coef + p * taps;
+        int32_t isum = 0, peak = 0;
+        for (int k = 0; k < taps; k++) {
+            c[k] = (int16_t)lrintf(row[k] / sum * 32768.0f);
+            isum += c[k];
+            peak = (c[k] > c[peak]) ? k : peak;
+        }
+        c[peak] += 32768 - isum;
+    }
+}
+
+audio_resample_handle_t audio_resample_create(int in_rate, int out_rate, int channels)
+{
+    if (in_rate < AUDIO_RESAMPLE_MIN_RATE || in_rate > AUDIO_RESAMPLE_MAX_RATE || out_rate < AUDIO_RESAMPLE_MIN_RATE || \
+        out_rate > AUDIO_RESAMPLE_MAX_RATE || channels < 1 || channels > 2) {
+        return NULL;
+    }
+    audio_resample_handle_t handle = (audio_resample_handle_t)calloc(1, sizeof(struct audio_resample));
+    if (handle == NULL) {
+        return NULL;
+    }
+    handle->in_rate = in_rate;
+    handle->out_rate = out_rate;
+    handle->channels = channels;
+    if (in_rate == out_rate) {
+        return handle;  // pass through
+    }
+    // downsampling narrows the pass band, widen the filter by the ratio to keep the transition band
+    int taps = AUDIO_RESAMPLE_TAPS * ((in_rate + out_rate - 1) / out_rate);
+    handle->taps = (taps > AUDIO_RESAMPLE_MAX_TAPS) ? AUDIO_RESAMPLE_MAX_TAPS : taps;
+    handle->step = ((uint64_t)in_rate << 32) / out_rate;
+    handle->coef = (int16_t *)malloc((AUDIO_RESAMPLE_PHASES + 1) * handle->taps * sizeof(int16_t));
+    handle->hist = (int16_t *)malloc(channels * 2 * handle->taps * sizeof(int16_t));
+    if (handle->coef == NULL || handle->hist == NULL) {
+        audio_resample_destroy(handle);
+        return NULL;
+    }
+    _audio_resample_init_coef(handle);
+    audio_resample_reset(handle);
+    return handle;
+}
+
+void audio_resample_destroy(audio_resample_handle_t handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    free(handle->coef);
+    free(handle->hist);
+    free(handle);
+}
+
+void audio_resample_reset(audio_resample_handle_t handle)
+{
+    if (handle == NULL || handle->hist == NULL) {
+        return;
+    }
+    memset(handle->hist, 0, handle->channels * 2 * handle->taps * sizeof(int16_t));
+    handle->hist_pos = 0;
+    handle->pos = AUDIO_RESAMPLE_ONE;
+}
+
+// dot product of the window with the two coefficient rows around the position, interpolated once
+static inline int16_t _audio_resample_dot(const int16_t *win, const int16_t *c0, int taps, int32_t w)
+{
+    const int16_t *c1 = c0 + taps;
+    int32_t s0 = 0, s1 = 0;
+    for (int k = 0; k < taps; k++) {
+        s0 += win[k] * c0[k];
+        s1 += win[k] * (c1[k] - c0[k]);
+    }
+    int64_t y = (int64_t)s0 + (((int64_t)s1 * w) >> 15);
+    y = (y + (1 << 14)) >> 15;
+    return (y > INT16_MAX) ? INT16_MAX : ((y < INT16_MIN) ? INT16_MIN : (int16_t)y);
+}
+
+int audio_resample_process(audio_resample_handle_t handle, const int16_t *in, int *in_frames, int16_t *out, int out_frames)
+{
+    if (handle == NULL || in_frames == NULL || *in_frames < 0 || out_frames < 0) {
+        return 0;
+    }
+    int channels = handle->channels;
+    if (handle->taps == 0) {
+        int n = (*in_frames < out_frames) ? *in_frames : out_frames;
+        if (out != in) {
+            memmove(out, in, n * channels * sizeof(int16_t));
+        }
+        *in_frames = n;
+        return n;
+    }
+
+    int taps = handle->taps;
+    int consumed = 0, produced = 0;
+    while (produced < out_frames) {
+        while (handle->pos >= AUDIO_RESAMPLE_ONE) {
+            if (consumed == *in_frames) {
+                goto _done;
+            }
+            int hp = handle->hist_pos;
+            for (int c = 0; c < channels; c++) {
+                int16_t *h = handle->hist + c * 2 * taps;
+                h[hp] = h[hp + taps] = in[consumed * channels + c];
+            }
+            handle->hist_pos = (hp + 1 == taps) ? 0 : hp + 1;
+            handle->pos -= AUDIO_RESAMPLE_ONE;
+            consumed++;
+        }
+        uint32_t frac = (uint32_t)handle->pos;
+        const int16_t *c0 = handle->coef + (frac >> (32 - AUDIO_RESAMPLE_PHASE_BITS)) * taps;
+        int32_t w = (frac >> (32 - AUDIO_RESAMPLE_PHASE_BITS - 15)) & 0x7fff;
+        for (int c = 0; c < channels; c++) {
+            const int16_t *win = handle->hist + c * 2 * taps + handle->hist_pos;
+            out[produced * channels + c] = _audio_resample_dot(win, c0, taps, w);
+        }
+        produced++;
+        handle->pos += handle->step;
+    }
+_done:
+    *in_frames = consumed;
+    return produced;
+}
+
+int audio_resample_out_frames(audio_resample_handle_t handle, int in_frames)
+{
+    if (handle == NULL) {
+        return 0;
+    }
+    return (int)(((int64_t)in_frames * handle->out_rate + handle->in_rate - 1) / handle->in_rate) + 1;
+}
+
+int audio_resample_delay(audio_resample_handle_t handle)
+{
+    return (handle == NULL) ? 0 : handle->taps / 2;
+}
@@ -0,0 +1,4 @@
+#pragma once
+#include <stdlib.h>
+#define audio_calloc calloc
+#define audio_free free
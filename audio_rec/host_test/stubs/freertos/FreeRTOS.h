@@ -0,0 +1,10 @@
+#pragma once
+// just enough FreeRTOS for audio_frame_ring on a host, ticks are ms
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint32_t TickType_t;
+#define portMAX_DELAY       0xffffffffu
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdMS_TO_TICKS(x)    (x)
@@ -0,0 +1,66 @@
+#pragma once
+// counting semaphores on pthreads, a mutex is a binary semaphore given once
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    pthread_mutex_t m;
+    pthread_cond_t  c;
+    int             count;
+    int             max;
+} host_sem_t;
+typedef host_sem_t* SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t host_sem_create(int count, int max)
+{
+    host_sem_t* s = calloc(1, sizeof(host_sem_t));
+    pthread_mutex_init(&s->m, NULL);
+    pthread_cond_init(&s->c, NULL);
+    s->count = count;
+    s->max = max;
+    return s;
+}
+#define xSemaphoreCreateMutex()     host_sem_create(1, 1)
+#define xSemaphoreCreateBinary()    host_sem_create(0, 1)
+
+static inline int xSemaphoreGive(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->m);
+    if(s->count < s->max) {
+        s->count++;
+    }
+    pthread_cond_signal(&s->c);
+    pthread_mutex_unlock(&s->m);
+    return pdTRUE;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += (ticks == portMAX_DELAY) ? 100000 : ticks / 1000;
+    ts.tv_nsec += (ticks == portMAX_DELAY) ? 0 : (ticks % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&s->m);
+    while(s->count == 0) {
+        if(ticks == 0 || pthread_cond_timedwait(&s->c, &s->m, &ts) == ETIMEDOUT) {
+            pthread_mutex_unlock(&s->m);
+            return pdFALSE;
+        }
+    }
+    s->count--;
+    pthread_mutex_unlock(&s->m);
+    return pdTRUE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+    pthread_cond_destroy(&s->c);
+    pthread_mutex_destroy(&s->m);
+    free(s);
+}
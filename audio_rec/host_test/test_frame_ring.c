@@ -0,0 +1,226 @@
+// host test of audio_frame_ring with one writer and two reader threads, see Makefile
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "audio_frame_ring.h"
+
+static int s_fail;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+#define FRAMES      (20000)
+#define FRAME_SIZE  (64)
+#define MARK_EVERY  (100)   // one marker frame before every MARK_EVERY data frames
+
+typedef struct {
+    audio_frame_ring_handle_t ring;
+    int         id;
+    int         slow_us;    // time spent on each frame
+    uint32_t    got;
+    uint32_t    marks;
+    uint32_t    bad;        // corrupt frames, data out of order, marker missing or out of order
+    int64_t     last;
+    int         mark;       // value of the last marker
+    int         lossless;   // every data frame that starts a group follows its marker
+} reader_t;
+
+static void *reader_task(void *arg)
+{
+    reader_t *r = arg;
+    while(1) {
+        audio_frame_t *frame = audio_frame_ring_acquire(r->ring, r->id, 200);
+        if(frame == NULL) {
+            break;
+        }
+        if(frame->mark) {
+            r->bad += frame->mark <= r->mark || frame->len != 0;
+            r->bad += r->lossless && frame->mark != r->mark + 1;
+            r->mark = frame->mark;
+            r->marks++;
+        } else {
+            uint32_t v;
+            memcpy(&v, frame->data, sizeof(v));
+            for(int i = sizeof(v); i < frame->len; i++) {
+                r->bad += frame->data[i] != (uint8_t)v;
+            }
+            r->bad += (int64_t)v <= r->last; // gaps only when frames are dropped
+            r->bad += r->lossless && v % MARK_EVERY == 0 && r->mark != (int)(v / MARK_EVERY + 1);
+            r->last = v;
+            r->got++;
+        }
+        if(r->slow_us) {
+            usleep(r->slow_us);
+        }
+        audio_frame_ring_release(r->ring, frame);
+    }
+    return NULL;
+}
+
+static void run(audio_frame_ring_policy_t policy)
+{
+    printf("%s\n", policy == AUDIO_FRAME_RING_BACKPRESSURE ? "backpressure" : "drop oldest");
+    audio_frame_ring_cfg_t cfg = { .frame_size = FRAME_SIZE, .frame_num = 8, .policy = policy };
+    audio_frame_ring_handle_t ring = audio_frame_ring_create(&cfg);
+    int lossless = policy == AUDIO_FRAME_RING_BACKPRESSURE;
+    reader_t fast = { .ring = ring, .id = audio_frame_ring_reader_add(ring), .last = -1, .lossless = lossless };
+    reader_t slow = { .ring = ring, .id = audio_frame_ring_reader_add(ring), .slow_us = 20, .last = -1, .lossless = lossless };
+    pthread_t t1, t2;
+    pthread_create(&t1, NULL, reader_task, &fast);
+    pthread_create(&t2, NULL, reader_task, &slow);
+
+    uint32_t marks = 0;
+    for(uint32_t v = 0; v < FRAMES; v++) {
+        audio_frame_t *frame;
+        if(v % MARK_EVERY == 0) {
+            frame = audio_frame_ring_acquire_write(ring, portMAX_DELAY);
+            frame->mark = v / MARK_EVERY + 1; // no data, published anyway
+            audio_frame_ring_publish(ring, frame);
+            marks++;
+        }
+        frame = audio_frame_ring_acquire_write(ring, portMAX_DELAY);
+        memcpy(frame->data, &v, sizeof(v));
+        memset(frame->data + sizeof(v), (uint8_t)v, FRAME_SIZE - sizeof(v));
+        frame->len = FRAME_SIZE;
+        audio_frame_ring_publish(ring, frame);
+        frame = audio_frame_ring_acquire_write(ring, portMAX_DELAY);
+        audio_frame_ring_publish(ring, frame); // empty, given back
+        if(v % 500 == 0) {
+            usleep(100);
+        }
+    }
+    pthread_join(t1, NULL);
+    pthread_join(t2, NULL);
+
+    audio_frame_ring_stats_t stats;
+    audio_frame_ring_get_stats(ring, &stats);
+    uint32_t fast_overrun = audio_frame_ring_reader_overrun(ring, fast.id);
+    uint32_t slow_overrun = audio_frame_ring_reader_overrun(ring, slow.id);
+    printf("  published %u, dropped %u, overrun %u, waits %u, fast got %u overrun %u, slow got %u overrun %u\n",
+           stats.published, stats.dropped, stats.overrun, stats.waits, fast.got, fast_overrun, slow.got, slow_overrun);
+    CHECK(fast.bad == 0 && slow.bad == 0);
+    CHECK(fast.marks <= marks && slow.marks <= marks);
+    CHECK(stats.published + stats.dropped == FRAMES + marks);
+    CHECK(fast.got + fast.marks + fast_overrun == stats.published);
+    CHECK(slow.got + slow.marks + slow_overrun == stats.published);
+    if(lossless) {
+        CHECK(stats.dropped == 0 && stats.overrun == 0);
+        CHECK(slow.got == FRAMES && slow.marks == marks);
+    }
+    audio_frame_ring_reader_remove(ring, fast.id);
+    audio_frame_ring_reader_remove(ring, slow.id);
+    audio_frame_ring_destroy(ring);
+}
+
+static void write_data(audio_frame_ring_handle_t ring, uint32_t v)
+{
+    audio_frame_t *frame = audio_frame_ring_acquire_write(ring, portMAX_DELAY);
+    memcpy(frame->data, &v, sizeof(v));
+    frame->len = sizeof(v);
+    audio_frame_ring_publish(ring, frame);
+}
+
+static void write_mark(audio_frame_ring_handle_t ring, int mark)
+{
+    audio_frame_t *frame = audio_frame_ring_acquire_write(ring, portMAX_DELAY);
+    frame->mark = mark;
+    audio_frame_ring_publish(ring, frame);
+}
+
+// drains reader, checks the markers come in order and before the data frames published after them
+static int drain(audio_frame_ring_handle_t ring, int reader, const uint32_t *mark_at, int marks, uint32_t *got)
+{
+    int next = 0;
+    int64_t last = -1;
+    audio_frame_t *frame;
+    *got = 0;
+    while((frame = audio_frame_ring_acquire(ring, reader, 0)) != NULL) {
+        if(frame->mark) {
+            CHECK(frame->mark == next + 1);
+            next = frame->mark;
+        } else {
+            uint32_t v;
+            memcpy(&v, frame->data, sizeof(v));
+            CHECK((int64_t)v > last);
+            for(int i = 0; i < marks; i++) {
+                CHECK((mark_at[i] <= v) == (i < next));
+            }
+            last = v;
+            (*got)++;
+        }
+        audio_frame_ring_release(ring, frame);
+    }
+    return next;
+}
+
+static void test_marks(void)
+{
+    printf("drop oldest: markers of a stalled reader, of a held frame, slot overflow\n");
+    audio_frame_ring_cfg_t cfg = { .frame_size = FRAME_SIZE, .frame_num = 8, .policy = AUDIO_FRAME_RING_DROP_OLDEST };
+    audio_frame_ring_handle_t ring = audio_frame_ring_create(&cfg);
+    int stalled = audio_frame_ring_reader_add(ring);
+    uint32_t mark_at[AUDIO_FRAME_RING_MAX_MARKS + 2], got, v = 0;
+
+    // the reader takes nothing while 100 frames follow every marker
+    for(int m = 0; m < AUDIO_FRAME_RING_MAX_MARKS; m++) {
+        mark_at[m] = v;
+        write_mark(ring, m + 1);
+        for(int i = 0; i < 100; i++) {
+            write_data(ring, v++);
+        }
+    }
+    CHECK(drain(ring, stalled, mark_at, AUDIO_FRAME_RING_MAX_MARKS, &got) == AUDIO_FRAME_RING_MAX_MARKS);
+    CHECK(got == 8);
+    CHECK(audio_frame_ring_reader_overrun(ring, stalled) == 100 * AUDIO_FRAME_RING_MAX_MARKS - 8);
+
+    // the reader holds the oldest frame, the writer has no frame for the markers
+    write_data(ring, v++);
+    audio_frame_t *held = audio_frame_ring_acquire(ring, stalled, 0);
+    CHECK(held && held->mark == 0);
+    for(int i = 0; i < 7; i++) {
+        write_data(ring, v++);
+    }
+    mark_at[0] = v;
+    write_mark(ring, 1);
+    write_data(ring, v++);
+    mark_at[1] = v;
+    write_mark(ring, 2);
+    audio_frame_ring_stats_t stats;
+    audio_frame_ring_get_stats(ring, &stats);
+    CHECK(stats.dropped == 1);
+    audio_frame_ring_release(ring, held);
+    CHECK(drain(ring, stalled, mark_at, 2, &got) == 2);
+    CHECK(got == 7);
+
+    // more markers than reserved slots, the oldest ones are lost and counted
+    uint32_t overrun = audio_frame_ring_reader_overrun(ring, stalled);
+    for(int m = 0; m < AUDIO_FRAME_RING_MAX_MARKS + 2; m++) {
+        write_mark(ring, m + 1);
+        for(int i = 0; i < 8; i++) {
+            write_data(ring, v++);
+        }
+    }
+    int last = 0;
+    audio_frame_t *frame;
+    while((frame = audio_frame_ring_acquire(ring, stalled, 0)) != NULL) {
+        if(frame->mark) {
+            CHECK(frame->mark > last);
+            last = frame->mark;
+        }
+        audio_frame_ring_release(ring, frame);
+    }
+    CHECK(last == AUDIO_FRAME_RING_MAX_MARKS + 2);
+    CHECK(audio_frame_ring_reader_overrun(ring, stalled) == overrun + (AUDIO_FRAME_RING_MAX_MARKS + 2) * 8 - 8 + 2);
+
+    audio_frame_ring_reader_remove(ring, stalled);
+    audio_frame_ring_destroy(ring);
+}
+
+int main(void)
+{
+    test_marks();
+    run(AUDIO_FRAME_RING_DROP_OLDEST);
+    run(AUDIO_FRAME_RING_BACKPRESSURE);
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
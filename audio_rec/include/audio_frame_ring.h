@@ -0,0 +1,86 @@
+#ifndef __AUDIO_FRAME_RING_H__
+#define __AUDIO_FRAME_RING_H__
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief fixed size frames shared by one writer and up to AUDIO_FRAME_RING_MAX_READERS readers
+ *
+ * The writer fills a frame in place and publishes it, every reader then gets the same frame by
+ * pointer and releases it when done. A frame is reused once all readers released it.
+ */
+#define AUDIO_FRAME_RING_MAX_READERS    (4)
+
+/**
+ * @brief marked frames a reader can keep aside with AUDIO_FRAME_RING_DROP_OLDEST. A marked frame the
+ *        reader is made to skip, or one the writer could not publish, is kept in one of these reserved
+ *        slots and handed out in publish order, so markers are not lost with the data frames around
+ *        them. The oldest kept marker is lost only when all slots are taken.
+ */
+#define AUDIO_FRAME_RING_MAX_MARKS      (8)
+
+typedef enum {
+    AUDIO_FRAME_RING_DROP_OLDEST,   // writer never waits: readers skip the oldest frame, a frame still held is dropped instead, markers are kept
+    AUDIO_FRAME_RING_BACKPRESSURE,  // writer waits until the oldest frame is released by all readers
+} audio_frame_ring_policy_t;
+
+typedef struct {
+    int                         frame_size; // bytes per frame
+    int                         frame_num;
+    audio_frame_ring_policy_t   policy;
+} audio_frame_ring_cfg_t;
+
+typedef struct {
+    uint8_t*    data;
+    int         size;   // capacity of data
+    int         len;    // bytes filled by the writer
+    int         mark;   // writer defined marker, 0: data frame. A marked frame is published even without data
+    uint32_t    seq;    // publish order
+    int         refs;   // readers that did not release the frame yet, owned by the ring
+} audio_frame_t;
+
+typedef struct {
+    uint32_t    published;  // frames published to readers, markers kept in the reserved slots included
+    uint32_t    dropped;    // data frames the writer filled but could not publish, drop oldest only
+    uint32_t    overrun;    // frames skipped by readers and markers lost, summed over the readers
+    uint32_t    waits;      // times the writer waited for a free frame, backpressure only
+} audio_frame_ring_stats_t;
+
+typedef struct audio_frame_ring* audio_frame_ring_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+audio_frame_ring_handle_t audio_frame_ring_create(const audio_frame_ring_cfg_t* cfg);
+void audio_frame_ring_destroy(audio_frame_ring_handle_t ring);
+
+/**
+ * @brief writer side, one writer per ring. Fill frame->data and frame->len, then publish.
+ *        A frame published with len <= 0 and no mark is given back unused.
+ * @return NULL on timeout, never NULL with AUDIO_FRAME_RING_DROP_OLDEST
+ */
+audio_frame_t* audio_frame_ring_acquire_write(audio_frame_ring_handle_t ring, TickType_t ticks);
+void audio_frame_ring_publish(audio_frame_ring_handle_t ring, audio_frame_t* frame);
+
+/**
+ * @brief reader side. A new reader starts with the next published frame, release the frames
+ *        it holds before it is removed.
+ * @return reader id, -1 if all readers are used
+ */
+int audio_frame_ring_reader_add(audio_frame_ring_handle_t ring);
+void audio_frame_ring_reader_remove(audio_frame_ring_handle_t ring, int reader);
+// next frame of reader in publish order, NULL on timeout
+audio_frame_t* audio_frame_ring_acquire(audio_frame_ring_handle_t ring, int reader, TickType_t ticks);
+void audio_frame_ring_release(audio_frame_ring_handle_t ring, audio_frame_t* frame);
+
+void audio_frame_ring_get_stats(audio_frame_ring_handle_t ring, audio_frame_ring_stats_t* stats);
+// frames skipped by reader
+uint32_t audio_frame_ring_reader_overrun(audio_frame_ring_handle_t ring, int reader);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !__AUDIO_FRAME_RING_H__
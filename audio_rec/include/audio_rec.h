@@ -4,6 +4,7 @@
 #include "stdio.h"
 #include "stdint.h"
 #include "stdbool.h"
+#include "audio_frame_ring.h"
 
 /**
  * @brief audio recorder player default volume
@@ -15,6 +16,26 @@
  */
 #define AUDIO_REC_PLAYER_CACHE_SIZE 10*1024
 
+/**
+ * @brief audio recorder player cache frame size, the cache holds AUDIO_REC_PLAYER_CACHE_SIZE / AUDIO_REC_PLAYER_FRAME_SIZE frames
+ */
+#define AUDIO_REC_PLAYER_FRAME_SIZE 1024
+
+/**
+ * @brief audio recorder voice frames, 16k 16bit pcm, 16 * 2KB is 1s
+ */
+#define AUDIO_REC_VOICE_FRAME_SIZE  2*1024
+#define AUDIO_REC_VOICE_FRAME_NUM   16
+
+/**
+ * @brief audio recorder voice ring policy
+ *
+ * @note AUDIO_FRAME_RING_DROP_OLDEST: the recorder never waits, slow consumers lose the oldest AUDIO_REC_SPEAKING
+ *       frames, the speak start/end markers are kept in reserved slots and still delivered in order
+ *       AUDIO_FRAME_RING_BACKPRESSURE: the recorder waits for the slowest consumer, nothing is lost
+ */
+#define AUDIO_REC_VOICE_RING_POLICY AUDIO_FRAME_RING_DROP_OLDEST
+
 /**
  * @brief audio recorder wakeup timeout [ms]
  * 
@@ -69,6 +90,21 @@ bool audio_rec_unstall_player(void);
 bool audio_rec_set_volume(int volume);
 bool audio_rec_play(void* src, int len);
 
+/**
+ * @brief fill a player frame in place instead of copying through audio_rec_play: write up to frame->size
+ *        bytes into frame->data, set frame->len, then commit. The frame belongs to the player ring, keep
+ *        frame->data as is and do not use the frame after commit. timeout_ms < 0 waits forever
+ */
+audio_frame_t* audio_rec_play_acquire(int timeout_ms);
+bool audio_rec_play_commit(audio_frame_t* frame);
+
+/**
+ * @brief recorder frames while speaking, uploaders add their own reader and get the frames by pointer:
+ *        reader = audio_frame_ring_reader_add(ring), audio_frame_ring_acquire / audio_frame_ring_release.
+ *        A frame with mark != 0 holds no data, it marks AUDIO_REC_SPEAK_START or AUDIO_REC_SPEAK_END
+ */
+audio_frame_ring_handle_t audio_rec_get_voice_ring(void);
+
 #ifdef __cplusplus
 }
 #endif
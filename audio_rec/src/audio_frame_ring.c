@@ -0,0 +1,339 @@
+#include "audio_frame_ring.h"
+
+#include <string.h>
+
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "audio_mem.h"
+
+static const char *TAG = "frame_ring";
+
+typedef enum {
+    AUDIO_FRAME_RING_MARK_FREE = 0,
+    AUDIO_FRAME_RING_MARK_PENDING,  // handed out before the ring frame with the same seq
+    AUDIO_FRAME_RING_MARK_HELD,     // acquired by the reader, free on release
+} audio_frame_ring_mark_state_t;
+
+typedef struct {
+    bool                used;
+    uint32_t            cursor;     // seq of the next frame to acquire
+    uint32_t            overrun;
+    SemaphoreHandle_t   ready;      // given on publish
+    audio_frame_t       marks[AUDIO_FRAME_RING_MAX_MARKS];  // markers kept aside, drop oldest only
+    uint8_t             mark_state[AUDIO_FRAME_RING_MAX_MARKS];
+    uint32_t            mark_order[AUDIO_FRAME_RING_MAX_MARKS];  // keep order, markers kept at the same seq
+    uint32_t            mark_kept;
+} audio_frame_ring_reader_t;
+
+struct audio_frame_ring {
+    audio_frame_ring_cfg_t      cfg;
+    SemaphoreHandle_t           lock;
+    SemaphoreHandle_t           free;       // given when a frame is released by its last reader
+    uint8_t*                    mem;
+    audio_frame_t*              frames;     // frame_num slots by seq, one more for frames that are dropped
+    uint32_t                    write_seq;  // seq of the next published frame
+    audio_frame_ring_reader_t   reader[AUDIO_FRAME_RING_MAX_READERS];
+    audio_frame_ring_stats_t    stats;
+};
+
+audio_frame_ring_handle_t audio_frame_ring_create(const audio_frame_ring_cfg_t* cfg)
+{
+    if(cfg == NULL || cfg->frame_size <= 0 || cfg->frame_num <= 0) {
+        ESP_LOGE(TAG, "## frame ring config invalid");
+        return NULL;
+    }
+    audio_frame_ring_handle_t ring = audio_calloc(1, sizeof(struct audio_frame_ring));
+    if(ring == NULL) {
+        ESP_LOGE(TAG, "## frame ring malloc failed");
+        return NULL;
+    }
+    ring->cfg = *cfg;
+    ring->lock = xSemaphoreCreateMutex();
+    ring->free = xSemaphoreCreateBinary();
+    ring->frames = audio_calloc(cfg->frame_num + 1, sizeof(audio_frame_t));
+    ring->mem = audio_calloc(cfg->frame_num + 1, cfg->frame_size);
+    bool ok = ring->lock && ring->free && ring->frames && ring->mem;
+    for(int i = 0; ok && i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+        ring->reader[i].ready = xSemaphoreCreateBinary();
+        ok = ring->reader[i].ready != NULL;
+    }
+    if(!ok) {
+        ESP_LOGE(TAG, "## frame ring malloc failed");
+        audio_frame_ring_destroy(ring);
+        return NULL;
+    }
+    for(int i = 0; i <= cfg->frame_num; i++) {
+        ring->frames[i].data = ring->mem + i * cfg->frame_size;
+        ring->frames[i].size = cfg->frame_size;
+    }
+    return ring;
+}
+
+void audio_frame_ring_destroy(audio_frame_ring_handle_t ring)
+{
+    if(ring == NULL) {
+        return;
+    }
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+        if(ring->reader[i].ready) {
+            vSemaphoreDelete(ring->reader[i].ready);
+        }
+    }
+    if(ring->lock) {
+        vSemaphoreDelete(ring->lock);
+    }
+    if(ring->free) {
+        vSemaphoreDelete(ring->free);
+    }
+    audio_free(ring->mem);
+    audio_free(ring->frames);
+    audio_free(ring);
+}
+
+static void audio_frame_ring_unref(audio_frame_ring_handle_t ring, audio_frame_t* frame)
+{
+    if(--frame->refs == 0) {
+        xSemaphoreGive(ring->free);
+    }
+}
+
+// seq order with wrap around
+static int32_t audio_frame_ring_seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+// slot a is due before slot b: by seq, markers kept at the same seq in the order they were kept
+static bool audio_frame_ring_mark_before(audio_frame_ring_reader_t* reader, int a, int b)
+{
+    int32_t diff = audio_frame_ring_seq_diff(reader->marks[a].seq, reader->marks[b].seq);
+    return diff < 0 || (diff == 0 && audio_frame_ring_seq_diff(reader->mark_order[a], reader->mark_order[b]) < 0);
+}
+
+// keep a marker the reader can not get from the ring, it is handed out before the ring frame seq
+static void audio_frame_ring_keep_mark(audio_frame_ring_handle_t ring, audio_frame_ring_reader_t* reader, int mark, uint32_t seq)
+{
+    int slot = -1;
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_MARKS && slot < 0; i++) {
+        if(reader->mark_state[i] == AUDIO_FRAME_RING_MARK_FREE) {
+            slot = i;
+        }
+    }
+    if(slot < 0) { // all slots taken, the oldest pending marker is lost
+        for(int i = 0; i < AUDIO_FRAME_RING_MAX_MARKS; i++) {
+            if(reader->mark_state[i] == AUDIO_FRAME_RING_MARK_PENDING
+                && (slot < 0 || audio_frame_ring_mark_before(reader, i, slot))) {
+                slot = i;
+            }
+        }
+        reader->overrun++;
+        ring->stats.overrun++;
+        if(slot < 0) {
+            return;
+        }
+    }
+    reader->marks[slot].mark = mark;
+    reader->marks[slot].seq = seq;
+    reader->mark_order[slot] = reader->mark_kept++;
+    reader->mark_state[slot] = AUDIO_FRAME_RING_MARK_PENDING;
+}
+
+// the oldest kept marker if it is due before the next ring frame of reader
+static audio_frame_t* audio_frame_ring_next_mark(audio_frame_ring_reader_t* reader)
+{
+    int slot = -1;
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_MARKS; i++) {
+        if(reader->mark_state[i] == AUDIO_FRAME_RING_MARK_PENDING
+            && (slot < 0 || audio_frame_ring_mark_before(reader, i, slot))) {
+            slot = i;
+        }
+    }
+    if(slot < 0 || audio_frame_ring_seq_diff(reader->marks[slot].seq, reader->cursor) > 0) {
+        return NULL;
+    }
+    reader->mark_state[slot] = AUDIO_FRAME_RING_MARK_HELD;
+    return &reader->marks[slot];
+}
+
+static void audio_frame_ring_reset_marks(audio_frame_ring_reader_t* reader)
+{
+    memset(reader->marks, 0, sizeof(reader->marks));
+    memset(reader->mark_state, 0, sizeof(reader->mark_state));
+    memset(reader->mark_order, 0, sizeof(reader->mark_order));
+    reader->mark_kept = 0;
+}
+
+// readers that did not take the oldest frame yet skip it, a marker is kept aside instead
+static void audio_frame_ring_force(audio_frame_ring_handle_t ring, audio_frame_t* frame)
+{
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+        audio_frame_ring_reader_t* reader = &ring->reader[i];
+        if(reader->used && reader->cursor == frame->seq) {
+            reader->cursor++;
+            if(frame->mark) {
+                audio_frame_ring_keep_mark(ring, reader, frame->mark, frame->seq);
+            } else {
+                reader->overrun++;
+                ring->stats.overrun++;
+            }
+            audio_frame_ring_unref(ring, frame);
+        }
+    }
+}
+
+audio_frame_t* audio_frame_ring_acquire_write(audio_frame_ring_handle_t ring, TickType_t ticks)
+{
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    audio_frame_t* frame = &ring->frames[ring->write_seq % ring->cfg.frame_num];
+    while(frame->refs > 0) {
+        if(ring->cfg.policy == AUDIO_FRAME_RING_DROP_OLDEST) {
+            audio_frame_ring_force(ring, frame);
+            if(frame->refs > 0) { // held by a slow reader, the new data goes nowhere
+                frame = &ring->frames[ring->cfg.frame_num];
+            }
+            break;
+        }
+        ring->stats.waits++;
+        xSemaphoreGive(ring->lock);
+        if(xSemaphoreTake(ring->free, ticks) != pdTRUE) {
+            return NULL;
+        }
+        xSemaphoreTake(ring->lock, portMAX_DELAY);
+    }
+    xSemaphoreGive(ring->lock);
+    frame->len = 0;
+    frame->mark = 0;
+    return frame;
+}
+
+void audio_frame_ring_publish(audio_frame_ring_handle_t ring, audio_frame_t* frame)
+{
+    if(frame->len <= 0 && frame->mark == 0) {
+        return;
+    }
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    if(frame == &ring->frames[ring->cfg.frame_num]) {
+        if(frame->mark == 0) {
+            ring->stats.dropped++;
+            xSemaphoreGive(ring->lock);
+            return;
+        }
+        // no free frame for a marker, every reader keeps it aside, due after the frames published so far
+        for(int i = 0; i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+            if(ring->reader[i].used) {
+                audio_frame_ring_keep_mark(ring, &ring->reader[i], frame->mark, ring->write_seq);
+                xSemaphoreGive(ring->reader[i].ready);
+            }
+        }
+        ring->stats.published++;
+        xSemaphoreGive(ring->lock);
+        return;
+    }
+    frame->seq = ring->write_seq++;
+    frame->refs = 0;
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+        if(ring->reader[i].used) {
+            frame->refs++;
+            xSemaphoreGive(ring->reader[i].ready);
+        }
+    }
+    ring->stats.published++;
+    xSemaphoreGive(ring->lock);
+}
+
+int audio_frame_ring_reader_add(audio_frame_ring_handle_t ring)
+{
+    int id = -1;
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+        audio_frame_ring_reader_t* reader = &ring->reader[i];
+        if(!reader->used) {
+            reader->used = true;
+            reader->cursor = ring->write_seq;
+            reader->overrun = 0;
+            audio_frame_ring_reset_marks(reader);
+            xSemaphoreTake(reader->ready, 0);
+            id = i;
+            break;
+        }
+    }
+    xSemaphoreGive(ring->lock);
+    return id;
+}
+
+void audio_frame_ring_reader_remove(audio_frame_ring_handle_t ring, int reader)
+{
+    if(reader < 0 || reader >= AUDIO_FRAME_RING_MAX_READERS) {
+        return;
+    }
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    audio_frame_ring_reader_t* r = &ring->reader[reader];
+    if(r->used) {
+        // give back the frames published but not taken yet
+        for(; r->cursor != ring->write_seq; r->cursor++) {
+            audio_frame_ring_unref(ring, &ring->frames[r->cursor % ring->cfg.frame_num]);
+        }
+        r->used = false;
+    }
+    xSemaphoreGive(ring->lock);
+}
+
+audio_frame_t* audio_frame_ring_acquire(audio_frame_ring_handle_t ring, int reader, TickType_t ticks)
+{
+    if(reader < 0 || reader >= AUDIO_FRAME_RING_MAX_READERS) {
+        return NULL;
+    }
+    audio_frame_ring_reader_t* r = &ring->reader[reader];
+    while(1) {
+        xSemaphoreTake(ring->lock, portMAX_DELAY);
+        audio_frame_t* mark = r->used ? audio_frame_ring_next_mark(r) : NULL;
+        if(mark) {
+            xSemaphoreGive(ring->lock);
+            return mark;
+        }
+        if(r->used && r->cursor != ring->write_seq) {
+            audio_frame_t* frame = &ring->frames[r->cursor % ring->cfg.frame_num];
+            r->cursor++;
+            xSemaphoreGive(ring->lock);
+            return frame;
+        }
+        xSemaphoreGive(ring->lock);
+        if(xSemaphoreTake(r->ready, ticks) != pdTRUE) {
+            return NULL;
+        }
+    }
+}
+
+void audio_frame_ring_release(audio_frame_ring_handle_t ring, audio_frame_t* frame)
+{
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    for(int i = 0; i < AUDIO_FRAME_RING_MAX_READERS; i++) {
+        audio_frame_ring_reader_t* reader = &ring->reader[i];
+        if(frame >= reader->marks && frame < reader->marks + AUDIO_FRAME_RING_MAX_MARKS) {
+            reader->mark_state[frame - reader->marks] = AUDIO_FRAME_RING_MARK_FREE;
+            xSemaphoreGive(ring->lock);
+            return;
+        }
+    }
+    audio_frame_ring_unref(ring, frame);
+    xSemaphoreGive(ring->lock);
+}
+
+void audio_frame_ring_get_stats(audio_frame_ring_handle_t ring, audio_frame_ring_stats_t* stats)
+{
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    *stats = ring->stats;
+    xSemaphoreGive(ring->lock);
+}
+
+uint32_t audio_frame_ring_reader_overrun(audio_frame_ring_handle_t ring, int reader)
+{
+    if(reader < 0 || reader >= AUDIO_FRAME_RING_MAX_READERS) {
+        return 0;
+    }
+    xSemaphoreTake(ring->lock, portMAX_DELAY);
+    uint32_t overrun = ring->reader[reader].overrun;
+    xSemaphoreGive(ring->lock);
+    return overrun;
+}
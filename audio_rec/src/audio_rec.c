@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
@@ -103,9 +104,14 @@ typedef struct {
     audio_rec_handle_t      recorder;
     audio_element_handle_t  raw_read;
     audio_element_handle_t  raw_write;
-    ringbuf_handle_t        raw_write_cache;
+    audio_frame_ring_handle_t player_ring;  // audio_rec_play frames, written to raw_write by the raw cache task
+    audio_frame_ring_handle_t voice_ring;   // recorder frames, read by the speaking callback and uploaders
+    int                     player_reader;
+    int                     voice_reader;
     QueueHandle_t           voice_ctrl;
     bool                    voice_exit;
+    bool                    voice_cb_running;   // ring readers, the rings are freed after they exit
+    bool                    raw_cache_running;
     bool                    voice_reading;
     char*                   command_word;
     audio_rec_player_type_t player_type;
@@ -206,33 +212,63 @@ static esp_err_t audio_rec_setdown_player(void)
     return ESP_OK;
 }
 
+// voice ring statistics of one utterance, base is the snapshot taken when it started
+static void audio_rec_voice_stats(const audio_frame_ring_stats_t *base)
+{
+    audio_frame_ring_stats_t stats;
+    audio_frame_ring_get_stats(s_rec_desc.voice_ring, &stats);
+    ESP_LOGI(TAG, "## voice ring published=%" PRIu32 ", dropped=%" PRIu32 ", overrun=%" PRIu32 ", waits=%" PRIu32,
+             stats.published - base->published, stats.dropped - base->dropped,
+             stats.overrun - base->overrun, stats.waits - base->waits);
+}
+
+// speak start/end go through the voice ring, so the callback task raises them in order with the frames
+static void audio_rec_voice_mark(audio_rec_event_t event)
+{
+    audio_frame_t *frame = audio_frame_ring_acquire_write(s_rec_desc.voice_ring, portMAX_DELAY);
+    if (frame) {
+        frame->mark = event;
+        audio_frame_ring_publish(s_rec_desc.voice_ring, frame);
+    }
+}
+
 static void audio_rec_voice_read_task(void *args)
 {
-    const int buf_len = 2 * 1024;
-    uint8_t *voiceData = audio_calloc(1, buf_len);
     int msg = 0;
     TickType_t delay = portMAX_DELAY;
-    s_rec_desc.voice_exit = false;
+    audio_frame_ring_stats_t base = { 0 };
 
     while (!s_rec_desc.voice_exit) {
         if (xQueueReceive(s_rec_desc.voice_ctrl, &msg, delay) == pdTRUE) {
             switch (msg) {
                 case REC_VOICE_START: {
+                    audio_rec_voice_mark(AUDIO_REC_SPEAK_START);
+                    if (s_rec_desc.voice_reading) {
+                        break;
+                    }
                     ESP_LOGW(TAG, "## voice read begin");
                     delay = 0;
                     s_rec_desc.voice_reading = true;
+                    audio_frame_ring_get_stats(s_rec_desc.voice_ring, &base);
                     break;
                 }
                 case REC_VOICE_STOP: {
-                    ESP_LOGW(TAG, "## voice read stopped");
-                    delay = portMAX_DELAY;
-                    s_rec_desc.voice_reading = false;
+                    if (s_rec_desc.voice_reading) {
+                        ESP_LOGW(TAG, "## voice read stopped");
+                        delay = portMAX_DELAY;
+                        s_rec_desc.voice_reading = false;
+                        audio_rec_voice_stats(&base);
+                    }
+                    audio_rec_voice_mark(AUDIO_REC_SPEAK_END);
                     break;
                 }
                 case REC_VOICE_CANCEL: {
-                    ESP_LOGW(TAG, "## voice read cancel");
-                    delay = portMAX_DELAY;
-                    s_rec_desc.voice_reading = false;
+                    if (s_rec_desc.voice_reading) {
+                        ESP_LOGW(TAG, "## voice read cancel");
+                        delay = portMAX_DELAY;
+                        s_rec_desc.voice_reading = false;
+                    }
+                    audio_rec_voice_mark(AUDIO_REC_SPEAK_START); // wakeup
                     break;
                 }
                 case REC_VOICE_EXIT: {
@@ -248,20 +284,49 @@ static void audio_rec_voice_read_task(void *args)
         }
 
         if (s_rec_desc.voice_reading) {
-            int ret = audio_recorder_data_read(s_rec_desc.recorder, voiceData, buf_len, portMAX_DELAY);
+            // the recorder writes straight into the frame, consumers get it by pointer
+            audio_frame_t *frame = audio_frame_ring_acquire_write(s_rec_desc.voice_ring, portMAX_DELAY);
+            if (frame == NULL) {
+                continue;
+            }
+            int ret = audio_recorder_data_read(s_rec_desc.recorder, frame->data, frame->size, portMAX_DELAY);
+            frame->len = ret;
+            audio_frame_ring_publish(s_rec_desc.voice_ring, frame);
             if (ret <= 0) {
                 ESP_LOGW(TAG, "audio recorder read finished %d", ret);
                 delay = portMAX_DELAY;
                 s_rec_desc.voice_reading = false;
-            } else {
-                if(s_rec_desc.event_cb) {
-                    s_rec_desc.event_cb(AUDIO_REC_SPEAKING, voiceData, ret);
-                }
             }
         }
     }
 
-    free(voiceData);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief speaking callback and the speak start/end markers, in the order the recorder published them
+ */
+static void audio_rec_voice_cb_task(void *args)
+{
+    ESP_LOGI(TAG, "## audio rec voice callback task start");
+
+    while (!s_rec_desc.voice_exit) {
+        audio_frame_t *frame = audio_frame_ring_acquire(s_rec_desc.voice_ring, s_rec_desc.voice_reader, pdMS_TO_TICKS(100));
+        if (frame == NULL) {
+            continue;
+        }
+        if (s_rec_desc.event_cb) {
+            if (frame->mark) {
+                s_rec_desc.event_cb(frame->mark, NULL, 0);
+            } else {
+                s_rec_desc.event_cb(AUDIO_REC_SPEAKING, frame->data, frame->len);
+            }
+        }
+        audio_frame_ring_release(s_rec_desc.voice_ring, frame);
+    }
+    audio_frame_ring_reader_remove(s_rec_desc.voice_ring, s_rec_desc.voice_reader);
+    ESP_LOGI(TAG, "## audio rec voice callback task end");
+    s_rec_desc.voice_cb_running = false;
     vTaskDelete(NULL);
 }
 
@@ -269,27 +334,21 @@ static void audio_rec_raw_cache_task(void *args)
 {
     ESP_LOGI(TAG, "## audio rec raw cache task start");
 
-    int cache_len = AUDIO_REC_PLAYER_CACHE_SIZE / 10;
-    uint8_t* cache_buff = audio_calloc(1, cache_len);
-
     while (!s_rec_desc.voice_exit) {
-        if(s_rec_desc.raw_write_cache == NULL) {
-            ESP_LOGE(TAG, "## raw write cache is null");
-            break;
-        }
-        int len = rb_read(s_rec_desc.raw_write_cache, (char*)cache_buff, cache_len, pdTICKS_TO_MS(100));
-        if(len < 0) {
-            ESP_LOGE(TAG, "## raw write cache read failed");
-            break;
+        audio_frame_t *frame = audio_frame_ring_acquire(s_rec_desc.player_ring, s_rec_desc.player_reader, pdMS_TO_TICKS(100));
+        if (frame == NULL) {
+            continue;
         }
         if(s_rec_desc.raw_write) {
-            if(raw_stream_write(s_rec_desc.raw_write, (char*)cache_buff, len) < 0) {
+            if(raw_stream_write(s_rec_desc.raw_write, (char*)frame->data, frame->len) < 0) {
                 ESP_LOGE(TAG, "## raw write failed");
             }
         }
+        audio_frame_ring_release(s_rec_desc.player_ring, frame);
     }
+    audio_frame_ring_reader_remove(s_rec_desc.player_ring, s_rec_desc.player_reader);
     ESP_LOGI(TAG, "## audio rec raw cache task end");
-    free(cache_buff);
+    s_rec_desc.raw_cache_running = false;
     vTaskDelete(NULL);
 }
 
@@ -297,36 +356,22 @@ static esp_err_t audio_rec_engine_event_cb(audio_rec_evt_t type, void *user_data
 {
     if (AUDIO_REC_WAKEUP_START == type) {
         ESP_LOGI(TAG, "@@ REC_EVENT_WAKEUP_START");
-        if (s_rec_desc.voice_reading) {
-            int msg = REC_VOICE_CANCEL;
-            if (xQueueSend(s_rec_desc.voice_ctrl, &msg, 0) != pdPASS) {
-                ESP_LOGE(TAG, "## rec cancel send failed");
-            }
-        }
-        if(s_rec_desc.event_cb) {
-            s_rec_desc.event_cb(AUDIO_REC_SPEAK_START, NULL, 0);
+        // the read task raises AUDIO_REC_SPEAK_START through the voice ring
+        int msg = REC_VOICE_CANCEL;
+        if (xQueueSend(s_rec_desc.voice_ctrl, &msg, 0) != pdPASS) {
+            ESP_LOGE(TAG, "## rec cancel send failed");
         }
     } else if (AUDIO_REC_VAD_START == type) {
         ESP_LOGI(TAG, "@@ REC_EVENT_VAD_START");
-        if (!s_rec_desc.voice_reading) {
-            int msg = REC_VOICE_START;
-            if (xQueueSend(s_rec_desc.voice_ctrl, &msg, 0) != pdPASS) {
-                ESP_LOGE(TAG, "## rec start send failed");
-            }
-        }
-        if(s_rec_desc.event_cb) {
-            s_rec_desc.event_cb(AUDIO_REC_SPEAK_START, NULL, 0);
+        int msg = REC_VOICE_START;
+        if (xQueueSend(s_rec_desc.voice_ctrl, &msg, 0) != pdPASS) {
+            ESP_LOGE(TAG, "## rec start send failed");
         }
     } else if (AUDIO_REC_VAD_END == type) {
         ESP_LOGI(TAG, "@@ REC_EVENT_VAD_STOP");
-        if (s_rec_desc.voice_reading) {
-            int msg = REC_VOICE_STOP;
-            if (xQueueSend(s_rec_desc.voice_ctrl, &msg, 0) != pdPASS) {
-                ESP_LOGE(TAG, "## rec stop send failed");
-            }
-        }
-        if(s_rec_desc.event_cb) {
-            s_rec_desc.event_cb(AUDIO_REC_SPEAK_END, NULL, 0);
+        int msg = REC_VOICE_STOP;
+        if (xQueueSend(s_rec_desc.voice_ctrl, &msg, 0) != pdPASS) {
+            ESP_LOGE(TAG, "## rec stop send failed");
         }
     } else if (AUDIO_REC_WAKEUP_END == type) {
         ESP_LOGI(TAG, "@@ REC_EVENT_WAKEUP_END");
@@ -525,22 +570,40 @@ bool audio_rec_init(audio_rec_conf_t conf)
         return false;
     }
 
-    if(s_rec_desc.raw_write_cache == NULL) {
-        s_rec_desc.raw_write_cache = rb_create(AUDIO_REC_PLAYER_CACHE_SIZE, 1);
-        ESP_LOGI(TAG, "## create raw write cache!");
+    audio_frame_ring_cfg_t player_cfg = {
+        .frame_size = AUDIO_REC_PLAYER_FRAME_SIZE,
+        .frame_num = AUDIO_REC_PLAYER_CACHE_SIZE / AUDIO_REC_PLAYER_FRAME_SIZE,
+        .policy = AUDIO_FRAME_RING_BACKPRESSURE,
+    };
+    s_rec_desc.player_ring = audio_frame_ring_create(&player_cfg);
+    if(s_rec_desc.player_ring == NULL) {
+        ESP_LOGE(TAG, "## create player ring failed!");
+        return false;
     }
-    if(s_rec_desc.raw_write_cache == NULL) {
-        ESP_LOGE(TAG, "## create raw write cache failed!");
+    s_rec_desc.player_reader = audio_frame_ring_reader_add(s_rec_desc.player_ring);
+
+    audio_frame_ring_cfg_t voice_cfg = {
+        .frame_size = AUDIO_REC_VOICE_FRAME_SIZE,
+        .frame_num = AUDIO_REC_VOICE_FRAME_NUM,
+        .policy = AUDIO_REC_VOICE_RING_POLICY,
+    };
+    s_rec_desc.voice_ring = audio_frame_ring_create(&voice_cfg);
+    if(s_rec_desc.voice_ring == NULL) {
+        ESP_LOGE(TAG, "## create voice ring failed!");
         return false;
     }
+    s_rec_desc.voice_reader = audio_frame_ring_reader_add(s_rec_desc.voice_ring);
 
-    s_rec_desc.voice_ctrl = xQueueCreate(3, sizeof(int));
+    s_rec_desc.voice_ctrl = xQueueCreate(8, sizeof(int));
     if(s_rec_desc.voice_ctrl == NULL) {
         ESP_LOGE(TAG, "## create voice ctrl queue failed!");
         return false;
     }
 
+    s_rec_desc.voice_cb_running = true;
+    s_rec_desc.raw_cache_running = true;
     audio_thread_create(NULL, "read_task", audio_rec_voice_read_task, NULL, 4 * 1024, 5, true, 0);
+    audio_thread_create(NULL, "voice_cb", audio_rec_voice_cb_task, NULL, 4 * 1024, 5, true, 0);
     audio_thread_create(NULL, "raw_cache", audio_rec_raw_cache_task, NULL, 4 * 1024, 21, true, 0);
     s_rec_desc.is_init = true;
     return true;
@@ -572,7 +635,7 @@ bool audio_rec_deinit(void)
         ESP_LOGE(TAG, "## rec exit send failed");
     } else {
         while (1) {
-            if(s_rec_desc.voice_exit == true) {
+            if(s_rec_desc.voice_exit == true && !s_rec_desc.voice_cb_running && !s_rec_desc.raw_cache_running) {
                 break;
             }
             vTaskDelay(pdMS_TO_TICKS(1000));
@@ -586,10 +649,16 @@ bool audio_rec_deinit(void)
         s_rec_desc.voice_ctrl = NULL;
     }
     
-    if(s_rec_desc.raw_write_cache != NULL) {
-        ESP_LOGW(TAG, "## destory raw write cache");
-        rb_destroy(s_rec_desc.raw_write_cache);
-        s_rec_desc.raw_write_cache = NULL;
+    if(s_rec_desc.player_ring != NULL) {
+        ESP_LOGW(TAG, "## destory player ring");
+        audio_frame_ring_destroy(s_rec_desc.player_ring);
+        s_rec_desc.player_ring = NULL;
+    }
+
+    if(s_rec_desc.voice_ring != NULL) {
+        ESP_LOGW(TAG, "## destory voice ring");
+        audio_frame_ring_destroy(s_rec_desc.voice_ring);
+        s_rec_desc.voice_ring = NULL;
     }
 
     if(s_rec_desc.command_word) {
@@ -634,29 +703,66 @@ bool audio_rec_set_volume(int volume)
     return board_hd->audio_hal->audio_codec_set_volume(volume) == ESP_OK ? true : false;
 }
 
-bool audio_rec_play(void* src, int len)
+static bool audio_rec_player_ready(void)
 {
     if(!s_rec_desc.is_init) {
         ESP_LOGW(TAG, "## audio rec is not init");
-        return true;
+        return false;
     }
 
     if(s_rec_desc.player == NULL) {
         ESP_LOGW(TAG, "## audio rec player is not init");
-        return true;
+        return false;
     }
 
     if(s_rec_desc.raw_write == NULL) {
         ESP_LOGW(TAG, "## audio rec raw is not init");
-        return true;
+        return false;
     }
+    return true;
+}
 
-    if(s_rec_desc.raw_write_cache == NULL) {
-        ESP_LOGW(TAG, "## audio rec raw write cache is not init");
+bool audio_rec_play(void* src, int len)
+{
+    if(!audio_rec_player_ready()) {
         return true;
     }
-    // return raw_stream_write(s_rec_desc.raw_write, src, len) < 0 ? false : true;
-    return rb_write(s_rec_desc.raw_write_cache, src, len, portMAX_DELAY) < 0 ? false : true;
+
+    uint8_t* data = (uint8_t*)src;
+    while(len > 0) {
+        audio_frame_t* frame = audio_frame_ring_acquire_write(s_rec_desc.player_ring, portMAX_DELAY);
+        if(frame == NULL) {
+            return false;
+        }
+        frame->len = len > frame->size ? frame->size : len;
+        memcpy(frame->data, data, frame->len);
+        audio_frame_ring_publish(s_rec_desc.player_ring, frame);
+        data += frame->len;
+        len -= frame->len;
+    }
+    return true;
+}
+
+audio_frame_t* audio_rec_play_acquire(int timeout_ms)
+{
+    if(!audio_rec_player_ready()) {
+        return NULL;
+    }
+    return audio_frame_ring_acquire_write(s_rec_desc.player_ring, timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+
+bool audio_rec_play_commit(audio_frame_t* frame)
+{
+    if(frame == NULL || s_rec_desc.player_ring == NULL) {
+        return false;
+    }
+    audio_frame_ring_publish(s_rec_desc.player_ring, frame);
+    return true;
+}
+
+audio_frame_ring_handle_t audio_rec_get_voice_ring(void)
+{
+    return s_rec_desc.voice_ring;
 }
 
 bool audio_rec_enter_sleep(void)
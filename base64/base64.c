@@ -5,11 +5,41 @@
 #include "base64.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #define BASE64_BYTE_0(x) ((uint8_t) ((x)         & 0xff))
 #define BASE64_BYTE_1(x) ((uint8_t) (((x) >>  8) & 0xff))
 #define BASE64_BYTE_2(x) ((uint8_t) (((x) >> 16) & 0xff))
 
+static const unsigned char base64_enc_map[64] =
+{
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/',
+};
+
+/* -1 for characters that are not base64 digits */
+static const signed char base64_dec_map[256] =
+{
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
 unsigned char uchar_mask_of_range(unsigned char low,
 								  unsigned char high,
 								  unsigned char c)
@@ -52,14 +82,57 @@ signed char base64_dec_value(unsigned char c)
     return val - 1;
 }
 
+#define BASE64_ENC(v, ct) ((ct) ? base64_enc_char(v) : base64_enc_map[v])
+#define BASE64_DEC(c, ct) ((ct) ? base64_dec_value(c) : base64_dec_map[c])
+
+/*
+ * Encode n whole 3 bytes groups
+ */
+static unsigned char *base64_enc_groups(unsigned char *p, const unsigned char *src,
+                                        size_t n, int ct)
+{
+    for (; n > 0; n--, src += 3) {
+        uint32_t x = ((uint32_t) src[0] << 16) | ((uint32_t) src[1] << 8) | src[2];
+
+        *p++ = BASE64_ENC((x >> 18) & 0x3F, ct);
+        *p++ = BASE64_ENC((x >> 12) & 0x3F, ct);
+        *p++ = BASE64_ENC((x >>  6) & 0x3F, ct);
+        *p++ = BASE64_ENC(x & 0x3F, ct);
+    }
+
+    return p;
+}
+
+/*
+ * Encode the last 1 or 2 bytes with '=' padding
+ */
+static unsigned char *base64_enc_tail(unsigned char *p, const unsigned char *src,
+                                      size_t n, int ct)
+{
+    int C1 = src[0];
+    int C2 = (n > 1) ? src[1] : 0;
+
+    *p++ = BASE64_ENC((C1 >> 2) & 0x3F, ct);
+    *p++ = BASE64_ENC((((C1 & 3) << 4) + (C2 >> 4)) & 0x3F, ct);
+
+    if (n > 1) {
+        *p++ = BASE64_ENC(((C2 & 15) << 2) & 0x3F, ct);
+    } else {
+        *p++ = '=';
+    }
+
+    *p++ = '=';
+
+    return p;
+}
+
 /*
  * Encode a buffer into base64 format
  */
-int base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
-				  const unsigned char *src, size_t slen)
+static int base64_encode_impl(unsigned char *dst, size_t dlen, size_t *olen,
+                              const unsigned char *src, size_t slen, int ct)
 {
-    size_t i, n;
-    int C1, C2, C3;
+    size_t n;
     unsigned char *p;
 
     if (slen == 0) {
@@ -81,36 +154,10 @@ int base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
         return BASE64_BUFFER_TOO_SMALL;
     }
 
-    n = (slen / 3) * 3;
-
-    for (i = 0, p = dst; i < n; i += 3) {
-        C1 = *src++;
-        C2 = *src++;
-        C3 = *src++;
-
-        *p++ = base64_enc_char((C1 >> 2) & 0x3F);
-        *p++ = base64_enc_char((((C1 &  3) << 4) + (C2 >> 4))
-                                          & 0x3F);
-        *p++ = base64_enc_char((((C2 & 15) << 2) + (C3 >> 6))
-                                          & 0x3F);
-        *p++ = base64_enc_char(C3 & 0x3F);
-    }
-
-    if (i < slen) {
-        C1 = *src++;
-        C2 = ((i + 1) < slen) ? *src++ : 0;
-
-        *p++ = base64_enc_char((C1 >> 2) & 0x3F);
-        *p++ = base64_enc_char((((C1 & 3) << 4) + (C2 >> 4))
-                                          & 0x3F);
-
-        if ((i + 1) < slen) {
-            *p++ = base64_enc_char(((C2 & 15) << 2) & 0x3F);
-        } else {
-            *p++ = '=';
-        }
+    p = base64_enc_groups(dst, src, slen / 3, ct);
 
-        *p++ = '=';
+    if (slen % 3 != 0) {
+        p = base64_enc_tail(p, src + (slen / 3) * 3, slen % 3, ct);
     }
 
     *olen = p - dst;
@@ -122,8 +169,8 @@ int base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
 /*
  * Decode a base64-formatted buffer
  */
-int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
-				  const unsigned char *src, size_t slen)
+static int base64_decode_impl(unsigned char *dst, size_t dlen, size_t *olen,
+                              const unsigned char *src, size_t slen, int ct)
 {
     size_t i; /* index in source */
     size_t n; /* number of digits or trailing = in source */
@@ -135,6 +182,14 @@ int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
 
     /* First pass: check for validity and get output length */
     for (i = n = 0; i < slen; i++) {
+        /* Table driven: skip whole groups of 4 digits at once */
+        while (!ct && equals == 0 && (slen - i) >= 4 &&
+               (base64_dec_map[src[i]] | base64_dec_map[src[i + 1]] |
+                base64_dec_map[src[i + 2]] | base64_dec_map[src[i + 3]]) >= 0) {
+            i += 4;
+            n += 4;
+        }
+
         /* Skip spaces before checking for EOL */
         spaces_present = 0;
         while (i < slen && src[i] == ' ') {
@@ -173,7 +228,7 @@ int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
             if (equals != 0) {
                 return BASE64_INVALID_CHARACTER;
             }
-            if (base64_dec_value(src[i]) < 0) {
+            if (BASE64_DEC(src[i], ct) < 0) {
                 return BASE64_INVALID_CHARACTER;
             }
         }
@@ -199,6 +254,25 @@ int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
 
     equals = 0;
     for (x = 0, p = dst; i > 0; i--, src++) {
+        /* Table driven: decode whole groups of 4 digits at once,
+         * the input is already validated */
+        if (!ct && accumulated_digits == 0) {
+            int a, b, c, d;
+            while (i >= 4 &&
+                   ((a = base64_dec_map[src[0]]) | (b = base64_dec_map[src[1]]) |
+                    (c = base64_dec_map[src[2]]) | (d = base64_dec_map[src[3]])) >= 0) {
+                x = ((uint32_t) a << 18) | ((uint32_t) b << 12) | ((uint32_t) c << 6) | (uint32_t) d;
+                *p++ = BASE64_BYTE_2(x);
+                *p++ = BASE64_BYTE_1(x);
+                *p++ = BASE64_BYTE_0(x);
+                src += 4;
+                i -= 4;
+            }
+            if (i == 0) {
+                break;
+            }
+        }
+
         if (*src == '\r' || *src == '\n' || *src == ' ') {
             continue;
         }
@@ -207,7 +281,7 @@ int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
         if (*src == '=') {
             ++equals;
         } else {
-            x |= base64_dec_value(*src);
+            x |= BASE64_DEC(*src, ct);
         }
 
         if (++accumulated_digits == 4) {
@@ -226,3 +300,205 @@ int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
 
     return 0;
 }
+
+int base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                  const unsigned char *src, size_t slen)
+{
+    return base64_encode_impl(dst, dlen, olen, src, slen, BASE64_CONSTANT_TIME);
+}
+
+int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
+                  const unsigned char *src, size_t slen)
+{
+    return base64_decode_impl(dst, dlen, olen, src, slen, BASE64_CONSTANT_TIME);
+}
+
+int base64_encode_ct(unsigned char *dst, size_t dlen, size_t *olen,
+                     const unsigned char *src, size_t slen)
+{
+    return base64_encode_impl(dst, dlen, olen, src, slen, 1);
+}
+
+int base64_decode_ct(unsigned char *dst, size_t dlen, size_t *olen,
+                     const unsigned char *src, size_t slen)
+{
+    return base64_decode_impl(dst, dlen, olen, src, slen, 1);
+}
+
+void base64_enc_init(base64_enc_ctx *ctx)
+{
+    ctx->len = 0;
+}
+
+/*
+ * Streaming encode, the leftover bytes of a partial group stay in ctx->buf
+ */
+int base64_enc_update(base64_enc_ctx *ctx, unsigned char *dst, size_t dlen,
+                      size_t *olen, const unsigned char *src, size_t slen)
+{
+    size_t n, fill;
+    unsigned char *p = dst;
+
+    if (slen > SIZE_MAX - 3 || (ctx->len + slen) / 3 > SIZE_MAX / 4) {
+        *olen = SIZE_MAX;
+        return BASE64_BUFFER_TOO_SMALL;
+    }
+
+    n = (ctx->len + slen) / 3;
+
+    if (dlen < n * 4 || (n > 0 && NULL == dst)) {
+        *olen = n * 4;
+        return BASE64_BUFFER_TOO_SMALL;
+    }
+
+    if (ctx->len > 0 && n > 0) {
+        fill = 3 - ctx->len;
+        memcpy(ctx->buf + ctx->len, src, fill);
+        p = base64_enc_groups(p, ctx->buf, 1, BASE64_CONSTANT_TIME);
+        src += fill;
+        slen -= fill;
+        ctx->len = 0;
+        n--;
+    }
+
+    p = base64_enc_groups(p, src, n, BASE64_CONSTANT_TIME);
+    src += n * 3;
+    slen -= n * 3;
+
+    memcpy(ctx->buf + ctx->len, src, slen);
+    ctx->len += slen;
+
+    *olen = p - dst;
+
+    return 0;
+}
+
+int base64_enc_finish(base64_enc_ctx *ctx, unsigned char *dst, size_t dlen,
+                      size_t *olen)
+{
+    if (ctx->len == 0) {
+        *olen = 0;
+        return 0;
+    }
+
+    if (dlen < 4 || NULL == dst) {
+        *olen = 4;
+        return BASE64_BUFFER_TOO_SMALL;
+    }
+
+    base64_enc_tail(dst, ctx->buf, ctx->len, BASE64_CONSTANT_TIME);
+    ctx->len = 0;
+    *olen = 4;
+
+    return 0;
+}
+
+/* ctx->equals after a padded group, nothing but spaces may follow */
+#define BASE64_DEC_PADDED 3
+
+void base64_dec_init(base64_dec_ctx *ctx)
+{
+    ctx->x = 0;
+    ctx->digits = 0;
+    ctx->equals = 0;
+}
+
+/*
+ * Streaming decode, the digits of a partial group stay in ctx->x
+ */
+int base64_dec_update(base64_dec_ctx *ctx, unsigned char *dst, size_t dlen,
+                      size_t *olen, const unsigned char *src, size_t slen)
+{
+    size_t n;
+    unsigned char *p = dst;
+    const int ct = BASE64_CONSTANT_TIME;
+
+    /* upper bound, spaces and padding make the output shorter */
+    n = (slen / 4 + (slen % 4 + ctx->digits) / 4) * 3;
+
+    if (dlen < n || (n > 0 && NULL == dst)) {
+        *olen = n;
+        return BASE64_BUFFER_TOO_SMALL;
+    }
+
+    while (slen > 0) {
+        /* Table driven: decode whole groups of 4 digits at once */
+        if (!ct && ctx->digits == 0 && ctx->equals == 0) {
+            int a, b, c, d;
+            while (slen >= 4 &&
+                   ((a = base64_dec_map[src[0]]) | (b = base64_dec_map[src[1]]) |
+                    (c = base64_dec_map[src[2]]) | (d = base64_dec_map[src[3]])) >= 0) {
+                uint32_t x = ((uint32_t) a << 18) | ((uint32_t) b << 12) | ((uint32_t) c << 6) | (uint32_t) d;
+                *p++ = BASE64_BYTE_2(x);
+                *p++ = BASE64_BYTE_1(x);
+                *p++ = BASE64_BYTE_0(x);
+                src += 4;
+                slen -= 4;
+            }
+            if (slen == 0) {
+                break;
+            }
+        }
+
+        unsigned char c = *src++;
+        slen--;
+
+        if (c == '\r' || c == '\n' || c == ' ') {
+            continue;
+        }
+
+        if (ctx->equals == BASE64_DEC_PADDED) {
+            goto invalid;
+        }
+
+        ctx->x <<= 6;
+        if (c == '=') {
+            /* only the last 1 or 2 digits of a group may be padding */
+            if (ctx->digits < 2) {
+                goto invalid;
+            }
+            ctx->equals++;
+        } else {
+            signed char v = BASE64_DEC(c, ct);
+            if (v < 0 || ctx->equals != 0) {
+                goto invalid;
+            }
+            ctx->x |= (uint32_t) v;
+        }
+
+        if (++ctx->digits == 4) {
+            *p++ = BASE64_BYTE_2(ctx->x);
+            if (ctx->equals <= 1) {
+                *p++ = BASE64_BYTE_1(ctx->x);
+            }
+            if (ctx->equals == 0) {
+                *p++ = BASE64_BYTE_0(ctx->x);
+            } else {
+                ctx->equals = BASE64_DEC_PADDED;
+            }
+            ctx->digits = 0;
+            ctx->x = 0;
+        }
+    }
+
+    *olen = p - dst;
+
+    return 0;
+
+invalid:
+    /* the groups before the invalid character are written */
+    *olen = p - dst;
+
+    return BASE64_INVALID_CHARACTER;
+}
+
+int base64_dec_finish(base64_dec_ctx *ctx)
+{
+    if (ctx->digits != 0) {
+        return BASE64_INVALID_CHARACTER;
+    }
+
+    base64_dec_init(ctx);
+
+    return 0;
+}
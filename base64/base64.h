@@ -2,12 +2,42 @@
 #define __BASE64_H__
 
 #include <stdio.h>
+#include <stdint.h>
+
+/**
+ * 1: base64_encode/base64_decode use the constant-time digit mapping (no
+ *    secret dependent table index), for keys and other secrets.
+ * 0: table driven, several times faster, for bulk data.
+ * base64_encode_ct/base64_decode_ct are always constant time.
+ */
+#ifndef BASE64_CONSTANT_TIME
+#define BASE64_CONSTANT_TIME 0
+#endif
 
 /** Output buffer too small. */
 #define BASE64_BUFFER_TOO_SMALL               -0x002A
 /** Invalid character in input. */
 #define BASE64_INVALID_CHARACTER              -0x002C
 
+/**
+ * \brief          Streaming encode context, carries the 0-2 input bytes
+ *                 that do not fill a 3 bytes group between calls
+ */
+typedef struct {
+    unsigned char buf[3];
+    size_t len;
+} base64_enc_ctx;
+
+/**
+ * \brief          Streaming decode context, carries the 0-3 digits that
+ *                 do not fill a 4 digits group between calls
+ */
+typedef struct {
+    uint32_t x;
+    uint32_t digits;
+    uint32_t equals;
+} base64_dec_ctx;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -54,6 +84,62 @@ int base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
 int base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
                   const unsigned char *src, size_t slen);
 
+/**
+ * \brief          Constant-time versions of base64_encode/base64_decode,
+ *                 same parameters and return values
+ */
+int base64_encode_ct(unsigned char *dst, size_t dlen, size_t *olen,
+                     const unsigned char *src, size_t slen);
+int base64_decode_ct(unsigned char *dst, size_t dlen, size_t *olen,
+                     const unsigned char *src, size_t slen);
+
+/**
+ * \brief          Start a streaming encode
+ */
+void base64_enc_init(base64_enc_ctx *ctx);
+
+/**
+ * \brief          Encode the next chunk, only whole 4 digits groups are
+ *                 written, no padding and no terminating zero
+ *
+ * \return         0 if successful, or BASE64_BUFFER_TOO_SMALL, then nothing
+ *                 is consumed and *olen is the required size.
+ */
+int base64_enc_update(base64_enc_ctx *ctx, unsigned char *dst, size_t dlen,
+                      size_t *olen, const unsigned char *src, size_t slen);
+
+/**
+ * \brief          Write the last group with '=' padding (0 or 4 digits)
+ *
+ * \return         0 if successful, or BASE64_BUFFER_TOO_SMALL.
+ */
+int base64_enc_finish(base64_enc_ctx *ctx, unsigned char *dst, size_t dlen,
+                      size_t *olen);
+
+/**
+ * \brief          Start a streaming decode
+ */
+void base64_dec_init(base64_dec_ctx *ctx);
+
+/**
+ * \brief          Decode the next chunk, ' ', '\r' and '\n' are skipped
+ *                 anywhere, chunks may split a 4 digits group
+ *
+ * \return         0 if successful, BASE64_BUFFER_TOO_SMALL, then nothing
+ *                 is consumed and *olen is the size needed at most, or
+ *                 BASE64_INVALID_CHARACTER, then *olen is the number of
+ *                 bytes of the groups before the invalid character and
+ *                 the context has to be restarted with base64_dec_init.
+ */
+int base64_dec_update(base64_dec_ctx *ctx, unsigned char *dst, size_t dlen,
+                      size_t *olen, const unsigned char *src, size_t slen);
+
+/**
+ * \brief          Check that the input ended on a whole 4 digits group
+ *
+ * \return         0 if successful, or BASE64_INVALID_CHARACTER.
+ */
+int base64_dec_finish(base64_dec_ctx *ctx);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,243 @@
+// host test of the one-shot, constant-time and streaming base64 paths, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "base64.h"
+
+#define MAX_LEN     (700)
+#define BENCH_LEN   (64 * 1024)
+
+static int s_fail;
+static uint32_t s_rand = 13;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(uint8_t *p, size_t len)
+{
+    for(size_t i = 0; i < len; i++) {
+        p[i] = rnd();
+    }
+}
+
+// next piece of a random split: often 0, often 1..5, sometimes large
+static size_t piece(size_t left)
+{
+    size_t n;
+    switch(rnd() % 4) {
+    case 0:  n = 0; break;
+    case 1:  n = 1 + rnd() % 5; break;
+    case 2:  n = 4 * (rnd() % 8); break;
+    default: n = rnd() % (left + 1); break;
+    }
+    return n < left ? n : left;
+}
+
+// streaming encode in random pieces, returns the digits written
+static size_t enc_stream(const uint8_t *src, size_t len, uint8_t *dst, size_t size)
+{
+    base64_enc_ctx ctx;
+    size_t off = 0, total = 0, olen;
+
+    base64_enc_init(&ctx);
+    while(off < len || rnd() % 3 == 0) {
+        size_t n = piece(len - off);
+        olen = 12345;
+        CHECK(base64_enc_update(&ctx, dst + total, size - total, &olen, src + off, n) == 0);
+        off += n;
+        total += olen;
+    }
+    CHECK(base64_enc_finish(&ctx, dst + total, size - total, &olen) == 0);
+    return total + olen;
+}
+
+// streaming decode in random pieces, -1 on an error
+static int dec_stream(const uint8_t *src, size_t len, uint8_t *dst, size_t size, size_t *olen)
+{
+    base64_dec_ctx ctx;
+    size_t off = 0, n;
+    int ret;
+
+    *olen = 0;
+    base64_dec_init(&ctx);
+    while(off < len || rnd() % 3 == 0) {
+        size_t out = 12345;
+        n = piece(len - off);
+        ret = base64_dec_update(&ctx, dst + *olen, size - *olen, &out, src + off, n);
+        *olen += out;
+        if(ret != 0) {
+            return -1;
+        }
+        off += n;
+    }
+    return base64_dec_finish(&ctx) == 0 ? 0 : -1;
+}
+
+// RFC 4648 section 10
+static void test_rfc4648(void)
+{
+    static const char *vec[][2] = {
+        { "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+        { "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" },
+    };
+    uint8_t buf[32];
+    size_t olen;
+
+    printf("RFC 4648 vectors through the table, _ct and streaming paths\n");
+    for(size_t i = 0; i < sizeof(vec) / sizeof(vec[0]); i++) {
+        const uint8_t *bin = (const uint8_t *)vec[i][0], *txt = (const uint8_t *)vec[i][1];
+        size_t bin_len = strlen(vec[i][0]), txt_len = strlen(vec[i][1]);
+
+        CHECK(base64_encode(buf, sizeof(buf), &olen, bin, bin_len) == 0);
+        CHECK(olen == txt_len && memcmp(buf, txt, olen) == 0);
+        CHECK(base64_encode_ct(buf, sizeof(buf), &olen, bin, bin_len) == 0);
+        CHECK(olen == txt_len && memcmp(buf, txt, olen) == 0);
+        olen = enc_stream(bin, bin_len, buf, sizeof(buf));
+        CHECK(olen == txt_len && memcmp(buf, txt, olen) == 0);
+
+        CHECK(base64_decode(buf, sizeof(buf), &olen, txt, txt_len) == 0);
+        CHECK(olen == bin_len && memcmp(buf, bin, olen) == 0);
+        CHECK(base64_decode_ct(buf, sizeof(buf), &olen, txt, txt_len) == 0);
+        CHECK(olen == bin_len && memcmp(buf, bin, olen) == 0);
+        CHECK(dec_stream(txt, txt_len, buf, sizeof(buf), &olen) == 0);
+        CHECK(olen == bin_len && memcmp(buf, bin, olen) == 0);
+    }
+}
+
+static void test_random(void)
+{
+    static uint8_t bin[MAX_LEN], txt[MAX_LEN * 2], ref[MAX_LEN * 2], out[MAX_LEN];
+    size_t olen, ref_len;
+
+    printf("random data, one-shot against _ct, streaming splits against one-shot\n");
+    for(int r = 0; r < 3000; r++) {
+        size_t len = r < 16 ? (size_t)r : rnd() % MAX_LEN;
+        fill(bin, len);
+
+        CHECK(base64_encode(ref, sizeof(ref), &ref_len, bin, len) == 0);
+        CHECK(base64_encode_ct(txt, sizeof(txt), &olen, bin, len) == 0);
+        CHECK(olen == ref_len && memcmp(txt, ref, olen) == 0);
+        olen = enc_stream(bin, len, txt, sizeof(txt));
+        CHECK(olen == ref_len && memcmp(txt, ref, olen) == 0);
+
+        CHECK(base64_decode(out, sizeof(out), &olen, ref, ref_len) == 0);
+        CHECK(olen == len && memcmp(out, bin, len) == 0);
+        CHECK(base64_decode_ct(out, sizeof(out), &olen, ref, ref_len) == 0);
+        CHECK(olen == len && memcmp(out, bin, len) == 0);
+        memset(out, 0, sizeof(out));
+        CHECK(dec_stream(ref, ref_len, out, sizeof(out), &olen) == 0);
+        CHECK(olen == len && memcmp(out, bin, len) == 0);
+    }
+}
+
+static void test_errors(void)
+{
+    uint8_t out[64];
+    size_t olen;
+    base64_dec_ctx ctx;
+
+    printf("invalid input, *olen on errors, short output buffer\n");
+    // the groups before the invalid character are written
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Zm9vYmFy*m9v", 12) == BASE64_INVALID_CHARACTER);
+    CHECK(olen == 6 && memcmp(out, "foobar", 6) == 0);
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Zm9", 3) == 0);
+    CHECK(olen == 0);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"vYm", 3) == 0);
+    CHECK(olen == 3 && memcmp(out, "foo", 3) == 0);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Fy\x80", 3) == BASE64_INVALID_CHARACTER);
+    CHECK(olen == 3 && memcmp(out, "bar", 3) == 0);
+    // padding only at the end of a group, nothing after it
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Zg==Zg==", 8) == BASE64_INVALID_CHARACTER);
+    CHECK(olen == 1 && out[0] == 'f');
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Z===", 4) == BASE64_INVALID_CHARACTER);
+    CHECK(olen == 0);
+    // truncated group
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Zm9vY", 5) == 0);
+    CHECK(base64_dec_finish(&ctx) == BASE64_INVALID_CHARACTER);
+    // spaces and line ends anywhere in the stream
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, sizeof(out), &olen, (const uint8_t *)"Zm 9v\r\nYm F y\n", 14) == 0);
+    CHECK(olen == 6 && memcmp(out, "foobar", 6) == 0);
+    CHECK(base64_dec_finish(&ctx) == 0);
+    // short output: nothing consumed, the size needed at most
+    base64_dec_init(&ctx);
+    CHECK(base64_dec_update(&ctx, out, 5, &olen, (const uint8_t *)"Zm9vYmFy", 8) == BASE64_BUFFER_TOO_SMALL);
+    CHECK(olen == 6);
+    CHECK(base64_dec_update(&ctx, out, 6, &olen, (const uint8_t *)"Zm9vYmFy", 8) == 0);
+    CHECK(olen == 6 && memcmp(out, "foobar", 6) == 0);
+    CHECK(base64_decode(out, sizeof(out), &olen, (const uint8_t *)"Zm9v*mFy", 8) == BASE64_INVALID_CHARACTER);
+    CHECK(base64_decode_ct(out, sizeof(out), &olen, (const uint8_t *)"Zm9v\x80mFy", 8) == BASE64_INVALID_CHARACTER);
+}
+
+typedef int (*b64_fn)(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen);
+
+static double mbps(b64_fn fn, uint8_t *dst, size_t dlen, const uint8_t *src, size_t slen)
+{
+    double t = now_s();
+    size_t olen;
+    int n;
+    for(n = 0; now_s() - t < 0.3; n++) {
+        fn(dst, dlen, &olen, src, slen);
+    }
+    return (double)n * slen / (now_s() - t) / 1e6;
+}
+
+// streaming decode in 256 digit chunks, as udp_music feeds a mac list
+static int dec_chunks(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen)
+{
+    base64_dec_ctx ctx;
+    size_t total = 0, out;
+    base64_dec_init(&ctx);
+    for(size_t off = 0; off < slen; off += 256) {
+        size_t n = slen - off < 256 ? slen - off : 256;
+        base64_dec_update(&ctx, dst + total, dlen - total, &out, src + off, n);
+        total += out;
+    }
+    *olen = total;
+    return base64_dec_finish(&ctx);
+}
+
+static void bench(void)
+{
+    static uint8_t bin[BENCH_LEN], txt[BENCH_LEN * 2], out[BENCH_LEN];
+    size_t txt_len;
+
+    fill(bin, sizeof(bin));
+    base64_encode(txt, sizeof(txt), &txt_len, bin, sizeof(bin));
+    printf("bench %d KB, MB/s of input, BASE64_CONSTANT_TIME %d\n", BENCH_LEN / 1024, BASE64_CONSTANT_TIME);
+    printf("  encode %.0f MB/s, encode_ct %.0f MB/s\n",
+           mbps(base64_encode, txt, sizeof(txt), bin, sizeof(bin)),
+           mbps(base64_encode_ct, txt, sizeof(txt), bin, sizeof(bin)));
+    printf("  decode %.0f MB/s, decode_ct %.0f MB/s, streaming decode 256 digit chunks %.0f MB/s\n",
+           mbps(base64_decode, out, sizeof(out), txt, txt_len),
+           mbps(base64_decode_ct, out, sizeof(out), txt, txt_len),
+           mbps(dec_chunks, out, sizeof(out), txt, txt_len));
+}
+
+int main(void)
+{
+    test_rfc4648();
+    test_random();
+    test_errors();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+// host cross-check and throughput test of crc, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+#include "crc16.h"
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// bit by bit references
+static uint16_t ref_modbus(uint16_t crc, const uint8_t *p, uint32_t len)
+{
+    while(len--) {
+        crc ^= *p++;
+        for(int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t ref_ccitt(uint16_t crc, const uint8_t *p, uint32_t len)
+{
+    while(len--) {
+        crc ^= *p++ << 8;
+        for(int k = 0; k < 8; k++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t ref_crc32(uint32_t crc, const uint8_t *p, uint32_t len)
+{
+    crc = ~crc;
+    while(len--) {
+        crc ^= *p++;
+        for(int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+// byte at a time tables, the loops crc16_modbus, chip_ota_get_crc and mz_crc32 used before
+static uint16_t s_modbus_tab[256], s_ccitt_tab[256];
+static uint32_t s_crc32_tab[256];
+
+static void byte_tables(void)
+{
+    for(int i = 0; i < 256; i++) {
+        uint8_t b = i;
+        s_modbus_tab[i] = ref_modbus(0, &b, 1);
+        s_ccitt_tab[i] = ref_ccitt(0, &b, 1);
+        s_crc32_tab[i] = ~ref_crc32(0xFFFFFFFF, &b, 1);
+    }
+}
+
+static uint16_t byte_modbus(uint16_t crc, const uint8_t *p, uint32_t len)
+{
+    while(len--) {
+        crc = (crc >> 8) ^ s_modbus_tab[(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+static uint16_t byte_ccitt(uint16_t crc, const uint8_t *p, uint32_t len)
+{
+    while(len--) {
+        crc = (crc << 8) ^ s_ccitt_tab[((crc >> 8) ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+static uint32_t byte_crc32(uint32_t crc, const uint8_t *p, uint32_t len)
+{
+    crc = ~crc;
+    while(len--) {
+        crc = (crc >> 8) ^ s_crc32_tab[(crc ^ *p++) & 0xFF];
+    }
+    return ~crc;
+}
+
+static void test_check_values(void)
+{
+    printf("check values\n");
+    const uint8_t *s = (const uint8_t *)"123456789";
+    CHECK(crc16_modbus_update(CRC16_MODBUS_INIT, s, 9) == 0x4B37);
+    CHECK(crc16_ccitt_update(CRC16_CCITT_INIT, s, 9) == 0x31C3);
+    CHECK(crc32_ieee_update(CRC32_IEEE_INIT, s, 9) == 0xCBF43926);
+    CHECK(crc16_modbus((uint8_t *)s, 9) == 0x4B37);   // the crc16 component wrapper
+    CHECK(crc16_modbus_update(CRC16_MODBUS_INIT, s, 0) == CRC16_MODBUS_INIT);
+    CHECK(crc32_ieee_update(CRC32_IEEE_INIT, s, 0) == 0);
+}
+
+// random lengths and misaligned starts, split at a random point: update and combine agree with one pass
+static void test_random(void)
+{
+    printf("random buffers, update, combine\n");
+    static uint8_t buf[4096 + 8];
+    for(int n = 0; n < 20000; n++) {
+        uint32_t len = rnd() % 4096, off = rnd() % 8, cut = len ? rnd() % (len + 1) : 0;
+        uint8_t *p = buf + off;
+        for(uint32_t i = 0; i < len; i++) {
+            p[i] = rnd();
+        }
+        uint16_t m = ref_modbus(CRC16_MODBUS_INIT, p, len);
+        uint16_t c = ref_ccitt(CRC16_CCITT_INIT, p, len);
+        uint32_t z = ref_crc32(CRC32_IEEE_INIT, p, len);
+        CHECK(crc16_modbus_update(CRC16_MODBUS_INIT, p, len) == m);
+        CHECK(crc16_ccitt_update(CRC16_CCITT_INIT, p, len) == c);
+        CHECK(crc32_ieee_update(CRC32_IEEE_INIT, p, len) == z);
+
+        uint16_t m1 = crc16_modbus_update(CRC16_MODBUS_INIT, p, cut);
+        uint16_t c1 = crc16_ccitt_update(CRC16_CCITT_INIT, p, cut);
+        uint32_t z1 = crc32_ieee_update(CRC32_IEEE_INIT, p, cut);
+        CHECK(crc16_modbus_update(m1, p + cut, len - cut) == m);
+        CHECK(crc16_ccitt_update(c1, p + cut, len - cut) == c);
+        CHECK(crc32_ieee_update(z1, p + cut, len - cut) == z);
+
+        uint16_t m2 = crc16_modbus_update(CRC16_MODBUS_INIT, p + cut, len - cut);
+        uint16_t c2 = crc16_ccitt_update(CRC16_CCITT_INIT, p + cut, len - cut);
+        uint32_t z2 = crc32_ieee_update(CRC32_IEEE_INIT, p + cut, len - cut);
+        CHECK(crc16_modbus_combine(m1, m2, len - cut) == m);
+        CHECK(crc16_ccitt_combine(c1, c2, len - cut) == c);
+        CHECK(crc32_ieee_combine(z1, z2, len - cut) == z);
+        if(s_fail) {
+            printf("  len %u, offset %u, cut %u\n", len, off, cut);
+            return;
+        }
+    }
+}
+
+static void bench(void)
+{
+    enum { LEN = 64 * 1024, ROUNDS = 2000 };
+    static uint8_t buf[LEN];
+    for(int i = 0; i < LEN; i++) {
+        buf[i] = rnd();
+    }
+    double mb = (double)LEN * ROUNDS / 1e6;
+    uint32_t sum = 0;
+    double t = now_s();
+    for(int r = 0; r < ROUNDS; r++) sum += crc16_modbus_update(CRC16_MODBUS_INIT, buf, LEN);
+    double a = now_s() - t;
+    t = now_s();
+    for(int r = 0; r < ROUNDS; r++) sum += byte_modbus(CRC16_MODBUS_INIT, buf, LEN);
+    double b = now_s() - t;
+    printf("bench crc16 modbus: %.0f MB/s, byte table %.0f MB/s\n", mb / a, mb / b);
+    t = now_s();
+    for(int r = 0; r < ROUNDS; r++) sum += crc16_ccitt_update(CRC16_CCITT_INIT, buf, LEN);
+    a = now_s() - t;
+    t = now_s();
+    for(int r = 0; r < ROUNDS; r++) sum += byte_ccitt(CRC16_CCITT_INIT, buf, LEN);
+    b = now_s() - t;
+    printf("bench crc16 ccitt:  %.0f MB/s, byte table %.0f MB/s\n", mb / a, mb / b);
+    t = now_s();
+    for(int r = 0; r < ROUNDS; r++) sum += crc32_ieee_update(CRC32_IEEE_INIT, buf, LEN);
+    a = now_s() - t;
+    t = now_s();
+    for(int r = 0; r < ROUNDS; r++) sum += byte_crc32(CRC32_IEEE_INIT, buf, LEN);
+    b = now_s() - t;
+    printf("bench crc32:        %.0f MB/s, byte table %.0f MB/s (%u)\n", mb / a, mb / b, sum & 1);
+}
+
+int main(void)
+{
+    byte_tables();
+    test_check_values();
+    test_random();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include "stdint.h"
+
+#define CRC16_MODBUS_INIT (0xFFFF)     // poly 0x8005 reflected, no xorout
+#define CRC16_CCITT_INIT  (0x0000)     // poly 0x1021, XMODEM, no xorout
+#define CRC32_IEEE_INIT   (0x00000000) // poly 0x04C11DB7 reflected, zlib / gzip compatible
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// update: crc is CRC*_INIT for the first chunk, or the result of the previous chunk
+uint16_t crc16_modbus_update(uint16_t crc, const uint8_t* data, uint32_t len);
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* data, uint32_t len);
+uint32_t crc32_ieee_update(uint32_t crc, const uint8_t* data, uint32_t len);
+
+// combine: crc of A+B from crc1 of A and crc2 of B (len2 bytes), both started from CRC*_INIT
+uint16_t crc16_modbus_combine(uint16_t crc1, uint16_t crc2, uint32_t len2);
+uint16_t crc16_ccitt_combine(uint16_t crc1, uint16_t crc2, uint32_t len2);
+uint32_t crc32_ieee_combine(uint32_t crc1, uint32_t crc2, uint32_t len2);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CRC_H__
@@ -0,0 +1,13 @@
+// byte-oriented reference AES for the host tests, see aes_ref.c
+#ifndef AES_REF_H
+#define AES_REF_H
+
+#include "aes.h"
+
+int aes_ref_set_encrypt_key(AES_KEY *aes_key, const uint8_t *key, size_t keylen);
+int aes_ref_set_decrypt_key(AES_KEY *aes_key, const uint8_t *key, size_t keylen);
+void aes_ref_encrypt(const AES_KEY *key, const uint8_t in[16], uint8_t out[16]);
+void aes_ref_decrypt(const AES_KEY *aes_key, const uint8_t in[16], uint8_t out[16]);
+void aes_ref_ctr_encrypt(const AES_KEY *key, uint8_t ctr[16], const uint8_t *in, size_t inlen, uint8_t *out);
+
+#endif
@@ -0,0 +1,170 @@
+// host test of the T-table AES and batched CTR against the old byte-oriented AES, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aes.h"
+#include "aes_ref.h"
+
+#define BENCH_LEN   (64 * 1024)
+
+static int s_fail;
+static uint32_t s_rand = 3;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(uint8_t *p, size_t len)
+{
+    for(size_t i = 0; i < len; i++) {
+        p[i] = rnd();
+    }
+}
+
+// FIPS-197 appendix C
+static void test_fips197(void)
+{
+    static const uint8_t pt[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+    };
+    static const uint8_t ct[3][16] = {
+        { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a },
+        { 0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91 },
+        { 0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89 },
+    };
+    uint8_t key[32], buf[16];
+    AES_KEY k;
+
+    printf("FIPS-197 known answers\n");
+    for(int i = 0; i < 32; i++) {
+        key[i] = i;
+    }
+    for(int i = 0; i < 3; i++) {
+        size_t keylen = 16 + 8 * i;
+        CHECK(aes_set_encrypt_key(&k, key, keylen) == 1);
+        aes_encrypt(&k, pt, buf);
+        CHECK(memcmp(buf, ct[i], 16) == 0);
+        CHECK(aes_set_decrypt_key(&k, key, keylen) == 1);
+        aes_decrypt(&k, ct[i], buf);
+        CHECK(memcmp(buf, pt, 16) == 0);
+    }
+}
+
+static void test_blocks(void)
+{
+    uint8_t key[32], in[16], a[16], b[16];
+    AES_KEY k, rk;
+
+    printf("encrypt/decrypt against the old AES, 128/192/256 bit keys\n");
+    for(int r = 0; r < 3000; r++) {
+        size_t keylen = 16 + 8 * (r % 3);
+        fill(key, keylen);
+        fill(in, 16);
+        aes_set_encrypt_key(&k, key, keylen);
+        aes_ref_set_encrypt_key(&rk, key, keylen);
+        aes_encrypt(&k, in, a);
+        aes_ref_encrypt(&rk, in, b);
+        CHECK(memcmp(a, b, 16) == 0);
+        aes_set_decrypt_key(&k, key, keylen);
+        aes_ref_set_decrypt_key(&rk, key, keylen);
+        aes_decrypt(&k, in, a);
+        aes_ref_decrypt(&rk, in, b);
+        CHECK(memcmp(a, b, 16) == 0);
+    }
+}
+
+// unaligned in and out, in place, lengths around the 4-block batch, counter wrap
+static void test_ctr(void)
+{
+    static uint8_t src[300 + 8], dst[300 + 8], ref[300];
+    uint8_t key[32], ctr[16], ctr_ref[16], ctr0[16];
+    AES_KEY k, rk;
+
+    printf("CTR against the old per-block CTR, unaligned, in place, counter wrap\n");
+    for(int r = 0; r < 3000; r++) {
+        size_t keylen = 16 + 8 * (r % 3);
+        size_t len = rnd() % 2 ? rnd() % 80 : rnd() % 300;
+        size_t ioff = rnd() % 8, ooff = rnd() % 8;
+        int in_place = rnd() % 4 == 0;
+
+        fill(key, keylen);
+        fill(ctr0, 16);
+        if(rnd() % 4 == 0) {
+            size_t p = 8 + rnd() % 8;
+            memset(ctr0 + p, 0xff, 16 - p);             // the carry runs through several bytes
+        }
+        fill(src + ioff, len);
+        aes_set_encrypt_key(&k, key, keylen);
+        aes_ref_set_encrypt_key(&rk, key, keylen);
+
+        memcpy(ctr_ref, ctr0, 16);
+        aes_ref_ctr_encrypt(&rk, ctr_ref, src + ioff, len, ref);
+
+        memcpy(ctr, ctr0, 16);
+        if(in_place) {
+            aes_ctr_encrypt(&k, ctr, src + ioff, len, src + ioff);
+            CHECK(memcmp(src + ioff, ref, len) == 0);
+        } else {
+            aes_ctr_encrypt(&k, ctr, src + ioff, len, dst + ooff);
+            CHECK(memcmp(dst + ooff, ref, len) == 0);
+        }
+        CHECK(memcmp(ctr, ctr_ref, 16) == 0);
+    }
+}
+
+static void bench(void)
+{
+    static uint8_t buf[BENCH_LEN + 1];
+    uint8_t key[16], ctr[16] = {0};
+    AES_KEY k, rk;
+    double t, mb_old, mb_new, mb_new_u;
+    int n;
+
+    fill(key, 16);
+    fill(buf, sizeof(buf));
+    aes_set_encrypt_key(&k, key, 16);
+    aes_ref_set_encrypt_key(&rk, key, 16);
+
+    t = now_s();
+    for(n = 0; now_s() - t < 0.5; n++) {
+        aes_ref_ctr_encrypt(&rk, ctr, buf, BENCH_LEN, buf);
+    }
+    mb_old = (double)n * BENCH_LEN / (now_s() - t) / 1e6;
+
+    t = now_s();
+    for(n = 0; now_s() - t < 0.5; n++) {
+        aes_ctr_encrypt(&k, ctr, buf, BENCH_LEN, buf);
+    }
+    mb_new = (double)n * BENCH_LEN / (now_s() - t) / 1e6;
+
+    t = now_s();
+    for(n = 0; now_s() - t < 0.5; n++) {
+        aes_ctr_encrypt(&k, ctr, buf + 1, BENCH_LEN, buf + 1);
+    }
+    mb_new_u = (double)n * BENCH_LEN / (now_s() - t) / 1e6;
+
+    printf("bench AES-128-CTR %d KB in place: old %.0f MB/s, new %.0f MB/s (%.1fx), new unaligned %.0f MB/s\n",
+           BENCH_LEN / 1024, mb_old, mb_new, mb_new / mb_old, mb_new_u);
+}
+
+int main(void)
+{
+    test_fips197();
+    test_blocks();
+    test_ctr();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+// host test of the BLOCK_CIPHER_CTX stream API against one-shot encryption, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "block_cipher.h"
+#include "gcm.h"
+
+#define MAX_LEN     (1200)
+#define MAX_PIECES  (8)
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(uint8_t *p, size_t len)
+{
+    for(size_t i = 0; i < len; i++) {
+        p[i] = rnd();
+    }
+}
+
+static const char *s_mode_name[] = { "", "CBC", "CTR", "GCM" };
+
+// one-shot references built on the single block functions and gcm_encrypt, padded CBC
+static size_t ref_encrypt(const BLOCK_CIPHER *cipher, int mode, const uint8_t *key, const uint8_t *iv, size_t ivlen,
+    const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen, uint8_t *out, uint8_t tag[16])
+{
+    BLOCK_CIPHER_KEY k;
+    uint8_t x[16], ks[16];
+    block_cipher_set_encrypt_key(&k, cipher, key);
+    switch(mode) {
+    case BLOCK_CIPHER_MODE_CBC: {
+        size_t pad = 16 - inlen % 16;
+        memcpy(x, iv, 16);
+        for(size_t i = 0; i < inlen + pad; i++) {
+            x[i % 16] ^= i < inlen ? in[i] : (uint8_t)pad;
+            if(i % 16 == 15) {
+                block_cipher_encrypt(&k, x, x);
+                memcpy(out + i - 15, x, 16);
+            }
+        }
+        return inlen + pad;
+    }
+    case BLOCK_CIPHER_MODE_CTR:
+        memcpy(x, iv, 16);
+        for(size_t i = 0; i < inlen; i++) {
+            if(i % 16 == 0) {
+                block_cipher_encrypt(&k, x, ks);
+                for(int j = 15; j >= 0 && ++x[j] == 0; j--);
+            }
+            out[i] = in[i] ^ ks[i % 16];
+        }
+        return inlen;
+    default:
+        gcm_encrypt(&k, iv, ivlen, aad, aadlen, in, inlen, out, 16, tag);
+        return inlen;
+    }
+}
+
+// random iovec lists over a buffer
+static size_t split(BLOCK_CIPHER_IOV *iov, uint8_t *base, size_t len)
+{
+    size_t cnt = 0;
+    while(len && cnt < MAX_PIECES - 1) {
+        size_t n = rnd() % 2 ? rnd() % 40 : rnd() % (len + 1);
+        n = n > len ? len : n;
+        iov[cnt].base = base;
+        iov[cnt++].len = n;
+        base += n;
+        len -= n;
+    }
+    iov[cnt].base = base;
+    iov[cnt++].len = len;
+    return cnt;
+}
+
+typedef struct {
+    size_t calls;
+    size_t pieces;
+} feed_stat_t;
+
+// feeds in[0, inlen) in random calls of update or updatev, out may equal in for the stream modes
+static size_t feed(BLOCK_CIPHER_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t outsize, feed_stat_t *st)
+{
+    size_t done = 0, produced = 0, outlen;
+    while(done < inlen) {
+        size_t n = rnd() % 3 ? rnd() % 100 : rnd() % (inlen - done + 1);
+        n = n > inlen - done ? inlen - done : n;
+        int ret;
+        if(rnd() % 2) {
+            ret = block_cipher_ctx_update(ctx, in + done, n, out + produced, &outlen);
+            st->pieces += 2;
+        } else {
+            BLOCK_CIPHER_IOV iv_in[MAX_PIECES], iv_out[MAX_PIECES];
+            size_t ci = split(iv_in, (uint8_t *)in + done, n);
+            size_t co = split(iv_out, out + produced, outsize - produced);
+            ret = block_cipher_ctx_updatev(ctx, iv_in, ci, iv_out, co, &outlen);
+            st->pieces += ci + co;
+        }
+        CHECK(ret == 1);
+        st->calls++;
+        done += n;
+        produced += outlen;
+    }
+    CHECK(block_cipher_ctx_finish(ctx, out + produced, &outlen) == 1);
+    return produced + outlen;
+}
+
+// CBC in place, one updatev whose out list mirrors the in list
+static size_t feed_cbc_in_place(BLOCK_CIPHER_CTX *ctx, uint8_t *buf, size_t inlen)
+{
+    BLOCK_CIPHER_IOV iov[MAX_PIECES];
+    size_t cnt = split(iov, buf, inlen), outlen, last;
+    CHECK(block_cipher_ctx_updatev(ctx, iov, cnt, iov, cnt, &outlen) == 1);
+    CHECK(block_cipher_ctx_finish(ctx, buf + outlen, &last) == 1);
+    return outlen + last;
+}
+
+static void test_cipher(const BLOCK_CIPHER *cipher, const char *name)
+{
+    static uint8_t msg[MAX_LEN], ref[MAX_LEN + 16], out[MAX_LEN + 16], buf[MAX_LEN + 16];
+    uint8_t key[16], iv[40], aad[64], tag[16], t[16];
+    for(int mode = BLOCK_CIPHER_MODE_CBC; mode <= BLOCK_CIPHER_MODE_GCM; mode++) {
+        size_t copied = 0, staged_max = 0, bytes = 0;
+        for(int n = 0; n < 3000; n++) {
+            size_t inlen = rnd() % 4 ? rnd() % MAX_LEN : (rnd() % (MAX_LEN / 16)) * 16;
+            size_t ivlen = mode != BLOCK_CIPHER_MODE_GCM ? 16 : rnd() % 2 ? 12 : rnd() % 40 + 1;
+            size_t aadlen = mode == BLOCK_CIPHER_MODE_GCM ? rnd() % sizeof(aad) : 0;
+            fill(key, 16);
+            fill(iv, ivlen);
+            fill(aad, aadlen);
+            fill(msg, inlen);
+            size_t clen = ref_encrypt(cipher, mode, key, iv, ivlen, aad, aadlen, msg, inlen, ref, tag);
+            int in_place = rnd() % 3 == 0;
+            BLOCK_CIPHER_CTX ctx;
+            feed_stat_t st = { 0, 0 };
+            size_t len;
+
+            // encrypt
+            CHECK(block_cipher_ctx_init(&ctx, cipher, mode, 1, key, iv, ivlen) == 1);
+            if(aadlen) {
+                size_t cut = rnd() % (aadlen + 1);
+                CHECK(block_cipher_ctx_aad(&ctx, aad, cut) == 1 && block_cipher_ctx_aad(&ctx, aad + cut, aadlen - cut) == 1);
+            }
+            memcpy(buf, msg, inlen);
+            if(in_place && mode == BLOCK_CIPHER_MODE_CBC) {
+                len = feed_cbc_in_place(&ctx, buf, inlen);
+            } else {
+                len = feed(&ctx, buf, inlen, in_place ? buf : out, sizeof(out), &st);
+            }
+            const uint8_t *c = in_place ? buf : out;
+            CHECK(len == clen && memcmp(c, ref, clen) == 0);
+            if(mode == BLOCK_CIPHER_MODE_GCM) {
+                CHECK(block_cipher_ctx_get_tag(&ctx, t, 16) == 1 && memcmp(t, tag, 16) == 0);
+            } else {
+                CHECK(block_cipher_ctx_get_tag(&ctx, t, 16) == -1);
+            }
+            if(mode != BLOCK_CIPHER_MODE_CBC) {
+                CHECK(ctx.copy_bytes == 0);
+            } else if(!in_place) {
+                // at most a partial block staged per in piece and one bounce per out piece
+                CHECK(ctx.copy_bytes <= 32 * st.pieces);
+            }
+            copied += ctx.copy_bytes;
+            bytes += inlen;
+            staged_max = ctx.copy_bytes > staged_max ? ctx.copy_bytes : staged_max;
+
+            // decrypt
+            CHECK(block_cipher_ctx_init(&ctx, cipher, mode, 0, key, iv, ivlen) == 1);
+            if(aadlen) {
+                CHECK(block_cipher_ctx_aad(&ctx, aad, aadlen) == 1);
+            }
+            memcpy(buf, ref, clen);
+            if(in_place && mode == BLOCK_CIPHER_MODE_CBC) {
+                len = feed_cbc_in_place(&ctx, buf, clen);
+            } else {
+                len = feed(&ctx, buf, clen, in_place ? buf : out, sizeof(out), &st);
+            }
+            CHECK(len == inlen && memcmp(in_place ? buf : out, msg, inlen) == 0);
+            if(mode == BLOCK_CIPHER_MODE_GCM) {
+                CHECK(block_cipher_ctx_verify_tag(&ctx, tag, 16) == 1);
+                tag[rnd() % 16] ^= 1 << rnd() % 8;
+                CHECK(block_cipher_ctx_verify_tag(&ctx, tag, 16) == -1);
+            }
+            if(s_fail) {
+                printf("  %s-%s %s, len %zu, ivlen %zu, aadlen %zu\n", name, s_mode_name[mode], in_place ? "in place" : "", inlen, ivlen, aadlen);
+                return;
+            }
+        }
+        printf("  %s-%s: staged %.2f%% of %zu bytes, at most %zu per message\n", name, s_mode_name[mode],
+            100.0 * copied / bytes, bytes, staged_max);
+    }
+}
+
+static void test_errors(void)
+{
+    printf("invalid parameters\n");
+    uint8_t key[16] = { 0 }, iv[16] = { 0 }, buf[32];
+    size_t outlen;
+    BLOCK_CIPHER_CTX ctx;
+    CHECK(block_cipher_ctx_init(&ctx, BLOCK_CIPHER_sm4(), BLOCK_CIPHER_MODE_CBC, 1, key, iv, 12) == -1);
+    CHECK(block_cipher_ctx_init(&ctx, BLOCK_CIPHER_sm4(), 9, 1, key, iv, 16) == -1);
+    CHECK(block_cipher_ctx_init(&ctx, BLOCK_CIPHER_sm4(), BLOCK_CIPHER_MODE_CTR, 1, key, iv, 16) == 1);
+    CHECK(block_cipher_ctx_aad(&ctx, buf, 4) == -1);
+    // CBC decrypt of a truncated ciphertext fails in finish
+    CHECK(block_cipher_ctx_init(&ctx, BLOCK_CIPHER_sm4(), BLOCK_CIPHER_MODE_CBC, 0, key, iv, 16) == 1);
+    CHECK(block_cipher_ctx_update(&ctx, buf, 20, buf, &outlen) == 1 && outlen == 16);
+    CHECK(block_cipher_ctx_finish(&ctx, buf, &outlen) == -1);
+    // updatev refuses an out list shorter than the output
+    BLOCK_CIPHER_IOV in = { buf, 32 }, out = { buf, 16 };
+    CHECK(block_cipher_ctx_init(&ctx, BLOCK_CIPHER_sm4(), BLOCK_CIPHER_MODE_CTR, 1, key, iv, 16) == 1);
+    CHECK(block_cipher_ctx_updatev(&ctx, &in, 1, &out, 1, &outlen) == -1);
+}
+
+// 1500 byte packets streamed through update against one gcm_encrypt call per message
+static void bench(void)
+{
+    enum { LEN = 16 * 1024, PACKET = 1500, ROUNDS = 400 };
+    static uint8_t buf[LEN], out[LEN + 16];
+    uint8_t key[16], iv[16], tag[16];
+    fill(buf, LEN);
+    fill(key, 16);
+    fill(iv, 16);
+    double mb = (double)LEN * ROUNDS / 1e6;
+    const BLOCK_CIPHER *ciphers[2] = { BLOCK_CIPHER_sm4(), BLOCK_CIPHER_aes128() };
+    static const char *names[2] = { "SM4", "AES-128" };
+    for(int i = 0; i < 2; i++) {
+        for(int mode = BLOCK_CIPHER_MODE_CBC; mode <= BLOCK_CIPHER_MODE_GCM; mode++) {
+            BLOCK_CIPHER_CTX ctx;
+            size_t outlen, copied = 0;
+            double t = now_s();
+            for(int r = 0; r < ROUNDS; r++) {
+                size_t produced = 0;
+                block_cipher_ctx_init(&ctx, ciphers[i], mode, 1, key, iv, mode == BLOCK_CIPHER_MODE_GCM ? 12 : 16);
+                for(size_t done = 0; done < LEN; done += PACKET) {
+                    size_t n = LEN - done < PACKET ? LEN - done : PACKET;
+                    block_cipher_ctx_update(&ctx, buf + done, n, out + produced, &outlen);
+                    produced += outlen;
+                }
+                block_cipher_ctx_finish(&ctx, out + produced, &outlen);
+                copied += ctx.copy_bytes;
+            }
+            double s = now_s() - t;
+            printf("bench %s-%s stream, %d byte packets: %.0f MB/s, staged %.2f%%", names[i],
+                s_mode_name[mode], PACKET, mb / s, 100.0 * copied / LEN / ROUNDS);
+            if(mode == BLOCK_CIPHER_MODE_GCM) {
+                BLOCK_CIPHER_KEY k;
+                block_cipher_set_encrypt_key(&k, ciphers[i], key);
+                t = now_s();
+                for(int r = 0; r < ROUNDS; r++) {
+                    gcm_encrypt(&k, iv, 12, NULL, 0, buf, LEN, out, 16, tag);
+                }
+                printf(", one-shot gcm_encrypt %.0f MB/s (%u)", mb / (now_s() - t), tag[0] & 1);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main(void)
+{
+    printf("stream against one-shot, random pieces, iovec lists, in place\n");
+    test_cipher(BLOCK_CIPHER_sm4(), "SM4");
+    test_cipher(BLOCK_CIPHER_aes128(), "AES-128");
+    test_errors();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+// host test of SM4_GCM_CTX / AES_GCM_CTX against sm4_gcm_encrypt / aes_gcm_encrypt, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "block_cipher.h"
+#include "sm4.h"
+#include "aes.h"
+
+#define MAX_LEN     (700)
+#define ROUNDS      (300)
+
+static int s_fail;
+static uint32_t s_rand = 7;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static void fill(uint8_t *p, size_t len)
+{
+    for(size_t i = 0; i < len; i++) {
+        p[i] = rnd();
+    }
+}
+
+// next piece of a random split: often 0, often 1..15, sometimes large
+static size_t piece(size_t left)
+{
+    size_t n;
+    switch(rnd() % 4) {
+    case 0:  n = 0; break;
+    case 1:  n = 1 + rnd() % 15; break;
+    case 2:  n = 16 * (rnd() % 4); break;
+    default: n = rnd() % (left + 1); break;
+    }
+    return n < left ? n : left;
+}
+
+typedef struct {
+    const char *name;
+    size_t keylen;      // 0 for SM4
+} gcm_case_t;
+
+static int ctx_init(const gcm_case_t *c, BLOCK_CIPHER_CTX *ctx, int enc, const uint8_t *key, const uint8_t *iv, size_t ivlen)
+{
+    if(c->keylen == 0) {
+        return enc ? sm4_gcm_encrypt_init(ctx, key, iv, ivlen) : sm4_gcm_decrypt_init(ctx, key, iv, ivlen);
+    }
+    return enc ? aes_gcm_encrypt_init(ctx, key, c->keylen, iv, ivlen) : aes_gcm_decrypt_init(ctx, key, c->keylen, iv, ivlen);
+}
+
+static int ctx_aad(const gcm_case_t *c, BLOCK_CIPHER_CTX *ctx, const uint8_t *aad, size_t len)
+{
+    return c->keylen == 0 ? sm4_gcm_encrypt_aad(ctx, aad, len) : aes_gcm_encrypt_aad(ctx, aad, len);
+}
+
+static int ctx_update(const gcm_case_t *c, BLOCK_CIPHER_CTX *ctx, int enc, const uint8_t *in, size_t len, uint8_t *out, size_t *outlen)
+{
+    if(c->keylen == 0) {
+        return enc ? sm4_gcm_encrypt_update(ctx, in, len, out, outlen) : sm4_gcm_decrypt_update(ctx, in, len, out, outlen);
+    }
+    return enc ? aes_gcm_encrypt_update(ctx, in, len, out, outlen) : aes_gcm_decrypt_update(ctx, in, len, out, outlen);
+}
+
+static int ctx_encrypt_finish(const gcm_case_t *c, BLOCK_CIPHER_CTX *ctx, uint8_t *out, size_t *outlen, size_t taglen, uint8_t *tag)
+{
+    return c->keylen == 0 ? sm4_gcm_encrypt_finish(ctx, out, outlen, taglen, tag)
+                          : aes_gcm_encrypt_finish(ctx, out, outlen, taglen, tag);
+}
+
+static int ctx_decrypt_finish(const gcm_case_t *c, BLOCK_CIPHER_CTX *ctx, const uint8_t *tag, size_t taglen, uint8_t *out, size_t *outlen)
+{
+    return c->keylen == 0 ? sm4_gcm_decrypt_finish(ctx, tag, taglen, out, outlen)
+                          : aes_gcm_decrypt_finish(ctx, tag, taglen, out, outlen);
+}
+
+static void one_shot(const gcm_case_t *c, const uint8_t *key, const uint8_t *iv, size_t ivlen,
+    const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen, uint8_t *out, size_t taglen, uint8_t *tag)
+{
+    if(c->keylen == 0) {
+        SM4_KEY k;
+        sm4_set_encrypt_key(&k, key);
+        CHECK(sm4_gcm_encrypt(&k, iv, ivlen, aad, aadlen, in, inlen, out, taglen, tag) == 1);
+    } else {
+        AES_KEY k;
+        aes_set_encrypt_key(&k, key, c->keylen);
+        CHECK(aes_gcm_encrypt(&k, iv, ivlen, aad, aadlen, in, inlen, out, taglen, tag) == 1);
+    }
+}
+
+// feeds aad and in through the context in random pieces, in place when in == out
+static size_t stream(const gcm_case_t *c, BLOCK_CIPHER_CTX *ctx, int enc,
+    const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen, uint8_t *out)
+{
+    size_t off = 0, total = 0, outlen;
+    while(off < aadlen || rnd() % 3 == 0) {
+        size_t n = piece(aadlen - off);
+        CHECK(ctx_aad(c, ctx, aad + off, n) == 1);
+        off += n;
+    }
+    off = 0;
+    while(off < inlen || rnd() % 3 == 0) {
+        size_t n = piece(inlen - off);
+        outlen = 12345;
+        CHECK(ctx_update(c, ctx, enc, in + off, n, out + total, &outlen) == 1);
+        CHECK(outlen == n);
+        off += n;
+        total += outlen;
+    }
+    return total;
+}
+
+static void test_case(const gcm_case_t *c)
+{
+    static uint8_t aad[MAX_LEN], pt[MAX_LEN], ref[MAX_LEN], buf[MAX_LEN], dec[MAX_LEN];
+    uint8_t key[32], iv[40], ref_tag[16], tag[16];
+    BLOCK_CIPHER_CTX ctx;
+    int fail0 = s_fail;
+
+    for(int r = 0; r < ROUNDS; r++) {
+        size_t aadlen = r < 4 ? (size_t)(r & 1) * 5 : rnd() % 3 ? rnd() % 40 : rnd() % MAX_LEN;
+        size_t len = r < 4 ? (size_t)(r >> 1) * 33 : rnd() % MAX_LEN;
+        size_t ivlen = rnd() % 4 ? 12 : 1 + rnd() % sizeof(iv);
+        size_t taglen = rnd() % 2 ? 16 : 12 + rnd() % 5;
+        size_t outlen = 12345, total;
+        int in_place = rnd() % 2;
+
+        fill(key, sizeof(key));
+        fill(iv, ivlen);
+        fill(aad, aadlen);
+        fill(pt, len);
+        one_shot(c, key, iv, ivlen, aad, aadlen, pt, len, ref, taglen, ref_tag);
+
+        // encrypt
+        CHECK(ctx_init(c, &ctx, 1, key, iv, ivlen) == 1);
+        if(in_place) {
+            memcpy(buf, pt, len);
+            total = stream(c, &ctx, 1, aad, aadlen, buf, len, buf);
+        } else {
+            total = stream(c, &ctx, 1, aad, aadlen, pt, len, buf);
+        }
+        memset(tag, 0, sizeof(tag));
+        CHECK(ctx_encrypt_finish(c, &ctx, buf + total, &outlen, taglen, tag) == 1);
+        CHECK(outlen == 0);
+        CHECK(total == len);
+        CHECK(memcmp(buf, ref, len) == 0);
+        CHECK(memcmp(tag, ref_tag, taglen) == 0);
+
+        // decrypt
+        CHECK(ctx_init(c, &ctx, 0, key, iv, ivlen) == 1);
+        if(in_place) {
+            memcpy(dec, ref, len);
+            total = stream(c, &ctx, 0, aad, aadlen, dec, len, dec);
+        } else {
+            total = stream(c, &ctx, 0, aad, aadlen, ref, len, dec);
+        }
+        CHECK(ctx_decrypt_finish(c, &ctx, ref_tag, taglen, dec + total, &outlen) == 1);
+        CHECK(outlen == 0);
+        CHECK(memcmp(dec, pt, len) == 0);
+
+        // any flipped bit of aad, ciphertext or tag fails the tag
+        int what = rnd() % 3;
+        if((what == 0 && aadlen == 0) || (what == 1 && len == 0)) {
+            what = 2;
+        }
+        if(what == 0) {
+            aad[rnd() % aadlen] ^= 1 << rnd() % 8;
+        } else if(what == 1) {
+            ref[rnd() % len] ^= 1 << rnd() % 8;
+        } else {
+            ref_tag[rnd() % taglen] ^= 1 << rnd() % 8;
+        }
+        CHECK(ctx_init(c, &ctx, 0, key, iv, ivlen) == 1);
+        total = stream(c, &ctx, 0, aad, aadlen, ref, len, dec);
+        CHECK(ctx_decrypt_finish(c, &ctx, ref_tag, taglen, dec + total, &outlen) == -1);
+    }
+    printf("  %s: %d rounds%s\n", c->name, ROUNDS, s_fail == fail0 ? "" : " FAILED");
+}
+
+static void test_errors(void)
+{
+    uint8_t key[16] = {0}, iv[12] = {0}, buf[32], tag[16];
+    size_t outlen;
+    BLOCK_CIPHER_CTX ctx;
+
+    printf("invalid parameters\n");
+    CHECK(sm4_gcm_encrypt_init(&ctx, key, iv, 0) == -1);
+    CHECK(aes_gcm_encrypt_init(&ctx, key, 15, iv, 12) == -1);
+    CHECK(aes_gcm_encrypt_init(&ctx, key, 16, iv, 12) == 1);
+    CHECK(aes_gcm_encrypt_update(&ctx, buf, 20, buf, &outlen) == 1);
+    CHECK(aes_gcm_decrypt_update(&ctx, buf, 1, buf, &outlen) == -1);
+    CHECK(aes_gcm_decrypt_finish(&ctx, tag, 16, buf, &outlen) == -1);
+    CHECK(aes_gcm_encrypt_aad(&ctx, buf, 1) == -1);             // aad after data
+    CHECK(aes_gcm_encrypt_finish(&ctx, buf, &outlen, 17, tag) == -1);
+    CHECK(sm4_gcm_decrypt_init(&ctx, key, iv, 12) == 1);
+    CHECK(sm4_gcm_encrypt_update(&ctx, buf, 1, buf, &outlen) == -1);
+    CHECK(sm4_gcm_encrypt_finish(&ctx, buf, &outlen, 16, tag) == -1);
+}
+
+int main(void)
+{
+    static const gcm_case_t cases[] = {
+        { "SM4-GCM", 0 },
+        { "AES-128-GCM", 16 },
+        { "AES-192-GCM", 24 },
+        { "AES-256-GCM", 32 },
+    };
+
+    printf("streaming GCM against one-shot, random aad/data splits with empty and unaligned pieces\n");
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        test_case(&cases[i]);
+    }
+    test_errors();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+// host known answer, cross-check and throughput test of the table GHASH, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gf128.h"
+#include "ghash.h"
+#include "gcm.h"
+#include "sm4.h"
+#include "block_cipher.h"
+#include "hex.h"
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t hex(const char *s, uint8_t *out)
+{
+    size_t len;
+    hex_to_bytes(s, strlen(s), out, &len);
+    return len;
+}
+
+static void fill(uint8_t *p, size_t len)
+{
+    for(size_t i = 0; i < len; i++) {
+        p[i] = rnd();
+    }
+}
+
+// the bit serial GHASH esp_gmssl used before the table, one gf128_mul per block
+static void ref_blocks(gf128_t *X, gf128_t H, const uint8_t *p, size_t len)
+{
+    uint8_t block[16];
+    while(len) {
+        size_t n = len < 16 ? len : 16;
+        memset(block, 0, 16);
+        memcpy(block, p, n);
+        *X = gf128_mul(gf128_add(*X, gf128_from_bytes(block)), H);
+        p += n;
+        len -= n;
+    }
+}
+
+static void ref_ghash(const uint8_t h[16], const uint8_t *aad, size_t aadlen, const uint8_t *c, size_t clen, uint8_t out[16])
+{
+    gf128_t H = gf128_from_bytes(h), X = gf128_zero();
+    uint8_t L[16];
+    ref_blocks(&X, H, aad, aadlen);
+    ref_blocks(&X, H, c, clen);
+    for(int i = 0; i < 8; i++) {
+        L[i] = (uint8_t)(((uint64_t)aadlen << 3) >> (56 - 8 * i));
+        L[8 + i] = (uint8_t)(((uint64_t)clen << 3) >> (56 - 8 * i));
+    }
+    X = gf128_mul(gf128_add(X, gf128_from_bytes(L)), H);
+    gf128_to_bytes(X, out);
+}
+
+static void test_vectors(void)
+{
+    printf("known answers, GHASH, AES-128-GCM, SM4-GCM\n");
+    uint8_t h[16], c[64], aad[20], iv[12], key[16], in[64], out[64], tag[16], t[16];
+    size_t clen, inlen, aadlen;
+
+    // McGrew and Viega GCM test case 2
+    hex("66e94bd4ef8a2c3b884cfa59ca342b2e", h);
+    clen = hex("0388dace60b6a392f328c2b971b2fe78", c);
+    hex("f38cbb1ad69223dcc3457ae5b6b0f885", t);
+    ghash(h, NULL, 0, c, clen, out);
+    CHECK(memcmp(out, t, 16) == 0);
+
+    // test case 4, AES-128
+    BLOCK_CIPHER_KEY bkey;
+    hex("feffe9928665731c6d6a8f9467308308", key);
+    hex("cafebabefacedbaddecaf888", iv);
+    aadlen = hex("feedfacedeadbeeffeedfacedeadbeefabaddad2", aad);
+    inlen = hex("d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+        "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39", in);
+    hex("42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+        "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091", c);
+    hex("5bc94fbc3221a5db94fae95ae7121a47", t);
+    block_cipher_set_encrypt_key(&bkey, BLOCK_CIPHER_aes128(), key);
+    CHECK(gcm_encrypt(&bkey, iv, 12, aad, aadlen, in, inlen, out, 16, tag) == 1);
+    CHECK(memcmp(out, c, inlen) == 0 && memcmp(tag, t, 16) == 0);
+    CHECK(gcm_decrypt(&bkey, iv, 12, aad, aadlen, c, inlen, t, 16, out) == 1 && memcmp(out, in, inlen) == 0);
+    t[15] ^= 1;
+    CHECK(gcm_decrypt(&bkey, iv, 12, aad, aadlen, c, inlen, t, 16, out) != 1);
+
+    // RFC 8998 A.1, SM4
+    SM4_KEY skey;
+    hex("0123456789ABCDEFFEDCBA9876543210", key);
+    hex("00001234567800000000ABCD", iv);
+    aadlen = hex("FEEDFACEDEADBEEFFEEDFACEDEADBEEFABADDAD2", aad);
+    inlen = hex("AAAAAAAAAAAAAAAABBBBBBBBBBBBBBBBCCCCCCCCCCCCCCCCDDDDDDDDDDDDDDDD"
+        "EEEEEEEEEEEEEEEEFFFFFFFFFFFFFFFFEEEEEEEEEEEEEEEEAAAAAAAAAAAAAAAA", in);
+    hex("17F399F08C67D5EE19D0DC9969C4BB7D5FD46FD3756489069157B282BB200735"
+        "D82710CA5C22F0CCFA7CBF93D496AC15A56834CBCF98C397B4024A2691233B8D", c);
+    hex("83DE3541E4C2B58177E065A9BF7B62EC", t);
+    sm4_set_encrypt_key(&skey, key);
+    CHECK(sm4_gcm_encrypt(&skey, iv, 12, aad, aadlen, in, inlen, out, 16, tag) == 1);
+    CHECK(memcmp(out, c, inlen) == 0 && memcmp(tag, t, 16) == 0);
+    CHECK(sm4_gcm_decrypt(&skey, iv, 12, aad, aadlen, c, inlen, t, 16, out) == 1 && memcmp(out, in, inlen) == 0);
+}
+
+// random keys and lengths: ghash, ghash_with_key and GHASH_CTX fed in random pieces agree with the bit serial loop
+static void test_random(void)
+{
+    printf("random keys, lengths and pieces against the bit serial GHASH\n");
+    static uint8_t aad[300], c[1200];
+    uint8_t h[16], ref[16], out[16];
+    for(int n = 0; n < 5000; n++) {
+        size_t aadlen = rnd() % 5 ? rnd() % sizeof(aad) : 0;
+        size_t clen = rnd() % 5 ? rnd() % sizeof(c) : 0;
+        fill(h, 16);
+        fill(aad, aadlen);
+        fill(c, clen);
+        ref_ghash(h, aad, aadlen, c, clen, ref);
+
+        ghash(h, aad, aadlen, c, clen, out);
+        CHECK(memcmp(out, ref, 16) == 0);
+
+        GHASH_KEY key;
+        ghash_set_key(&key, h);
+        ghash_with_key(&key, aad, aadlen, c, clen, out);
+        CHECK(memcmp(out, ref, 16) == 0);
+
+        GHASH_CTX ctx;
+        ghash_ctx_init(&ctx, h);
+        for(size_t done = 0, k; done < aadlen; done += k) {
+            k = rnd() % 40;
+            k = k > aadlen - done ? aadlen - done : k;
+            CHECK(ghash_ctx_aad(&ctx, aad + done, k) == 1);
+        }
+        for(size_t done = 0, k; done < clen; done += k) {
+            k = rnd() % 70;
+            k = k > clen - done ? clen - done : k;
+            ghash_ctx_update(&ctx, c + done, k);
+        }
+        ghash_ctx_finish(&ctx, out);
+        CHECK(memcmp(out, ref, 16) == 0);
+        if(s_fail) {
+            printf("  aadlen %zu, clen %zu\n", aadlen, clen);
+            return;
+        }
+    }
+}
+
+static void bench(void)
+{
+    enum { LEN = 16 * 1024, ROUNDS = 2000 };
+    static uint8_t buf[LEN], out[LEN];
+    uint8_t h[16], x[16], key[16], iv[12], tag[16];
+    fill(buf, LEN);
+    fill(h, 16);
+    fill(key, 16);
+    fill(iv, 12);
+    double mb = (double)LEN * ROUNDS / 1e6;
+
+    GHASH_KEY gkey;
+    ghash_set_key(&gkey, h);
+    double t = now_s();
+    for(int r = 0; r < ROUNDS; r++) {
+        ghash_with_key(&gkey, NULL, 0, buf, LEN, x);
+        buf[r & 0xff] ^= x[0];
+    }
+    double table = now_s() - t;
+    t = now_s();
+    for(int r = 0; r < ROUNDS / 20; r++) {
+        ref_ghash(h, NULL, 0, buf, LEN, x);
+        buf[r & 0xff] ^= x[0];
+    }
+    double serial = now_s() - t;
+    printf("bench ghash: table %.0f MB/s, bit serial %.1f MB/s\n", mb / table, mb / 20 / serial);
+
+    SM4_KEY skey;
+    sm4_set_encrypt_key(&skey, key);
+    t = now_s();
+    for(int r = 0; r < ROUNDS / 4; r++) {
+        sm4_gcm_encrypt(&skey, iv, 12, NULL, 0, buf, LEN, out, 16, tag);
+    }
+    double sm4 = now_s() - t;
+    BLOCK_CIPHER_KEY bkey;
+    block_cipher_set_encrypt_key(&bkey, BLOCK_CIPHER_aes128(), key);
+    t = now_s();
+    for(int r = 0; r < ROUNDS / 4; r++) {
+        gcm_encrypt(&bkey, iv, 12, NULL, 0, buf, LEN, out, 16, tag);
+    }
+    double aes = now_s() - t;
+    printf("bench gcm encrypt 16 KB: SM4 %.0f MB/s, AES-128 %.0f MB/s (%u)\n", mb / 4 / sm4, mb / 4 / aes, tag[0] & 1);
+}
+
+int main(void)
+{
+    test_vectors();
+    test_random();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
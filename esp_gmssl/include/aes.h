@@ -83,6 +83,8 @@ int aes_gcm_decrypt(const AES_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	const uint8_t *tag, size_t taglen, uint8_t *out);
 
+// AES_GCM_CTX, the streaming GCM context, is declared in block_cipher.h
+
 
 #ifdef  __cplusplus
 }
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include "aes.h"
 #include "sm4.h"
+#include "ghash.h"
 
 
 #ifdef __cplusplus
@@ -46,6 +47,7 @@ typedef void (*block_cipher_set_encrypt_key_func)(BLOCK_CIPHER_KEY *key, const u
 typedef void (*block_cipher_set_decrypt_key_func)(BLOCK_CIPHER_KEY *key, const uint8_t *raw_key);
 typedef void (*block_cipher_encrypt_func)(const BLOCK_CIPHER_KEY *key, const uint8_t *in, uint8_t *out);
 typedef void (*block_cipher_decrypt_func)(const BLOCK_CIPHER_KEY *key, const uint8_t *in, uint8_t *out);
+typedef void (*block_cipher_ctr_encrypt_func)(const BLOCK_CIPHER_KEY *key, uint8_t ctr[16], const uint8_t *in, size_t inlen, uint8_t *out);
 
 struct BLOCK_CIPHER {
 	int oid;
@@ -55,6 +57,7 @@ struct BLOCK_CIPHER {
 	block_cipher_set_decrypt_key_func set_decrypt_key;
 	block_cipher_encrypt_func encrypt;
 	block_cipher_decrypt_func decrypt;
+	block_cipher_ctr_encrypt_func ctr_encrypt;
 };
 
 const BLOCK_CIPHER *BLOCK_CIPHER_sm4(void);
@@ -68,6 +71,95 @@ int block_cipher_encrypt(const BLOCK_CIPHER_KEY *key, const uint8_t *in, uint8_t
 int block_cipher_decrypt(const BLOCK_CIPHER_KEY *key, const uint8_t *in, uint8_t *out);
 
 
+/*
+Block Cipher Stream API
+
+	BLOCK_CIPHER_CTX
+	block_cipher_ctx_init
+	block_cipher_ctx_aad		GCM only, before the first update
+	block_cipher_ctx_update
+	block_cipher_ctx_updatev
+	block_cipher_ctx_finish
+	block_cipher_ctx_get_tag	GCM encrypt, after finish
+	block_cipher_ctx_verify_tag	GCM decrypt, after finish
+
+	CTR and GCM are byte oriented: update outputs exactly inlen bytes and never
+	copies, so in-place (out == in) works across any number of calls.
+	CBC outputs whole blocks and keeps the rest in ctx (decrypt always keeps the
+	last block for the padding), in-place is only safe within one updatev call
+	where the out list mirrors the in list.
+	copy_bytes counts the bytes staged through ctx->block or a bounce buffer.
+*/
+
+#define BLOCK_CIPHER_MODE_CBC		1
+#define BLOCK_CIPHER_MODE_CTR		2
+#define BLOCK_CIPHER_MODE_GCM		3
+
+#define BLOCK_CIPHER_GCM_MAX_TAG_SIZE	16
+
+typedef struct {
+	uint8_t *base;
+	size_t len;
+} BLOCK_CIPHER_IOV;
+
+typedef struct {
+	BLOCK_CIPHER_KEY key;
+	int mode;
+	int enc;
+	uint8_t iv[BLOCK_CIPHER_BLOCK_SIZE];	// CBC chaining value or counter
+	uint8_t block[BLOCK_CIPHER_BLOCK_SIZE];	// CBC pending input or CTR keystream
+	size_t block_nbytes;			// CBC pending bytes or CTR unused keystream bytes
+	GHASH_CTX ghash_ctx;
+	uint8_t tag[BLOCK_CIPHER_BLOCK_SIZE];	// E(K, Y0), the tag after finish
+	size_t copy_bytes;
+} BLOCK_CIPHER_CTX;
+
+int block_cipher_ctx_init(BLOCK_CIPHER_CTX *ctx, const BLOCK_CIPHER *cipher, int mode, int enc,
+	const uint8_t *raw_key, const uint8_t *iv, size_t ivlen);
+int block_cipher_ctx_aad(BLOCK_CIPHER_CTX *ctx, const uint8_t *aad, size_t aadlen);
+int block_cipher_ctx_update(BLOCK_CIPHER_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen);
+int block_cipher_ctx_updatev(BLOCK_CIPHER_CTX *ctx, const BLOCK_CIPHER_IOV *in, size_t in_cnt,
+	const BLOCK_CIPHER_IOV *out, size_t out_cnt, size_t *outlen);
+int block_cipher_ctx_finish(BLOCK_CIPHER_CTX *ctx, uint8_t *out, size_t *outlen);
+int block_cipher_ctx_get_tag(const BLOCK_CIPHER_CTX *ctx, uint8_t *tag, size_t taglen);
+int block_cipher_ctx_verify_tag(const BLOCK_CIPHER_CTX *ctx, const uint8_t *tag, size_t taglen);
+
+
+/*
+Streaming SM4/AES GCM, built on BLOCK_CIPHER_CTX in GCM mode
+
+	Memory use does not depend on the message length. update outputs exactly
+	inlen bytes (out may equal in), finish outputs nothing and sets *outlen to 0.
+	Plaintext from *_gcm_decrypt_update must not be trusted until
+	*_gcm_decrypt_finish has returned 1.
+	aes_gcm_*_init takes 16, 24 or 32 byte keys.
+*/
+
+typedef BLOCK_CIPHER_CTX SM4_GCM_CTX;
+
+int sm4_gcm_encrypt_init(SM4_GCM_CTX *ctx, const uint8_t key[SM4_KEY_SIZE], const uint8_t *iv, size_t ivlen);
+int sm4_gcm_encrypt_aad(SM4_GCM_CTX *ctx, const uint8_t *aad, size_t aadlen);
+int sm4_gcm_encrypt_update(SM4_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen);
+int sm4_gcm_encrypt_finish(SM4_GCM_CTX *ctx, uint8_t *out, size_t *outlen, size_t taglen, uint8_t *tag);
+
+int sm4_gcm_decrypt_init(SM4_GCM_CTX *ctx, const uint8_t key[SM4_KEY_SIZE], const uint8_t *iv, size_t ivlen);
+#define sm4_gcm_decrypt_aad(ctx,aad,aadlen) sm4_gcm_encrypt_aad(ctx,aad,aadlen)
+int sm4_gcm_decrypt_update(SM4_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen);
+int sm4_gcm_decrypt_finish(SM4_GCM_CTX *ctx, const uint8_t *tag, size_t taglen, uint8_t *out, size_t *outlen);
+
+typedef BLOCK_CIPHER_CTX AES_GCM_CTX;
+
+int aes_gcm_encrypt_init(AES_GCM_CTX *ctx, const uint8_t *key, size_t keylen, const uint8_t *iv, size_t ivlen);
+int aes_gcm_encrypt_aad(AES_GCM_CTX *ctx, const uint8_t *aad, size_t aadlen);
+int aes_gcm_encrypt_update(AES_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen);
+int aes_gcm_encrypt_finish(AES_GCM_CTX *ctx, uint8_t *out, size_t *outlen, size_t taglen, uint8_t *tag);
+
+int aes_gcm_decrypt_init(AES_GCM_CTX *ctx, const uint8_t *key, size_t keylen, const uint8_t *iv, size_t ivlen);
+#define aes_gcm_decrypt_aad(ctx,aad,aadlen) aes_gcm_encrypt_aad(ctx,aad,aadlen)
+int aes_gcm_decrypt_update(AES_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen);
+int aes_gcm_decrypt_finish(AES_GCM_CTX *ctx, const uint8_t *tag, size_t taglen, uint8_t *out, size_t *outlen);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,7 @@
 #include <stdint.h>
 #include <string.h>
 #include "gf128.h"
+#include "ghash.h"
 #include "block_cipher.h"
 
 
@@ -41,9 +42,6 @@ extern "C" {
 #define GCM_IS_LITTLE_ENDIAN 1
 
 
-void ghash(const uint8_t h[16], const uint8_t *aad, size_t aadlen,
-	const uint8_t *c, size_t clen, uint8_t out[16]);
-
 int gcm_encrypt(const BLOCK_CIPHER_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	uint8_t *out, size_t taglen, uint8_t *tag);
@@ -0,0 +1,64 @@
+/*
+ *  Copyright 2014-2022 The GmSSL Project. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the License); you may
+ *  not use this file except in compliance with the License.
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+
+#ifndef GMSSL_GHASH_H
+#define GMSSL_GHASH_H
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * GHASH_KEY holds the per-key 4-bit table (16 * 16 bytes) of multiples of H.
+ * Set it once per key and reuse it for every message under that key.
+ */
+typedef struct {
+	uint64_t Htable[16][2];
+} GHASH_KEY;
+
+void ghash_set_key(GHASH_KEY *key, const uint8_t h[16]);
+void ghash_mul(const GHASH_KEY *key, uint8_t X[16]);
+void ghash_update(const GHASH_KEY *key, uint8_t X[16], const uint8_t *in, size_t inlen);
+void ghash_finish(const GHASH_KEY *key, uint8_t X[16], uint64_t aadlen, uint64_t clen);
+void ghash_with_key(const GHASH_KEY *key, const uint8_t *aad, size_t aadlen,
+	const uint8_t *c, size_t clen, uint8_t out[16]);
+
+void ghash(const uint8_t h[16], const uint8_t *aad, size_t aadlen,
+	const uint8_t *c, size_t clen, uint8_t out[16]);
+
+/*
+ * Incremental GHASH(H, A, C), A and C may be fed in pieces of any length.
+ * All of A must be given before the first byte of C.
+ */
+typedef struct {
+	GHASH_KEY key;
+	uint8_t X[16];
+	uint8_t block[16];
+	size_t block_nbytes;
+	uint64_t aadlen;
+	uint64_t clen;
+} GHASH_CTX;
+
+void ghash_ctx_init(GHASH_CTX *ctx, const uint8_t h[16]);
+int ghash_ctx_aad(GHASH_CTX *ctx, const uint8_t *aad, size_t aadlen);
+void ghash_ctx_update(GHASH_CTX *ctx, const uint8_t *c, size_t clen);
+void ghash_ctx_finish(GHASH_CTX *ctx, uint8_t out[16]);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
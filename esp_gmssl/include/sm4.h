@@ -41,6 +41,16 @@ SM4 Public API
 	sm4_ctr_decrypt_update
 	sm4_ctr_decrypt_finish
 
+	SM4_GCM_CTX
+	sm4_gcm_encrypt_init
+	sm4_gcm_encrypt_aad
+	sm4_gcm_encrypt_update
+	sm4_gcm_encrypt_finish
+	sm4_gcm_decrypt_init
+	sm4_gcm_decrypt_aad
+	sm4_gcm_decrypt_update
+	sm4_gcm_decrypt_finish
+
 	SM4_EBC_CTX
 	sm4_ecb_encrypt_init
 	sm4_ecb_encrypt_update
@@ -101,6 +111,8 @@ int sm4_gcm_decrypt(const SM4_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	const uint8_t *tag, size_t taglen, uint8_t *out);
 
+// SM4_GCM_CTX, the streaming GCM context, is declared in block_cipher.h
+
 
 typedef struct {
 	SM4_KEY sm4_key;
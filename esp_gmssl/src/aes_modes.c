@@ -105,16 +105,36 @@ static void ctr_incr(uint8_t a[16])
 	}
 }
 
+// counter blocks turned into keystream per pass
+#define AES_CTR_BATCH_BLOCKS	4
+
 void aes_ctr_encrypt(const AES_KEY *key, uint8_t ctr[16], const uint8_t *in, size_t inlen, uint8_t *out)
 {
-	uint8_t block[16];
+	uint8_t block[16 * AES_CTR_BATCH_BLOCKS];
+	uint32_t a, b;
+	size_t nblocks;
 	size_t len;
+	size_t i;
 
 	while (inlen) {
-		len = inlen < 16 ? inlen : 16;
-		aes_encrypt(key, ctr, block);
-		gmssl_memxor(out, in, block, len);
-		ctr_incr(ctr);
+		nblocks = (inlen + 15) / 16;
+		if (nblocks > AES_CTR_BATCH_BLOCKS) {
+			nblocks = AES_CTR_BATCH_BLOCKS;
+		}
+		for (i = 0; i < nblocks; i++) {
+			aes_encrypt(key, ctr, block + 16 * i);
+			ctr_incr(ctr);
+		}
+		len = inlen < 16 * nblocks ? inlen : 16 * nblocks;
+
+		// word-wide XOR through memcpy, in and out may be unaligned or equal
+		for (i = 0; i + 4 <= len; i += 4) {
+			memcpy(&a, in + i, 4);
+			memcpy(&b, block + i, 4);
+			a ^= b;
+			memcpy(out + i, &a, 4);
+		}
+		gmssl_memxor(out + i, in + i, block + i, len - i);
 		in += len;
 		out += len;
 		inlen -= len;
@@ -125,12 +145,10 @@ int aes_gcm_encrypt(const AES_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	uint8_t *out, size_t taglen, uint8_t *tag)
 {
-	const uint8_t *pin = in;
-	uint8_t *pout = out;
-	size_t left = inlen;
 	uint8_t H[16] = {0};
 	uint8_t Y[16];
 	uint8_t T[16];
+	GHASH_KEY ghash_key;
 
 	if (taglen > AES_GCM_MAX_TAG_SIZE) {
 		error_print();
@@ -138,29 +156,23 @@ int aes_gcm_encrypt(const AES_KEY *key, const uint8_t *iv, size_t ivlen,
 	}
 
 	aes_encrypt(key, H, H);
+	ghash_set_key(&ghash_key, H);
 
 	if (ivlen == 12) {
 		memcpy(Y, iv, 12);
 		Y[12] = Y[13] = Y[14] = 0;
 		Y[15] = 1;
 	} else {
-		ghash(H, NULL, 0, iv, ivlen, Y);
+		ghash_with_key(&ghash_key, NULL, 0, iv, ivlen, Y);
 	}
 
 	aes_encrypt(key, Y, T);
 
-	while (left) {
-		uint8_t block[16];
-		size_t len = left < 16 ? left : 16;
-		ctr_incr(Y);
-		aes_encrypt(key, Y, block);
-		gmssl_memxor(pout, pin, block, len);
-		pin += len;
-		pout += len;
-		left -= len;
-	}
+	ctr_incr(Y);
+	aes_ctr_encrypt(key, Y, in, inlen, out);
 
-	ghash(H, aad, aadlen, out, inlen, H);
+	ghash_with_key(&ghash_key, aad, aadlen, out, inlen, H);
+	gmssl_secure_clear(&ghash_key, sizeof(ghash_key));
 	gmssl_memxor(tag, T, H, taglen);
 	return 1;
 }
@@ -169,24 +181,24 @@ int aes_gcm_decrypt(const AES_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	const uint8_t *tag, size_t taglen, uint8_t *out)
 {
-	const uint8_t *pin = in;
-	uint8_t *pout = out;
-	size_t left = inlen;
 	uint8_t H[16] = {0};
 	uint8_t Y[16];
 	uint8_t T[16];
+	GHASH_KEY ghash_key;
 
 	aes_encrypt(key, H, H);
+	ghash_set_key(&ghash_key, H);
 
 	if (ivlen == 12) {
 		memcpy(Y, iv, 12);
 		Y[12] = Y[13] = Y[14] = 0;
 		Y[15] = 1;
 	} else {
-		ghash(H, NULL, 0, iv, ivlen, Y);
+		ghash_with_key(&ghash_key, NULL, 0, iv, ivlen, Y);
 	}
 
-	ghash(H, aad, aadlen, in, inlen, H);
+	ghash_with_key(&ghash_key, aad, aadlen, in, inlen, H);
+	gmssl_secure_clear(&ghash_key, sizeof(ghash_key));
 	aes_encrypt(key, Y, T);
 	gmssl_memxor(T, T, H, taglen);
 	if (memcmp(T, tag, taglen) != 0) {
@@ -194,15 +206,7 @@ int aes_gcm_decrypt(const AES_KEY *key, const uint8_t *iv, size_t ivlen,
 		return -1;
 	}
 
-	while (left) {
-		uint8_t block[16];
-		size_t len = left < 16 ? left : 16;
-		ctr_incr(Y);
-		aes_encrypt(key, Y, block);
-		gmssl_memxor(pout, pin, block, len);
-		pin += len;
-		pout += len;
-		left -= len;
-	}
+	ctr_incr(Y);
+	aes_ctr_encrypt(key, Y, in, inlen, out);
 	return 1;
 }
@@ -53,6 +53,7 @@ static const BLOCK_CIPHER sm4_block_cipher_object = {
 	(block_cipher_set_decrypt_key_func)sm4_set_decrypt_key,
 	(block_cipher_encrypt_func)sm4_encrypt,
 	(block_cipher_decrypt_func)sm4_encrypt,
+	(block_cipher_ctr_encrypt_func)sm4_ctr_encrypt,
 };
 
 const BLOCK_CIPHER *BLOCK_CIPHER_sm4(void) {
@@ -74,7 +75,8 @@ static const BLOCK_CIPHER aes128_block_cipher_object = {
 	(block_cipher_set_encrypt_key_func)aes128_set_encrypt_key,
 	(block_cipher_set_decrypt_key_func)aes128_set_decrypt_key,
 	(block_cipher_encrypt_func)aes_encrypt,
-	(block_cipher_decrypt_func)aes_encrypt,
+	(block_cipher_decrypt_func)aes_decrypt,
+	(block_cipher_ctr_encrypt_func)aes_ctr_encrypt,
 };
 
 const BLOCK_CIPHER *BLOCK_CIPHER_aes128(void) {
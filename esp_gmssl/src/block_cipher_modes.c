@@ -0,0 +1,531 @@
+/*
+ *  Copyright 2014-2022 The GmSSL Project. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the License); you may
+ *  not use this file except in compliance with the License.
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "block_cipher.h"
+#include "ghash.h"
+#include "mem.h"
+#include "error.h"
+
+
+typedef struct {
+	const BLOCK_CIPHER_IOV *iov;
+	size_t cnt;
+	size_t idx;
+	size_t off;
+} IOV_CURSOR;
+
+static void iov_cursor_init(IOV_CURSOR *cur, const BLOCK_CIPHER_IOV *iov, size_t cnt)
+{
+	cur->iov = iov;
+	cur->cnt = cnt;
+	cur->idx = 0;
+	cur->off = 0;
+}
+
+// contiguous bytes left at the cursor, skipping empty entries
+static uint8_t *iov_cursor_ptr(IOV_CURSOR *cur, size_t *room)
+{
+	while (cur->idx < cur->cnt && cur->off == cur->iov[cur->idx].len) {
+		cur->idx++;
+		cur->off = 0;
+	}
+	if (cur->idx == cur->cnt) {
+		*room = 0;
+		return NULL;
+	}
+	*room = cur->iov[cur->idx].len - cur->off;
+	return cur->iov[cur->idx].base + cur->off;
+}
+
+static void iov_cursor_advance(IOV_CURSOR *cur, size_t len)
+{
+	cur->off += len;
+}
+
+static void iov_cursor_write(IOV_CURSOR *cur, const uint8_t *buf, size_t len)
+{
+	uint8_t *p;
+	size_t room;
+
+	while (len && (p = iov_cursor_ptr(cur, &room)) != NULL) {
+		if (room > len) {
+			room = len;
+		}
+		memcpy(p, buf, room);
+		iov_cursor_advance(cur, room);
+		buf += room;
+		len -= room;
+	}
+}
+
+static size_t iov_total(const BLOCK_CIPHER_IOV *iov, size_t cnt)
+{
+	size_t len = 0;
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		len += iov[i].len;
+	}
+	return len;
+}
+
+static void ctr_incr(uint8_t a[16])
+{
+	int i;
+	for (i = 15; i >= 0; i--) {
+		a[i]++;
+		if (a[i]) break;
+	}
+}
+
+// CTR and GCM, any length, in may equal out
+static void ctx_stream(BLOCK_CIPHER_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out)
+{
+	const BLOCK_CIPHER *cipher = ctx->key.cipher;
+	uint8_t *pout = out;
+	size_t left = inlen;
+	size_t len;
+
+	if (ctx->mode == BLOCK_CIPHER_MODE_GCM && !ctx->enc) {
+		ghash_ctx_update(&ctx->ghash_ctx, in, inlen);
+	}
+	if (ctx->block_nbytes) {
+		len = left < ctx->block_nbytes ? left : ctx->block_nbytes;
+		gmssl_memxor(pout, in, ctx->block + BLOCK_CIPHER_BLOCK_SIZE - ctx->block_nbytes, len);
+		ctx->block_nbytes -= len;
+		in += len;
+		pout += len;
+		left -= len;
+	}
+	len = left - left % BLOCK_CIPHER_BLOCK_SIZE;
+	if (len) {
+		cipher->ctr_encrypt(&ctx->key, ctx->iv, in, len, pout);
+		in += len;
+		pout += len;
+		left -= len;
+	}
+	if (left) {
+		cipher->encrypt(&ctx->key, ctx->iv, ctx->block);
+		ctr_incr(ctx->iv);
+		gmssl_memxor(pout, in, ctx->block, left);
+		ctx->block_nbytes = BLOCK_CIPHER_BLOCK_SIZE - left;
+	}
+	if (ctx->mode == BLOCK_CIPHER_MODE_GCM && ctx->enc) {
+		ghash_ctx_update(&ctx->ghash_ctx, out, inlen);
+	}
+}
+
+// CBC, whole blocks, in may equal out
+static void ctx_cbc_blocks(BLOCK_CIPHER_CTX *ctx, const uint8_t *in, size_t nblocks, uint8_t *out)
+{
+	const BLOCK_CIPHER *cipher = ctx->key.cipher;
+	uint8_t c[BLOCK_CIPHER_BLOCK_SIZE];
+
+	while (nblocks--) {
+		if (ctx->enc) {
+			memxor(ctx->iv, in, BLOCK_CIPHER_BLOCK_SIZE);
+			cipher->encrypt(&ctx->key, ctx->iv, ctx->iv);
+			memcpy(out, ctx->iv, BLOCK_CIPHER_BLOCK_SIZE);
+		} else {
+			memcpy(c, in, BLOCK_CIPHER_BLOCK_SIZE);
+			cipher->decrypt(&ctx->key, c, out);
+			memxor(out, ctx->iv, BLOCK_CIPHER_BLOCK_SIZE);
+			memcpy(ctx->iv, c, BLOCK_CIPHER_BLOCK_SIZE);
+		}
+		in += BLOCK_CIPHER_BLOCK_SIZE;
+		out += BLOCK_CIPHER_BLOCK_SIZE;
+	}
+}
+
+// one CBC block to the cursor, bounced when it straddles two out entries
+static void ctx_cbc_emit(BLOCK_CIPHER_CTX *ctx, const uint8_t *in, IOV_CURSOR *cur)
+{
+	uint8_t buf[BLOCK_CIPHER_BLOCK_SIZE];
+	uint8_t *p;
+	size_t room;
+
+	p = iov_cursor_ptr(cur, &room);
+	if (room >= BLOCK_CIPHER_BLOCK_SIZE) {
+		ctx_cbc_blocks(ctx, in, 1, p);
+		iov_cursor_advance(cur, BLOCK_CIPHER_BLOCK_SIZE);
+	} else {
+		ctx_cbc_blocks(ctx, in, 1, buf);
+		iov_cursor_write(cur, buf, BLOCK_CIPHER_BLOCK_SIZE);
+		ctx->copy_bytes += BLOCK_CIPHER_BLOCK_SIZE;
+	}
+}
+
+// output produced by the next update of inlen bytes
+static size_t ctx_output_size(const BLOCK_CIPHER_CTX *ctx, size_t inlen)
+{
+	size_t len;
+
+	if (ctx->mode != BLOCK_CIPHER_MODE_CBC) {
+		return inlen;
+	}
+	len = ctx->block_nbytes + inlen;
+	if (ctx->enc) {
+		return len - len % BLOCK_CIPHER_BLOCK_SIZE;
+	}
+	return len ? (len - 1) / BLOCK_CIPHER_BLOCK_SIZE * BLOCK_CIPHER_BLOCK_SIZE : 0;
+}
+
+// ctx->key is already set, for CBC decrypt it is the decryption key
+static int ctx_init_iv(BLOCK_CIPHER_CTX *ctx, int mode, int enc, const uint8_t *iv, size_t ivlen)
+{
+	const BLOCK_CIPHER *cipher = ctx->key.cipher;
+	uint8_t H[BLOCK_CIPHER_BLOCK_SIZE] = {0};
+
+	ctx->mode = mode;
+	ctx->enc = enc ? 1 : 0;
+
+	switch (mode) {
+	case BLOCK_CIPHER_MODE_CBC:
+	case BLOCK_CIPHER_MODE_CTR:
+		if (ivlen != BLOCK_CIPHER_BLOCK_SIZE) {
+			error_print();
+			return -1;
+		}
+		memcpy(ctx->iv, iv, BLOCK_CIPHER_BLOCK_SIZE);
+		break;
+	case BLOCK_CIPHER_MODE_GCM:
+		if (ivlen < 1) {
+			error_print();
+			return -1;
+		}
+		cipher->encrypt(&ctx->key, H, H);
+		ghash_ctx_init(&ctx->ghash_ctx, H);
+		gmssl_secure_clear(H, sizeof(H));
+		if (ivlen == 12) {
+			memcpy(ctx->iv, iv, 12);
+			ctx->iv[15] = 1;
+		} else {
+			ghash_with_key(&ctx->ghash_ctx.key, NULL, 0, iv, ivlen, ctx->iv);
+		}
+		cipher->encrypt(&ctx->key, ctx->iv, ctx->tag);
+		ctr_incr(ctx->iv);
+		break;
+	default:
+		error_print();
+		return -1;
+	}
+	return 1;
+}
+
+int block_cipher_ctx_init(BLOCK_CIPHER_CTX *ctx, const BLOCK_CIPHER *cipher, int mode, int enc,
+	const uint8_t *raw_key, const uint8_t *iv, size_t ivlen)
+{
+	if (!ctx || !cipher || !raw_key || !iv) {
+		error_print();
+		return -1;
+	}
+	memset(ctx, 0, sizeof(BLOCK_CIPHER_CTX));
+	if (mode == BLOCK_CIPHER_MODE_CBC && !enc) {
+		block_cipher_set_decrypt_key(&ctx->key, cipher, raw_key);
+	} else {
+		block_cipher_set_encrypt_key(&ctx->key, cipher, raw_key);
+	}
+	return ctx_init_iv(ctx, mode, enc, iv, ivlen);
+}
+
+int block_cipher_ctx_aad(BLOCK_CIPHER_CTX *ctx, const uint8_t *aad, size_t aadlen)
+{
+	if (ctx->mode != BLOCK_CIPHER_MODE_GCM) {
+		error_print();
+		return -1;
+	}
+	if (ghash_ctx_aad(&ctx->ghash_ctx, aad, aadlen) != 1) {
+		error_print();
+		return -1;
+	}
+	return 1;
+}
+
+int block_cipher_ctx_updatev(BLOCK_CIPHER_CTX *ctx, const BLOCK_CIPHER_IOV *in, size_t in_cnt,
+	const BLOCK_CIPHER_IOV *out, size_t out_cnt, size_t *outlen)
+{
+	IOV_CURSOR cur;
+	size_t total = iov_total(in, in_cnt);
+	size_t rest = total;
+	size_t i;
+
+	*outlen = ctx_output_size(ctx, total);
+	if (iov_total(out, out_cnt) < *outlen) {
+		error_print();
+		return -1;
+	}
+	iov_cursor_init(&cur, out, out_cnt);
+
+	for (i = 0; i < in_cnt; i++) {
+		const uint8_t *p = in[i].base;
+		size_t len = in[i].len;
+		uint8_t *q;
+		size_t room;
+		size_t n;
+
+		rest -= len;
+		while (len) {
+			if (ctx->mode != BLOCK_CIPHER_MODE_CBC) {
+				q = iov_cursor_ptr(&cur, &room);
+				n = len < room ? len : room;
+				ctx_stream(ctx, p, n, q);
+				iov_cursor_advance(&cur, n);
+				p += n;
+				len -= n;
+				continue;
+			}
+
+			// decrypt keeps a full block pending until more input arrives
+			if (ctx->block_nbytes == BLOCK_CIPHER_BLOCK_SIZE) {
+				ctx_cbc_emit(ctx, ctx->block, &cur);
+				ctx->block_nbytes = 0;
+			}
+
+			n = len / BLOCK_CIPHER_BLOCK_SIZE;
+			if (!ctx->enc && n && len % BLOCK_CIPHER_BLOCK_SIZE == 0 && rest == 0) {
+				n--;
+			}
+			if (ctx->block_nbytes || n == 0) {
+				n = BLOCK_CIPHER_BLOCK_SIZE - ctx->block_nbytes;
+				if (n > len) {
+					n = len;
+				}
+				memcpy(ctx->block + ctx->block_nbytes, p, n);
+				ctx->block_nbytes += n;
+				ctx->copy_bytes += n;
+				p += n;
+				len -= n;
+				if (ctx->block_nbytes == BLOCK_CIPHER_BLOCK_SIZE && (ctx->enc || len || rest)) {
+					ctx_cbc_emit(ctx, ctx->block, &cur);
+					ctx->block_nbytes = 0;
+				}
+				continue;
+			}
+
+			q = iov_cursor_ptr(&cur, &room);
+			if (room < BLOCK_CIPHER_BLOCK_SIZE) {
+				ctx_cbc_emit(ctx, p, &cur);
+				n = 1;
+			} else {
+				if (n > room / BLOCK_CIPHER_BLOCK_SIZE) {
+					n = room / BLOCK_CIPHER_BLOCK_SIZE;
+				}
+				ctx_cbc_blocks(ctx, p, n, q);
+				iov_cursor_advance(&cur, n * BLOCK_CIPHER_BLOCK_SIZE);
+			}
+			p += n * BLOCK_CIPHER_BLOCK_SIZE;
+			len -= n * BLOCK_CIPHER_BLOCK_SIZE;
+		}
+	}
+	return 1;
+}
+
+int block_cipher_ctx_update(BLOCK_CIPHER_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen)
+{
+	BLOCK_CIPHER_IOV in_iov;
+	BLOCK_CIPHER_IOV out_iov;
+
+	in_iov.base = (uint8_t *)in;
+	in_iov.len = inlen;
+	out_iov.base = out;
+	out_iov.len = ctx_output_size(ctx, inlen);
+	return block_cipher_ctx_updatev(ctx, &in_iov, 1, &out_iov, 1, outlen);
+}
+
+int block_cipher_ctx_finish(BLOCK_CIPHER_CTX *ctx, uint8_t *out, size_t *outlen)
+{
+	uint8_t X[BLOCK_CIPHER_BLOCK_SIZE];
+	size_t padding;
+
+	*outlen = 0;
+	switch (ctx->mode) {
+	case BLOCK_CIPHER_MODE_CBC:
+		if (ctx->enc) {
+			padding = BLOCK_CIPHER_BLOCK_SIZE - ctx->block_nbytes;
+			memset(ctx->block + ctx->block_nbytes, (int)padding, padding);
+			ctx_cbc_blocks(ctx, ctx->block, 1, out);
+			*outlen = BLOCK_CIPHER_BLOCK_SIZE;
+		} else {
+			if (ctx->block_nbytes != BLOCK_CIPHER_BLOCK_SIZE) {
+				error_print();
+				return -1;
+			}
+			ctx_cbc_blocks(ctx, ctx->block, 1, X);
+			padding = X[BLOCK_CIPHER_BLOCK_SIZE - 1];
+			if (padding < 1 || padding > BLOCK_CIPHER_BLOCK_SIZE) {
+				error_print();
+				return -1;
+			}
+			*outlen = BLOCK_CIPHER_BLOCK_SIZE - padding;
+			memcpy(out, X, *outlen);
+		}
+		ctx->block_nbytes = 0;
+		break;
+	case BLOCK_CIPHER_MODE_CTR:
+		break;
+	case BLOCK_CIPHER_MODE_GCM:
+		ghash_ctx_finish(&ctx->ghash_ctx, X);
+		memxor(ctx->tag, X, BLOCK_CIPHER_BLOCK_SIZE);
+		break;
+	default:
+		error_print();
+		return -1;
+	}
+	return 1;
+}
+
+int block_cipher_ctx_get_tag(const BLOCK_CIPHER_CTX *ctx, uint8_t *tag, size_t taglen)
+{
+	if (ctx->mode != BLOCK_CIPHER_MODE_GCM || taglen > BLOCK_CIPHER_GCM_MAX_TAG_SIZE) {
+		error_print();
+		return -1;
+	}
+	memcpy(tag, ctx->tag, taglen);
+	return 1;
+}
+
+int block_cipher_ctx_verify_tag(const BLOCK_CIPHER_CTX *ctx, const uint8_t *tag, size_t taglen)
+{
+	if (ctx->mode != BLOCK_CIPHER_MODE_GCM || taglen > BLOCK_CIPHER_GCM_MAX_TAG_SIZE) {
+		error_print();
+		return -1;
+	}
+	if (gmssl_secure_memcmp(ctx->tag, tag, taglen) != 0) {
+		error_print();
+		return -1;
+	}
+	return 1;
+}
+
+
+/*
+ * SM4_GCM_CTX and AES_GCM_CTX are BLOCK_CIPHER_CTX in GCM mode.
+ * The AES key may be 128, 192 or 256 bits, the aes128 object only supplies
+ * the block and CTR functions, which take the round count from the key.
+ */
+static int gcm_ctx_update(BLOCK_CIPHER_CTX *ctx, int enc,
+	const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen)
+{
+	if (ctx->mode != BLOCK_CIPHER_MODE_GCM || ctx->enc != enc) {
+		error_print();
+		return -1;
+	}
+	return block_cipher_ctx_update(ctx, in, inlen, out, outlen);
+}
+
+static int gcm_ctx_encrypt_finish(BLOCK_CIPHER_CTX *ctx, uint8_t *out, size_t *outlen, size_t taglen, uint8_t *tag)
+{
+	if (ctx->mode != BLOCK_CIPHER_MODE_GCM || !ctx->enc || taglen > BLOCK_CIPHER_GCM_MAX_TAG_SIZE
+		|| block_cipher_ctx_finish(ctx, out, outlen) != 1
+		|| block_cipher_ctx_get_tag(ctx, tag, taglen) != 1) {
+		error_print();
+		return -1;
+	}
+	return 1;
+}
+
+static int gcm_ctx_decrypt_finish(BLOCK_CIPHER_CTX *ctx, const uint8_t *tag, size_t taglen, uint8_t *out, size_t *outlen)
+{
+	if (ctx->mode != BLOCK_CIPHER_MODE_GCM || ctx->enc || taglen > BLOCK_CIPHER_GCM_MAX_TAG_SIZE
+		|| block_cipher_ctx_finish(ctx, out, outlen) != 1
+		|| block_cipher_ctx_verify_tag(ctx, tag, taglen) != 1) {
+		error_print();
+		return -1;
+	}
+	return 1;
+}
+
+int sm4_gcm_encrypt_init(SM4_GCM_CTX *ctx, const uint8_t key[SM4_KEY_SIZE], const uint8_t *iv, size_t ivlen)
+{
+	return block_cipher_ctx_init(ctx, BLOCK_CIPHER_sm4(), BLOCK_CIPHER_MODE_GCM, 1, key, iv, ivlen);
+}
+
+int sm4_gcm_encrypt_aad(SM4_GCM_CTX *ctx, const uint8_t *aad, size_t aadlen)
+{
+	return block_cipher_ctx_aad(ctx, aad, aadlen);
+}
+
+int sm4_gcm_encrypt_update(SM4_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen)
+{
+	return gcm_ctx_update(ctx, 1, in, inlen, out, outlen);
+}
+
+int sm4_gcm_encrypt_finish(SM4_GCM_CTX *ctx, uint8_t *out, size_t *outlen, size_t taglen, uint8_t *tag)
+{
+	return gcm_ctx_encrypt_finish(ctx, out, outlen, taglen, tag);
+}
+
+int sm4_gcm_decrypt_init(SM4_GCM_CTX *ctx, const uint8_t key[SM4_KEY_SIZE], const uint8_t *iv, size_t ivlen)
+{
+	return block_cipher_ctx_init(ctx, BLOCK_CIPHER_sm4(), BLOCK_CIPHER_MODE_GCM, 0, key, iv, ivlen);
+}
+
+int sm4_gcm_decrypt_update(SM4_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen)
+{
+	return gcm_ctx_update(ctx, 0, in, inlen, out, outlen);
+}
+
+int sm4_gcm_decrypt_finish(SM4_GCM_CTX *ctx, const uint8_t *tag, size_t taglen, uint8_t *out, size_t *outlen)
+{
+	return gcm_ctx_decrypt_finish(ctx, tag, taglen, out, outlen);
+}
+
+static int aes_gcm_init(AES_GCM_CTX *ctx, const uint8_t *key, size_t keylen, const uint8_t *iv, size_t ivlen, int enc)
+{
+	if (!ctx || !key || !iv) {
+		error_print();
+		return -1;
+	}
+	memset(ctx, 0, sizeof(AES_GCM_CTX));
+	if (aes_set_encrypt_key(&ctx->key.u.aes_key, key, keylen) != 1) {
+		error_print();
+		return -1;
+	}
+	ctx->key.cipher = BLOCK_CIPHER_aes128();
+	return ctx_init_iv(ctx, BLOCK_CIPHER_MODE_GCM, enc, iv, ivlen);
+}
+
+int aes_gcm_encrypt_init(AES_GCM_CTX *ctx, const uint8_t *key, size_t keylen, const uint8_t *iv, size_t ivlen)
+{
+	return aes_gcm_init(ctx, key, keylen, iv, ivlen, 1);
+}
+
+int aes_gcm_encrypt_aad(AES_GCM_CTX *ctx, const uint8_t *aad, size_t aadlen)
+{
+	return block_cipher_ctx_aad(ctx, aad, aadlen);
+}
+
+int aes_gcm_encrypt_update(AES_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen)
+{
+	return gcm_ctx_update(ctx, 1, in, inlen, out, outlen);
+}
+
+int aes_gcm_encrypt_finish(AES_GCM_CTX *ctx, uint8_t *out, size_t *outlen, size_t taglen, uint8_t *tag)
+{
+	return gcm_ctx_encrypt_finish(ctx, out, outlen, taglen, tag);
+}
+
+int aes_gcm_decrypt_init(AES_GCM_CTX *ctx, const uint8_t *key, size_t keylen, const uint8_t *iv, size_t ivlen)
+{
+	return aes_gcm_init(ctx, key, keylen, iv, ivlen, 0);
+}
+
+int aes_gcm_decrypt_update(AES_GCM_CTX *ctx, const uint8_t *in, size_t inlen, uint8_t *out, size_t *outlen)
+{
+	return gcm_ctx_update(ctx, 0, in, inlen, out, outlen);
+}
+
+int aes_gcm_decrypt_finish(AES_GCM_CTX *ctx, const uint8_t *tag, size_t taglen, uint8_t *out, size_t *outlen)
+{
+	return gcm_ctx_decrypt_finish(ctx, tag, taglen, out, outlen);
+}
@@ -17,8 +17,132 @@
 #include "error.h"
 #include "aes.h"
 #include "endian.h"
+#include "mem.h"
 
 
+/*
+ * GHASH with Shoup's 4-bit table
+ *
+ * Htable[i] = i * H, i = 0..15, where the 4-bit index is read in the GCM bit
+ * order (bit 0 of the block is the x^0 coefficient, stored as the MSB of byte 0).
+ * Values are kept as big-endian hi/lo words so no bit reversal is needed, and
+ * each 16-byte block costs 32 table lookups instead of 128 shift-and-add steps.
+ */
+static const uint64_t ghash_rem_4bit[16] = {
+	(uint64_t)0x0000 << 48, (uint64_t)0x1C20 << 48, (uint64_t)0x3840 << 48, (uint64_t)0x2460 << 48,
+	(uint64_t)0x7080 << 48, (uint64_t)0x6CA0 << 48, (uint64_t)0x48C0 << 48, (uint64_t)0x54E0 << 48,
+	(uint64_t)0xE100 << 48, (uint64_t)0xFD20 << 48, (uint64_t)0xD940 << 48, (uint64_t)0xC560 << 48,
+	(uint64_t)0x9180 << 48, (uint64_t)0x8DA0 << 48, (uint64_t)0xA9C0 << 48, (uint64_t)0xB5E0 << 48,
+};
+
+void ghash_set_key(GHASH_KEY *key, const uint8_t h[16])
+{
+	uint64_t (*T)[2] = key->Htable;
+	uint64_t hi = GETU64(h);
+	uint64_t lo = GETU64(h + 8);
+	int i;
+
+	// T[8] = H, T[4] = H * x, T[2] = H * x^2, T[1] = H * x^3
+	T[0][0] = 0;
+	T[0][1] = 0;
+	for (i = 8; i > 0; i >>= 1) {
+		T[i][0] = hi;
+		T[i][1] = lo;
+		uint64_t r = (uint64_t)0xE1 << 56 & (0 - (lo & 1));
+		lo = (hi << 63) | (lo >> 1);
+		hi = (hi >> 1) ^ r;
+	}
+	for (i = 2; i < 16; i <<= 1) {
+		int j;
+		for (j = 1; j < i; j++) {
+			T[i + j][0] = T[i][0] ^ T[j][0];
+			T[i + j][1] = T[i][1] ^ T[j][1];
+		}
+	}
+}
+
+// X = X * H
+void ghash_mul(const GHASH_KEY *key, uint8_t X[16])
+{
+	const uint64_t (*T)[2] = key->Htable;
+	uint64_t hi, lo, rem;
+	int nlo, nhi;
+	int i = 15;
+
+	nlo = X[15] & 0xf;
+	nhi = X[15] >> 4;
+	hi = T[nlo][0];
+	lo = T[nlo][1];
+
+	for (;;) {
+		rem = lo & 0xf;
+		lo = (hi << 60) | (lo >> 4);
+		hi = (hi >> 4) ^ ghash_rem_4bit[rem];
+		hi ^= T[nhi][0];
+		lo ^= T[nhi][1];
+
+		if (--i < 0) {
+			break;
+		}
+		nlo = X[i] & 0xf;
+		nhi = X[i] >> 4;
+
+		rem = lo & 0xf;
+		lo = (hi << 60) | (lo >> 4);
+		hi = (hi >> 4) ^ ghash_rem_4bit[rem];
+		hi ^= T[nlo][0];
+		lo ^= T[nlo][1];
+	}
+
+	PUTU64(X, hi);
+	PUTU64(X + 8, lo);
+}
+
+// X = (X xor in_1) * H, ..., the last partial block is zero padded
+void ghash_update(const GHASH_KEY *key, uint8_t X[16], const uint8_t *in, size_t inlen)
+{
+	size_t i;
+
+	while (inlen >= 16) {
+		for (i = 0; i < 16; i++) {
+			X[i] ^= in[i];
+		}
+		ghash_mul(key, X);
+		in += 16;
+		inlen -= 16;
+	}
+	if (inlen) {
+		for (i = 0; i < inlen; i++) {
+			X[i] ^= in[i];
+		}
+		ghash_mul(key, X);
+	}
+}
+
+// X = (X xor (nbits(A)||nbits(C))) * H
+void ghash_finish(const GHASH_KEY *key, uint8_t X[16], uint64_t aadlen, uint64_t clen)
+{
+	uint8_t L[16];
+	int i;
+
+	PUTU64(L, aadlen << 3);
+	PUTU64(L + 8, clen << 3);
+	for (i = 0; i < 16; i++) {
+		X[i] ^= L[i];
+	}
+	ghash_mul(key, X);
+}
+
+void ghash_with_key(const GHASH_KEY *key, const uint8_t *aad, size_t aadlen, const uint8_t *c, size_t clen, uint8_t out[16])
+{
+	uint8_t X[16] = {0};
+
+	ghash_update(key, X, aad, aadlen);
+	ghash_update(key, X, c, clen);
+	ghash_finish(key, X, aadlen, clen);
+	memcpy(out, X, 16);
+}
+
 /*
  * GHASH(H, A, C) = X_{m + n + 1}
  *   A additional authenticated data, A = A_1, ..., A_{m-1}, A_{m^*}, nbits(A_{m^*}) = v
@@ -34,49 +158,89 @@
  */
 void ghash(const uint8_t h[16], const uint8_t *aad, size_t aadlen, const uint8_t *c, size_t clen, uint8_t out[16])
 {
-	gf128_t H = gf128_from_bytes(h);
-	gf128_t X = gf128_zero();
-	gf128_t L;
-
-	PUTU64(out, (uint64_t)aadlen << 3);
-	PUTU64(out + 8, (uint64_t)clen << 3);
-	L = gf128_from_bytes(out);
-
-	while (aadlen) {
-		gf128_t A;
-		if (aadlen >= 16) {
-			A = gf128_from_bytes(aad);
-			aad += 16;
-			aadlen -= 16;
-		} else {
-			memset(out, 0, 16);
-			memcpy(out, aad, aadlen);
-			A = gf128_from_bytes(out);
-			aadlen = 0;
+	GHASH_KEY key;
+
+	ghash_set_key(&key, h);
+	ghash_with_key(&key, aad, aadlen, c, clen, out);
+	gmssl_secure_clear(&key, sizeof(key));
+}
+
+static void ghash_ctx_absorb(GHASH_CTX *ctx, const uint8_t *in, size_t inlen)
+{
+	size_t left;
+	size_t len;
+
+	if (ctx->block_nbytes) {
+		left = 16 - ctx->block_nbytes;
+		if (inlen < left) {
+			memcpy(ctx->block + ctx->block_nbytes, in, inlen);
+			ctx->block_nbytes += inlen;
+			return;
 		}
-		X = gf128_add(X, A);
-		X = gf128_mul(X, H);
+		memcpy(ctx->block + ctx->block_nbytes, in, left);
+		ghash_update(&ctx->key, ctx->X, ctx->block, 16);
+		in += left;
+		inlen -= left;
+	}
+	len = inlen - inlen % 16;
+	if (len) {
+		ghash_update(&ctx->key, ctx->X, in, len);
+		in += len;
+		inlen -= len;
 	}
+	if (inlen) {
+		memcpy(ctx->block, in, inlen);
+	}
+	ctx->block_nbytes = inlen;
+}
 
-	while (clen) {
-		gf128_t C;
-		if (clen >= 16) {
-			C = gf128_from_bytes(c);
-			c += 16;
-			clen -= 16;
-		} else {
-			memset(out, 0, 16);
-			memcpy(out, c, clen);
-			C = gf128_from_bytes(out);
-			clen = 0;
-		}
-		X = gf128_add(X, C);
-		X = gf128_mul(X, H);
+// pad the pending partial block with zeros
+static void ghash_ctx_flush(GHASH_CTX *ctx)
+{
+	if (ctx->block_nbytes) {
+		ghash_update(&ctx->key, ctx->X, ctx->block, ctx->block_nbytes);
+		ctx->block_nbytes = 0;
 	}
+}
+
+void ghash_ctx_init(GHASH_CTX *ctx, const uint8_t h[16])
+{
+	ghash_set_key(&ctx->key, h);
+	memset(ctx->X, 0, 16);
+	memset(ctx->block, 0, 16);
+	ctx->block_nbytes = 0;
+	ctx->aadlen = 0;
+	ctx->clen = 0;
+}
 
-	X = gf128_add(X, L);
-	H = gf128_mul(X, H);
-	gf128_to_bytes(H, out);
+int ghash_ctx_aad(GHASH_CTX *ctx, const uint8_t *aad, size_t aadlen)
+{
+	if (ctx->clen) {
+		error_print();
+		return -1;
+	}
+	ghash_ctx_absorb(ctx, aad, aadlen);
+	ctx->aadlen += aadlen;
+	return 1;
+}
+
+void ghash_ctx_update(GHASH_CTX *ctx, const uint8_t *c, size_t clen)
+{
+	if (!clen) {
+		return;
+	}
+	if (!ctx->clen) {
+		ghash_ctx_flush(ctx);
+	}
+	ghash_ctx_absorb(ctx, c, clen);
+	ctx->clen += clen;
+}
+
+void ghash_ctx_finish(GHASH_CTX *ctx, uint8_t out[16])
+{
+	ghash_ctx_flush(ctx);
+	ghash_finish(&ctx->key, ctx->X, ctx->aadlen, ctx->clen);
+	memcpy(out, ctx->X, 16);
 }
 
 int gcm_encrypt(const BLOCK_CIPHER_KEY *key, const uint8_t *iv, size_t ivlen,
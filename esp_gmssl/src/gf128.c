@@ -77,16 +77,12 @@ int gf128_print(FILE *fp, int fmt, int ind, const char *label, gf128_t a)
 
 static uint64_t reverse_bits(uint64_t a)
 {
-	uint64_t r = 0;
-	int i;
-
-	for (i = 0; i < 63; i++) {
-		r |= a & 1;
-		r <<= 1;
-		a >>= 1;
-	}
-	r |= a & 1;
-	return r;
+	a = ((a >> 1) & 0x5555555555555555ULL) | ((a & 0x5555555555555555ULL) << 1);
+	a = ((a >> 2) & 0x3333333333333333ULL) | ((a & 0x3333333333333333ULL) << 2);
+	a = ((a >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((a & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	a = ((a >> 8) & 0x00FF00FF00FF00FFULL) | ((a & 0x00FF00FF00FF00FFULL) << 8);
+	a = ((a >> 16) & 0x0000FFFF0000FFFFULL) | ((a & 0x0000FFFF0000FFFFULL) << 16);
+	return (a >> 32) | (a << 32);
 }
 
 gf128_t gf128_from_bytes(const uint8_t p[16])
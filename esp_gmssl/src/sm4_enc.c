@@ -59,8 +59,67 @@ void sm4_encrypt(const SM4_KEY *key, const unsigned char in[16], unsigned char o
 	PUTU32(out + 12, x2);
 }
 
+/*
+ * 4-block kernel, the blocks are interleaved word by word so every round key
+ * is loaded once for 4 blocks and the 4 T-box chains are independent.
+ */
+static inline uint32_t sm4_tl(uint32_t x)
+{
+	return ROL32(SM4_T[(uint8_t)x], 8) ^
+		ROL32(SM4_T[(uint8_t)(x >> 8)], 16) ^
+		ROL32(SM4_T[(uint8_t)(x >> 16)], 24) ^
+		SM4_T[x >> 24];
+}
+
+#define ROUND4(A, B, C, D, k)					\
+	A[0] ^= sm4_tl(B[0] ^ C[0] ^ D[0] ^ (k));		\
+	A[1] ^= sm4_tl(B[1] ^ C[1] ^ D[1] ^ (k));		\
+	A[2] ^= sm4_tl(B[2] ^ C[2] ^ D[2] ^ (k));		\
+	A[3] ^= sm4_tl(B[3] ^ C[3] ^ D[3] ^ (k))
+
+static void sm4_encrypt_4blocks(const uint32_t *rk, const uint32_t x[4][4], uint8_t out[64])
+{
+	uint32_t x0[4], x1[4], x2[4], x3[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		x0[i] = x[i][0];
+		x1[i] = x[i][1];
+		x2[i] = x[i][2];
+		x3[i] = x[i][3];
+	}
+	for (i = 0; i < SM4_NUM_ROUNDS; i += 4) {
+		ROUND4(x0, x1, x2, x3, rk[i]);
+		ROUND4(x1, x2, x3, x0, rk[i + 1]);
+		ROUND4(x2, x3, x0, x1, rk[i + 2]);
+		ROUND4(x3, x0, x1, x2, rk[i + 3]);
+	}
+	for (i = 0; i < 4; i++) {
+		PUTU32(out     , x3[i]);
+		PUTU32(out +  4, x2[i]);
+		PUTU32(out +  8, x1[i]);
+		PUTU32(out + 12, x0[i]);
+		out += 16;
+	}
+}
+
 void sm4_encrypt_blocks(const SM4_KEY *key, const uint8_t *in, size_t nblocks, uint8_t *out)
 {
+	uint32_t x[4][4];
+	int i;
+
+	while (nblocks >= 4) {
+		for (i = 0; i < 4; i++) {
+			x[i][0] = GETU32(in     );
+			x[i][1] = GETU32(in +  4);
+			x[i][2] = GETU32(in +  8);
+			x[i][3] = GETU32(in + 12);
+			in += 16;
+		}
+		sm4_encrypt_4blocks(key->rk, (const uint32_t (*)[4])x, out);
+		out += 64;
+		nblocks -= 4;
+	}
 	while (nblocks--) {
 		sm4_encrypt(key, in, out);
 		in += 16;
@@ -72,26 +131,30 @@ void sm4_encrypt_blocks(const SM4_KEY *key, const uint8_t *in, size_t nblocks, u
 void sm4_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
 	size_t blocks, const SM4_KEY *key, const unsigned char iv[16])
 {
-	const uint32_t *rk = key->rk;
-	unsigned int c0 = GETU32(iv     );
-	unsigned int c1 = GETU32(iv +  4);
-	unsigned int c2 = GETU32(iv +  8);
-	unsigned int c3 = GETU32(iv + 12);
-	uint32_t x0, x1, x2, x3, x4;
-	uint32_t t0, t1;
+	uint32_t x[4][4];
+	uint8_t block[64];
+	uint32_t c0 = GETU32(iv     );
+	uint32_t c1 = GETU32(iv +  4);
+	uint32_t c2 = GETU32(iv +  8);
+	uint32_t c3 = GETU32(iv + 12);
+	size_t n;
+	size_t i;
 
-	while (blocks--) {
-		x0 = c0;
-		x1 = c1;
-		x2 = c2;
-		x3 = c3;
-		ROUNDS(x0, x1, x2, x3, x4);
-		PUTU32(out     , GETU32(in     ) ^ x0);
-		PUTU32(out +  4, GETU32(in +  4) ^ x4);
-		PUTU32(out +  8, GETU32(in +  8) ^ x3);
-		PUTU32(out + 12, GETU32(in + 12) ^ x2);
-		in += 16;
-		out += 16;
-		c3++;
+	while (blocks) {
+		n = blocks < 4 ? blocks : 4;
+		for (i = 0; i < 4; i++) {
+			x[i][0] = c0;
+			x[i][1] = c1;
+			x[i][2] = c2;
+			x[i][3] = c3 + (uint32_t)i;
+		}
+		sm4_encrypt_4blocks(key->rk, (const uint32_t (*)[4])x, block);
+		for (i = 0; i < n * 16; i++) {
+			out[i] = in[i] ^ block[i];
+		}
+		in += n * 16;
+		out += n * 16;
+		c3 += (uint32_t)n;
+		blocks -= n;
 	}
 }
@@ -101,16 +101,28 @@ static void ctr_incr(uint8_t a[16])
 	}
 }
 
+// counter blocks encrypted per sm4_encrypt_blocks call
+#define SM4_CTR_BATCH_BLOCKS	4
+
 void sm4_ctr_encrypt(const SM4_KEY *key, uint8_t ctr[16], const uint8_t *in, size_t inlen, uint8_t *out)
 {
-	uint8_t block[16];
+	uint8_t block[16 * SM4_CTR_BATCH_BLOCKS];
+	size_t nblocks;
 	size_t len;
+	size_t i;
 
 	while (inlen) {
-		len = inlen < 16 ? inlen : 16;
-		sm4_encrypt(key, ctr, block);
+		nblocks = (inlen + 15) / 16;
+		if (nblocks > SM4_CTR_BATCH_BLOCKS) {
+			nblocks = SM4_CTR_BATCH_BLOCKS;
+		}
+		for (i = 0; i < nblocks; i++) {
+			memcpy(block + 16 * i, ctr, 16);
+			ctr_incr(ctr);
+		}
+		sm4_encrypt_blocks(key, block, nblocks, block);
+		len = inlen < 16 * nblocks ? inlen : 16 * nblocks;
 		gmssl_memxor(out, in, block, len);
-		ctr_incr(ctr);
 		in += len;
 		out += len;
 		inlen -= len;
@@ -121,12 +133,10 @@ int sm4_gcm_encrypt(const SM4_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	uint8_t *out, size_t taglen, uint8_t *tag)
 {
-	const uint8_t *pin = in;
-	uint8_t *pout = out;
-	size_t left = inlen;
 	uint8_t H[16] = {0};
 	uint8_t Y[16];
 	uint8_t T[16];
+	GHASH_KEY ghash_key;
 
 	if (taglen > SM4_GCM_MAX_TAG_SIZE) {
 		error_print();
@@ -134,29 +144,23 @@ int sm4_gcm_encrypt(const SM4_KEY *key, const uint8_t *iv, size_t ivlen,
 	}
 
 	sm4_encrypt(key, H, H);
+	ghash_set_key(&ghash_key, H);
 
 	if (ivlen == 12) {
 		memcpy(Y, iv, 12);
 		Y[12] = Y[13] = Y[14] = 0;
 		Y[15] = 1;
 	} else {
-		ghash(H, NULL, 0, iv, ivlen, Y);
+		ghash_with_key(&ghash_key, NULL, 0, iv, ivlen, Y);
 	}
 
 	sm4_encrypt(key, Y, T);
 
-	while (left) {
-		uint8_t block[16];
-		size_t len = left < 16 ? left : 16;
-		ctr_incr(Y);
-		sm4_encrypt(key, Y, block);
-		gmssl_memxor(pout, pin, block, len);
-		pin += len;
-		pout += len;
-		left -= len;
-	}
+	ctr_incr(Y);
+	sm4_ctr_encrypt(key, Y, in, inlen, out);
 
-	ghash(H, aad, aadlen, out, inlen, H);
+	ghash_with_key(&ghash_key, aad, aadlen, out, inlen, H);
+	gmssl_secure_clear(&ghash_key, sizeof(ghash_key));
 	gmssl_memxor(tag, T, H, taglen);
 	return 1;
 }
@@ -165,24 +169,24 @@ int sm4_gcm_decrypt(const SM4_KEY *key, const uint8_t *iv, size_t ivlen,
 	const uint8_t *aad, size_t aadlen, const uint8_t *in, size_t inlen,
 	const uint8_t *tag, size_t taglen, uint8_t *out)
 {
-	const uint8_t *pin = in;
-	uint8_t *pout = out;
-	size_t left = inlen;
 	uint8_t H[16] = {0};
 	uint8_t Y[16];
 	uint8_t T[16];
+	GHASH_KEY ghash_key;
 
 	sm4_encrypt(key, H, H);
+	ghash_set_key(&ghash_key, H);
 
 	if (ivlen == 12) {
 		memcpy(Y, iv, 12);
 		Y[12] = Y[13] = Y[14] = 0;
 		Y[15] = 1;
 	} else {
-		ghash(H, NULL, 0, iv, ivlen, Y);
+		ghash_with_key(&ghash_key, NULL, 0, iv, ivlen, Y);
 	}
 
-	ghash(H, aad, aadlen, in, inlen, H);
+	ghash_with_key(&ghash_key, aad, aadlen, in, inlen, H);
+	gmssl_secure_clear(&ghash_key, sizeof(ghash_key));
 	sm4_encrypt(key, Y, T);
 	gmssl_memxor(T, T, H, taglen);
 	if (memcmp(T, tag, taglen) != 0) {
@@ -190,16 +194,8 @@ int sm4_gcm_decrypt(const SM4_KEY *key, const uint8_t *iv, size_t ivlen,
 		return -1;
 	}
 
-	while (left) {
-		uint8_t block[16];
-		size_t len = left < 16 ? left : 16;
-		ctr_incr(Y);
-		sm4_encrypt(key, Y, block);
-		gmssl_memxor(pout, pin, block, len);
-		pin += len;
-		pout += len;
-		left -= len;
-	}
+	ctr_incr(Y);
+	sm4_ctr_encrypt(key, Y, in, inlen, out);
 	return 1;
 }
 
@@ -20,6 +20,15 @@ void app_main(void)
         gzip_deflate_write(handle, (uint8_t*)buff, strlen(buff), 0);
     }
     gzip_deflate_write(handle, (uint8_t*)"finish", strlen("finish"), 1);
+
+    // reuse the compressor, flush every 4KB input
+    gzip_deflate_reset(handle, stream_out_func, NULL);
+    gzip_deflate_set_flush(handle, GZIP_DEFLATE_FLUSH_BYTES, 4096);
+    for(int i = 0; i < 10; i++) {
+        sprintf(buff, "[%d]hello world\n", i);
+        gzip_deflate_write(handle, (uint8_t*)buff, strlen(buff), 0);
+    }
+    gzip_deflate_write(handle, NULL, 0, 1);
     gzip_deflate_destroy(handle);
 
     char* str = "Hello world!";
@@ -0,0 +1,64 @@
+#pragma once
+// the ROM tdefl calls gzip_deflate uses, on top of the host zlib: raw deflate, level 6, 32 KB window
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+typedef unsigned long mz_ulong;
+typedef unsigned int mz_uint;
+
+#define MINIZ_NO_ZLIB_APIS
+#define MZ_DEFLATED     8
+#define MZ_ADLER32_INIT 1
+enum { MZ_DEFAULT_STRATEGY = 0, MZ_FILTERED = 1, MZ_HUFFMAN_ONLY = 2, MZ_RLE = 3, MZ_FIXED = 4 };
+
+#define TDEFL_WRITE_ZLIB_HEADER         0x01000
+#define TDEFL_COMPUTE_ADLER32           0x02000
+#define TDEFL_GREEDY_PARSING_FLAG       0x04000
+#define TDEFL_RLE_MATCHES               0x10000
+#define TDEFL_FILTER_MATCHES            0x20000
+#define TDEFL_FORCE_ALL_STATIC_BLOCKS   0x40000
+#define TDEFL_FORCE_ALL_RAW_BLOCKS      0x80000
+#define TDEFL_MAX_PROBES_MASK           0xFFF
+
+typedef enum { TDEFL_STATUS_BAD_PARAM = -2, TDEFL_STATUS_PUT_BUF_FAILED = -1, TDEFL_STATUS_OKAY = 0, TDEFL_STATUS_DONE = 1 } tdefl_status;
+typedef enum { TDEFL_NO_FLUSH = 0, TDEFL_SYNC_FLUSH = 2, TDEFL_FULL_FLUSH = 3, TDEFL_FINISH = 4 } tdefl_flush;
+
+typedef struct {
+    mz_uint m_flags;
+    tdefl_status m_prev_return_status;
+    z_stream z;
+    int inited;
+} tdefl_compressor;
+
+// called on calloc'ed memory by mz_deflateInit2 and again by mz_deflateReset
+static inline tdefl_status tdefl_init(tdefl_compressor *d, void *put_buf_func, void *put_buf_user, int flags)
+{
+    d->m_flags = flags;
+    d->m_prev_return_status = TDEFL_STATUS_OKAY;
+    if(d->inited) {
+        return deflateReset(&d->z) == Z_OK ? TDEFL_STATUS_OKAY : TDEFL_STATUS_BAD_PARAM;
+    }
+    d->inited = 1;
+    int level = (flags & TDEFL_FORCE_ALL_RAW_BLOCKS) ? 0 : 6;
+    return deflateInit2(&d->z, level, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) == Z_OK ? TDEFL_STATUS_OKAY : TDEFL_STATUS_BAD_PARAM;
+}
+
+static inline tdefl_status tdefl_compress(tdefl_compressor *d, const void *in, size_t *in_size, void *out, size_t *out_size, tdefl_flush flush)
+{
+    d->z.next_in = (Bytef *)in;
+    d->z.avail_in = in ? *in_size : 0;
+    d->z.next_out = out;
+    d->z.avail_out = *out_size;
+    int r = deflate(&d->z, flush);
+    *in_size = (in ? *in_size : 0) - d->z.avail_in;
+    *out_size -= d->z.avail_out;
+    d->m_prev_return_status = r == Z_STREAM_END ? TDEFL_STATUS_DONE : (r == Z_OK || r == Z_BUF_ERROR) ? TDEFL_STATUS_OKAY : TDEFL_STATUS_BAD_PARAM;
+    return d->m_prev_return_status;
+}
+
+static inline uint32_t tdefl_get_adler32(tdefl_compressor *d)
+{
+    return d->z.adler;
+}
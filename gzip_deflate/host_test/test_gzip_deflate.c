@@ -0,0 +1,307 @@
+// host round trip test, flush policy and upload pass benchmark of gzip_deflate, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "gzip_deflate.h"
+
+#define CORPUS_SIZE (1024 * 1024)
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double cpu_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    uint8_t* data;
+    uint32_t len;
+    uint32_t size;
+    uint32_t calls;
+} sink_t;
+
+static esp_err_t sink_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    sink_t* sink = user_ctx;
+    if(sink->len + len > sink->size) {
+        return ESP_FAIL;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    sink->calls++;
+    return ESP_OK;
+}
+
+// gzip member back through zlib, which checks the crc32 and ISIZE trailer
+static int gunzip(const uint8_t* in, uint32_t inlen, uint8_t* out, uint32_t size, uint32_t* outlen)
+{
+    z_stream z = { 0 };
+    inflateInit2(&z, 16 + 15);
+    z.next_in = (Bytef*)in;
+    z.avail_in = inlen;
+    z.next_out = out;
+    z.avail_out = size;
+    int r = inflate(&z, Z_FINISH);
+    *outlen = size - z.avail_out;
+    inflateEnd(&z);
+    return r == Z_STREAM_END && z.avail_in == 0 ? 0 : -1;
+}
+
+// device log lines, the log_svr upload content
+static uint32_t log_corpus(uint8_t* buf, uint32_t size, uint32_t* lines)
+{
+    static const char* tags[] = { "wifi", "udp_music", "player", "http", "sys", "log_svr", "ota" };
+    uint32_t len = 0, ms = 1200, n = 0;
+    char line[160];
+    while(1) {
+        int k;
+        ms += rnd() % 200;
+        switch(rnd() % 6) {
+        case 0: k = snprintf(line, sizeof(line), "I (%u) %s: state: run -> assoc (%u)\n", ms, tags[0], rnd() % 16); break;
+        case 1: k = snprintf(line, sizeof(line), "W (%u) %s: jitter late %u, lost %u, recovered %u\n", ms, tags[1], rnd() % 40, rnd() % 20, rnd() % 10); break;
+        case 2: k = snprintf(line, sizeof(line), "I (%u) %s: play /sdcard/tone_%02u.wav, %u bytes\n", ms, tags[2], rnd() % 30, rnd() % 200000); break;
+        case 3: k = snprintf(line, sizeof(line), "E (%u) %s: connect to 192.168.%u.%u:%u failed, errno %u\n", ms, tags[3], rnd() % 4, rnd() % 255, 8000 + rnd() % 100, rnd() % 120); break;
+        case 4: k = snprintf(line, sizeof(line), "I (%u) %s: heap free %u, min %u, psram %u\n", ms, tags[4], 100000 + rnd() % 50000, 80000 + rnd() % 10000, rnd() % 4000000); break;
+        default: k = snprintf(line, sizeof(line), "D (%u) %s: %s chunk %u/%u crc %08x\n", ms, tags[5 + rnd() % 2], rnd() % 2 ? "upload" : "write", rnd() % 64, 64, rnd() << 8 ^ rnd()); break;
+        }
+        if(len + k > size) {
+            break;
+        }
+        memcpy(buf + len, line, k);
+        len += k;
+        n++;
+    }
+    *lines = n;
+    return len;
+}
+
+static const char* s_policy_name[] = { "none", "bytes", "sync", "full" };
+
+// random write sizes under every policy, then a reset handle on other data
+static void test_round_trip(void)
+{
+    printf("round trip, every flush policy, reset\n");
+    static uint8_t in[64 * 1024], out[128 * 1024], back[64 * 1024];
+    uint32_t lines;
+    log_corpus(in, sizeof(in), &lines);
+    for(uint32_t i = 0; i < 4096; i++) {
+        in[rnd() % sizeof(in)] = rnd(); // some noise
+    }
+    sink_t sink = { out, 0, sizeof(out), 0 };
+    gzip_deflate_handle_t handle = gzip_deflate_create(sink_out, &sink);
+    CHECK(handle != NULL);
+    for(int n = 0; n < 200; n++) {
+        gzip_deflate_flush_t flush = rnd() % 4;
+        uint32_t flush_bytes = rnd() % 3 ? rnd() % 6000 + 1 : rnd() % 20 + 1;
+        uint32_t total = rnd() % 4 ? rnd() % sizeof(in) : rnd() % 100;
+        CHECK(gzip_deflate_set_flush(handle, flush, flush_bytes) == ESP_OK);
+        if(n) {
+            sink.len = 0;
+            CHECK(gzip_deflate_reset(handle, sink_out, &sink) == ESP_OK);
+        }
+        uint32_t done = 0;
+        while(done < total) {
+            uint32_t k = rnd() % 3 ? rnd() % 200 + 1 : rnd() % 9000 + 1;
+            k = k > total - done ? total - done : k;
+            // the policy may change mid stream
+            if(rnd() % 50 == 0) {
+                CHECK(gzip_deflate_set_flush(handle, rnd() % 4, rnd() % 3000 + 1) == ESP_OK);
+            }
+            CHECK(gzip_deflate_write(handle, in + done, k, 0) == ESP_OK);
+            done += k;
+        }
+        CHECK(gzip_deflate_write(handle, NULL, 0, 1) == ESP_OK);
+        uint32_t len = 0;
+        CHECK(gunzip(out, sink.len, back, sizeof(back), &len) == 0 && len == total && memcmp(back, in, total) == 0);
+        CHECK(handle->zipsize == sink.len && handle->issize == total);
+        if(s_fail) {
+            printf("  policy %s %u, %u bytes\n", s_policy_name[flush], flush_bytes, total);
+            break;
+        }
+    }
+    gzip_deflate_destroy(handle);
+
+    int outlen = sizeof(out);
+    uint32_t len = 0;
+    CHECK(gzip_deflate(in, sizeof(in), out, &outlen) == ESP_OK);
+    CHECK(gunzip(out, outlen, back, sizeof(back), &len) == 0 && len == sizeof(in) && memcmp(back, in, len) == 0);
+    outlen = 40;
+    CHECK(gzip_deflate(in, sizeof(in), out, &outlen) == ESP_FAIL);
+}
+
+static void test_params(void)
+{
+    printf("invalid parameters\n");
+    uint8_t out[64];
+    sink_t sink = { out, 0, sizeof(out), 0 };
+    gzip_deflate_handle_t handle = gzip_deflate_create(sink_out, &sink);
+    CHECK(gzip_deflate_set_flush(handle, GZIP_DEFLATE_FLUSH_BYTES, 0) == ESP_FAIL);
+    CHECK(gzip_deflate_set_flush(handle, GZIP_DEFLATE_FLUSH_FULL + 1, 0) == ESP_FAIL);
+    CHECK(gzip_deflate_set_flush(NULL, GZIP_DEFLATE_FLUSH_NONE, 0) == ESP_FAIL);
+    CHECK(gzip_deflate_write(handle, NULL, 0, 0) == ESP_FAIL);
+    // none stages small writes, nothing but the header leaves before 4 KB
+    CHECK(gzip_deflate_set_flush(handle, GZIP_DEFLATE_FLUSH_NONE, 0) == ESP_OK);
+    CHECK(gzip_deflate_write(handle, (uint8_t*)"hello\n", 6, 0) == ESP_OK && sink.len == sizeof(gzip_header_t));
+    gzip_deflate_destroy(handle);
+}
+
+// the corpus written one log line per call, as log_svr does
+static void bench(void)
+{
+    static uint8_t in[CORPUS_SIZE], out[2 * CORPUS_SIZE];
+    uint32_t lines;
+    uint32_t size = log_corpus(in, sizeof(in), &lines);
+    static const struct {
+        gzip_deflate_flush_t flush;
+        uint32_t bytes;
+    } policies[] = {
+        { GZIP_DEFLATE_FLUSH_NONE, 0 }, { GZIP_DEFLATE_FLUSH_BYTES, 512 }, { GZIP_DEFLATE_FLUSH_BYTES, 4096 },
+        { GZIP_DEFLATE_FLUSH_SYNC, 0 }, { GZIP_DEFLATE_FLUSH_FULL, 0 },
+    };
+    printf("bench %u log lines, %u bytes, one write per line\n", lines, size);
+    sink_t sink = { out, 0, sizeof(out), 0 };
+    gzip_deflate_handle_t handle = gzip_deflate_create(sink_out, &sink);
+    for(int p = 0; p < 5; p++) {
+        gzip_deflate_set_flush(handle, policies[p].flush, policies[p].bytes);
+        double best = 1e9;
+        for(int r = 0; r < 3; r++) {
+            sink.len = 0;
+            sink.calls = 0;
+            double t = now_s();
+            gzip_deflate_reset(handle, sink_out, &sink);
+            for(uint32_t i = 0, j = 0; i < size; i = j) {
+                for(j = i; in[j] != '\n'; j++);
+                j++;
+                gzip_deflate_write(handle, in + i, j - i, 0);
+            }
+            gzip_deflate_write(handle, NULL, 0, 1);
+            t = now_s() - t;
+            best = t < best ? t : best;
+        }
+        uint32_t len = 0;
+        static uint8_t back[CORPUS_SIZE];
+        CHECK(gunzip(out, sink.len, back, sizeof(back), &len) == 0 && len == size);
+        char name[16];
+        snprintf(name, sizeof(name), policies[p].bytes ? "%s %u" : "%s", s_policy_name[policies[p].flush], policies[p].bytes);
+        printf("  %-10s ratio %5.2f, %6u bytes out in %6u calls, %5.1f MB/s\n", name, (double)size / sink.len, sink.len,
+            sink.calls, size / best / 1e6);
+    }
+    gzip_deflate_destroy(handle);
+}
+
+// size pass of the two pass upload, only counts the output
+static esp_err_t count_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    sink_t* sink = user_ctx;
+    sink->len += len;
+    sink->calls++;
+    return ESP_OK;
+}
+
+// chunked upload, every write framed as one chunk as http_cli does
+static esp_err_t chunk_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    char size[12];
+    int k = snprintf(size, sizeof(size), "%x\r\n", len);
+    sink_t* sink = user_ctx;
+    if(sink->len + k + len + 2 > sink->size) {
+        return ESP_FAIL;
+    }
+    memcpy(sink->data + sink->len, size, k);
+    memcpy(sink->data + sink->len + k, data, len);
+    memcpy(sink->data + sink->len + k + len, "\r\n", 2);
+    sink->len += k + len + 2;
+    sink->calls++;
+    return ESP_OK;
+}
+
+static void deflate_lines(gzip_deflate_handle_t handle, gzip_stream_out_t out, sink_t* sink, const uint8_t* in, uint32_t size)
+{
+    gzip_deflate_reset(handle, out, sink);
+    for(uint32_t i = 0, j = 0; i < size; i = j) {
+        for(j = i; in[j] != '\n'; j++);
+        j++;
+        gzip_deflate_write(handle, (uint8_t*)in + i, j - i, 0);
+    }
+    gzip_deflate_write(handle, NULL, 0, 1);
+}
+
+// log_svr upload: deflate once for Content-Length and again to send, or once with chunked encoding.
+// input bytes per CPU second, the cost the device pays per uploaded log byte
+static void bench_upload(void)
+{
+    static uint8_t in[CORPUS_SIZE], out[2 * CORPUS_SIZE], back[CORPUS_SIZE];
+    uint32_t lines;
+    uint32_t size = log_corpus(in, sizeof(in), &lines);
+    sink_t sink = { out, 0, sizeof(out), 0 };
+    gzip_deflate_handle_t handle = gzip_deflate_create(sink_out, &sink);
+    gzip_deflate_set_flush(handle, GZIP_DEFLATE_FLUSH_NONE, 0);
+    double best_double = 1e9, best_single = 1e9;
+    uint32_t wire_double = 0, wire_single = 0;
+
+    printf("bench upload %u log lines, %u bytes, flush none as log_svr\n", lines, size);
+    for(int r = 0; r < 5; r++) {
+        sink_t count = { NULL, 0, 0, 0 };
+        double t = cpu_s();
+        deflate_lines(handle, count_out, &count, in, size);
+        sink.len = 0;
+        deflate_lines(handle, sink_out, &sink, in, size);
+        t = cpu_s() - t;
+        CHECK(count.len == sink.len);
+        best_double = t < best_double ? t : best_double;
+        wire_double = sink.len;
+
+        sink.len = 0;
+        t = cpu_s();
+        deflate_lines(handle, chunk_out, &sink, in, size);
+        t = cpu_s() - t;
+        best_single = t < best_single ? t : best_single;
+        wire_single = sink.len;
+    }
+    // the chunked body back to the gzip member
+    uint32_t zip = 0, len = 0;
+    for(uint32_t i = 0; i < sink.len;) {
+        uint32_t k = strtoul((char*)out + i, NULL, 16);
+        i = (uint8_t*)strstr((char*)out + i, "\r\n") - out + 2;
+        memmove(out + zip, out + i, k);
+        zip += k;
+        i += k + 2;
+    }
+    CHECK(zip == wire_double);
+    CHECK(gunzip(out, zip, back, sizeof(back), &len) == 0 && len == size && memcmp(back, in, size) == 0);
+    printf("  two pass  %5.1f MB/CPU-s, %u bytes on the wire\n", size / best_double / 1e6, wire_double);
+    printf("  one pass  %5.1f MB/CPU-s, %u bytes on the wire, %u chunk framing (%.2fx)\n", size / best_single / 1e6,
+        wire_single, wire_single - wire_double, best_double / best_single);
+    CHECK(best_single < best_double);
+    gzip_deflate_destroy(handle);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_params();
+    bench();
+    bench_upload();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
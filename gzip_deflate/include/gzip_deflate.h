@@ -40,6 +40,14 @@ typedef mz_stream *mz_streamp;
 
 #define GZIP_DEFLATE_LEVEL      MZ_DEFAULT_LEVEL // -1 ~ 10
 #define GZIP_DEFLATE_BUFF_SIZE  1024
+#define GZIP_DEFLATE_STAGE_SIZE (4 * 1024) // input staging buffer, used by none/bytes flush policy
+
+typedef enum {
+    GZIP_DEFLATE_FLUSH_NONE = 0, // flush only on finish, small writes are staged
+    GZIP_DEFLATE_FLUSH_BYTES,    // sync flush every N input bytes, small writes are staged
+    GZIP_DEFLATE_FLUSH_SYNC,     // sync flush every write (default)
+    GZIP_DEFLATE_FLUSH_FULL,     // full flush every write, reset the dictionary
+} gzip_deflate_flush_t;
 
 typedef esp_err_t(*gzip_stream_out_t)(uint8_t* data, uint32_t len, void* user_ctx);
 
@@ -62,6 +70,11 @@ typedef struct {
     uint8_t       buffer[GZIP_DEFLATE_BUFF_SIZE];
     gzip_stream_out_t stream_out;
     void*         user_ctx;
+    gzip_deflate_flush_t flush;
+    uint32_t      flush_bytes;
+    uint32_t      unflushed; // input bytes since last flush
+    uint32_t      stage_len;
+    uint8_t       stage[GZIP_DEFLATE_STAGE_SIZE];
 } gzip_deflate_t;
 
 typedef gzip_deflate_t* gzip_deflate_handle_t;
@@ -72,6 +85,8 @@ extern "C" {
 
 gzip_deflate_handle_t gzip_deflate_create(gzip_stream_out_t stream_out, void* user_ctx);
 esp_err_t gzip_deflate_destroy(gzip_deflate_handle_t handle);
+esp_err_t gzip_deflate_reset(gzip_deflate_handle_t handle, gzip_stream_out_t stream_out, void* user_ctx);
+esp_err_t gzip_deflate_set_flush(gzip_deflate_handle_t handle, gzip_deflate_flush_t flush, uint32_t flush_bytes);
 esp_err_t gzip_deflate_write(gzip_deflate_handle_t handle, uint8_t* data, uint32_t len, int is_finish);
 esp_err_t gzip_deflate(uint8_t *in, int inlen, uint8_t *out, int *outlen);
 
@@ -1,5 +1,6 @@
 #include "gzip_deflate.h"
 #include "esp_log.h"
+#include "crc.h"
 
 const static char* TAG = "gzip";
 
@@ -41,6 +42,7 @@ enum {
 
 static int mz_deflateInit2(mz_streamp pStream, int level, int method, int window_bits, int mem_level, int strategy);
 static int mz_deflate(mz_streamp pStream, int flush);
+static int mz_deflateReset(mz_streamp pStream);
 static int mz_deflateEnd(mz_streamp pStream);
 
 static const char *mz_error(int err)
@@ -171,6 +173,15 @@ static int mz_deflate(mz_streamp pStream, int flush)
     return mz_status;
 }
 
+static int mz_deflateReset(mz_streamp pStream)
+{
+    if ((!pStream) || (!pStream->state))
+        return MZ_STREAM_ERROR;
+    pStream->total_in = pStream->total_out = 0;
+    tdefl_init((tdefl_compressor *)pStream->state, NULL, NULL, ((tdefl_compressor *)pStream->state)->m_flags);
+    return MZ_OK;
+}
+
 static int mz_deflateEnd(mz_streamp pStream)
 {
     if (!pStream)
@@ -201,13 +212,8 @@ typedef enum {
     GZIP_OS_Unknown = 0xFF
 } gzip_os_t;
 
-gzip_deflate_handle_t gzip_deflate_create(gzip_stream_out_t stream_out, void* user_ctx)
+static esp_err_t _gzip_deflate_begin(gzip_deflate_handle_t handle, gzip_stream_out_t stream_out, void* user_ctx)
 {
-    gzip_deflate_handle_t handle = (gzip_deflate_handle_t)malloc(sizeof(gzip_deflate_t));
-    if(handle == NULL) {
-        ESP_LOGE(TAG, "gzip deflate create malloc failed.");
-        goto create_failed;
-    }
     handle->header.id1 = 0x1F;
     handle->header.id2 = 0x8B;
     handle->header.compression = MZ_DEFLATED;
@@ -218,23 +224,79 @@ gzip_deflate_handle_t gzip_deflate_create(gzip_stream_out_t stream_out, void* us
     handle->header.mtime[3] = 0x00;
     handle->header.extra_flags = 0;
     handle->header.os = GZIP_OS_Unknown;
-    handle->crc32 = MZ_CRC32_INIT;
+    handle->crc32 = CRC32_IEEE_INIT;
     handle->issize = 0;
     handle->zipsize = sizeof(handle->header) + sizeof(handle->crc32) + sizeof(handle->issize);
-
-    memset(&handle->stream, 0, sizeof(handle->stream));
-    if(mz_deflateInit2(&handle->stream, GZIP_DEFLATE_LEVEL, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK) {
-        ESP_LOGE(TAG, "gzip deflate miniz stream init failed.");
-        goto create_failed;
-    }
+    handle->unflushed = 0;
+    handle->stage_len = 0;
 
     handle->user_ctx = user_ctx;
     handle->stream_out = stream_out;
     if(handle->stream_out) {
         if(handle->stream_out((uint8_t*)&handle->header, sizeof(handle->header), handle->user_ctx) != ESP_OK) {
             ESP_LOGE(TAG, "gzip deflate stream out failed.");
-            goto create_failed;
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+// deflate data to output buffer and stream out, flush: MZ_NO_FLUSH ~ MZ_FINISH
+static esp_err_t _gzip_deflate_compress(gzip_deflate_handle_t handle, uint8_t* data, uint32_t len, int flush)
+{
+    uint32_t deflate_size = 0;
+    handle->stream.next_in = data;
+    handle->stream.avail_in = len;
+
+    do {
+        handle->stream.next_out = handle->buffer;
+        handle->stream.avail_out = GZIP_DEFLATE_BUFF_SIZE;
+        int status = mz_deflate(&handle->stream, flush);
+        if(status < 0 && !((status == MZ_BUF_ERROR) && (flush == MZ_NO_FLUSH))) { // no flush, no progress is not error
+            ESP_LOGE(TAG, "gzip deflate failed.");
+            return ESP_FAIL;
+        }
+        deflate_size = GZIP_DEFLATE_BUFF_SIZE - handle->stream.avail_out;
+        handle->zipsize += deflate_size;
+        if(handle->stream_out && deflate_size) {
+            if(handle->stream_out(handle->buffer, deflate_size, handle->user_ctx) != ESP_OK) {
+                ESP_LOGE(TAG, "gzip deflate stream out failed.");
+                return ESP_FAIL;
+            }
         }
+    } while(handle->stream.avail_out == 0);
+    return ESP_OK;
+}
+
+// deflate staging buffer
+static esp_err_t _gzip_deflate_stage_drain(gzip_deflate_handle_t handle, int flush)
+{
+    if(handle->stage_len == 0 && flush == MZ_NO_FLUSH) {
+        return ESP_OK;
+    }
+    uint32_t stage_len = handle->stage_len;
+    handle->stage_len = 0;
+    return _gzip_deflate_compress(handle, handle->stage, stage_len, flush);
+}
+
+gzip_deflate_handle_t gzip_deflate_create(gzip_stream_out_t stream_out, void* user_ctx)
+{
+    gzip_deflate_handle_t handle = (gzip_deflate_handle_t)malloc(sizeof(gzip_deflate_t));
+    if(handle == NULL) {
+        ESP_LOGE(TAG, "gzip deflate create malloc failed.");
+        goto create_failed;
+    }
+    handle->flush = GZIP_DEFLATE_FLUSH_SYNC;
+    handle->flush_bytes = 0;
+
+    memset(&handle->stream, 0, sizeof(handle->stream));
+    if(mz_deflateInit2(&handle->stream, GZIP_DEFLATE_LEVEL, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK) {
+        ESP_LOGE(TAG, "gzip deflate miniz stream init failed.");
+        goto create_failed;
+    }
+
+    if(_gzip_deflate_begin(handle, stream_out, user_ctx) != ESP_OK) {
+        goto create_failed;
     }
     ESP_LOGI(TAG, "gzip deflate create success.");
     return handle;
@@ -257,10 +319,37 @@ esp_err_t gzip_deflate_destroy(gzip_deflate_handle_t handle)
     return ESP_OK;
 }
 
+esp_err_t gzip_deflate_reset(gzip_deflate_handle_t handle, gzip_stream_out_t stream_out, void* user_ctx)
+{
+    if(handle == NULL) {
+        ESP_LOGE(TAG, "gzip deflate handle is null.");
+        return ESP_FAIL;
+    }
+    // reuse the compressor, avoid malloc and free tdefl_compressor
+    if(mz_deflateReset(&handle->stream) != MZ_OK) {
+        ESP_LOGE(TAG, "gzip deflate miniz stream reset failed.");
+        return ESP_FAIL;
+    }
+    return _gzip_deflate_begin(handle, stream_out, user_ctx);
+}
+
+esp_err_t gzip_deflate_set_flush(gzip_deflate_handle_t handle, gzip_deflate_flush_t flush, uint32_t flush_bytes)
+{
+    if(handle == NULL) {
+        ESP_LOGE(TAG, "gzip deflate handle is null.");
+        return ESP_FAIL;
+    }
+    if((flush > GZIP_DEFLATE_FLUSH_FULL) || ((flush == GZIP_DEFLATE_FLUSH_BYTES) && (flush_bytes == 0))) {
+        ESP_LOGE(TAG, "gzip deflate flush param error.");
+        return ESP_FAIL;
+    }
+    handle->flush = flush;
+    handle->flush_bytes = flush_bytes;
+    return ESP_OK;
+}
+
 esp_err_t gzip_deflate_write(gzip_deflate_handle_t handle, uint8_t* data, uint32_t len, int is_finish)
 {
-    int flush = is_finish ? MZ_FINISH : MZ_SYNC_FLUSH;
-    uint32_t deflate_size = 0;
     if(handle == NULL) {
         ESP_LOGE(TAG, "gzip deflate handle is null.");
         return ESP_FAIL;
@@ -270,30 +359,48 @@ esp_err_t gzip_deflate_write(gzip_deflate_handle_t handle, uint8_t* data, uint32
         return ESP_FAIL;
     }
 
-    handle->stream.next_in = data;
-    handle->stream.avail_in = len;
-
     if(data && len) {
-        handle->crc32 = mz_crc32(handle->crc32, data, len);
+        handle->crc32 = crc32_ieee_update(handle->crc32, data, len);
         handle->issize += len;
     }
 
-    do {
-        handle->stream.next_out = handle->buffer;
-        handle->stream.avail_out = GZIP_DEFLATE_BUFF_SIZE;
-        if(mz_deflate(&handle->stream, flush) < 0) {
-            ESP_LOGE(TAG, "gzip deflate failed.");
+    if((handle->flush == GZIP_DEFLATE_FLUSH_SYNC) || (handle->flush == GZIP_DEFLATE_FLUSH_FULL)) {
+        int flush = (handle->flush == GZIP_DEFLATE_FLUSH_SYNC) ? MZ_SYNC_FLUSH : MZ_FULL_FLUSH;
+        // staged data by last flush policy
+        if(_gzip_deflate_stage_drain(handle, MZ_NO_FLUSH) != ESP_OK) {
             return ESP_FAIL;
         }
-        deflate_size = GZIP_DEFLATE_BUFF_SIZE - handle->stream.avail_out;
-        handle->zipsize += deflate_size;
-        if(handle->stream_out) {
-            if(handle->stream_out(handle->buffer, deflate_size, handle->user_ctx) != ESP_OK) {
-                ESP_LOGE(TAG, "gzip deflate stream out failed.");
-                return ESP_FAIL;
+        if(_gzip_deflate_compress(handle, data, len, is_finish ? MZ_FINISH : flush) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    } else {
+        while(data && len) {
+            uint32_t size = GZIP_DEFLATE_STAGE_SIZE - handle->stage_len;
+            size = (len < size) ? len : size;
+            if(handle->flush == GZIP_DEFLATE_FLUSH_BYTES) {
+                uint32_t remain = handle->flush_bytes - handle->unflushed;
+                size = (remain < size) ? remain : size;
+            }
+            memcpy(handle->stage + handle->stage_len, data, size);
+            handle->stage_len += size;
+            handle->unflushed += size;
+            data += size;
+            len -= size;
+            if((handle->flush == GZIP_DEFLATE_FLUSH_BYTES) && (handle->unflushed >= handle->flush_bytes)) {
+                if(_gzip_deflate_stage_drain(handle, MZ_SYNC_FLUSH) != ESP_OK) {
+                    return ESP_FAIL;
+                }
+                handle->unflushed = 0;
+            } else if(handle->stage_len == GZIP_DEFLATE_STAGE_SIZE) {
+                if(_gzip_deflate_stage_drain(handle, MZ_NO_FLUSH) != ESP_OK) {
+                    return ESP_FAIL;
+                }
             }
         }
-    } while(handle->stream.avail_out == 0);
+        if(is_finish && _gzip_deflate_stage_drain(handle, MZ_FINISH) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
 
     if(is_finish && handle->stream_out) {
         if(handle->stream_out((uint8_t*)&handle->crc32, sizeof(handle->crc32), handle->user_ctx) != ESP_OK) {
@@ -312,7 +419,7 @@ esp_err_t gzip_deflate(uint8_t *in, int inlen, uint8_t *out, int *outlen)
 {
     esp_err_t ret = ESP_FAIL;
     gzip_header_t header = { 0 };
-    uint32_t crc32 = MZ_CRC32_INIT, issize = 0;
+    uint32_t crc32 = CRC32_IEEE_INIT, issize = 0;
     uint32_t fmt_size = sizeof(gzip_header_t) + sizeof(crc32) + sizeof(issize);
     if(!in || !inlen || !out || !outlen || (*outlen <= fmt_size)) {
         ESP_LOGE(TAG, "gzip deflate param error");
@@ -343,7 +450,7 @@ esp_err_t gzip_deflate(uint8_t *in, int inlen, uint8_t *out, int *outlen)
         header.mtime[3] = 0x00;
         header.extra_flags = 0;
         header.os = GZIP_OS_Unknown;
-        crc32 = mz_crc32(crc32, in, inlen);
+        crc32 = crc32_ieee_update(crc32, in, inlen);
         issize = inlen;
         memcpy(out, &header, sizeof(header));
         memcpy(out + sizeof(header) + stream.total_out, &crc32, sizeof(crc32));
@@ -8,6 +8,12 @@
 #include "mbedtls/base64.h"
 #include "gzip_inflate.h"
 
+static esp_err_t _stream_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    printf("%.*s", (int)len, (char*)data);
+    return ESP_OK;
+}
+
 void app_main(void)
 {
     printf("Hello world!\n");
@@ -26,4 +32,21 @@ void app_main(void)
     }
     printf("gzip inflate success\n");
     printf("%s\n", out2);
+
+    gzip_inflate_handle_t handle = gzip_inflate_create(_stream_out, NULL);
+    if(handle == NULL) {
+        return;
+    }
+    // feed the data in small pieces, as if it came from the network
+    for(int i = 0; i < len1; i += 16) {
+        int len = (len1 - i) < 16 ? (len1 - i) : 16;
+        if(gzip_inflate_write(handle, out1 + i, len) != ESP_OK) {
+            printf("gzip_inflate_write failed\n");
+            break;
+        }
+    }
+    if(gzip_inflate_finish(handle) == ESP_OK) {
+        printf("\ngzip stream inflate success, size: %u\n", (unsigned)gzip_inflate_get_size(handle));
+    }
+    gzip_inflate_destroy(handle);
 }
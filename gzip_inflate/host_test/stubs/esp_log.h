@@ -0,0 +1,8 @@
+#pragma once
+#include <stdio.h>
+#define ESP_LOGE(tag, fmt, ...) do { if(!stub_log_quiet) printf("E %s: " fmt "\n", tag, ##__VA_ARGS__); } while(0)
+#define ESP_LOGW(tag, fmt, ...) do { if(!stub_log_quiet) printf("W %s: " fmt "\n", tag, ##__VA_ARGS__); } while(0)
+#define ESP_LOGI(tag, fmt, ...) do { } while(0)
+
+// set by the tests that feed broken input on purpose
+extern int stub_log_quiet;
@@ -0,0 +1,40 @@
+#pragma once
+// the ROM tinfl calls gzip_inflate uses, on top of the host zlib raw inflate, see tinfl.c
+#include <stdint.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    int m_state;                    // 0 after tinfl_init, like the ROM
+    int done;
+    z_stream z;
+    size_t arena_used;
+    uint64_t arena[48 * 1024 / 8];  // zlib state and window, so a freed decompressor leaks nothing
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while(0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *pIn_buf_next, size_t *pIn_buf_size,
+    uint8_t *pOut_buf_start, uint8_t *pOut_buf_next, size_t *pOut_buf_size, const uint32_t decomp_flags);
+
+// bytes past the end of the deflate data reported as consumed with DONE, the ROM tinfl
+// keeps up to 7 of them in its 64-bit bit buffer, zlib stops exactly at the end
+extern size_t tinfl_overread;
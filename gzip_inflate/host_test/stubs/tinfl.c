@@ -0,0 +1,65 @@
+// tinfl_decompress for the host tests, zlib raw inflate with tinfl's status codes
+#include <string.h>
+#include "rom/miniz.h"
+
+size_t tinfl_overread;
+int stub_log_quiet;
+
+static voidpf arena_alloc(voidpf opaque, uInt items, uInt size)
+{
+    tinfl_decompressor *r = (tinfl_decompressor *)opaque;
+    size_t n = ((size_t)items * size + 7) & ~(size_t)7;
+    if(r->arena_used + n > sizeof(r->arena)) {
+        return Z_NULL;
+    }
+    void *p = (uint8_t *)r->arena + r->arena_used;
+    r->arena_used += n;
+    return p;
+}
+
+static void arena_free(voidpf opaque, voidpf p)
+{
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *pIn_buf_next, size_t *pIn_buf_size,
+    uint8_t *pOut_buf_start, uint8_t *pOut_buf_next, size_t *pOut_buf_size, const uint32_t decomp_flags)
+{
+    if(r->m_state == 0) {
+        memset(&r->z, 0, sizeof(r->z));
+        r->arena_used = 0;
+        r->z.zalloc = arena_alloc;
+        r->z.zfree = arena_free;
+        r->z.opaque = r;
+        if(inflateInit2(&r->z, -15) != Z_OK) {
+            return TINFL_STATUS_FAILED;
+        }
+        r->m_state = 1;
+        r->done = 0;
+    }
+    if(r->done) {
+        *pIn_buf_size = 0;
+        *pOut_buf_size = 0;
+        return TINFL_STATUS_DONE;
+    }
+    r->z.next_in = (Bytef *)pIn_buf_next;
+    r->z.avail_in = *pIn_buf_size;
+    r->z.next_out = pOut_buf_next;
+    r->z.avail_out = *pOut_buf_size;
+    int ret = inflate(&r->z, Z_NO_FLUSH);
+    size_t in_used = *pIn_buf_size - r->z.avail_in;
+    *pOut_buf_size -= r->z.avail_out;
+    if(ret == Z_STREAM_END) {
+        size_t extra = r->z.avail_in < tinfl_overread ? r->z.avail_in : tinfl_overread;
+        *pIn_buf_size = in_used + extra;
+        r->done = 1;
+        return TINFL_STATUS_DONE;
+    }
+    *pIn_buf_size = in_used;
+    if(ret != Z_OK && ret != Z_BUF_ERROR) {
+        return TINFL_STATUS_FAILED;
+    }
+    if(r->z.avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    }
+    return (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_FAILED;
+}
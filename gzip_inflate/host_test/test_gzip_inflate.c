@@ -0,0 +1,375 @@
+// host test of gzip_inflate: header flags, arbitrary input splits, trailer checks, members, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "esp_log.h"
+#include "gzip_inflate.h"
+
+#define MAX_RAW     (80 * 1024)
+#define MAX_GZ      (3 * MAX_RAW)
+
+static int s_fail;
+static uint32_t s_rand = 11;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+typedef struct {
+    uint8_t* data;
+    uint32_t len;
+    uint32_t size;
+} sink_t;
+
+static esp_err_t sink_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    sink_t* sink = user_ctx;
+    if(sink->len + len > sink->size) {
+        return ESP_FAIL;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    return ESP_OK;
+}
+
+// log lines: compressible, matches reach back across the 32 KB window
+static uint32_t make_text(uint8_t* p, uint32_t len)
+{
+    uint32_t n = 0;
+    while(n < len) {
+        n += snprintf((char*)p + n, len - n, "I (%u) udp_stream: seq %u len %u\n", rnd() % 100000, rnd() % 5000, rnd() % 1500);
+    }
+    return len;
+}
+
+// incompressible, deflate falls back to stored blocks
+static uint32_t make_random(uint8_t* p, uint32_t len)
+{
+    for(uint32_t i = 0; i < len; i++) {
+        p[i] = rnd();
+    }
+    return len;
+}
+
+static void put_le32(uint8_t* p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+#define F_HCRC      0x02
+#define F_EXTRA     0x04
+#define F_NAME      0x08
+#define F_COMMENT   0x10
+
+// one gzip member with the optional header fields in flags, returns its size
+static uint32_t make_gzip(uint8_t* gz, uint8_t flags, const uint8_t* raw, uint32_t len)
+{
+    uint32_t n = 0;
+    static const uint8_t head[10] = { 0x1f, 0x8b, 8, 0, 0x12, 0x34, 0x56, 0x78, 0, 3 };
+    memcpy(gz, head, 10);
+    gz[3] = flags;
+    n = 10;
+    if(flags & F_EXTRA) {
+        uint32_t xlen = rnd() % 3 == 0 ? 0 : rnd() % 40;
+        gz[n++] = xlen;
+        gz[n++] = xlen >> 8;
+        for(uint32_t i = 0; i < xlen; i++) {
+            gz[n++] = rnd();
+        }
+    }
+    if(flags & F_NAME) {
+        n += sprintf((char*)gz + n, "log_%u.txt", rnd() % 1000) + 1;
+    }
+    if(flags & F_COMMENT) {
+        n += sprintf((char*)gz + n, "%s", rnd() % 2 ? "" : "captured on the device") + 1;
+    }
+    if(flags & F_HCRC) {
+        uint32_t hcrc = crc32(0, gz, n);
+        gz[n++] = hcrc;
+        gz[n++] = hcrc >> 8;
+    }
+    z_stream z = { 0 };
+    deflateInit2(&z, 1 + rnd() % 9, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    z.next_in = (Bytef*)raw;
+    z.avail_in = len;
+    z.next_out = gz + n;
+    z.avail_out = MAX_GZ - n - 8;
+    deflate(&z, Z_FINISH);
+    n += z.total_out;
+    deflateEnd(&z);
+    put_le32(gz + n, crc32(0, raw, len));
+    put_le32(gz + n + 4, len);
+    return n + 8;
+}
+
+// streams gz in the given pieces, returns 0 and the output in sink if write and finish succeed
+static int stream(const uint8_t* gz, uint32_t gzlen, const uint32_t* cuts, int ncuts, sink_t* sink)
+{
+    static gzip_inflate_handle_t handle;
+    if(handle == NULL) {
+        handle = gzip_inflate_create(sink_out, sink);
+    }
+    gzip_inflate_reset(handle, sink_out, sink);
+    sink->len = 0;
+    uint32_t ofs = 0;
+    for(int i = 0; i <= ncuts; i++) {
+        uint32_t end = i < ncuts ? cuts[i] : gzlen;
+        if(gzip_inflate_write(handle, (uint8_t*)gz + ofs, end - ofs) != ESP_OK) {
+            return -1;
+        }
+        ofs = end;
+    }
+    if(gzip_inflate_finish(handle) != ESP_OK) {
+        return -1;
+    }
+    return gzip_inflate_get_size(handle) == sink->len ? 0 : -2;
+}
+
+// what gzip_inflate_size does without GZIP_INFLATE_SIZE_FROM_TRAILER, inflate and count
+static int count_size(uint8_t* gz, uint32_t gzlen)
+{
+    int size = 0;
+    gzip_inflate_handle_t handle = gzip_inflate_create(NULL, NULL);
+    if(gzip_inflate_write(handle, gz, gzlen) == ESP_OK && gzip_inflate_finish(handle) == ESP_OK) {
+        size = gzip_inflate_get_size(handle);
+    }
+    gzip_inflate_destroy(handle);
+    return size;
+}
+
+static uint8_t s_raw[MAX_RAW * 3], s_gz[MAX_GZ], s_out[MAX_RAW * 3];
+static sink_t s_sink = { s_out, 0, sizeof(s_out) };
+
+static int same(const uint8_t* raw, uint32_t len)
+{
+    return s_sink.len == len && memcmp(s_out, raw, len) == 0;
+}
+
+static void test_splits(void)
+{
+    printf("single member, split in two at every offset, every header flag, tinfl over-read 0..8\n");
+    for(int r = 0; r < 64; r++) {
+        uint8_t flags = r % 32 & (F_HCRC | F_EXTRA | F_NAME | F_COMMENT);
+        uint32_t len = r < 4 ? make_text(s_raw, r * 3) : r % 3 ? make_text(s_raw, 100 + rnd() % 3000) : make_random(s_raw, 1 + rnd() % 1500);
+        uint32_t gzlen = make_gzip(s_gz, flags, s_raw, len);
+        tinfl_overread = r % 9;
+        for(uint32_t cut = 0; cut <= gzlen; cut++) {
+            int ret = stream(s_gz, gzlen, &cut, 1, &s_sink);
+            CHECK(ret == 0);
+            CHECK(same(s_raw, len));
+            if(ret || !same(s_raw, len)) {
+                printf("  len %u gzlen %u flags %02x cut %u overread %u\n", len, gzlen, flags, cut, (unsigned)tinfl_overread);
+                return;
+            }
+        }
+    }
+}
+
+static void test_byte_feed(void)
+{
+    printf("1-byte writes and random pieces, up to 80 KB members\n");
+    for(int r = 0; r < 24; r++) {
+        static uint32_t cuts[MAX_GZ];
+        uint32_t len = r % 2 ? make_text(s_raw, 1 + rnd() % MAX_RAW) : make_random(s_raw, 1 + rnd() % MAX_RAW);
+        uint32_t gzlen = make_gzip(s_gz, rnd() % 32 & 0x1e, s_raw, len);
+        int ncuts = 0;
+        tinfl_overread = rnd() % 9;
+        if(r < 8) {
+            for(uint32_t i = 1; i < gzlen; i++) {
+                cuts[ncuts++] = i;
+            }
+        } else {
+            for(uint32_t i = rnd() % 64; i < gzlen; i += rnd() % (rnd() % 2 ? 16 : 4096)) {
+                cuts[ncuts++] = i;
+            }
+        }
+        CHECK(stream(s_gz, gzlen, cuts, ncuts, &s_sink) == 0);
+        CHECK(same(s_raw, len));
+    }
+}
+
+static void test_members(void)
+{
+    printf("concatenated members, streamed in random pieces, gzip_inflate_alloc and gzip_inflate_size\n");
+    stub_log_quiet = 1;     // the single member fast paths log before they fall back
+    for(int r = 0; r < 40; r++) {
+        uint32_t cuts[64];
+        uint32_t rawlen = 0, gzlen = 0;
+        int members = 2 + rnd() % 3;
+        tinfl_overread = rnd() % 9;
+        for(int m = 0; m < members; m++) {
+            uint32_t len = m == 1 && r % 4 == 0 ? 0 : rnd() % 2 ? make_text(s_raw + rawlen, rnd() % 20000) : make_random(s_raw + rawlen, rnd() % 300);
+            gzlen += make_gzip(s_gz + gzlen, rnd() % 32 & 0x1e, s_raw + rawlen, len);
+            rawlen += len;
+        }
+        int ncuts = rnd() % 64;
+        for(int i = 0; i < ncuts; i++) {
+            cuts[i] = rnd() % (gzlen + 1);
+        }
+        for(int i = 1; i < ncuts; i++) {
+            for(int j = i; j > 0 && cuts[j - 1] > cuts[j]; j--) {
+                uint32_t t = cuts[j];
+                cuts[j] = cuts[j - 1];
+                cuts[j - 1] = t;
+            }
+        }
+        CHECK(stream(s_gz, gzlen, cuts, ncuts, &s_sink) == 0);
+        CHECK(same(s_raw, rawlen));
+
+        uint8_t* out = NULL;
+        int outlen = 0;
+        CHECK(gzip_inflate_alloc(s_gz, gzlen, &out, &outlen) == ESP_OK);
+        CHECK(out && outlen == (int)rawlen && memcmp(out, s_raw, rawlen) == 0);
+        free(out);
+        CHECK(gzip_inflate_size(s_gz, gzlen) == (int)rawlen);
+    }
+    stub_log_quiet = 0;
+}
+
+static void test_one_shot(void)
+{
+    printf("gzip_inflate and gzip_inflate_alloc on a single member\n");
+    for(int r = 0; r < 40; r++) {
+        uint32_t len = r % 2 ? make_text(s_raw, rnd() % MAX_RAW) : make_random(s_raw, rnd() % 5000);
+        uint32_t gzlen = make_gzip(s_gz, rnd() % 32 & 0x1e, s_raw, len);
+        tinfl_overread = rnd() % 9;
+        int outlen = sizeof(s_out);
+        CHECK(gzip_inflate(s_gz, gzlen, s_out, &outlen) == ESP_OK);
+        CHECK(outlen == (int)len && memcmp(s_out, s_raw, len) == 0);
+        if(len) {
+            outlen = len - 1;
+            stub_log_quiet = 1;
+            CHECK(gzip_inflate(s_gz, gzlen, s_out, &outlen) != ESP_OK);
+            stub_log_quiet = 0;
+        }
+        uint8_t* out = NULL;
+        CHECK(gzip_inflate_alloc(s_gz, gzlen, &out, &outlen) == ESP_OK);
+        CHECK(out && outlen == (int)len && memcmp(out, s_raw, len) == 0);
+        free(out);
+        CHECK(gzip_inflate_size(s_gz, gzlen) == (int)len);
+    }
+}
+
+static void test_corrupt(void)
+{
+    printf("corrupt CRC32, ISIZE, FHCRC, reserved flags, truncated input, garbage after the member\n");
+    stub_log_quiet = 1;
+    for(int r = 0; r < 60; r++) {
+        uint32_t len = make_text(s_raw, 1 + rnd() % 4000);
+        uint32_t gzlen = make_gzip(s_gz, (r % 2 ? F_HCRC : 0) | (rnd() % 32 & 0x1c), s_raw, len);
+        uint32_t cut = rnd() % (gzlen + 1);
+        int outlen;
+        tinfl_overread = rnd() % 9;
+
+        // every bit of the trailer is checked
+        uint32_t at = gzlen - 8 + rnd() % 8;
+        uint8_t bit = 1 << rnd() % 8;
+        s_gz[at] ^= bit;
+        CHECK(stream(s_gz, gzlen, &cut, 1, &s_sink) != 0);
+        outlen = sizeof(s_out);
+        CHECK(gzip_inflate(s_gz, gzlen, s_out, &outlen) != ESP_OK);
+        CHECK(count_size(s_gz, gzlen) == 0);
+#if !GZIP_INFLATE_SIZE_FROM_TRAILER
+        CHECK(gzip_inflate_size(s_gz, gzlen) == 0);
+#endif
+        s_gz[at] ^= bit;
+
+        // truncated anywhere, even one byte short of the trailer
+        uint32_t short_len = r < 8 ? gzlen - 1 - r : rnd() % gzlen;
+        cut = rnd() % (short_len + 1);
+        CHECK(stream(s_gz, short_len, &cut, 1, &s_sink) != 0);
+        outlen = sizeof(s_out);
+        CHECK(gzip_inflate(s_gz, short_len, s_out, &outlen) != ESP_OK);
+
+        // a trailing byte that does not start a member
+        s_gz[gzlen] = 0x1f;
+        CHECK(stream(s_gz, gzlen + 1, &cut, 1, &s_sink) != 0);
+
+        // header crc and reserved flags
+        if(r % 2) {
+            s_gz[4] ^= 1;  // MTIME is covered by FHCRC
+            CHECK(stream(s_gz, gzlen, &cut, 1, &s_sink) != 0);
+            outlen = sizeof(s_out);
+            CHECK(gzip_inflate(s_gz, gzlen, s_out, &outlen) != ESP_OK);
+            s_gz[4] ^= 1;
+        }
+        s_gz[3] |= 0x20;
+        CHECK(stream(s_gz, gzlen, &cut, 1, &s_sink) != 0);
+        s_gz[3] &= ~0x20;
+
+        CHECK(stream(s_gz, gzlen, &cut, 1, &s_sink) == 0);
+        CHECK(same(s_raw, len));
+    }
+    stub_log_quiet = 0;
+}
+
+#if GZIP_INFLATE_SIZE_FROM_TRAILER
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// gzip_inflate_size from the trailer against counting by inflating, log text of 100 KB to 1 MB
+static void bench(void)
+{
+    static const uint32_t sizes[] = { 100 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024 };
+    uint8_t* raw = malloc(sizes[3]);
+    uint8_t* gz = malloc(sizes[3] + 1024);
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t len = make_text(raw, sizes[i]);
+        uLongf gzlen = sizes[3] + 1024;
+        z_stream z = { 0 };
+        deflateInit2(&z, 6, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY);
+        z.next_in = raw;
+        z.avail_in = len;
+        z.next_out = gz;
+        z.avail_out = gzlen;
+        deflate(&z, Z_FINISH);
+        gzlen = z.total_out;
+        deflateEnd(&z);
+
+        int n, size = 0;
+        double t = now_s();
+        for(n = 0; now_s() - t < 0.3; n++) {
+            size = gzip_inflate_size(gz, gzlen);
+        }
+        double us_trailer = (now_s() - t) / n * 1e6;
+        CHECK(size == (int)len);
+        t = now_s();
+        for(n = 0; now_s() - t < 0.3; n++) {
+            size = count_size(gz, gzlen);
+        }
+        double us_count = (now_s() - t) / n * 1e6;
+        CHECK(size == (int)len);
+        printf("bench gzip_inflate_size %4u KB (%3u KB gz): trailer %7.1f us, inflate count %8.1f us (%.0fx)\n",
+               len / 1024, (uint32_t)gzlen / 1024, us_trailer, us_count, us_count / us_trailer);
+    }
+    free(raw);
+    free(gz);
+}
+#endif
+
+int main(void)
+{
+    test_splits();
+    test_byte_feed();
+    test_members();
+    test_one_shot();
+    test_corrupt();
+#if GZIP_INFLATE_SIZE_FROM_TRAILER
+    bench();
+#endif
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -2,14 +2,78 @@
 #define __GZIP_INFLATE_H__
 
 #include "stdio.h"
+#include "stdint.h"
+#include "esp_idf_version.h"
+#if (ESP_IDF_VERSION_MAJOR == 4) && (ESP_IDF_VERSION_MINOR < 3)
+#include "esp32/rom/miniz.h"
+#else
+#include "rom/miniz.h"
+#endif
 #include "esp_err.h"
 
+// 1: gzip_inflate_size reads ISIZE from the trailer of a single member, input with another member
+// header or an implausible trailer is counted by inflating. ISIZE is not verified on this path, the
+// inflate that follows verifies it. 0: always count by inflating, which also rejects corrupt input.
+// Input that is not in memory as a whole is counted by streaming it, see gzip_inflate_get_size.
+#ifndef GZIP_INFLATE_SIZE_FROM_TRAILER
+#define GZIP_INFLATE_SIZE_FROM_TRAILER 1
+#endif
+
+// bytes tinfl may consume past the end of the deflate data before it reports DONE
+#define GZIP_INFLATE_OVERREAD_MAX (8)
+
+typedef esp_err_t(*gzip_inflate_stream_out_t)(uint8_t* data, uint32_t len, void* user_ctx);
+
+typedef enum {
+    GZIP_INFLATE_STATE_HEADER = 0, // fixed 10 bytes header
+    GZIP_INFLATE_STATE_EXTRA_LEN,  // 2 bytes FEXTRA length
+    GZIP_INFLATE_STATE_EXTRA,      // FEXTRA data
+    GZIP_INFLATE_STATE_NAME,       // zero terminated FNAME
+    GZIP_INFLATE_STATE_COMMENT,    // zero terminated FCOMMENT
+    GZIP_INFLATE_STATE_HCRC,       // 2 bytes FHCRC
+    GZIP_INFLATE_STATE_BODY,       // deflate data
+    GZIP_INFLATE_STATE_TRAILER,    // CRC32 and ISIZE
+    GZIP_INFLATE_STATE_ERROR,
+} gzip_inflate_state_t;
+
+typedef struct {
+    gzip_inflate_state_t state;
+    uint8_t       flags;
+    uint8_t       head[10];  // header field gathered so far
+    uint32_t      head_len;
+    uint8_t       trail[GZIP_INFLATE_OVERREAD_MAX + 8]; // last bytes fed to tinfl, then the trailer
+    uint32_t      trail_len;
+    uint32_t      trail_ofs; // bytes of trail tinfl had consumed when it finished the member
+    uint32_t      skip;      // FEXTRA bytes left to skip
+    uint32_t      crc32;     // crc32 of the current member
+    uint32_t      isize;     // inflated size of the current member
+    uint32_t      total_out; // inflated size of all members
+    uint32_t      members;   // verified members
+    uint32_t      dict_ofs;
+    uint32_t      hcrc;      // crc32 of the header bytes for FHCRC
+    gzip_inflate_stream_out_t stream_out;
+    void*         user_ctx;
+    tinfl_decompressor decomp;
+    uint8_t       dict[TINFL_LZ_DICT_SIZE]; // output window, stream out directly from it
+} gzip_inflate_t;
+
+typedef gzip_inflate_t* gzip_inflate_handle_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+gzip_inflate_handle_t gzip_inflate_create(gzip_inflate_stream_out_t stream_out, void* user_ctx);
+esp_err_t gzip_inflate_destroy(gzip_inflate_handle_t handle);
+esp_err_t gzip_inflate_reset(gzip_inflate_handle_t handle, gzip_inflate_stream_out_t stream_out, void* user_ctx);
+esp_err_t gzip_inflate_write(gzip_inflate_handle_t handle, uint8_t* data, uint32_t len);
+esp_err_t gzip_inflate_finish(gzip_inflate_handle_t handle);
+uint32_t gzip_inflate_get_size(gzip_inflate_handle_t handle);
+
 esp_err_t gzip_inflate(uint8_t *in, int inlen, uint8_t *out, int *outlen);
 int gzip_inflate_size(uint8_t *in, int inlen);
+// inflate all members into a malloc'd buffer sized once, free *out after use
+esp_err_t gzip_inflate_alloc(uint8_t *in, int inlen, uint8_t **out, int *outlen);
 
 #ifdef __cplusplus
 }
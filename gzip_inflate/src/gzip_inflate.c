@@ -1,449 +1,580 @@
 #include "gzip_inflate.h"
 
 #include "stdio.h"
+#include "stdlib.h"
 #include "stdint.h"
 #include "string.h"
 #include "stdbool.h"
-#include "esp_idf_version.h"
-#if (ESP_IDF_VERSION_MAJOR == 4) && (ESP_IDF_VERSION_MINOR < 3)
-#include "esp32/rom/miniz.h"
-#else
-#include "rom/miniz.h"
-#endif
 #include "esp_err.h"
 #include "esp_log.h"
+#include "crc.h"
 
-// Add the API missing in miniz of ROM code
-// Original code can be gotten from: https://github.com/richgel999/miniz/blob/master/miniz.c
-#ifdef MINIZ_NO_ZLIB_APIS
-
-// Flush values. For typical usage you only need MZ_NO_FLUSH and MZ_FINISH. The other values are for advanced use (refer
-// to the zlib docs).
-enum { MZ_NO_FLUSH = 0, MZ_PARTIAL_FLUSH = 1, MZ_SYNC_FLUSH = 2, MZ_FULL_FLUSH = 3, MZ_FINISH = 4, MZ_BLOCK = 5 };
-
-// Return status codes. MZ_PARAM_ERROR is non-standard.
-enum {
-    MZ_OK = 0,
-    MZ_STREAM_END = 1,
-    MZ_NEED_DICT = 2,
-    MZ_ERRNO = -1,
-    MZ_STREAM_ERROR = -2,
-    MZ_DATA_ERROR = -3,
-    MZ_MEM_ERROR = -4,
-    MZ_BUF_ERROR = -5,
-    MZ_VERSION_ERROR = -6,
-    MZ_PARAM_ERROR = -10000
-};
-
-// Compression levels: 0-9 are the standard zlib-style levels, 10 is best possible compression (not zlib compatible, and
-// may be very slow), MZ_DEFAULT_COMPRESSION=MZ_DEFAULT_LEVEL.
-enum {
-    MZ_NO_COMPRESSION = 0,
-    MZ_BEST_SPEED = 1,
-    MZ_BEST_COMPRESSION = 9,
-    MZ_UBER_COMPRESSION = 10,
-    MZ_DEFAULT_LEVEL = 6,
-    MZ_DEFAULT_COMPRESSION = -1
-};
-
-// Window bits
-#define MZ_DEFAULT_WINDOW_BITS 15
-#define MZ_MIN(a, b)           (a > b ? b : a)
-
-struct mz_internal_state;
-
-// Compression/decompression stream struct.
-typedef struct mz_stream_s {
-    const unsigned char      *next_in;   // pointer to next byte to read
-    unsigned int              avail_in;  // number of bytes available at next_in
-    mz_ulong                  total_in;  // total number of bytes consumed so far
-
-    unsigned char            *next_out;  // pointer to next byte to write
-    unsigned int              avail_out; // number of bytes that can be written to next_out
-    mz_ulong                  total_out; // total number of bytes produced so far
-
-    char                     *msg;       // error msg (unused)
-    struct mz_internal_state *state;     // internal state, allocated by zalloc/zfree
-
-    int                       data_type; // data_type (unused)
-    mz_ulong                  adler;     // adler32 of the source or uncompressed data
-    mz_ulong                  crc32;     // crc32 of the source or uncompressed data
-} mz_stream;
+static const char* TAG = "GZIP_INFLATE";
+#define GZIP_HEADER_SIZE  (10)
+#define GZIP_TRAILER_SIZE (8)
 
-typedef mz_stream *mz_streamp;
+#define GZIP_FLAG_FHCRC    (0x02)
+#define GZIP_FLAG_FEXTRA   (0x04)
+#define GZIP_FLAG_FNAME    (0x08)
+#define GZIP_FLAG_FCOMMENT (0x10)
+#define GZIP_FLAG_RESERVED (0xE0)
 
-typedef struct {
-    tinfl_decompressor m_decomp;
-    mz_uint            m_dict_ofs, m_dict_avail, m_first_call, m_has_flushed;
-    int                m_window_bits;
-    mz_uint8           m_dict[TINFL_LZ_DICT_SIZE];
-    tinfl_status       m_last_status;
-} inflate_state;
+#define GZIP_DEFLATE_MAX_RATIO (1032) // deflate can not expand better than ~1032:1
 
-static const char *mz_error(int err)
+static uint32_t _gzip_get_le32(const uint8_t* p)
 {
-    static struct
-    {
-        int m_err;
-        const char *m_pDesc;
-    } s_error_descs[] =
-        {
-          { MZ_OK, "" }, { MZ_STREAM_END, "stream end" }, { MZ_NEED_DICT, "need dictionary" }, { MZ_ERRNO, "file error" }, { MZ_STREAM_ERROR, "stream error" }, { MZ_DATA_ERROR, "data error" }, { MZ_MEM_ERROR, "out of memory" }, { MZ_BUF_ERROR, "buf error" }, { MZ_VERSION_ERROR, "version error" }, { MZ_PARAM_ERROR, "parameter error" }
-        };
-    mz_uint i;
-    for (i = 0; i < sizeof(s_error_descs) / sizeof(s_error_descs[0]); ++i)
-        if (s_error_descs[i].m_err == err)
-            return s_error_descs[i].m_pDesc;
-    return "";
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-static int mz_inflateInit2(mz_streamp pStream, int window_bits)
+static bool _gzip_verify_header(const uint8_t* head)
 {
-    inflate_state *pDecomp;
-    if (!pStream)
-        return MZ_STREAM_ERROR;
-    if ((window_bits != MZ_DEFAULT_WINDOW_BITS) && (-window_bits != MZ_DEFAULT_WINDOW_BITS))
-        return MZ_PARAM_ERROR;
-
-    pStream->data_type = 0;
-    pStream->adler = 0;
-    pStream->crc32 = 0;
-    pStream->msg = NULL;
-    pStream->total_in = 0;
-    pStream->total_out = 0;
-
-    pDecomp = (inflate_state *) calloc(1, sizeof(inflate_state));
-    if (!pDecomp)
-        return MZ_MEM_ERROR;
-
-    pStream->state = (struct mz_internal_state *) pDecomp;
-
-    tinfl_init(&pDecomp->m_decomp);
-    pDecomp->m_dict_ofs = 0;
-    pDecomp->m_dict_avail = 0;
-    pDecomp->m_last_status = TINFL_STATUS_NEEDS_MORE_INPUT;
-    pDecomp->m_first_call = 1;
-    pDecomp->m_has_flushed = 0;
-    pDecomp->m_window_bits = window_bits;
-
-    return MZ_OK;
+    if (head[0] != 0x1F || head[1] != 0x8B || head[2] != 0x8) {
+        return false;
+    }
+    if (head[3] & GZIP_FLAG_RESERVED) {
+        return false;
+    }
+    return true;
 }
 
-static int mz_inflate(mz_streamp pStream, int flush)
+static void _gzip_put_le32(uint8_t* p, uint32_t v)
 {
-    inflate_state *pState;
-    mz_uint n, first_call, decomp_flags = TINFL_FLAG_COMPUTE_ADLER32;
-    size_t in_bytes, out_bytes, orig_avail_in;
-    tinfl_status status;
-
-    if ((!pStream) || (!pStream->state))
-        return MZ_STREAM_ERROR;
-    if (flush == MZ_PARTIAL_FLUSH)
-        flush = MZ_SYNC_FLUSH;
-    if ((flush) && (flush != MZ_SYNC_FLUSH) && (flush != MZ_FINISH))
-        return MZ_STREAM_ERROR;
-
-    pState = (inflate_state *) pStream->state;
-    if (pState->m_window_bits > 0)
-        decomp_flags |= TINFL_FLAG_PARSE_ZLIB_HEADER;
-    orig_avail_in = pStream->avail_in;
-
-    first_call = pState->m_first_call;
-    pState->m_first_call = 0;
-    if (pState->m_last_status < 0)
-        return MZ_DATA_ERROR;
-
-    if (pState->m_has_flushed && (flush != MZ_FINISH))
-        return MZ_STREAM_ERROR;
-    pState->m_has_flushed |= (flush == MZ_FINISH);
-
-    if ((flush == MZ_FINISH) && (first_call)) {
-        // MZ_FINISH on the first call implies that the input and output buffers are large enough to hold the entire
-        // compressed/decompressed file.
-        decomp_flags |= TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
-        in_bytes = pStream->avail_in;
-        out_bytes = pStream->avail_out;
-        status = tinfl_decompress(&pState->m_decomp, pStream->next_in, &in_bytes, pStream->next_out, pStream->next_out,
-                                  &out_bytes, decomp_flags);
-        pState->m_last_status = status;
-        pStream->next_in += (mz_uint) in_bytes;
-        pStream->avail_in -= (mz_uint) in_bytes;
-        pStream->total_in += (mz_uint) in_bytes;
-        pStream->adler = tinfl_get_adler32(&pState->m_decomp);
-        pStream->next_out += (mz_uint) out_bytes;
-        pStream->avail_out -= (mz_uint) out_bytes;
-        pStream->total_out += (mz_uint) out_bytes;
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
 
-        if (status < 0)
-            return MZ_DATA_ERROR;
-        else if (status != TINFL_STATUS_DONE) {
-            pState->m_last_status = TINFL_STATUS_FAILED;
-            return MZ_BUF_ERROR;
+// size of the header of a complete gzip member in memory, -1 if invalid or truncated
+static int _gzip_header_size(const uint8_t* in, int inlen)
+{
+    if (inlen < GZIP_HEADER_SIZE || !_gzip_verify_header(in)) {
+        return -1;
+    }
+    uint8_t flags = in[3];
+    int pos = GZIP_HEADER_SIZE;
+    if (flags & GZIP_FLAG_FEXTRA) {
+        if (pos + 2 > inlen) {
+            return -1;
         }
-        return MZ_STREAM_END;
+        pos += 2 + (in[pos] | (in[pos + 1] << 8));
     }
-    // flush != MZ_FINISH then we must assume there's more input.
-    if (flush != MZ_FINISH)
-        decomp_flags |= TINFL_FLAG_HAS_MORE_INPUT;
-
-    if (pState->m_dict_avail) {
-        n = MZ_MIN(pState->m_dict_avail, pStream->avail_out);
-        memcpy(pStream->next_out, pState->m_dict + pState->m_dict_ofs, n);
-        pStream->next_out += n;
-        pStream->avail_out -= n;
-        pStream->total_out += n;
-        pState->m_dict_avail -= n;
-        pState->m_dict_ofs = (pState->m_dict_ofs + n) & (TINFL_LZ_DICT_SIZE - 1);
-        return ((pState->m_last_status == TINFL_STATUS_DONE) && (!pState->m_dict_avail)) ? MZ_STREAM_END : MZ_OK;
+    if (flags & GZIP_FLAG_FNAME) {
+        while (pos < inlen && in[pos] != '\0') {
+            pos++;
+        }
+        pos++;
+    }
+    if (flags & GZIP_FLAG_FCOMMENT) {
+        while (pos < inlen && in[pos] != '\0') {
+            pos++;
+        }
+        pos++;
+    }
+    if (flags & GZIP_FLAG_FHCRC) {
+        if (pos + 2 > inlen) {
+            return -1;
+        }
+        uint32_t hcrc = crc32_ieee_update(CRC32_IEEE_INIT, in, pos);
+        if ((hcrc & 0xFFFF) != (uint32_t)(in[pos] | (in[pos + 1] << 8))) {
+            ESP_LOGE(TAG, "gzip inflate header crc mismatch");
+            return -1;
+        }
+        pos += 2;
     }
+    return (pos < inlen) ? pos : -1;
+}
 
-    for (;;) {
-        in_bytes = pStream->avail_in;
-        out_bytes = TINFL_LZ_DICT_SIZE - pState->m_dict_ofs;
+/*
+ * tinfl reports how many input bytes it consumed, and when it returns DONE that count may
+ * include a few bytes past the end of the deflate data (ROM tinfl keeps them in its bit
+ * buffer). The trailer therefore starts at most GZIP_INFLATE_OVERREAD_MAX bytes before
+ * the consumed end. buf holds n consumed bytes followed by the input after them, the
+ * trailer is the first 8 bytes at n - k, k = 0..n, that carry the crc32 and isize just
+ * computed. Returns its offset in buf, -1 if none matches within len.
+ */
+static int _gzip_find_trailer(const uint8_t* buf, uint32_t n, uint32_t len, uint32_t crc32, uint32_t isize)
+{
+    uint8_t expect[GZIP_TRAILER_SIZE];
+    _gzip_put_le32(expect, crc32);
+    _gzip_put_le32(expect + 4, isize);
+    for (uint32_t k = 0; k <= n; k++) {
+        uint32_t pos = n - k;
+        if (pos + GZIP_TRAILER_SIZE <= len && memcmp(buf + pos, expect, GZIP_TRAILER_SIZE) == 0) {
+            return (int)pos;
+        }
+    }
+    return -1;
+}
 
-        status = tinfl_decompress(&pState->m_decomp, pStream->next_in, &in_bytes, pState->m_dict,
-                                  pState->m_dict + pState->m_dict_ofs, &out_bytes, decomp_flags);
-        pState->m_last_status = status;
+// keep the last GZIP_INFLATE_OVERREAD_MAX bytes handed to tinfl in trail
+static void _gzip_inflate_keep_tail(gzip_inflate_handle_t handle, const uint8_t* data, uint32_t len)
+{
+    if (len >= GZIP_INFLATE_OVERREAD_MAX) {
+        memcpy(handle->trail, data + len - GZIP_INFLATE_OVERREAD_MAX, GZIP_INFLATE_OVERREAD_MAX);
+        handle->trail_len = GZIP_INFLATE_OVERREAD_MAX;
+        return;
+    }
+    uint32_t keep = GZIP_INFLATE_OVERREAD_MAX - len;
+    if (handle->trail_len > keep) {
+        memmove(handle->trail, handle->trail + handle->trail_len - keep, keep);
+        handle->trail_len = keep;
+    }
+    memcpy(handle->trail + handle->trail_len, data, len);
+    handle->trail_len += len;
+}
 
-        pStream->next_in += (mz_uint) in_bytes;
-        pStream->avail_in -= (mz_uint) in_bytes;
-        pStream->total_in += (mz_uint) in_bytes;
-        pStream->adler = tinfl_get_adler32(&pState->m_decomp);
+// next header field by flags, or deflate data
+static void _gzip_inflate_next_field(gzip_inflate_handle_t handle)
+{
+    handle->head_len = 0;
+    if (handle->flags & GZIP_FLAG_FEXTRA) {
+        handle->flags &= ~GZIP_FLAG_FEXTRA;
+        handle->state = GZIP_INFLATE_STATE_EXTRA_LEN;
+    } else if (handle->flags & GZIP_FLAG_FNAME) {
+        handle->flags &= ~GZIP_FLAG_FNAME;
+        handle->state = GZIP_INFLATE_STATE_NAME;
+    } else if (handle->flags & GZIP_FLAG_FCOMMENT) {
+        handle->flags &= ~GZIP_FLAG_FCOMMENT;
+        handle->state = GZIP_INFLATE_STATE_COMMENT;
+    } else if (handle->flags & GZIP_FLAG_FHCRC) {
+        handle->flags &= ~GZIP_FLAG_FHCRC;
+        handle->state = GZIP_INFLATE_STATE_HCRC;
+    } else {
+        tinfl_init(&handle->decomp);
+        handle->crc32 = CRC32_IEEE_INIT;
+        handle->isize = 0;
+        handle->dict_ofs = 0;
+        handle->trail_len = 0;
+        handle->state = GZIP_INFLATE_STATE_BODY;
+    }
+}
 
-        pState->m_dict_avail = (mz_uint) out_bytes;
+// gather up to size bytes into head, true when complete
+static bool _gzip_inflate_gather(gzip_inflate_handle_t handle, uint32_t size, uint8_t** data, uint32_t* len)
+{
+    uint32_t n = size - handle->head_len;
+    n = (*len < n) ? *len : n;
+    memcpy(handle->head + handle->head_len, *data, n);
+    handle->head_len += n;
+    *data += n;
+    *len -= n;
+    return handle->head_len == size;
+}
 
-        n = MZ_MIN(pState->m_dict_avail, pStream->avail_out);
-        memcpy(pStream->next_out, pState->m_dict + pState->m_dict_ofs, n);
-        pStream->next_out += n;
-        pStream->avail_out -= n;
-        pStream->total_out += n;
-        pState->m_dict_avail -= n;
-        pState->m_dict_ofs = (pState->m_dict_ofs + n) & (TINFL_LZ_DICT_SIZE - 1);
+static esp_err_t _gzip_inflate_body(gzip_inflate_handle_t handle, uint8_t** data, uint32_t* len)
+{
+    tinfl_status status;
+    do {
+        size_t in_bytes = *len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - handle->dict_ofs;
+        uint8_t* out = handle->dict + handle->dict_ofs;
+        status = tinfl_decompress(&handle->decomp, *data, &in_bytes, handle->dict, out, &out_bytes, TINFL_FLAG_HAS_MORE_INPUT);
+        _gzip_inflate_keep_tail(handle, *data, in_bytes);
+        *data += in_bytes;
+        *len -= in_bytes;
+        if (out_bytes) {
+            handle->crc32 = crc32_ieee_update(handle->crc32, out, out_bytes);
+            handle->isize += out_bytes;
+            handle->total_out += out_bytes;
+            handle->dict_ofs = (handle->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+            if (handle->stream_out && handle->stream_out(out, out_bytes, handle->user_ctx) != ESP_OK) {
+                ESP_LOGE(TAG, "gzip inflate stream out failed.");
+                return ESP_FAIL;
+            }
+        }
+        if (status < 0) {
+            ESP_LOGE(TAG, "gzip inflate failed, status: %d", status);
+            return ESP_FAIL;
+        }
+    } while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
 
-        if (status < 0)
-            return MZ_DATA_ERROR; // Stream is corrupted (there could be some uncompressed data left in the output
-                                  // dictionary - oh well).
-        else if ((status == TINFL_STATUS_NEEDS_MORE_INPUT) && (!orig_avail_in))
-            return MZ_BUF_ERROR; // Signal caller that we can't make forward progress without supplying more input or by
-                                 // setting flush to MZ_FINISH.
-        else if (flush == MZ_FINISH) {
-            // The output buffer MUST be large to hold the remaining uncompressed data when flush==MZ_FINISH.
-            if (status == TINFL_STATUS_DONE)
-                return pState->m_dict_avail ? MZ_BUF_ERROR : MZ_STREAM_END;
-            // status here must be TINFL_STATUS_HAS_MORE_OUTPUT, which means there's at least 1 more byte on the way. If
-            // there's no more room left in the output buffer then something is wrong.
-            else if (!pStream->avail_out)
-                return MZ_BUF_ERROR;
-        } else if ((status == TINFL_STATUS_DONE) || (!pStream->avail_in) || (!pStream->avail_out) ||
-                   (pState->m_dict_avail))
-            break;
+    if (status == TINFL_STATUS_DONE) {
+        handle->trail_ofs = handle->trail_len;
+        handle->state = GZIP_INFLATE_STATE_TRAILER;
     }
+    return ESP_OK;
+}
 
-    return ((status == TINFL_STATUS_DONE) && (!pState->m_dict_avail)) ? MZ_STREAM_END : MZ_OK;
+static void _gzip_inflate_begin(gzip_inflate_handle_t handle, gzip_inflate_stream_out_t stream_out, void* user_ctx)
+{
+    handle->state = GZIP_INFLATE_STATE_HEADER;
+    handle->flags = 0;
+    handle->head_len = 0;
+    handle->skip = 0;
+    handle->crc32 = CRC32_IEEE_INIT;
+    handle->isize = 0;
+    handle->total_out = 0;
+    handle->members = 0;
+    handle->dict_ofs = 0;
+    handle->hcrc = CRC32_IEEE_INIT;
+    handle->trail_len = 0;
+    handle->trail_ofs = 0;
+    handle->stream_out = stream_out;
+    handle->user_ctx = user_ctx;
 }
 
-static int mz_inflateEnd(mz_streamp pStream)
+gzip_inflate_handle_t gzip_inflate_create(gzip_inflate_stream_out_t stream_out, void* user_ctx)
 {
-    if (!pStream)
-        return MZ_STREAM_ERROR;
-    if (pStream->state) {
-        free(pStream->state);
-        pStream->state = NULL;
+    gzip_inflate_handle_t handle = (gzip_inflate_handle_t)malloc(sizeof(gzip_inflate_t));
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "gzip inflate create malloc failed.");
+        return NULL;
     }
-    return MZ_OK;
+    _gzip_inflate_begin(handle, stream_out, user_ctx);
+    ESP_LOGI(TAG, "gzip inflate create success.");
+    return handle;
 }
 
-#endif // MINIZ_NO_ZLIB_APIS
+esp_err_t gzip_inflate_destroy(gzip_inflate_handle_t handle)
+{
+    if (handle) {
+        free(handle);
+    }
+    ESP_LOGI(TAG, "gzip inflate destory success.");
+    return ESP_OK;
+}
 
-static const char* TAG = "GZIP_INFLATE";
-#define GZIP_HEADER_SIZE (10)
+esp_err_t gzip_inflate_reset(gzip_inflate_handle_t handle, gzip_inflate_stream_out_t stream_out, void* user_ctx)
+{
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "gzip inflate handle is null.");
+        return ESP_FAIL;
+    }
+    _gzip_inflate_begin(handle, stream_out, user_ctx);
+    return ESP_OK;
+}
 
-typedef struct {
-    int              head_flag;
-    int              extra_len;
-    int              head_filled;
-    mz_stream        stream;
-} gzip_inflate_t;
+// header bytes also go into the FHCRC crc
+static void _gzip_inflate_hcrc(gzip_inflate_handle_t handle, const uint8_t* data, uint32_t len)
+{
+    handle->hcrc = crc32_ieee_update(handle->hcrc, data, len);
+}
 
-static bool _gzip_verify_header(gzip_inflate_t *gzip, uint8_t *data, int size)
+// a member is complete, bytes after its trailer start the next member
+static esp_err_t _gzip_inflate_member_done(gzip_inflate_handle_t handle, int pos)
 {
-    if (size < GZIP_HEADER_SIZE) {
-        return false;
-    }
-    if (data[0] != 0x1F || data[1] != 0x8B || data[2] != 0x8) {
-        return false;
-    }
-    gzip->head_flag = data[3];
-    return true;
+    uint8_t rest[GZIP_INFLATE_OVERREAD_MAX];
+    uint32_t rest_len = handle->trail_len - pos - GZIP_TRAILER_SIZE;
+    memcpy(rest, handle->trail + pos + GZIP_TRAILER_SIZE, rest_len);
+    // concatenated members are allowed
+    handle->members++;
+    handle->head_len = 0;
+    handle->hcrc = CRC32_IEEE_INIT;
+    handle->trail_len = 0;
+    handle->state = GZIP_INFLATE_STATE_HEADER;
+    return rest_len ? gzip_inflate_write(handle, rest, rest_len) : ESP_OK;
 }
 
-static int _gzip_skip_header(gzip_inflate_t *gzip, uint8_t *data, int size)
+esp_err_t gzip_inflate_write(gzip_inflate_handle_t handle, uint8_t* data, uint32_t len)
 {
-    if (gzip->head_flag == 0) {
-        return 0;
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "gzip inflate handle is null.");
+        return ESP_FAIL;
     }
-    int org_size = size;
-    if (gzip->head_flag & 4) {
-        // 2 bytes extra len
-        if (gzip->head_filled > 2) {
-            return -1;
-        }
-        if (gzip->head_filled + size >= 2) {
-            int used = 2 - gzip->head_filled;
-            if (used) {
-                size -= used;
-                while (used--) {
-                    gzip->extra_len = gzip->extra_len + (*data << (gzip->head_filled * 8));
-                    gzip->head_filled++;
-                    data++;
+    if (data == NULL && len) {
+        ESP_LOGE(TAG, "gzip inflate data is null.");
+        return ESP_FAIL;
+    }
+    while (len) {
+        switch (handle->state) {
+        case GZIP_INFLATE_STATE_HEADER:
+            if (_gzip_inflate_gather(handle, GZIP_HEADER_SIZE, &data, &len)) {
+                if (!_gzip_verify_header(handle->head)) {
+                    ESP_LOGE(TAG, "gzip inflate header error");
+                    goto _write_failed;
                 }
+                _gzip_inflate_hcrc(handle, handle->head, GZIP_HEADER_SIZE);
+                handle->flags = handle->head[3];
+                _gzip_inflate_next_field(handle);
             }
-            if (size >= gzip->extra_len) {
-                size -= gzip->extra_len;
-                data += gzip->extra_len;
-                gzip->extra_len = 0;
-                gzip->head_flag &= ~4;
-                gzip->head_filled = 0;
-            } else {
-                gzip->extra_len -= size;
-                return org_size;
+            break;
+        case GZIP_INFLATE_STATE_EXTRA_LEN:
+            if (_gzip_inflate_gather(handle, 2, &data, &len)) {
+                _gzip_inflate_hcrc(handle, handle->head, 2);
+                handle->skip = handle->head[0] | (handle->head[1] << 8);
+                handle->head_len = 0;
+                handle->state = GZIP_INFLATE_STATE_EXTRA;
+                if (handle->skip == 0) {
+                    _gzip_inflate_next_field(handle);
+                }
             }
-        } else {
-            for (int i = 0; i < size; i++) {
-                gzip->extra_len = gzip->extra_len + (*data << (gzip->head_filled * 8));
-                gzip->head_filled++;
-                data++;
+            break;
+        case GZIP_INFLATE_STATE_EXTRA: {
+            uint32_t n = (len < handle->skip) ? len : handle->skip;
+            _gzip_inflate_hcrc(handle, data, n);
+            data += n;
+            len -= n;
+            handle->skip -= n;
+            if (handle->skip == 0) {
+                _gzip_inflate_next_field(handle);
             }
-            gzip->head_filled += size;
-            return org_size;
-        }
-    }
-    if (gzip->head_flag & 8) {
-        // name
-        while (size) {
-            size--;
-            data++;
-            if (*(data - 1) == '\0') {
-                gzip->head_flag &= ~8;
-                break;
+        } break;
+        case GZIP_INFLATE_STATE_NAME:
+        case GZIP_INFLATE_STATE_COMMENT: {
+            uint8_t* end = memchr(data, '\0', len);
+            uint32_t n = end ? (uint32_t)(end - data) + 1 : len;
+            _gzip_inflate_hcrc(handle, data, n);
+            data += n;
+            len -= n;
+            if (end) {
+                _gzip_inflate_next_field(handle);
             }
-        }
-        if (size == 0) {
-            return org_size;
+        } break;
+        case GZIP_INFLATE_STATE_HCRC:
+            if (_gzip_inflate_gather(handle, 2, &data, &len)) {
+                if ((handle->hcrc & 0xFFFF) != (uint32_t)(handle->head[0] | (handle->head[1] << 8))) {
+                    ESP_LOGE(TAG, "gzip inflate header crc mismatch");
+                    goto _write_failed;
+                }
+                _gzip_inflate_next_field(handle);
+            }
+            break;
+        case GZIP_INFLATE_STATE_BODY:
+            if (_gzip_inflate_body(handle, &data, &len) != ESP_OK) {
+                goto _write_failed;
+            }
+            break;
+        case GZIP_INFLATE_STATE_TRAILER: {
+            // trail holds trail_ofs bytes tinfl consumed, gather the 8 bytes after them
+            uint32_t n = handle->trail_ofs + GZIP_TRAILER_SIZE - handle->trail_len;
+            n = (len < n) ? len : n;
+            memcpy(handle->trail + handle->trail_len, data, n);
+            handle->trail_len += n;
+            data += n;
+            len -= n;
+            if (handle->trail_len == handle->trail_ofs + GZIP_TRAILER_SIZE) {
+                int pos = _gzip_find_trailer(handle->trail, handle->trail_ofs, handle->trail_len, handle->crc32, handle->isize);
+                if (pos < 0) {
+                    ESP_LOGE(TAG, "gzip inflate crc32 or isize mismatch");
+                    goto _write_failed;
+                }
+                if (_gzip_inflate_member_done(handle, pos) != ESP_OK) {
+                    goto _write_failed;
+                }
+            }
+        } break;
+        default:
+            ESP_LOGE(TAG, "gzip inflate state error");
+            return ESP_FAIL;
         }
     }
-    if (gzip->head_flag & 0x10) {
-        // comment
-        while (size) {
-            size--;
-            data++;
-            if (*(data - 1) == '\0') {
-                gzip->head_flag &= ~0x10;
-                break;
-            }
+    return ESP_OK;
+_write_failed:
+    handle->state = GZIP_INFLATE_STATE_ERROR;
+    return ESP_FAIL;
+}
+
+esp_err_t gzip_inflate_finish(gzip_inflate_handle_t handle)
+{
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "gzip inflate handle is null.");
+        return ESP_FAIL;
+    }
+    if (handle->state == GZIP_INFLATE_STATE_TRAILER) {
+        // the input ended less than 8 bytes after the consumed end, the trailer must end with it
+        int pos = _gzip_find_trailer(handle->trail, handle->trail_ofs, handle->trail_len, handle->crc32, handle->isize);
+        if (pos < 0 || pos + GZIP_TRAILER_SIZE != handle->trail_len) {
+            ESP_LOGE(TAG, "gzip inflate crc32 or isize mismatch, or trailer truncated");
+            handle->state = GZIP_INFLATE_STATE_ERROR;
+            return ESP_FAIL;
         }
-        if (size == 0) {
-            return org_size;
+        _gzip_inflate_member_done(handle, pos);
+    }
+    if (handle->state != GZIP_INFLATE_STATE_HEADER || handle->head_len || handle->members == 0) {
+        ESP_LOGE(TAG, "gzip inflate stream truncated");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+uint32_t gzip_inflate_get_size(gzip_inflate_handle_t handle)
+{
+    return handle ? handle->total_out : 0;
+}
+
+// inflate the first member of in straight into out, *used returns the input bytes of the member
+static esp_err_t _gzip_inflate_member(uint8_t *in, int inlen, uint8_t *out, int *outlen, int *used)
+{
+    esp_err_t ret = ESP_FAIL;
+    int header_size = _gzip_header_size(in, inlen);
+    if (header_size < 0) {
+        ESP_LOGE(TAG, "gzip inflate header error");
+        return ret;
+    }
+    // the whole output fits in out, decompress straight into it without a 32 KB window
+    tinfl_decompressor* decomp = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    if (decomp == NULL) {
+        ESP_LOGE(TAG, "gzip inflate malloc failed");
+        return ret;
+    }
+    tinfl_init(decomp);
+    size_t in_bytes = inlen - header_size;
+    size_t out_bytes = *outlen;
+    tinfl_status status = tinfl_decompress(decomp, in + header_size, &in_bytes, out, out, &out_bytes, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    if (status != TINFL_STATUS_DONE) {
+        ESP_LOGE(TAG, "gzip inflate error, status: %d", status);
+        goto _inflate_end;
+    }
+    uint32_t n = (in_bytes < GZIP_INFLATE_OVERREAD_MAX) ? in_bytes : GZIP_INFLATE_OVERREAD_MAX;
+    int start = header_size + in_bytes - n;
+    int pos = _gzip_find_trailer(in + start, n, inlen - start, crc32_ieee_update(CRC32_IEEE_INIT, out, out_bytes), out_bytes);
+    if (pos < 0) {
+        ESP_LOGE(TAG, "gzip inflate crc32 or isize mismatch, or trailer truncated");
+        goto _inflate_end;
+    }
+    ret = ESP_OK;
+    *outlen = out_bytes;
+    *used = start + pos + GZIP_TRAILER_SIZE;
+_inflate_end:
+    free(decomp);
+    return ret;
+}
+
+// a header of another member after the first one, ISIZE in the trailer would only cover the last member.
+// deflate data may contain the magic by chance, that only costs a fall back to counting.
+static bool _gzip_has_next_member(const uint8_t* in, int header_size, int inlen)
+{
+    const uint8_t* p = in + header_size;
+    const uint8_t* end = in + inlen - GZIP_TRAILER_SIZE - GZIP_HEADER_SIZE;
+    while (p < end && (p = memchr(p, 0x1F, end - p)) != NULL) {
+        if (_gzip_verify_header(p)) {
+            return true;
         }
+        p++;
     }
-    if (gzip->head_flag & 0x2) {
-        // CRC16
-        if (gzip->head_filled > 2) {
-            return -1;
+    return false;
+}
+
+// ISIZE of the last member, -1 if it can not describe a complete single member
+static int _gzip_trailer_isize(uint8_t *in, int inlen)
+{
+    int header_size = _gzip_header_size(in, inlen);
+    // the smallest deflate body is 2 bytes
+    if (header_size < 0 || inlen < header_size + 2 + GZIP_TRAILER_SIZE) {
+        return -1;
+    }
+    if (_gzip_has_next_member(in, header_size, inlen)) {
+        return -1;
+    }
+    uint32_t isize = _gzip_get_le32(in + inlen - 4);
+    uint64_t max_size = (uint64_t)(inlen - header_size - GZIP_TRAILER_SIZE) * GZIP_DEFLATE_MAX_RATIO;
+    if (isize > INT32_MAX || isize > max_size) {
+        return -1;
+    }
+    return (int)isize;
+}
+
+typedef struct {
+    uint8_t* buf;
+    uint32_t len;
+    uint32_t size;
+} gzip_inflate_buf_t;
+
+static esp_err_t _gzip_inflate_buf_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    gzip_inflate_buf_t* out = (gzip_inflate_buf_t*)user_ctx;
+    if (out->len + len > out->size) {
+        uint32_t size = out->size;
+        while (size < out->len + len) {
+            size *= 2;
         }
-        if (gzip->head_filled + size >= 2) {
-            int used = 2 - gzip->head_filled;
-            size -= used;
-            data += used;
-            gzip->head_flag &= ~0x2;
-        } else {
-            gzip->head_filled += size;
-            return org_size;
+        uint8_t* buf = (uint8_t*)realloc(out->buf, size);
+        if (buf == NULL) {
+            ESP_LOGE(TAG, "gzip inflate realloc failed");
+            return ESP_FAIL;
         }
+        out->buf = buf;
+        out->size = size;
     }
-    return org_size - size;
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+    return ESP_OK;
 }
 
 esp_err_t gzip_inflate(uint8_t *in, int inlen, uint8_t *out, int *outlen)
 {
-    esp_err_t ret = ESP_FAIL;
-    gzip_inflate_t gzip = { 0 };
+    int used = 0;
     if (!in || (inlen < GZIP_HEADER_SIZE) || !out || !outlen || (*outlen <= 0)) {
         ESP_LOGE(TAG, "gzip inflate params error");
-        return ret;
+        return ESP_FAIL;
     }
-    if(!_gzip_verify_header(&gzip, in, inlen)) {
-        ESP_LOGE(TAG, "gzip inflate header error");
-        return ret;
+    esp_err_t ret = _gzip_inflate_member(in, inlen, out, outlen, &used);
+    ESP_LOGI(TAG, "gzip inflate finish");
+    return ret;
+}
+
+esp_err_t gzip_inflate_alloc(uint8_t *in, int inlen, uint8_t **out, int *outlen)
+{
+    if (!in || (inlen < GZIP_HEADER_SIZE) || !out || !outlen) {
+        ESP_LOGE(TAG, "gzip inflate params error");
+        return ESP_FAIL;
     }
-    int skip_size = _gzip_skip_header(&gzip, in + GZIP_HEADER_SIZE, inlen - GZIP_HEADER_SIZE);
-    int header_size = GZIP_HEADER_SIZE + skip_size;
-    if(header_size >= inlen) {
-        ESP_LOGE(TAG, "gzip inflate header size error");
-        return ret;
+    // fast path, a single member inflated once into a buffer of exactly ISIZE bytes
+    int size = _gzip_trailer_isize(in, inlen);
+    if (size >= 0) {
+        int used = 0, len = size;
+        uint8_t* buf = (uint8_t*)malloc(size + 1);
+        if (buf && _gzip_inflate_member(in, inlen, buf, &len, &used) == ESP_OK && used == inlen) {
+            *out = buf;
+            *outlen = len;
+            return ESP_OK;
+        }
+        free(buf);
+        ESP_LOGW(TAG, "gzip inflate not a single member, fall back to stream");
     }
-    int status = mz_inflateInit2(&gzip.stream, -MZ_DEFAULT_WINDOW_BITS);
-    if(status != MZ_OK) {
-        ESP_LOGE(TAG, "gzip inflate init error, reason: %s", mz_error(status));
-        return ret;
+    // multi-member, implausible trailer or ISIZE too large to allocate, stream into a growing
+    // buffer that starts from a size bounded by the input, ISIZE is not trusted here
+    uint32_t start = (uint32_t)inlen * 2;
+    gzip_inflate_buf_t buf = { .buf = NULL, .len = 0, .size = (size > 0 && (uint32_t)size < start) ? size : start };
+    buf.buf = (uint8_t*)malloc(buf.size);
+    if (buf.buf == NULL) {
+        ESP_LOGE(TAG, "gzip inflate malloc failed");
+        return ESP_FAIL;
     }
-    gzip.stream.next_in = (uint8_t *)in + header_size;
-    gzip.stream.avail_in = inlen - header_size;
-    gzip.stream.next_out = out;
-    gzip.stream.avail_out = *outlen;
-    status = mz_inflate(&gzip.stream, MZ_FINISH);
-    if(status != MZ_STREAM_END) {
-        ESP_LOGE(TAG, "gzip inflate error, reason: %s", mz_error(status));
-    } else {
-        ret = ESP_OK;
-        *outlen = gzip.stream.total_out;
-        ESP_LOGI(TAG, "gzip inflate success");
+    gzip_inflate_handle_t handle = gzip_inflate_create(_gzip_inflate_buf_out, &buf);
+    if (handle == NULL) {
+        free(buf.buf);
+        return ESP_FAIL;
     }
-    mz_inflateEnd(&gzip.stream);
-    ESP_LOGI(TAG, "gzip inflate finish");
-    return ret;
+    esp_err_t ret = gzip_inflate_write(handle, in, inlen);
+    if (ret == ESP_OK) {
+        ret = gzip_inflate_finish(handle);
+    }
+    gzip_inflate_destroy(handle);
+    if (ret != ESP_OK) {
+        free(buf.buf);
+        return ret;
+    }
+    *out = buf.buf;
+    *outlen = buf.len;
+    return ESP_OK;
 }
 
 int gzip_inflate_size(uint8_t *in, int inlen)
 {
     int inflate_size = 0;
-    gzip_inflate_t gzip = { 0 };
     if (!in || (inlen < GZIP_HEADER_SIZE)) {
         ESP_LOGE(TAG, "gzip inflate params error");
         return inflate_size;
     }
-    if(!_gzip_verify_header(&gzip, in, inlen)) {
-        ESP_LOGE(TAG, "gzip inflate header error");
+#if GZIP_INFLATE_SIZE_FROM_TRAILER
+    // no inflate, trust ISIZE of a complete single member
+    inflate_size = _gzip_trailer_isize(in, inlen);
+    if (inflate_size >= 0) {
         return inflate_size;
     }
-    int skip_size = _gzip_skip_header(&gzip, in + GZIP_HEADER_SIZE, inlen - GZIP_HEADER_SIZE);
-    int header_size = GZIP_HEADER_SIZE + skip_size;
-    if(header_size >= inlen) {
-        ESP_LOGE(TAG, "gzip inflate header size error");
+    inflate_size = 0;
+#endif
+    // count by inflating, handles multi-member and rejects corrupt or truncated input
+    gzip_inflate_handle_t handle = gzip_inflate_create(NULL, NULL);
+    if (handle == NULL) {
         return inflate_size;
     }
-    int status = mz_inflateInit2(&gzip.stream, -MZ_DEFAULT_WINDOW_BITS);
-    if(status != MZ_OK) {
-        ESP_LOGE(TAG, "gzip inflate init error, reason: %s", mz_error(status));
-        return inflate_size;
+    if (gzip_inflate_write(handle, in, inlen) == ESP_OK && gzip_inflate_finish(handle) == ESP_OK) {
+        inflate_size = gzip_inflate_get_size(handle);
     }
-    uint8_t out[1024];
-    uint32_t outlen = sizeof(out), total_out = 0;
-    gzip.stream.next_in = (uint8_t *)in + header_size;
-    gzip.stream.avail_in = inlen - header_size;
-    do {
-        gzip.stream.next_out = out;
-        gzip.stream.avail_out = outlen;
-        status = mz_inflate(&gzip.stream, MZ_SYNC_FLUSH);
-        if(status < 0) {
-            ESP_LOGE(TAG, "gzip inflate error, reason: %s", mz_error(status));
-            goto _inflate_end;
-        }
-        total_out += sizeof(out) - gzip.stream.avail_out;
-    } while(gzip.stream.avail_out == 0);
-    inflate_size = total_out;
-_inflate_end:
-    mz_inflateEnd(&gzip.stream);
+    gzip_inflate_destroy(handle);
     ESP_LOGI(TAG, "gzip inflate finish");
     return inflate_size;
 }
@@ -2,6 +2,7 @@
 #define __HTTP_CLI_H__
 
 #include "stdio.h"
+#include "stdint.h"
 #include "esp_err.h"
 #include "esp_http_client.h"
 
@@ -9,6 +10,8 @@
 #define HTTP_CLI_TIMEOUT_SEC  10
 // http response buffer length
 #define HTTP_CLI_RESPONSE_LEN 4096
+// http form file size unknown, use chunked transfer encoding
+#define HTTP_CLI_FORM_CHUNKED UINT32_MAX
 
 typedef struct {
     char* url; // heap memory, free in http_cli_destroy()
@@ -22,6 +25,7 @@ typedef struct {
     esp_http_client_handle_t client;
     void* response_handler;
     char* modify_time;
+    int chunked; // chunked transfer encoding, set by http_cli_form_begin()
 } http_cli_t;
 
 // http post url
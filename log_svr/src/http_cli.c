@@ -11,6 +11,30 @@ static const char* TAG = "http_cli";
 
 typedef int (*http_response_handler_t)(char* response, char* modify_time);
 
+// http client write, frame data as one chunk in chunked transfer encoding
+static int _http_cli_write(http_cli_t* handle, const char* buff, int len)
+{
+    esp_http_client_handle_t client = handle->client;
+    if(!handle->chunked) {
+        return esp_http_client_write(client, buff, len);
+    }
+    if(len <= 0) {
+        return 0; // zero length chunk is the last chunk, write by finish
+    }
+    char chunk_size[12] = { 0 };
+    int size_len = snprintf(chunk_size, sizeof(chunk_size), "%x\r\n", len);
+    if(esp_http_client_write(client, chunk_size, size_len) < 0) {
+        return -1;
+    }
+    if(esp_http_client_write(client, buff, len) < 0) {
+        return -1;
+    }
+    if(esp_http_client_write(client, "\r\n", 2) < 0) {
+        return -1;
+    }
+    return len;
+}
+
 esp_err_t http_cli_create(http_cli_t* handle)
 {
     if(handle == NULL) {
@@ -86,16 +110,20 @@ esp_err_t http_cli_form_begin(http_cli_t* handle, uint32_t file_size)
     }
     esp_http_client_handle_t client = handle->client;
 
-    uint32_t content_len = http_cli_get_content_len(handle, file_size);
+    int content_len = -1; // chunked transfer encoding
+    handle->chunked = (file_size == HTTP_CLI_FORM_CHUNKED) ? 1 : 0;
+    if(!handle->chunked) {
+        content_len = http_cli_get_content_len(handle, file_size);
+    }
     esp_err_t ret = esp_http_client_open(client, content_len);
     if(ret != ESP_OK) {
         ESP_LOGE(TAG, "[form begin] http open failed, error: %s!", esp_err_to_name(ret));
         return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "[form begin] http connect success.");
+    ESP_LOGI(TAG, "[form begin] http connect success, chunked: %d.", handle->chunked);
     
     // prefix
-    if(esp_http_client_write(client, "\r\n", 2) < 0) {
+    if(_http_cli_write(handle, "\r\n", 2) < 0) {
         goto write_error;
     }
     char* form_prefix = "Content-Disposition: form-data; name=";
@@ -110,54 +138,54 @@ esp_err_t http_cli_form_begin(http_cli_t* handle, uint32_t file_size)
     // key + value
     for(int i = 0; i < sizeof(key) / sizeof(key[0]); i++) {
         // ESP_LOGI(TAG, "[form begin] form key: %s, value: %s", key[i], value[i]);
-        if(esp_http_client_write(client, "--", 2) < 0) {
+        if(_http_cli_write(handle, "--", 2) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, boundary, strlen(boundary)) < 0) {
+        if(_http_cli_write(handle, boundary, strlen(boundary)) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, "\r\n", 2) < 0) {
+        if(_http_cli_write(handle, "\r\n", 2) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, form_prefix, strlen(form_prefix)) < 0) {
+        if(_http_cli_write(handle, form_prefix, strlen(form_prefix)) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, key[i], strlen(key[i])) < 0) {
+        if(_http_cli_write(handle, key[i], strlen(key[i])) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, "\r\n\r\n", 4) < 0) {
+        if(_http_cli_write(handle, "\r\n\r\n", 4) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, value[i], strlen(value[i])) < 0) {
+        if(_http_cli_write(handle, value[i], strlen(value[i])) < 0) {
             goto write_error;
         }
-        if(esp_http_client_write(client, "\r\n", 2) < 0) {
+        if(_http_cli_write(handle, "\r\n", 2) < 0) {
             goto write_error;
         }
     }
     // file header
-    if(esp_http_client_write(client, "--", 2) < 0) {
+    if(_http_cli_write(handle, "--", 2) < 0) {
         goto write_error;
     }
-    if(esp_http_client_write(client, boundary, strlen(boundary)) < 0) {
+    if(_http_cli_write(handle, boundary, strlen(boundary)) < 0) {
         goto write_error;
     }
-    if(esp_http_client_write(client, "\r\n", 2) < 0) {
+    if(_http_cli_write(handle, "\r\n", 2) < 0) {
         goto write_error;
     }
-    if(esp_http_client_write(client, form_prefix, strlen(form_prefix)) < 0) {
+    if(_http_cli_write(handle, form_prefix, strlen(form_prefix)) < 0) {
         goto write_error;
     }
     char* tmp_str = "\"data\"; filename=\"";
-    if(esp_http_client_write(client, tmp_str, strlen(tmp_str)) < 0) {
+    if(_http_cli_write(handle, tmp_str, strlen(tmp_str)) < 0) {
         goto write_error;
     }
     tmp_str = HTTP_CLI_FORM_FILE_NAME(handle);
-    if(esp_http_client_write(client, tmp_str, strlen(tmp_str)) < 0) {
+    if(_http_cli_write(handle, tmp_str, strlen(tmp_str)) < 0) {
         goto write_error;
     }
     tmp_str = "\"\r\nContent-Type: application/gzip\r\n\r\n";
-    if(esp_http_client_write(client, tmp_str, strlen(tmp_str)) < 0) {
+    if(_http_cli_write(handle, tmp_str, strlen(tmp_str)) < 0) {
         goto write_error;
     }
     return ESP_OK;
@@ -174,7 +202,7 @@ esp_err_t http_cli_form_file_write(http_cli_t* handle, void* buff, size_t len)
         return ESP_FAIL;
     }
 
-    if(esp_http_client_write(client, (const char*)buff, len) < 0) {
+    if(_http_cli_write(handle, (const char*)buff, len) < 0) {
         goto write_error;
     }
     return ESP_OK;
@@ -200,17 +228,21 @@ esp_err_t http_cli_form_finish(http_cli_t* handle)
 
     char* boundary = HTTP_CLI_FORM_BOUNDARY(handle);
     // file footer
-    if(esp_http_client_write(client, "\r\n", 2) < 0) {
+    if(_http_cli_write(handle, "\r\n", 2) < 0) {
         goto write_error;
     }
     // body suffix
-    if(esp_http_client_write(client, "--", 2) < 0) {
+    if(_http_cli_write(handle, "--", 2) < 0) {
+        goto write_error;
+    }
+    if(_http_cli_write(handle, boundary, strlen(boundary)) < 0) {
         goto write_error;
     }
-    if(esp_http_client_write(client, boundary, strlen(boundary)) < 0) {
+    if(_http_cli_write(handle, "--\r\n", 4) < 0) {
         goto write_error;
     }
-    if(esp_http_client_write(client, "--\r\n", 4) < 0) {
+    // last chunk
+    if(handle->chunked && esp_http_client_write(client, "0\r\n\r\n", 5) < 0) {
         goto write_error;
     }
 
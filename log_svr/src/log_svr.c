@@ -35,6 +35,7 @@ typedef struct {
     SemaphoreHandle_t mutex;
     log_svr_duration_t duration[LOG_SVR_DURATION_NUM];
     QueueHandle_t trigger_queue;
+    gzip_deflate_handle_t gzip_handle; // reused by every upload
 } log_svr_t;
 
 static log_svr_t s_log_desc = {
@@ -43,6 +44,16 @@ static log_svr_t s_log_desc = {
 
 // log server ring buffer log threshold [20k], for uploading log cache
 #define LOG_SVR_RB_LOG_THRESHOLD  (20 * 1024)
+// log server ring buffer batch number, for ws output and dropping msg
+#define LOG_SVR_RB_LOG_BATCH_NUM  32
+// log server msg text size, for deferred format msg
+#define LOG_SVR_MSG_TEXT_SIZE     512
+
+// log server http upload with chunked transfer encoding, deflate once while uploading.
+// set 0 if the server not support chunked request, deflate twice for content length.
+#ifndef LOG_SVR_HTTP_CHUNKED
+#define LOG_SVR_HTTP_CHUNKED      1
+#endif
 
 // log server http default handle
 #define LOG_SVR_HTTP_DEFAULT_HANDLE()                           \
@@ -63,6 +74,21 @@ static char* _log_svr_get_datetime(char* buf, size_t len, uint64_t timestamp);
 static char* _log_svr_get_modify_time(char* buf, size_t len, uint64_t timestamp);
 static bool _log_svr_rate_monitor(void);
 
+// gzip deflate open, create the compressor once and reset it for the next upload
+static gzip_deflate_handle_t _log_svr_gzip_deflate_open(gzip_stream_out_t stream_out, void* user_ctx)
+{
+    if(s_log_desc.gzip_handle == NULL) {
+        s_log_desc.gzip_handle = gzip_deflate_create(stream_out, user_ctx);
+        // log lines are short, stage them and flush on finish only
+        gzip_deflate_set_flush(s_log_desc.gzip_handle, GZIP_DEFLATE_FLUSH_NONE, 0);
+        return s_log_desc.gzip_handle;
+    }
+    if(gzip_deflate_reset(s_log_desc.gzip_handle, stream_out, user_ctx) != ESP_OK) {
+        return NULL;
+    }
+    return s_log_desc.gzip_handle;
+}
+
 static esp_err_t _log_svr_http_stream_out(uint8_t* data, uint32_t len, void* user_ctx)
 {
     http_cli_t* http_handle = (http_cli_t*)user_ctx;
@@ -73,22 +99,26 @@ static esp_err_t _log_svr_http_stream_out(uint8_t* data, uint32_t len, void* use
     return ESP_FAIL;
 }
 
-static uint32_t _log_svr_gzip_deflate_msg_size(char** msg_buf, int msg_num)
+#if !LOG_SVR_HTTP_CHUNKED
+static uint32_t _log_svr_gzip_deflate_msg_size(rb_log_msg_t* msg_buf, int msg_num)
 {
     char* finish_msg = "\n";
     uint32_t deflate_size = 0;
+    char text[LOG_SVR_MSG_TEXT_SIZE];
     if(msg_buf == NULL || msg_num <= 0) {
         return deflate_size;
     }
     // deflate create
-    gzip_deflate_handle_t gzip_handle = gzip_deflate_create(NULL, NULL);
+    gzip_deflate_handle_t gzip_handle = _log_svr_gzip_deflate_open(NULL, NULL);
     if(gzip_handle == NULL) {
         return deflate_size;
     }
     // defalte msg
     for(int i = 0; i < msg_num; i++) {
-        if(msg_buf[i]) {
-            if(gzip_deflate_write(gzip_handle, (uint8_t*)msg_buf[i], strlen(msg_buf[i]), 0) != ESP_OK) {
+        size_t len = 0;
+        char* msg = rb_log_msg_text(&msg_buf[i], text, sizeof(text), &len);
+        if(msg && len) {
+            if(gzip_deflate_write(gzip_handle, (uint8_t*)msg, len, 0) != ESP_OK) {
                 goto deflate_failed;
             }
         }
@@ -97,28 +127,33 @@ static uint32_t _log_svr_gzip_deflate_msg_size(char** msg_buf, int msg_num)
     if(gzip_deflate_write(gzip_handle, (uint8_t*)finish_msg, strlen(finish_msg), 1) != ESP_OK) {
         goto deflate_failed;
     }
-    // deflate destory
+    // deflate size
     deflate_size = gzip_handle->zipsize;
 deflate_failed:
-    gzip_deflate_destroy(gzip_handle);
     return deflate_size;
 }
+#endif // !LOG_SVR_HTTP_CHUNKED
 
 // http server http form msg
-static esp_err_t _log_svr_http_form_msg(char** msg_buf, int msg_num)
+static esp_err_t _log_svr_http_form_msg(rb_log_msg_t* msg_buf, int msg_num)
 {
     char* finish_msg = "\n";
     esp_err_t ret = ESP_FAIL;
     gzip_deflate_handle_t gzip_handle = NULL;
+    char text[LOG_SVR_MSG_TEXT_SIZE];
     if(msg_buf == NULL || msg_num <= 0) {
         return ret;
     }
+#if LOG_SVR_HTTP_CHUNKED
+    uint32_t content_len = HTTP_CLI_FORM_CHUNKED;
+#else
     // gzip deflate msg for content length
-    size_t content_len = _log_svr_gzip_deflate_msg_size(msg_buf, msg_num);
+    uint32_t content_len = _log_svr_gzip_deflate_msg_size(msg_buf, msg_num);
     if(content_len == 0) {
         ESP_LOGE(TAG, "[form msg] gzip deflate failed!");
         return ret;
     }
+#endif
     char modify_time[32] = { 0 };
     _log_svr_get_modify_time(modify_time, sizeof(modify_time), _log_svr_get_current_time());
     // http form create
@@ -133,15 +168,17 @@ static esp_err_t _log_svr_http_form_msg(char** msg_buf, int msg_num)
         goto _commit_exit;
     }
     // gzip deflate create with http stream out
-    gzip_handle = gzip_deflate_create(_log_svr_http_stream_out, &http_handle);
+    gzip_handle = _log_svr_gzip_deflate_open(_log_svr_http_stream_out, &http_handle);
     if(gzip_handle == NULL) {
         ESP_LOGE(TAG, "[form msg] gzip deflate create failed!");
         goto _commit_exit;
     }
     // deflate msg and http write
     for(int i = 0; i < msg_num; i++) {
-        if(msg_buf[i] != NULL) {
-            if(gzip_deflate_write(gzip_handle, (uint8_t*)msg_buf[i], strlen(msg_buf[i]), 0) != ESP_OK) {
+        size_t len = 0;
+        char* msg = rb_log_msg_text(&msg_buf[i], text, sizeof(text), &len);
+        if(msg && len) {
+            if(gzip_deflate_write(gzip_handle, (uint8_t*)msg, len, 0) != ESP_OK) {
                 goto _commit_exit;
             }
         }
@@ -156,13 +193,13 @@ static esp_err_t _log_svr_http_form_msg(char** msg_buf, int msg_num)
     }
     ret = ESP_OK;
 _commit_exit:
-    gzip_deflate_destroy(gzip_handle);
     http_cli_destroy(&http_handle);
     return ret;
 }
 
-esp_err_t _log_svr_file_save_msg(char** msg_buf, int msg_num)
+esp_err_t _log_svr_file_save_msg(rb_log_msg_t* msg_buf, int msg_num)
 {
+    char text[LOG_SVR_MSG_TEXT_SIZE];
     if(msg_buf == NULL || msg_num <= 0) {
         return ESP_FAIL;
     }
@@ -175,8 +212,10 @@ esp_err_t _log_svr_file_save_msg(char** msg_buf, int msg_num)
     }
     // write msg to file
     for(int i = 0; i < msg_num; i++) {
-        if(msg_buf[i]) {
-            if(file_svr_write(&file_desc, (uint8_t*)msg_buf[i], strlen(msg_buf[i])) != ESP_OK) {
+        size_t len = 0;
+        char* msg = rb_log_msg_text(&msg_buf[i], text, sizeof(text), &len);
+        if(msg && len) {
+            if(file_svr_write(&file_desc, (uint8_t*)msg, len) != ESP_OK) {
                 ESP_LOGE(TAG, "file write failed!");
                 goto _commit_exit;
             }
@@ -190,6 +229,7 @@ _commit_exit:
     return ESP_OK;
 }
 
+#if !LOG_SVR_HTTP_CHUNKED
 static uint32_t _log_svr_gzip_deflate_file_size(file_svr_desc_t* desc)
 {
     char* finish_msg = "\n";
@@ -198,7 +238,7 @@ static uint32_t _log_svr_gzip_deflate_file_size(file_svr_desc_t* desc)
         return deflate_size;
     }
     // deflate create
-    gzip_deflate_handle_t gzip_handle = gzip_deflate_create(NULL, NULL);
+    gzip_deflate_handle_t gzip_handle = _log_svr_gzip_deflate_open(NULL, NULL);
     if(gzip_handle == NULL) {
         return deflate_size;
     }
@@ -226,13 +266,13 @@ static uint32_t _log_svr_gzip_deflate_file_size(file_svr_desc_t* desc)
     if(gzip_deflate_write(gzip_handle, (uint8_t*)finish_msg, strlen(finish_msg), 1) != ESP_OK) {
         goto deflate_failed;
     }
-    // deflate destory
+    // deflate size
     deflate_size = gzip_handle->zipsize;
 deflate_failed:
     file_svr_close(desc);
-    gzip_deflate_destroy(gzip_handle);
     return deflate_size;
 }
+#endif // !LOG_SVR_HTTP_CHUNKED
 
 // http server http form file
 static esp_err_t _log_svr_http_form_file(file_svr_desc_t* desc, uint64_t modify)
@@ -243,16 +283,28 @@ static esp_err_t _log_svr_http_form_file(file_svr_desc_t* desc, uint64_t modify)
     if(desc == NULL) {
         return ret;
     }
+#if LOG_SVR_HTTP_CHUNKED
+    uint32_t content_len = HTTP_CLI_FORM_CHUNKED;
+#else
     // gzip deflate file for content length
-    size_t content_len = _log_svr_gzip_deflate_file_size(desc);
+    uint32_t content_len = _log_svr_gzip_deflate_file_size(desc);
     if(content_len == 0) {
         ESP_LOGE(TAG, "[form file] gzip deflate failed!");
         return ret;
     }
+#endif
     // open file
     if(file_svr_open(desc, "rb") != ESP_OK) {
         return ret;
     }
+#if LOG_SVR_HTTP_CHUNKED
+    // file size
+    if(file_svr_size(desc) == 0) {
+        ESP_LOGE(TAG, "[form file] file is empty!");
+        file_svr_close(desc);
+        return ret;
+    }
+#endif
     char modify_time[32] = { 0 };
     _log_svr_get_modify_time(modify_time, sizeof(modify_time), modify);
     // http form create
@@ -267,7 +319,7 @@ static esp_err_t _log_svr_http_form_file(file_svr_desc_t* desc, uint64_t modify)
         goto _commit_exit;
     }
     // gzip deflate create with http stream out
-    gzip_handle = gzip_deflate_create(_log_svr_http_stream_out, &http_handle);
+    gzip_handle = _log_svr_gzip_deflate_open(_log_svr_http_stream_out, &http_handle);
     if(gzip_handle == NULL) {
         ESP_LOGE(TAG, "[form file] gzip deflate create failed!");
         goto _commit_exit;
@@ -294,7 +346,6 @@ static esp_err_t _log_svr_http_form_file(file_svr_desc_t* desc, uint64_t modify)
     }
     ret = ESP_OK;
 _commit_exit:
-    gzip_deflate_destroy(gzip_handle);
     http_cli_destroy(&http_handle);
     file_svr_close(desc);
     return ret;
@@ -528,11 +579,14 @@ static esp_err_t _log_svr_get_rb_full(void)
 
 static esp_err_t _log_svr_drop_rb_msg(int msg_num)
 {
-    for(int i = 0; i < msg_num; i++) {
-        char* msg = rb_log_get_msg();
-        if(msg) {
-            rb_log_free_msg(msg);
+    rb_log_msg_t msgs[LOG_SVR_RB_LOG_BATCH_NUM];
+    while(msg_num > 0) {
+        int num = rb_log_acquire_batch(msgs, (msg_num < LOG_SVR_RB_LOG_BATCH_NUM) ? msg_num : LOG_SVR_RB_LOG_BATCH_NUM);
+        if(num <= 0) {
+            break;
         }
+        rb_log_release_batch(msgs, num);
+        msg_num -= num;
     }
     return ESP_OK;
 }
@@ -622,11 +676,15 @@ void log_svr_task(void * arg)
         }
         // ws server connected
         if(is_eth && ws_svr_connected() == ESP_OK) {
-            char* msg = rb_log_get_msg();
-            if(msg != NULL) {
-                ws_svr_send_text(msg, strlen(msg));
-                rb_log_free_msg(msg);
+            rb_log_msg_t msgs[LOG_SVR_RB_LOG_BATCH_NUM];
+            char text[LOG_SVR_MSG_TEXT_SIZE];
+            int num = rb_log_acquire_batch(msgs, LOG_SVR_RB_LOG_BATCH_NUM);
+            for(int i = 0; i < num; i++) {
+                size_t len = 0;
+                char* msg = rb_log_msg_text(&msgs[i], text, sizeof(text), &len);
+                ws_svr_send_text(msg, len);
             }
+            rb_log_release_batch(msgs, num);
             sys_delay_ms(10); continue;
         }
 
@@ -679,22 +737,21 @@ void log_svr_task(void * arg)
             ESP_LOGE(TAG, "msg output, msg num is %d", msg_num);
             sys_delay_ms(10); continue;
         }
-        char** msg_buf = (char**)malloc(msg_num * sizeof(char*)); // free by LOG_SVR_RB_MSG_FREE
+        rb_log_msg_t* msg_buf = (rb_log_msg_t*)malloc((msg_num + 1) * sizeof(rb_log_msg_t)); // msg header + msg
         if(msg_buf == NULL) {
             ESP_LOGE(TAG, "msg buffer malloc failed!");
             _log_svr_drop_rb_msg(msg_num); // drop all msg
             sys_delay_ms(10); continue;
         }
-        printf("msg num: %d\n", msg_num);
         // featch msg from ring buffer
-        for(int i = 0; i < msg_num; i++) {
-            msg_buf[i] = rb_log_get_msg();
-        }
+        msg_num = rb_log_acquire_batch(&msg_buf[1], msg_num);
+        printf("msg num: %d\n", msg_num);
 
         // msg header
         snprintf(msg_header, sizeof(msg_header), "## MAC:%s, Time:%s ##\n", s_log_desc.config.get_mac(), _log_svr_get_datetime(curr_time, sizeof(curr_time), _log_svr_get_current_time()));
-        char* first_msg = msg_buf[0];
-        msg_buf[0] = msg_header;
+        msg_buf[0].msg = msg_header;
+        msg_buf[0].len = strlen(msg_header);
+        msg_num += 1;
 
         // output msg
         bool is_dump_file = false;
@@ -717,12 +774,7 @@ void log_svr_task(void * arg)
         }
 
         // free msg
-        msg_buf[0] = first_msg;
-        for(int i = 0; i < msg_num; i++) {
-            if(msg_buf[i]) {
-                rb_log_free_msg(msg_buf[i]);
-            }
-        }
+        rb_log_release_batch(&msg_buf[1], msg_num - 1);
         if(msg_buf) {
             free(msg_buf);
         }
@@ -731,6 +783,8 @@ void log_svr_task(void * arg)
             _log_svr_trigger_finish(trigger_msg.type, trigger_msg.timestamp);
         }
     }
+    gzip_deflate_destroy(s_log_desc.gzip_handle);
+    s_log_desc.gzip_handle = NULL;
     ESP_LOGW(TAG, "log svr task stop");
     vTaskDelete(NULL);
 }
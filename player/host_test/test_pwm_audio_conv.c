@@ -0,0 +1,155 @@
+// host golden output test and benchmark of the pwm_audio_write kernels, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pwm_audio_conv.h"
+
+#define SAMPLES (65536)
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the former per sample loops of pwm_audio_write, x * volume / 16 with volume 0 ~ 16,
+// 64 bits product where the 32 bits one overflowed
+static uint16_t ref_conv(const uint8_t *in, size_t i, int bits, int res, int volume)
+{
+    switch(bits) {
+    case 8: {
+        uint8_t value = (in[i] * volume / 16) + 0x7f;
+        return (uint16_t)(value << (res - 8));
+    }
+    case 16: {
+        int16_t temp = ((const int16_t *)in)[i] * volume / 16;
+        uint16_t value = temp + 0x7fff;
+        return value >> (16 - res);
+    }
+    default: {
+        int32_t temp = (int32_t)((int64_t)((const int32_t *)in)[i] * volume / 16);
+        uint32_t value = temp + 0x7fffffff;
+        return value >> (32 - res);
+    }
+    }
+}
+
+// random samples, the most negative value is clamped by the kernels and left out of the golden compare
+static void fill(uint8_t *in, int bits)
+{
+    for(int i = 0; i < SAMPLES * 4; i += 4) {
+        uint32_t r = rnd() << 8 ^ rnd();
+        memcpy(in + i, &r, 4);
+    }
+    for(int i = 0; i < SAMPLES; i++) {
+        if(bits == 16 && ((int16_t *)in)[i] == INT16_MIN) {
+            ((int16_t *)in)[i] = INT16_MIN + 1;
+        } else if(bits == 32 && ((int32_t *)in)[i] == INT32_MIN) {
+            ((int32_t *)in)[i] = INT32_MIN + 1;
+        }
+    }
+    // full scale edges
+    if(bits == 16) {
+        ((int16_t *)in)[0] = INT16_MAX;
+        ((int16_t *)in)[1] = -INT16_MAX;
+    } else if(bits == 32) {
+        ((int32_t *)in)[0] = INT32_MAX;
+        ((int32_t *)in)[1] = -INT32_MAX;
+    }
+}
+
+static void test_golden(void)
+{
+    printf("golden, volume 0 ~ 0dB\n");
+    static uint8_t in[SAMPLES * 4];
+    static uint16_t out[SAMPLES];
+    static const int bits[] = { 8, 16, 32 };
+    for(int b = 0; b < 3; b++) {
+        fill(in, bits[b]);
+        for(int res = 8; res <= 10; res++) {
+            pwm_audio_conv_fn_t conv = pwm_audio_conv_get(bits[b], res);
+            CHECK(conv != NULL);
+            for(int volume = 0; volume <= 16; volume++) {
+                conv(in, out, SAMPLES, pwm_audio_conv_gain(volume));
+                int mismatch = 0;
+                for(int i = 0; i < SAMPLES; i++) {
+                    mismatch += out[i] != ref_conv(in, i, bits[b], res, volume);
+                }
+                CHECK(mismatch == 0);
+                if(mismatch) {
+                    printf("  %d bits, %d bits duty, volume %d: %d mismatches\n", bits[b], res, volume, mismatch);
+                }
+            }
+        }
+    }
+    CHECK(pwm_audio_conv_get(24, 10) == NULL && pwm_audio_conv_get(16, 11) == NULL);
+    CHECK(pwm_audio_conv_gain(-1) == 0 && pwm_audio_conv_gain(40) == 2 * PWM_AUDIO_CONV_GAIN_0DB);
+}
+
+static void test_saturate(void)
+{
+    printf("saturate above 0dB, most negative sample\n");
+    int16_t in16[4] = { INT16_MAX, INT16_MIN, 20000, -20000 };
+    uint16_t out[4];
+    pwm_audio_conv_get(16, 10)((const uint8_t *)in16, out, 4, pwm_audio_conv_gain(32));
+    CHECK(out[0] == 1023 && out[1] == 0 && out[2] == 1023 && out[3] == 0);
+    pwm_audio_conv_get(16, 10)((const uint8_t *)in16, out, 2, PWM_AUDIO_CONV_GAIN_0DB);
+    CHECK(out[0] == 1023 && out[1] == 0); // the old loop wrapped INT16_MIN to the top duty
+    int32_t in32[4] = { INT32_MAX, INT32_MIN, 3 << 29, -(3 << 29) };
+    pwm_audio_conv_get(32, 9)((const uint8_t *)in32, out, 4, pwm_audio_conv_gain(24));
+    CHECK(out[0] == 511 && out[1] == 0 && out[2] == 511 && out[3] == 0);
+    int16_t half[2] = { 16384, -16384 };
+    pwm_audio_conv_get(16, 10)((const uint8_t *)half, out, 2, pwm_audio_conv_gain(24));
+    CHECK(out[0] == (24576 + 0x7fff) >> 6 && out[1] == (-24576 + 0x7fff) >> 6);
+}
+
+static void bench(void)
+{
+    enum { ROUNDS = 400 };
+    static uint8_t in[SAMPLES * 4];
+    static uint16_t out[SAMPLES];
+    static const int bits[] = { 8, 16, 32 };
+    for(int b = 0; b < 3; b++) {
+        fill(in, bits[b]);
+        pwm_audio_conv_fn_t conv = pwm_audio_conv_get(bits[b], 10);
+        int32_t gain = pwm_audio_conv_gain(12);
+        double t = now_s();
+        for(int r = 0; r < ROUNDS; r++) {
+            conv(in, out, SAMPLES, gain);
+            in[r & 0xff] ^= out[r & 0xff];
+        }
+        double kernel = now_s() - t;
+        uint32_t sum = 0;
+        t = now_s();
+        for(int r = 0; r < ROUNDS / 8; r++) {
+            for(int i = 0; i < SAMPLES; i++) {
+                sum += ref_conv(in, i, bits[b], 10, 12);
+            }
+        }
+        double ref = now_s() - t;
+        printf("bench %2d bits -> 10 bits duty: kernel %.0f Msamples/s, per sample divide %.0f Msamples/s (%u)\n", bits[b],
+            (double)SAMPLES * ROUNDS / kernel / 1e6, (double)SAMPLES * (ROUNDS / 8) / ref / 1e6, sum & 1);
+    }
+}
+
+int main(void)
+{
+    test_golden();
+    test_saturate();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
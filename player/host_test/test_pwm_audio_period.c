@@ -0,0 +1,181 @@
+// host simulation of the timer ISR against pwm_audio_write, see Makefile
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pwm_audio_period.h"
+
+static int s_fail;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+#define PERIOD  (64)
+
+typedef struct {
+    pwm_audio_period_t  p;
+    uint16_t            mem[4 * PERIOD];
+    uint32_t            total;      // frames to write
+    uint32_t            written;
+    uint32_t            played;
+    uint32_t            bad;        // frames played out of order
+    uint32_t            swaps;
+    uint32_t            rand;
+} sim_t;
+
+static uint32_t sim_rand(sim_t *s)
+{
+    s->rand = s->rand * 1103515245u + 12345u;
+    return s->rand >> 8;
+}
+
+// one timer interrupt, the frame carries its index in both duties, false on underrun
+static bool sim_isr(sim_t *s)
+{
+    bool swapped = false;
+    const uint16_t *frame = pwm_audio_period_next(&s->p, &swapped);
+    s->swaps += swapped;
+    if (frame == NULL) {
+        return false;
+    }
+    if (frame[0] != (uint16_t)s->played || frame[1] != (uint16_t)~s->played) {
+        s->bad++;
+    }
+    s->played++;
+    return true;
+}
+
+// one pwm_audio_write of up to max frames, the frames are filled one isr at a time,
+// false if the back period is full
+static bool sim_write(sim_t *s, uint32_t max, int isr_per_frame)
+{
+    uint32_t space;
+    uint16_t *frames = pwm_audio_period_back(&s->p, &space);
+    if (frames == NULL) {
+        return false;
+    }
+    uint32_t n = s->total - s->written;
+    n = n < max ? n : max;
+    n = n < space ? n : space;
+    for (uint32_t i = 0; i < n; i++) {
+        frames[2 * i] = (uint16_t)(s->written + i);
+        frames[2 * i + 1] = (uint16_t)~(s->written + i);
+        for (int k = 0; k < isr_per_frame; k++) {
+            sim_isr(s); // the ISR keeps running while the writer is converting
+        }
+    }
+    pwm_audio_period_commit(&s->p, n);
+    s->written += n;
+    return true;
+}
+
+static void sim_init(sim_t *s, uint32_t total, uint32_t seed)
+{
+    pwm_audio_period_init(&s->p, s->mem, PERIOD);
+    s->total = total;
+    s->written = s->played = s->bad = s->swaps = 0;
+    s->rand = seed;
+}
+
+// the writer keeps the back period full, no underrun after the first period
+static void test_steady(void)
+{
+    printf("steady writer\n");
+    static sim_t s;
+    sim_init(&s, 100 * PERIOD, 1);
+    while (s.played < s.total) {
+        sim_write(&s, 3 * PERIOD, 0);
+        sim_isr(&s);
+    }
+    CHECK(s.bad == 0 && s.p.underrun == 0);
+    printf("  played %u, swaps %u, underrun %u\n", s.played, s.swaps, s.p.underrun);
+}
+
+// a short write and the tail of a stream play once the writer goes idle
+static void test_partial(void)
+{
+    printf("partial period\n");
+    static sim_t s;
+    sim_init(&s, PERIOD / 4, 2);
+    sim_write(&s, PERIOD, 0);
+    for (int i = 0; i < PERIOD; i++) {
+        sim_isr(&s);
+    }
+    CHECK(s.played == PERIOD / 4 && s.bad == 0 && s.p.underrun == 1);
+
+    sim_init(&s, 5 * PERIOD + 7, 3);
+    while (s.written < s.total) {
+        sim_write(&s, PERIOD, 1);
+        sim_isr(&s);
+    }
+    for (int i = 0; i < 3 * PERIOD; i++) {
+        sim_isr(&s);
+    }
+    CHECK(s.played == s.total && s.bad == 0);
+}
+
+// random writes, idle gaps and isr ticks inside writes, every frame plays once and in order
+static void test_random(void)
+{
+    printf("random interleaving\n");
+    static sim_t s;
+    sim_init(&s, 200000, 4);
+    uint32_t ticks = 0;
+    while (s.played < s.total && ticks < 4 * s.total) {
+        uint32_t r = sim_rand(&s) % 100;
+        if (r < 40) {
+            sim_write(&s, 1 + sim_rand(&s) % (2 * PERIOD), sim_rand(&s) % 4 == 0);
+        } else if (r < 45) {
+            for (uint32_t i = sim_rand(&s) % (2 * PERIOD); i; i--, ticks++) {
+                sim_isr(&s); // writer stalls
+            }
+        } else {
+            sim_isr(&s);
+            ticks++;
+        }
+    }
+    CHECK(s.played == s.total && s.bad == 0);
+    printf("  played %u, swaps %u, underrun %u\n", s.played, s.swaps, s.p.underrun);
+}
+
+static sim_t s_thread_sim;
+static int s_thread_done;
+
+static void *isr_thread(void *arg)
+{
+    sim_t *s = &s_thread_sim;
+    while (s->played < s->total) {
+        if (!sim_isr(s)) {
+            sched_yield(); // the timer period, lets the writer run on a single cpu
+        }
+    }
+    __atomic_store_n(&s_thread_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// real concurrency, the isr and the writer on their own threads
+static void test_threads(void)
+{
+    printf("threads\n");
+    sim_t *s = &s_thread_sim;
+    sim_init(s, 500000, 5);
+    pthread_t tid;
+    pthread_create(&tid, NULL, isr_thread, NULL);
+    while (!__atomic_load_n(&s_thread_done, __ATOMIC_ACQUIRE)) {
+        if (s->written == s->total || !sim_write(s, 1 + sim_rand(s) % (2 * PERIOD), 0) || sim_rand(s) % 8 == 0) {
+            sched_yield();
+        }
+    }
+    pthread_join(tid, NULL);
+    CHECK(s->played == s->total && s->bad == 0);
+    printf("  played %u, swaps %u, underrun %u\n", s->played, s->swaps, s->p.underrun);
+}
+
+int main(void)
+{
+    test_steady();
+    test_partial();
+    test_random();
+    test_threads();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
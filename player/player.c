@@ -8,6 +8,8 @@
 #include "esp_log.h"
 #include "file_manager.h"
 #include "pwm_audio.h"
+#include "audio_resample.h"
+#include "audio_mix.h"
 
 static const char *TAG = "wav player";
 
@@ -33,6 +35,13 @@ typedef struct {
 #define GPIO_AUDIO_OUTPUT_L 3
 // #define GPIO_AUDIO_OUTPUT_R 2
 
+/**
+ * 16 bits files are converted to this format instead of reconfiguring the timer per file,
+ * 8 and 32 bits files still set their own parameters
+ */
+#define PLAYER_PWM_SAMPLE_RATE  16000
+#define PLAYER_PWM_CHANNELS     1
+
 static esp_err_t play_wav(const char *filepath)
 {
     FILE *fd = NULL;
@@ -78,7 +87,23 @@ static esp_err_t play_wav(const char *filepath)
 
     ESP_LOGI(TAG, "frame_rate= %"PRIi32", ch=%d, width=%d", wav_head.SampleRate, wav_head.NumChannels, wav_head.BitsPerSample);
 
-    pwm_audio_set_param(wav_head.SampleRate, wav_head.BitsPerSample, wav_head.NumChannels);
+    int channels = wav_head.NumChannels;
+    audio_resample_handle_t resample = NULL;
+    int16_t *out = NULL;
+    int out_frames = 0;
+    if (wav_head.BitsPerSample == 16 && (channels == 1 || channels == 2)) {
+        resample = audio_resample_create(wav_head.SampleRate, PLAYER_PWM_SAMPLE_RATE, channels);
+        out_frames = audio_resample_out_frames(resample, chunk_size / (2 * channels));
+        out = resample ? malloc(out_frames * 2 * (channels > PLAYER_PWM_CHANNELS ? channels : PLAYER_PWM_CHANNELS)) : NULL;
+        if (resample == NULL || out == NULL) {
+            ESP_LOGW(TAG, "resample to %d failed, play at the file rate", PLAYER_PWM_SAMPLE_RATE);
+            audio_resample_destroy(resample);
+            resample = NULL;
+        }
+    }
+    if (resample == NULL) {
+        pwm_audio_set_param(wav_head.SampleRate, wav_head.BitsPerSample, channels);
+    }
     pwm_audio_start();
 
     /**
@@ -93,10 +118,30 @@ static esp_err_t play_wav(const char *filepath)
         if (len <= 0) {
             break;
         }
-        pwm_audio_write(buffer, len, &cnt, 1000 / portTICK_PERIOD_MS);
+        if (resample) {
+            const int16_t *in = (const int16_t *)buffer;
+            int frames = len / (2 * channels);
+            while (frames > 0) {
+                int used = frames;
+                int n = audio_resample_process(resample, in, &used, out, out_frames);
+                audio_channel_convert(out, channels, out, PLAYER_PWM_CHANNELS, n);
+                pwm_audio_write((uint8_t *)out, n * 2 * PLAYER_PWM_CHANNELS, &cnt, 1000 / portTICK_PERIOD_MS);
+                in += used * channels;
+                frames -= used;
+            }
+        } else {
+            pwm_audio_write(buffer, len, &cnt, 1000 / portTICK_PERIOD_MS);
+        }
         write_num += len;
     } while (1);
     pwm_audio_stop();
+    if (resample) {
+        audio_resample_destroy(resample);
+    } else {
+        pwm_audio_set_param(PLAYER_PWM_SAMPLE_RATE, 16, PLAYER_PWM_CHANNELS);
+    }
+    free(out);
+    free(buffer);
     fclose(fd);
     ESP_LOGI(TAG, "File reading complete, total: %d bytes", write_num);
     return ESP_OK;
@@ -124,6 +169,7 @@ void player_pwm_init(void)
 #endif
     };
     pwm_audio_init(&pac);
+    pwm_audio_set_param(PLAYER_PWM_SAMPLE_RATE, 16, PLAYER_PWM_CHANNELS);
 
     ret = fm_spiffs_init();
     if (ESP_OK != ret) {
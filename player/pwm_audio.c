@@ -10,6 +10,8 @@
 #include "esp_log.h"
 #include "soc/ledc_struct.h"
 #include "pwm_audio.h"
+#include "pwm_audio_conv.h"
+#include "pwm_audio_period.h"
 
 static const char *TAG = "pwm_audio";
 
@@ -52,24 +54,22 @@ static const char *PWM_AUDIO_TIMER_NUM_ERROR  = "PWM AUDIO TIMER NUMBER ERROR";
 #define ISR_DEBUG_IO_MASK 0x8000
 
 typedef struct {
-    char *buf;                         /**< Original pointer */
-    volatile uint32_t head;            /**< ending pointer */
-    volatile uint32_t tail;            /**< Read pointer */
-    volatile uint32_t size;            /**< Buffer size */
-    volatile uint32_t is_give;         /**< semaphore give flag */
-    SemaphoreHandle_t semaphore_rb;    /**< Semaphore for ringbuffer */
-} ringbuf_handle_t;
+    pwm_audio_period_t period;         /**< front/back periods of duty frames */
+    uint16_t *mem;                     /**< Original pointer */
+    SemaphoreHandle_t semaphore_pb;    /**< Given by the ISR on every period swap */
+} periodbuf_handle_t;
 
 typedef struct {
     pwm_audio_config_t    config;                          /**< pwm audio config struct */
     ledc_channel_config_t ledc_channel[PWM_AUDIO_CH_MAX];  /**< ledc channel config */
     ledc_timer_config_t   ledc_timer;                      /**< ledc timer config  */
-    ringbuf_handle_t      *ringbuf;                        /**< audio ringbuffer pointer */
+    periodbuf_handle_t    *periodbuf;                      /**< audio period buffer pointer */
     uint32_t              channel_mask;                    /**< channel gpio mask */
     uint32_t              channel_set_num;                 /**< channel audio set number */
     int32_t               framerate;                       /*!< frame rates in Hz */
     int32_t               bits_per_sample;                 /*!< bits per sample (8, 16, 32) */
     int32_t               volume;                          /*!< the volume(-VOLUME_0DB ~ VOLUME_0DB) */
+    int32_t               gain;                            /*!< Q15 gain of the volume */
     pwm_audio_status_t status;
 } pwm_audio_data_t;
 
@@ -89,131 +89,60 @@ static gptimer_handle_t g_gptimer;
 #endif
 
 /**
- * Ringbuffer for pwm audio
+ * Period buffer for pwm audio, two periods of [left, right] duty frames in size bytes
  */
-static esp_err_t rb_destroy(ringbuf_handle_t *rb)
+static esp_err_t pb_destroy(periodbuf_handle_t *pb)
 {
-    if (rb == NULL) {
+    if (pb == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (rb->buf) {
-        heap_caps_free(rb->buf);
+    if (pb->mem) {
+        heap_caps_free(pb->mem);
     }
 
-    if (rb->semaphore_rb) {
-        vSemaphoreDelete(rb->semaphore_rb);
+    if (pb->semaphore_pb) {
+        vSemaphoreDelete(pb->semaphore_pb);
     }
 
-    heap_caps_free(rb);
-    rb = NULL;
+    heap_caps_free(pb);
     return ESP_OK;
 }
 
-static ringbuf_handle_t *rb_create(uint32_t size)
+static periodbuf_handle_t *pb_create(uint32_t size)
 {
     if (size < (BUFFER_MIN_SIZE << 2)) {
         ESP_LOGE(TAG, "Invalid buffer size, Minimum = %"PRIi32"", (int32_t)(BUFFER_MIN_SIZE << 2));
         return NULL;
     }
 
-    ringbuf_handle_t *rb = NULL;
-    char *buf = NULL;
+    periodbuf_handle_t *pb = NULL;
+    uint32_t period = size / (2 * PWM_AUDIO_CH_MAX * sizeof(uint16_t)); /**< frames per period */
 
     do {
         bool _success =
             (
-                (rb             = heap_caps_malloc(sizeof(ringbuf_handle_t), MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL)) &&
-                (buf            = heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL))   &&
-                (rb->semaphore_rb   = xSemaphoreCreateBinary())
-
+                (pb                 = heap_caps_calloc(1, sizeof(periodbuf_handle_t), MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL)) &&
+                (pb->mem            = heap_caps_malloc(2 * PWM_AUDIO_CH_MAX * sizeof(uint16_t) * period, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL)) &&
+                (pb->semaphore_pb   = xSemaphoreCreateBinary())
             );
 
         if (!_success) {
             break;
         }
 
-        rb->is_give = 0;
-        rb->buf = buf;
-        rb->head = rb->tail = 0;
-        rb->size = size;
-        return rb;
+        pwm_audio_period_init(&pb->period, pb->mem, period);
+        return pb;
 
     } while (0);
 
-    rb_destroy(rb);
+    pb_destroy(pb);
     return NULL;
 }
 
-static uint32_t IRAM_ATTR rb_get_count(ringbuf_handle_t *rb)
-{
-    uint32_t tail = rb->tail;
-
-    if (rb->head >= tail) {
-        return (rb->head - tail);
-    }
-
-    return (rb->size - (tail - rb->head));
-}
-
-static uint32_t IRAM_ATTR rb_get_free(ringbuf_handle_t *rb)
-{
-    /** < Free a byte to judge the ringbuffer direction */
-    return (rb->size - rb_get_count(rb) - 1);
-}
-
-static esp_err_t rb_flush(ringbuf_handle_t *rb)
+static esp_err_t pb_wait_semaphore(periodbuf_handle_t *pb, TickType_t ticks_to_wait)
 {
-    rb->tail = rb->head = 0;
-    return ESP_OK;
-}
-
-static esp_err_t IRAM_ATTR rb_read_byte(ringbuf_handle_t *rb, uint8_t *outdata)
-{
-    uint32_t tail = rb->tail;
-
-    if (tail == rb->head) {
-        return ESP_FAIL;
-    }
-
-    // Send a byte from the buffer
-    *outdata = rb->buf[tail];
-
-    // Update tail position
-    tail++;
-
-    if (tail == rb->size) {
-        tail = 0;
-    }
-
-    rb->tail = tail;
-    return ESP_OK;
-}
-
-static esp_err_t rb_write_byte(ringbuf_handle_t *rb, const uint8_t indata)
-{
-    // Calculate next head
-    uint32_t next_head = rb->head + 1;
-
-    if (next_head == rb->size) {
-        next_head = 0;
-    }
-
-    if (next_head == rb->tail) {
-        return ESP_FAIL;
-    }
-
-    // Store data and advance head
-    rb->buf[rb->head] = indata;
-    rb->head = next_head;
-    return ESP_OK;
-}
-
-static esp_err_t rb_wait_semaphore(ringbuf_handle_t *rb, TickType_t ticks_to_wait)
-{
-    rb->is_give = 0; /**< As long as it's written, it's allowed to give semaphore again */
-
-    if (xSemaphoreTake(rb->semaphore_rb, ticks_to_wait) == pdTRUE) {
+    if (xSemaphoreTake(pb->semaphore_pb, ticks_to_wait) == pdTRUE) {
         return ESP_OK;
     }
 
@@ -260,82 +189,32 @@ static void IRAM_ATTR timer_group_isr(void *para)
     /* After the alarm has been triggered we need enable it again, so it is triggered the next time */
     timer_group_enable_alarm_in_isr(handle->config.tg_num, handle->config.timer_num);
 #endif
-    static uint8_t wave_h, wave_l;
-    static uint16_t value;
-    ringbuf_handle_t *rb = handle->ringbuf;
+    bool swapped = false;
 #if (1==ISR_DEBUG)
     GPIO.out_w1ts = ISR_DEBUG_IO_MASK;
 #endif
 
     /**
-     * It is believed that the channel configured with GPIO needs to output sound
-    */
-    if (handle->channel_mask & CHANNEL_LEFT_MASK) {
-        if (handle->config.duty_resolution > 8) {
-            if (rb_get_count(rb) > 1) {
-                rb_read_byte(rb, &wave_l);
-                rb_read_byte(rb, &wave_h);
-                value = ((wave_h << 8) | wave_l);
-                ledc_set_left_duty_fast(value);/**< set the PWM duty */
-            }
-        } else {
-            if (ESP_OK == rb_read_byte(rb, &wave_h)) {
-                ledc_set_left_duty_fast(wave_h);/**< set the PWM duty */
-            }
-        }
-    }
-
-    /**
-     * If two gpios are configured, but the audio data has only one channel, copy the data to the right channel
-     * Instead, the right channel data is discarded
-    */
-    if (handle->channel_mask & CHANNEL_RIGHT_MASK) {
-        if (handle->channel_set_num == 1) {
-            if (handle->config.duty_resolution > 8) {
-                ledc_set_right_duty_fast(value);/**< set the PWM duty */
-            } else {
-                ledc_set_right_duty_fast(wave_h);/**< set the PWM duty */
-            }
-        } else {
-            if (handle->config.duty_resolution > 8) {
-                if (rb_get_count(rb) > 1) {
-                    rb_read_byte(rb, &wave_l);
-                    rb_read_byte(rb, &wave_h);
-                    value = ((wave_h << 8) | wave_l);
-                    ledc_set_right_duty_fast(value);/**< set the PWM duty */
-                }
-            } else {
-                if (ESP_OK == rb_read_byte(rb, &wave_h)) {
-                    ledc_set_right_duty_fast(wave_h);/**< set the PWM duty */
-                }
-            }
+     * The frame is already converted and laid out per output channel, mono data was copied to
+     * the right channel and stereo data for a single gpio just leaves the other duty unused.
+     * On underrun the last duty is held.
+     */
+    const uint16_t *frame = pwm_audio_period_next(&handle->periodbuf->period, &swapped);
+    if (frame) {
+        if (handle->channel_mask & CHANNEL_LEFT_MASK) {
+            ledc_set_left_duty_fast(frame[CHANNEL_LEFT_INDEX]);/**< set the PWM duty */
         }
-    } else {
-        if (handle->channel_set_num == 2) {
-            /**
-             * Discard the right channel data only if the right channel is configured but the audio data is stereo
-             * Read buffer but do nothing
-             */
-            if (handle->config.duty_resolution > 8) {
-                if (rb_get_count(rb) > 1) {
-                    rb_read_byte(rb, &wave_h);
-                    rb_read_byte(rb, &wave_h);
-                }
-            } else {
-                rb_read_byte(rb, &wave_h);
-            }
+        if (handle->channel_mask & CHANNEL_RIGHT_MASK) {
+            ledc_set_right_duty_fast(frame[CHANNEL_RIGHT_INDEX]);/**< set the PWM duty */
         }
     }
 
     /**
-     * Send semaphore when buffer free is more than BUFFER_MIN_SIZE
+     * Send semaphore once per period, when the old front period became free for the writer
      */
-    uint32_t free_size = rb_get_free(rb);
-    if (0 == rb->is_give && free_size > BUFFER_MIN_SIZE) {
-        /**< The execution time of the following code is 2.71 microsecond */
-        rb->is_give = 1; /**< To prevent multiple give semaphores */
-        BaseType_t xHigherPriorityTaskWoken;
-        xSemaphoreGiveFromISR(rb->semaphore_rb, &xHigherPriorityTaskWoken);
+    if (swapped) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xSemaphoreGiveFromISR(handle->periodbuf->semaphore_pb, &xHigherPriorityTaskWoken);
 
         if (pdFALSE != xHigherPriorityTaskWoken) {
             portYIELD_FROM_ISR();
@@ -359,6 +238,15 @@ esp_err_t pwm_audio_get_status(pwm_audio_status_t *status)
     return ESP_OK;
 }
 
+esp_err_t pwm_audio_get_underrun(uint32_t *count)
+{
+    pwm_audio_data_t *handle = g_pwm_audio_handle;
+    PWM_AUDIO_CHECK(NULL != handle, PWM_AUDIO_NOT_INITIALIZED, ESP_ERR_INVALID_STATE);
+    PWM_AUDIO_CHECK(NULL != count, PWM_AUDIO_PARAM_ADDR_ERROR, ESP_ERR_INVALID_ARG);
+    *count = handle->periodbuf->period.underrun;
+    return ESP_OK;
+}
+
 esp_err_t pwm_audio_get_param(int *rate, int *bits, int *ch)
 {
     pwm_audio_data_t *handle = g_pwm_audio_handle;
@@ -406,8 +294,8 @@ esp_err_t pwm_audio_init(const pwm_audio_config_t *cfg)
     PWM_AUDIO_CHECK(handle != NULL, PWM_AUDIO_ALLOC_ERROR, ESP_ERR_NO_MEM);
     memset(handle, 0, sizeof(pwm_audio_data_t));
 
-    handle->ringbuf = rb_create(cfg->ringbuf_len);
-    PWM_AUDIO_CHECK(handle->ringbuf != NULL, PWM_AUDIO_ALLOC_ERROR, ESP_ERR_NO_MEM);
+    handle->periodbuf = pb_create(cfg->ringbuf_len);
+    PWM_AUDIO_CHECK(handle->periodbuf != NULL, PWM_AUDIO_ALLOC_ERROR, ESP_ERR_NO_MEM);
 
     handle->config = *cfg;
     g_pwm_audio_handle = handle;
@@ -602,6 +490,7 @@ esp_err_t pwm_audio_set_volume(int8_t volume)
     }
 
     handle->volume = volume + VOLUME_0DB;
+    handle->gain = pwm_audio_conv_gain(handle->volume);
     return ESP_OK;
 }
 
@@ -623,125 +512,43 @@ esp_err_t IRAM_ATTR pwm_audio_write(uint8_t *inbuf, size_t inbuf_len, size_t *by
     PWM_AUDIO_CHECK(inbuf_len != 0, "Length should not be zero", ESP_ERR_INVALID_ARG);
 
     *bytes_written = 0;
-    ringbuf_handle_t *rb = handle->ringbuf;
+    periodbuf_handle_t *pb = handle->periodbuf;
     TickType_t start_ticks = xTaskGetTickCount();
 
-    while (inbuf_len) {
-        uint32_t free = rb_get_free(rb);
-        if (ESP_OK == rb_wait_semaphore(rb, ticks_to_wait)) {
-            uint32_t bytes_can_write = inbuf_len;
+    pwm_audio_conv_fn_t conv = pwm_audio_conv_get(handle->bits_per_sample, handle->config.duty_resolution);
+    PWM_AUDIO_CHECK(conv != NULL, "Unsupported Bit width", ESP_ERR_INVALID_STATE);
+    size_t frame_size = (handle->bits_per_sample >> 3) * handle->channel_set_num;
 
-            if (inbuf_len > free) {
-                bytes_can_write = free;
-            }
-
-            bytes_can_write &= 0xfffffffc;/**< Aligned data, bytes_can_write should be an integral multiple of 4 */
-
-            if (0 == bytes_can_write) {
-                *bytes_written += inbuf_len;  /**< Discard the last misaligned bytes of data directly */
-                return ESP_OK;
-            }
+    while (inbuf_len) {
+        if (inbuf_len < frame_size) {
+            *bytes_written += inbuf_len;  /**< Discard the last misaligned bytes of data directly */
+            return ESP_OK;
+        }
 
-            /**< Get the difference between PWM resolution and audio samplewidth */
-            int8_t shift = handle->bits_per_sample - handle->config.duty_resolution;
-            uint32_t len = bytes_can_write;
-
-            switch (handle->bits_per_sample) {
-            case 8: {
-                if (shift < 0) {
-                    /**< When the PWM resolution is greater than 8 bits, the value needs to be expanded */
-                    uint16_t value;
-                    uint8_t temp;
-                    shift = -shift;
-                    len >>= 1;
-                    bytes_can_write >>= 1;
-
-                    for (size_t i = 0; i < len; i++) {
-                        temp = (inbuf[i] * handle->volume / VOLUME_0DB) + 0x7f; /**< offset */
-                        value = temp << shift;
-                        rb_write_byte(rb, value);
-                        rb_write_byte(rb, value >> 8);
-                    }
-                } else {
-                    uint8_t value;
-
-                    for (size_t i = 0; i < len; i++) {
-                        value = (inbuf[i] * handle->volume / VOLUME_0DB) + 0x7f; /**< offset */
-                        rb_write_byte(rb, value);
-                    }
-                }
-            }
-            break;
+        uint32_t space;
+        uint16_t *frames = pwm_audio_period_back(&pb->period, &space);
+        if (frames) {
+            size_t n = inbuf_len / frame_size;
+            n = (n < space) ? n : space;
 
-            case 16: {
-                len >>= 1;
-                uint16_t *buf_16b = (uint16_t *)inbuf;
-                static uint16_t value_16b;
-                int16_t temp;
-
-                if (handle->config.duty_resolution > 8) {
-                    for (size_t i = 0; i < len; i++) {
-                        temp = buf_16b[i];
-                        temp = temp * handle->volume / VOLUME_0DB;
-                        value_16b = temp + 0x7fff; /**< offset */
-                        value_16b >>= shift;
-                        rb_write_byte(rb, value_16b);
-                        rb_write_byte(rb, value_16b >> 8);
-                    }
-                } else {
-                    /**
-                     * When the PWM resolution is 8 bit, only one byte is transmitted
-                     */
-                    for (size_t i = 0; i < len; i++) {
-                        temp = buf_16b[i];
-                        temp = temp * handle->volume / VOLUME_0DB;
-                        value_16b = temp + 0x7fff; /**< offset */
-                        value_16b >>= shift;
-                        rb_write_byte(rb, value_16b);
-                    }
-                }
-            }
-            break;
-
-            case 32: {
-                len >>= 2;
-                uint32_t *buf_32b = (uint32_t *)inbuf;
-                uint32_t value;
-                int32_t temp;
-
-                if (handle->config.duty_resolution > 8) {
-                    for (size_t i = 0; i < len; i++) {
-                        temp = buf_32b[i];
-                        temp = temp * handle->volume / VOLUME_0DB;
-                        value = temp + 0x7fffffff; /**< offset */
-                        value >>= shift;
-                        rb_write_byte(rb, value);
-                        rb_write_byte(rb, value >> 8);
-                    }
-                } else {
-                    /**
-                     * When the PWM resolution is 8 bit, only one byte is transmitted
-                     */
-                    for (size_t i = 0; i < len; i++) {
-                        temp = buf_32b[i];
-                        temp = temp * handle->volume / VOLUME_0DB;
-                        value = temp + 0x7fffffff; /**< offset */
-                        value >>= shift;
-                        rb_write_byte(rb, value);
-                    }
+            if (handle->channel_set_num == 2) {
+                conv(inbuf, frames, 2 * n, handle->gain);
+            } else {
+                /**< convert into the upper half, then spread to [left, right] front to back */
+                conv(inbuf, frames + n, n, handle->gain);
+                for (size_t i = 0; i < n; i++) {
+                    frames[2 * i] = frames[2 * i + 1] = frames[n + i];
                 }
             }
-            break;
-
-            default:
-                break;
-            }
-
-            inbuf += bytes_can_write;
-            inbuf_len -= bytes_can_write;
-            *bytes_written += bytes_can_write;
+            pwm_audio_period_commit(&pb->period, n);
+            inbuf += n * frame_size;
+            inbuf_len -= n * frame_size;
+            *bytes_written += n * frame_size;
+            continue;
+        }
 
-        } else {
+        /**< back period full, wait for the ISR to swap */
+        if (ESP_OK != pb_wait_semaphore(pb, ticks_to_wait)) {
             res = ESP_FAIL;
         }
 
@@ -759,6 +566,7 @@ esp_err_t pwm_audio_start(void)
     pwm_audio_data_t *handle = g_pwm_audio_handle;
     PWM_AUDIO_CHECK(NULL != handle, PWM_AUDIO_NOT_INITIALIZED, ESP_ERR_INVALID_STATE);
     PWM_AUDIO_CHECK(handle->status == PWM_AUDIO_STATUS_IDLE, PWM_AUDIO_STATUS_ERROR, ESP_ERR_INVALID_STATE);
+    handle->periodbuf->period.underrun = 0;
     handle->status = PWM_AUDIO_STATUS_BUSY;
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
@@ -795,7 +603,8 @@ esp_err_t pwm_audio_stop(void)
     res = timer_disable_intr(handle->config.tg_num, handle->config.timer_num);
     PWM_AUDIO_CHECK(res == ESP_OK, "timer disable failed", res);
 #endif
-    rb_flush(handle->ringbuf);  /**< flush ringbuf, avoid play noise */
+    pwm_audio_period_reset(&handle->periodbuf->period);  /**< drop queued periods, avoid play noise */
+    xSemaphoreTake(handle->periodbuf->semaphore_pb, 0);
     handle->status = PWM_AUDIO_STATUS_IDLE;
     return ESP_OK;
 }
@@ -828,7 +637,7 @@ esp_err_t pwm_audio_deinit(void)
         }
     }
 
-    rb_destroy(handle->ringbuf);
+    pb_destroy(handle->periodbuf);
     heap_caps_free(handle);
     g_pwm_audio_handle = NULL;
     return ESP_OK;
@@ -31,7 +31,7 @@ typedef struct {
     ledc_channel_t ledc_channel_right;   /*!< LEDC channel (0 - 7), Corresponding to right channel*/
     ledc_timer_t ledc_timer_sel;         /*!< Select the timer source of channel (0 - 3) */
     ledc_timer_bit_t duty_resolution;    /*!< ledc pwm bits */
-    uint32_t ringbuf_len;                /*!< ringbuffer size */
+    uint32_t ringbuf_len;                /*!< buffer size in bytes, split into two periods of duty frames (ringbuf_len / 8 frames each) */
 } pwm_audio_config_t;
 
 /**
@@ -192,6 +192,20 @@ esp_err_t pwm_audio_get_param(int *rate, int *bits, int *ch);
  */
 esp_err_t pwm_audio_get_status(pwm_audio_status_t *status);
 
+/**
+ * @brief Get the number of underruns since pwm_audio_start
+ *
+ * @attention The ISR takes a full period, or the frames written so far once it runs out of data,
+ *            so a write shorter than a period still plays
+ *
+ * @param count times the output ran out of data and held the last duty
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ */
+esp_err_t pwm_audio_get_underrun(uint32_t *count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,110 @@
+/* SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "pwm_audio_conv.h"
+
+/**
+ * The gain is volume * 2048, so (x * gain) / 2^15 rounded toward zero equals the former
+ * x * volume / 16, up to 0dB the output is bit exact. 16 and 32 bits samples saturate to
+ * +-(2^(n-1) - 1) instead of wrapping around above 0dB, the full scale negative sample no longer
+ * wraps to the top duty through the 0x7fff offset.
+ */
+static inline int32_t conv_scale(int32_t x, int32_t gain)
+{
+    int32_t p = x * gain;  /**< |x| <= 32768, 0 <= gain <= 65536, fits */
+    return (p + ((p >> 31) & 0x7fff)) >> 15;
+}
+
+static inline uint32_t conv_scale_u(uint32_t x, int32_t gain)
+{
+    return (x * (uint32_t)gain) >> 15;
+}
+
+static inline int64_t conv_scale64(int32_t x, int32_t gain)
+{
+    int64_t p = (int64_t)x * gain;
+    return (p + ((p >> 63) & 0x7fff)) >> 15;
+}
+
+/**
+ * Generic kernels, always inlined into the specialized ones below so that the
+ * resolution and the shift are compile time constants
+ */
+static inline __attribute__((always_inline))
+void conv_8b(const uint8_t *restrict in, uint16_t *restrict out, size_t samples, int32_t gain, int duty_resolution)
+{
+    for (size_t i = 0; i < samples; i++) {
+        uint8_t value = conv_scale_u(in[i], gain) + 0x7f; /**< offset */
+        out[i] = (uint32_t)value << (duty_resolution - 8);
+    }
+}
+
+static inline __attribute__((always_inline))
+void conv_16b(const uint8_t *restrict in, uint16_t *restrict out, size_t samples, int32_t gain, int duty_resolution)
+{
+    const int16_t *buf_16b = (const int16_t *)in;
+
+    for (size_t i = 0; i < samples; i++) {
+        int32_t temp = conv_scale(buf_16b[i], gain);
+        temp = (temp > INT16_MAX) ? INT16_MAX : ((temp < -INT16_MAX) ? -INT16_MAX : temp);
+        uint16_t value = temp + 0x7fff; /**< offset */
+        out[i] = value >> (16 - duty_resolution);
+    }
+}
+
+static inline __attribute__((always_inline))
+void conv_32b(const uint8_t *restrict in, uint16_t *restrict out, size_t samples, int32_t gain, int duty_resolution)
+{
+    const int32_t *buf_32b = (const int32_t *)in;
+
+    for (size_t i = 0; i < samples; i++) {
+        int64_t temp = conv_scale64(buf_32b[i], gain);
+        temp = (temp > INT32_MAX) ? INT32_MAX : ((temp < -INT32_MAX) ? -INT32_MAX : temp);
+        uint32_t value = (uint32_t)temp + 0x7fffffff; /**< offset */
+        out[i] = value >> (32 - duty_resolution);
+    }
+}
+
+#define PWM_AUDIO_CONV_DEFINE(bits, res)                                                            \
+    static void conv_##bits##b_##res(const uint8_t *in, uint16_t *out, size_t samples, int32_t gain) \
+    {                                                                                               \
+        conv_##bits##b(in, out, samples, gain, res);                                                \
+    }
+
+PWM_AUDIO_CONV_DEFINE(8, 8)
+PWM_AUDIO_CONV_DEFINE(8, 9)
+PWM_AUDIO_CONV_DEFINE(8, 10)
+PWM_AUDIO_CONV_DEFINE(16, 8)
+PWM_AUDIO_CONV_DEFINE(16, 9)
+PWM_AUDIO_CONV_DEFINE(16, 10)
+PWM_AUDIO_CONV_DEFINE(32, 8)
+PWM_AUDIO_CONV_DEFINE(32, 9)
+PWM_AUDIO_CONV_DEFINE(32, 10)
+
+static const pwm_audio_conv_fn_t s_conv_table[3][3] = {
+    { conv_8b_8,  conv_8b_9,  conv_8b_10  },
+    { conv_16b_8, conv_16b_9, conv_16b_10 },
+    { conv_32b_8, conv_32b_9, conv_32b_10 },
+};
+
+int32_t pwm_audio_conv_gain(int volume)
+{
+    if (volume < 0) {
+        volume = 0;
+    } else if (volume > 32) {
+        volume = 32;
+    }
+    return volume * (PWM_AUDIO_CONV_GAIN_0DB / 16);
+}
+
+pwm_audio_conv_fn_t pwm_audio_conv_get(int bits_per_sample, int duty_resolution)
+{
+    int row = (bits_per_sample == 8) ? 0 : ((bits_per_sample == 16) ? 1 : ((bits_per_sample == 32) ? 2 : -1));
+
+    if (row < 0 || duty_resolution < 8 || duty_resolution > 10) {
+        return NULL;
+    }
+    return s_conv_table[row][duty_resolution - 8];
+}
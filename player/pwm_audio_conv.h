@@ -0,0 +1,56 @@
+/* SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _PWM_AUDIO_CONV_H_
+#define _PWM_AUDIO_CONV_H_
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sample -> PWM duty conversion kernels of pwm_audio_write, plain C so they build on a host.
+ *
+ * Every kernel converts a block of interleaved samples, the channel count does not change the
+ * conversion, pwm_audio_write lays the duty values out as [left, right] frames.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWM_AUDIO_CONV_GAIN_0DB   (1L << 15)  /*!< Q15 unity gain */
+
+/**
+ * @brief Convert a block of samples to duty values
+ *
+ * @param in samples, 8 bits unsigned, 16 or 32 bits signed, native endian
+ * @param out duty values
+ * @param samples number of samples
+ * @param gain Q15 gain, see pwm_audio_conv_gain()
+ */
+typedef void (*pwm_audio_conv_fn_t)(const uint8_t *in, uint16_t *out, size_t samples, int32_t gain);
+
+/**
+ * @brief Q15 gain of a pwm_audio volume step
+ *
+ * @param volume 0 (mute) ~ 32 (double), 16 is 0dB
+ *
+ * @return gain, volume / 16 in Q15
+ */
+int32_t pwm_audio_conv_gain(int volume);
+
+/**
+ * @brief Get the kernel specialized for a sample width and duty resolution
+ *
+ * @param bits_per_sample 8, 16, 32
+ * @param duty_resolution 8, 9, 10
+ *
+ * @return kernel, NULL if the combination is not supported
+ */
+pwm_audio_conv_fn_t pwm_audio_conv_get(int bits_per_sample, int duty_resolution);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+/* SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "pwm_audio_period.h"
+
+void pwm_audio_period_init(pwm_audio_period_t *p, uint16_t *mem, uint32_t period)
+{
+    p->buf[0] = mem;
+    p->buf[1] = mem + 2 * period;
+    p->period = period;
+    p->underrun = 0;
+    pwm_audio_period_reset(p);
+}
+
+void pwm_audio_period_reset(pwm_audio_period_t *p)
+{
+    p->index = 0;
+    p->front_len = 0; /**< front exhausted, the first committed frames start playing */
+    p->front = 0;
+    p->back = PWM_AUDIO_PERIOD_BACK;
+    p->playing = 0;
+}
+
+uint16_t *pwm_audio_period_back(pwm_audio_period_t *p, uint32_t *frames)
+{
+    uint32_t back = __atomic_load_n(&p->back, __ATOMIC_ACQUIRE);
+    do {
+        if (back & PWM_AUDIO_PERIOD_READY) {
+            *frames = 0;
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&p->back, &back, back | PWM_AUDIO_PERIOD_WRITING,
+                                          false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    /**< the ISR leaves a writing back period alone */
+    uint32_t len = back & PWM_AUDIO_PERIOD_LEN_MASK;
+    *frames = p->period - len;
+    return p->buf[(back & PWM_AUDIO_PERIOD_BACK) ? 1 : 0] + 2 * len;
+}
+
+void pwm_audio_period_commit(pwm_audio_period_t *p, uint32_t frames)
+{
+    uint32_t back = __atomic_load_n(&p->back, __ATOMIC_RELAXED) & ~PWM_AUDIO_PERIOD_WRITING;
+    back += frames;
+    if ((back & PWM_AUDIO_PERIOD_LEN_MASK) == p->period) {
+        back |= PWM_AUDIO_PERIOD_READY;
+    }
+    __atomic_store_n(&p->back, back, __ATOMIC_RELEASE); /**< after the frames, the ISR reads them once it sees the length */
+}
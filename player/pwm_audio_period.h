@@ -0,0 +1,113 @@
+/* SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _PWM_AUDIO_PERIOD_H_
+#define _PWM_AUDIO_PERIOD_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Double buffered periods of duty frames between pwm_audio_write and the timer ISR, plain C so
+ * the buffer management can be simulated on a host.
+ *
+ * A frame is the [left, right] duty pair of one sample period. The ISR plays the front period
+ * frame by frame, the writer fills the back period. When the front period is exhausted the ISR
+ * swaps in the back period if it is full, or takes the frames committed so far if the writer is
+ * not in the middle of a write, so the tail of a stream plays once the writer goes idle. With no
+ * frame committed it holds the last duty and counts one underrun until frames arrive again.
+ *
+ * The back period state is one word changed atomically: the ISR owns it while it is ready,
+ * the writer while it is writing, either side may take it otherwise.
+ */
+
+#define PWM_AUDIO_PERIOD_LEN_MASK   0x0fffffffu  /*!< frames committed to the back period */
+#define PWM_AUDIO_PERIOD_BACK       0x20000000u  /*!< index of the back buffer */
+#define PWM_AUDIO_PERIOD_WRITING    0x40000000u  /*!< writer is filling frames past the committed ones */
+#define PWM_AUDIO_PERIOD_READY      0x80000000u  /*!< back period is full, taken by the ISR only */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t          *buf[2];       /*!< two periods of frames */
+    uint32_t          period;        /*!< frames per period */
+    uint32_t          index;         /*!< next frame of the front period, ISR only */
+    uint32_t          front_len;     /*!< frames of the front period, ISR only */
+    uint32_t          front;         /*!< buffer played by the ISR, ISR only */
+    volatile uint32_t back;          /*!< back period state, PWM_AUDIO_PERIOD_xxx */
+    volatile uint32_t playing;       /*!< the front period holds audio */
+    volatile uint32_t underrun;      /*!< times the ISR ran out of frames */
+} pwm_audio_period_t;
+
+/**
+ * @brief Initialize the periods
+ *
+ * @param p periods
+ * @param mem 4 * period duty values
+ * @param period frames per period, at most PWM_AUDIO_PERIOD_LEN_MASK
+ */
+void pwm_audio_period_init(pwm_audio_period_t *p, uint16_t *mem, uint32_t period);
+
+/**
+ * @brief Drop all frames, only while the ISR is stopped
+ */
+void pwm_audio_period_reset(pwm_audio_period_t *p);
+
+/**
+ * @brief Free space of the back period, writer side, must be followed by pwm_audio_period_commit
+ *
+ * @param p periods
+ * @param[out] frames number of free frames
+ *
+ * @return first free frame, NULL if the back period is full and waits for the ISR
+ */
+uint16_t *pwm_audio_period_back(pwm_audio_period_t *p, uint32_t *frames);
+
+/**
+ * @brief Mark frames written into the back period, the ISR may take them from now on
+ */
+void pwm_audio_period_commit(pwm_audio_period_t *p, uint32_t frames);
+
+/**
+ * @brief Next frame to play, ISR side
+ *
+ * @param p periods
+ * @param[out] swapped set when the back period was swapped in, the writer may fill the new back period
+ *
+ * @return frame, NULL on underrun, the last duty should be held
+ *
+ * @attention always inlined, it runs inside the IRAM timer ISR
+ */
+static inline __attribute__((always_inline))
+const uint16_t *pwm_audio_period_next(pwm_audio_period_t *p, bool *swapped)
+{
+    if (p->index == p->front_len) {
+        uint32_t back = __atomic_load_n(&p->back, __ATOMIC_ACQUIRE);
+        uint32_t len = back & PWM_AUDIO_PERIOD_LEN_MASK;
+        /**< a full period, or the committed frames of an idle writer; the writer may start a write meanwhile */
+        bool take = (back & PWM_AUDIO_PERIOD_READY) || (!(back & PWM_AUDIO_PERIOD_WRITING) && len);
+        if (!take || !__atomic_compare_exchange_n(&p->back, &back, (back & PWM_AUDIO_PERIOD_BACK) ^ PWM_AUDIO_PERIOD_BACK,
+                                                  false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (p->playing) {
+                p->playing = 0;
+                p->underrun++;
+            }
+            return NULL;
+        }
+        p->front = (back & PWM_AUDIO_PERIOD_BACK) ? 1 : 0;
+        p->index = 0;
+        p->front_len = len;
+        p->playing = 1;
+        *swapped = true; /**< the old front period is the new back period of the writer */
+    }
+    return p->buf[p->front] + 2 * p->index++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,6 +5,7 @@
 #include "esp_system.h"
 #include "esp_spi_flash.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "rb_log.h"
 
@@ -70,4 +71,20 @@ void app_main(void)
             rb_log_free_msg(msg);
         }
     }
+
+    // drain rate of rb_log_acquire_batch, the log reader has to keep up with 10k msgs/s
+    for(int i = 0; i < 3000; i++) {
+        ESP_LOGI("wifi", "hello world [%d]", i);
+    }
+    vTaskDelay(1000);
+    rb_log_msg_t msgs[32];
+    int total = 0;
+    int num = 0;
+    int64_t start = esp_timer_get_time();
+    while((num = rb_log_acquire_batch(msgs, 32)) > 0) {
+        rb_log_release_batch(msgs, num);
+        total += num;
+    }
+    int64_t cost = esp_timer_get_time() - start;
+    printf("-------->8 drain %d msg, %lld us, %lld msg/s\n", total, cost, cost ? total * 1000000LL / cost : 0);
 }
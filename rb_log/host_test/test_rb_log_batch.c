@@ -0,0 +1,379 @@
+// host test and drain rate of the rb_log batch reader on a byte ring buffer model, see Makefile
+// the model follows the esp_ringbuf byte buffer: one send is copied in whole, one receive returns the
+// contiguous bytes up to the end of the storage, one retrieval at a time, every call takes the lock
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "rb_log_batch.h"
+
+#define MSG_MAX         (300)                   // RB_LOG_BUFF_MSG_MAX of the test
+#define SPILL_SIZE      RB_LOG_BATCH_RECORD(MSG_MAX)
+#define MAX_BATCH       (64)
+#define BENCH_MSGS      (200000)
+#define BENCH_LEN       (60)                    // "I (12345) wifi: hello world [123]\n" and alike
+#define DRAIN_METRIC    (10000)                 // msgs/s the log reader has to keep up with
+
+static int s_fail;
+static uint32_t s_rand = 3;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint8_t* storage;
+    uint32_t size;
+    uint32_t read;
+    uint32_t used;
+    uint32_t out;       // bytes of the outstanding retrieval
+    uint32_t locks;
+} ring_t;
+
+static void ring_init(ring_t* ring, uint32_t size)
+{
+    memset(ring, 0, sizeof(ring_t));
+    pthread_mutex_init(&ring->lock, NULL);
+    ring->storage = malloc(size);
+    ring->size = size;
+}
+
+static void ring_deinit(ring_t* ring)
+{
+    pthread_mutex_destroy(&ring->lock);
+    free(ring->storage);
+}
+
+// xRingbufferSend
+static int ring_send(ring_t* ring, const uint8_t* data, uint32_t len)
+{
+    int ret = 0;
+    pthread_mutex_lock(&ring->lock);
+    ring->locks++;
+    if(ring->size - ring->used >= len) {
+        uint32_t wr = (ring->read + ring->used) % ring->size;
+        uint32_t n = ring->size - wr < len ? ring->size - wr : len;
+        memcpy(ring->storage + wr, data, n);
+        memcpy(ring->storage, data + n, len - n);
+        ring->used += len;
+        ret = 1;
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return ret;
+}
+
+// xRingbufferReceiveUpTo, no wait
+static uint8_t* ring_receive_up_to(ring_t* ring, uint32_t* len, uint32_t max)
+{
+    uint8_t* data = NULL;
+    pthread_mutex_lock(&ring->lock);
+    ring->locks++;
+    if((ring->out == 0) && ring->used) {
+        uint32_t n = ring->size - ring->read;
+        n = ring->used < n ? ring->used : n;
+        n = max < n ? max : n;
+        data = ring->storage + ring->read;
+        ring->out = n;
+        *len = n;
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return data;
+}
+
+// vRingbufferReturnItem
+static void ring_return(ring_t* ring, uint8_t* data)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->locks++;
+    CHECK(data == ring->storage + ring->read);
+    ring->read = (ring->read + ring->out) % ring->size;
+    ring->used -= ring->out;
+    ring->out = 0;
+    pthread_mutex_unlock(&ring->lock);
+}
+
+// _rb_log_buff_send
+static int send_msg(ring_t* ring, const char* msg, uint32_t len)
+{
+    uint8_t rec[RB_LOG_BATCH_RECORD(MSG_MAX)];
+    if(len > MSG_MAX) {
+        return 0;
+    }
+    rb_log_batch_head(rec, len);
+    memcpy(rec + RB_LOG_BATCH_HEAD, msg, len);
+    rec[RB_LOG_BATCH_HEAD + len] = '\0';
+    return ring_send(ring, rec, RB_LOG_BATCH_RECORD(len));
+}
+
+// rb_log_acquire_batch
+static int acquire(ring_t* ring, rb_log_batch_t* batch, rb_log_msg_t* msgs, int max_num)
+{
+    int num = 0;
+    for(int i = 0; i < 2; i++) {
+        if(batch->chunk == NULL) {
+            uint32_t len = 0;
+            uint8_t* data = ring_receive_up_to(ring, &len, ring->size);
+            if(data == NULL) {
+                break;
+            }
+            rb_log_batch_fill(batch, data, len);
+        }
+        num = rb_log_batch_parse(batch, msgs, max_num);
+        if(num || batch->acquired) {
+            break;
+        }
+        uint8_t* done = rb_log_batch_release(batch);
+        if(done == NULL) {
+            break;
+        }
+        ring_return(ring, done);
+    }
+    return num;
+}
+
+// rb_log_release_batch
+static void release(ring_t* ring, rb_log_batch_t* batch)
+{
+    uint8_t* done = rb_log_batch_release(batch);
+    if(done) {
+        ring_return(ring, done);
+    }
+}
+
+// message seq, its length and content follow from seq
+static uint32_t make_msg(char* msg, uint32_t seq)
+{
+    uint32_t len = (seq * 2654435761u >> 7) % 8 == 0 ? (seq * 40503u) % (MSG_MAX + 1) : (seq * 40503u) % 80;
+    for(uint32_t i = 0; i < len; i++) {
+        msg[i] = 'a' + (seq + i) % 26;
+    }
+    if(len >= 4) {
+        memcpy(msg, &seq, 4);
+    }
+    return len;
+}
+
+static int check_msg(const rb_log_msg_t* item, uint32_t seq)
+{
+    char ref[MSG_MAX];
+    uint32_t len = make_msg(ref, seq);
+    return (item->len == len) && (memcmp(item->msg, ref, len) == 0) && (item->msg[len] == '\0');
+}
+
+// random writes, reads with random max_num, double acquire before release, storages from tiny to roomy
+static void test_order(uint32_t size)
+{
+    static uint8_t spill[SPILL_SIZE];
+    rb_log_msg_t msgs[2 * MAX_BATCH];
+    char msg[MSG_MAX];
+    rb_log_batch_t batch;
+    ring_t ring;
+    uint32_t sent = 0, read = 0, cut = 0;
+    int fail0 = s_fail;
+
+    ring_init(&ring, size);
+    CHECK(rb_log_batch_init(&batch, spill, SPILL_SIZE) == 0);
+    for(int r = 0; r < 20000; r++) {
+        int writes = rnd() % 8;
+        for(int i = 0; i < writes; i++) {
+            uint32_t len = make_msg(msg, sent);
+            if(send_msg(&ring, msg, len) == 0) {
+                break;
+            }
+            sent++;
+        }
+        int max_num = 1 + rnd() % MAX_BATCH;
+        int num = acquire(&ring, &batch, msgs, max_num);
+        CHECK(num <= max_num);
+        // never empty while messages are queued and nothing is held
+        CHECK((num > 0) || (sent == read));
+        if(rnd() % 4 == 0) {
+            num += acquire(&ring, &batch, msgs + num, 1 + rnd() % MAX_BATCH);
+        }
+        for(int i = 0; i < num; i++) {
+            CHECK(check_msg(&msgs[i], read));
+            if(msgs[i].msg == (char*)spill + RB_LOG_BATCH_HEAD) {
+                cut++;
+            }
+            read++;
+        }
+        release(&ring, &batch);
+    }
+    while(read < sent) {
+        int num = acquire(&ring, &batch, msgs, MAX_BATCH);
+        CHECK(num > 0);
+        if(num <= 0) {
+            break;
+        }
+        for(int i = 0; i < num; i++) {
+            CHECK(check_msg(&msgs[i], read));
+            read++;
+        }
+        release(&ring, &batch);
+    }
+    CHECK(acquire(&ring, &batch, msgs, MAX_BATCH) == 0);
+    release(&ring, &batch);
+    CHECK((ring.used == 0) && (ring.out == 0) && (batch.spill_len == 0));
+    printf("  storage %u: %u messages in order, %u cut at the storage end%s\n", size, read, cut, s_fail == fail0 ? "" : " FAILED");
+    ring_deinit(&ring);
+}
+
+// a record cut at every offset of its header and body
+static void test_cut(void)
+{
+    static uint8_t spill[SPILL_SIZE];
+    rb_log_msg_t msgs[4];
+    rb_log_batch_t batch;
+    ring_t ring;
+    char msg[MSG_MAX];
+
+    printf("record cut at every offset, header included\n");
+    for(uint32_t at = 0; at <= RB_LOG_BATCH_RECORD(10); at++) {
+        ring_init(&ring, 64);
+        rb_log_batch_init(&batch, spill, SPILL_SIZE);
+        // ring start so that at bytes of the second record fit before the end of the storage
+        ring.read = (2 * 64 - at - RB_LOG_BATCH_RECORD(10)) % 64;
+        memset(msg, 'x', 10);
+        CHECK(send_msg(&ring, msg, 10) == 1);
+        memset(msg, 'y', 10);
+        CHECK(send_msg(&ring, msg, 10) == 1);
+        int num = 0;
+        char seen[2] = { 0 };
+        for(int r = 0; (r < 4) && (num < 2); r++) {
+            int n = acquire(&ring, &batch, msgs, 4);
+            for(int i = 0; i < n; i++) {
+                CHECK(msgs[i].len == 10);
+                seen[num + i] = msgs[i].msg[0];
+                CHECK(memchr(msgs[i].msg, seen[num + i] == 'x' ? 'y' : 'x', 10) == NULL);
+            }
+            num += n;
+            release(&ring, &batch);
+        }
+        CHECK((num == 2) && (seen[0] == 'x') && (seen[1] == 'y'));
+        CHECK((ring.used == 0) && (batch.spill_len == 0));
+        ring_deinit(&ring);
+    }
+}
+
+static void test_errors(void)
+{
+    static uint8_t spill[SPILL_SIZE];
+    rb_log_msg_t msgs[4];
+    rb_log_batch_t batch;
+    uint8_t chunk[16] = { 0xff, 0xff };
+
+    printf("invalid parameters and broken records\n");
+    CHECK(rb_log_batch_init(NULL, spill, SPILL_SIZE) == -1);
+    CHECK(rb_log_batch_init(&batch, NULL, SPILL_SIZE) == -1);
+    CHECK(rb_log_batch_init(&batch, spill, 2) == -1);
+    CHECK(rb_log_batch_init(&batch, spill, SPILL_SIZE) == 0);
+    CHECK(rb_log_batch_parse(&batch, msgs, 4) == 0);
+    CHECK(rb_log_batch_release(&batch) == NULL);
+    // length over the writer limit, the chunk is dropped and given back
+    rb_log_batch_fill(&batch, chunk, sizeof(chunk));
+    CHECK(rb_log_batch_parse(&batch, msgs, 4) == 0);
+    CHECK(rb_log_batch_release(&batch) == chunk);
+    CHECK(batch.spill_len == 0);
+}
+
+// old reader: xRingbufferReceive and vRingbufferReturnItem per message, each under the lock
+static int drain_per_msg(ring_t* ring)
+{
+    int num = 0;
+    while(1) {
+        uint32_t len = 0;
+        pthread_mutex_lock(&ring->lock);
+        ring->locks++;
+        if(ring->used == 0) {
+            pthread_mutex_unlock(&ring->lock);
+            break;
+        }
+        uint8_t* rec = ring->storage + ring->read; // records do not wrap in the bench storage
+        len = RB_LOG_BATCH_RECORD(rec[0] | (rec[1] << 8));
+        ring->out = len;
+        pthread_mutex_unlock(&ring->lock);
+        num += rec[RB_LOG_BATCH_HEAD] != 0;
+        ring_return(ring, rec);
+    }
+    return num;
+}
+
+static int drain_batch(ring_t* ring, rb_log_batch_t* batch)
+{
+    rb_log_msg_t msgs[MAX_BATCH];
+    int num = 0, n;
+    while((n = acquire(ring, batch, msgs, MAX_BATCH)) > 0) {
+        for(int i = 0; i < n; i++) {
+            num += msgs[i].msg[0] != 0;
+        }
+        release(ring, batch);
+    }
+    return num;
+}
+
+static void bench(void)
+{
+    static uint8_t spill[SPILL_SIZE];
+    rb_log_batch_t batch;
+    ring_t ring;
+    char msg[BENCH_LEN];
+    double t, a, b;
+    uint32_t la, lb;
+
+    memset(msg, 'm', sizeof(msg));
+    ring_init(&ring, BENCH_MSGS * RB_LOG_BATCH_RECORD(BENCH_LEN));
+    rb_log_batch_init(&batch, spill, SPILL_SIZE);
+
+    for(int i = 0; i < BENCH_MSGS; i++) {
+        send_msg(&ring, msg, BENCH_LEN);
+    }
+    ring.locks = 0;
+    t = now_s();
+    CHECK(drain_per_msg(&ring) == BENCH_MSGS);
+    a = BENCH_MSGS / (now_s() - t);
+    la = ring.locks;
+
+    ring.read = ring.used = 0;
+    for(int i = 0; i < BENCH_MSGS; i++) {
+        send_msg(&ring, msg, BENCH_LEN);
+    }
+    ring.locks = 0;
+    t = now_s();
+    CHECK(drain_batch(&ring, &batch) == BENCH_MSGS);
+    b = BENCH_MSGS / (now_s() - t);
+    lb = ring.locks;
+
+    printf("bench drain %d messages of %d B, batch %d: per message %.2f M msgs/s %.2f locks/msg, "
+        "batch %.2f M msgs/s %.3f locks/msg (%.2fx), metric %d msgs/s\n", BENCH_MSGS, BENCH_LEN, MAX_BATCH,
+        a / 1e6, (double)la / BENCH_MSGS, b / 1e6, (double)lb / BENCH_MSGS, b / a, DRAIN_METRIC);
+    CHECK(b > DRAIN_METRIC);
+    ring_deinit(&ring);
+}
+
+int main(void)
+{
+    static const uint32_t sizes[] = { 512, 1000, 4096, 64 * 1024 };
+
+    printf("batch read of the byte ring buffer against the written order\n");
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        test_order(sizes[i]);
+    }
+    test_cut();
+    test_errors();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+// host test of the deferred log record and its export stream against vsnprintf, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "rb_log_defer.h"
+
+#define RECORD_MAX  (512)
+#define TEXT_MAX    (256)
+#define TABLE_SIZE  (16)
+#define STREAM_PATH "build/export.bin"
+#define TEXT_PATH   "build/export.txt"
+#define DECODE_PATH "build/decode.txt"
+
+static int s_fail;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t s_table[TABLE_SIZE];
+static FILE* s_stream;
+static FILE* s_text;
+static int s_record_bytes, s_text_bytes, s_records;
+
+static int encode(uint8_t* record, int len, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = rb_log_defer_encode(record, len, fmt, args);
+    va_end(args);
+    return n;
+}
+
+// record, native decode, export and export decode of one message all give the vsnprintf text
+static void check_fmt(const char* fmt, ...)
+{
+    uint8_t record[RECORD_MAX], frames[RECORD_MAX + 64];
+    char ref[TEXT_MAX], text[TEXT_MAX];
+    va_list args, ap;
+
+    va_start(args, fmt);
+    va_copy(ap, args);
+    int ref_len = vsnprintf(ref, sizeof(ref), fmt, ap);
+    va_end(ap);
+    int len = rb_log_defer_encode(record, sizeof(record), fmt, args);
+    va_end(args);
+    CHECK(len > 0);
+    if(len <= 0) {
+        printf("  format \"%s\"\n", fmt);
+        return;
+    }
+
+    int n = rb_log_defer_decode(record, len, text, sizeof(text));
+    CHECK(n == ref_len);
+    CHECK(strcmp(text, ref) == 0);
+
+    int out = rb_log_defer_export(s_table, TABLE_SIZE, record, len, frames, sizeof(frames));
+    CHECK(out > 0);
+    if(out <= 0) {
+        return;
+    }
+    // last frame is the record, a format frame may come first
+    int pos = 0;
+    if(frames[0] == RB_LOG_DEFER_FRAME_FMT) {
+        pos = RB_LOG_DEFER_FRAME_HEAD + (frames[1] | (frames[2] << 8));
+        CHECK(memcmp(frames + RB_LOG_DEFER_FRAME_HEAD + 4, fmt, strlen(fmt)) == 0);
+    }
+    CHECK(frames[pos] == RB_LOG_DEFER_FRAME_RECORD);
+    int payload = frames[pos + 1] | (frames[pos + 2] << 8);
+    CHECK(pos + RB_LOG_DEFER_FRAME_HEAD + payload == out);
+    n = rb_log_defer_decode_export(fmt, frames + pos + RB_LOG_DEFER_FRAME_HEAD + 4, payload - 4, text, sizeof(text));
+    CHECK(n == ref_len);
+    CHECK(strcmp(text, ref) == 0);
+    if(strcmp(text, ref) != 0) {
+        printf("  format \"%s\": \"%s\" != \"%s\"\n", fmt, text, ref);
+    }
+
+    fwrite(frames, 1, out, s_stream);
+    out = rb_log_defer_export(s_table, TABLE_SIZE, (const uint8_t*)"\n", 1, frames, sizeof(frames));
+    fwrite(frames, 1, out, s_stream);
+    fprintf(s_text, "%s\n", ref);
+    s_record_bytes += len;
+    s_text_bytes += ref_len;
+    s_records++;
+}
+
+static void test_formats(void)
+{
+    int x = 0;
+
+    printf("native and export decode against vsnprintf\n");
+    check_fmt("plain text without args");
+    check_fmt("I (%u) wifi: connected %d dBm, %s", 123456u, -67, "ssid_home");
+    check_fmt("%*d|%-*d|%.*s|%-8s|%08.3f", 6, -42, 5, 7, 3, "abcdef", "ab", 3.14159);
+    check_fmt("%lld %llu %llx %lld", -1234567890123LL, 18446744073709551615ULL, 0x123456789abcULL, 0LL);
+    check_fmt("%zu %ld %lu %lx", (size_t)99999, -5L, 4000000000UL, 0xdeadbeefUL);
+    check_fmt("%hhx %hhd %hx %hd %hu", 0x1ff, 200, 0x12345, 40000, 70000);
+    check_fmt("%c%c%3c|%-3c|", 'a', 'Z', 'q', '!');
+    check_fmt("%x %X %o %#x %#o %u", -1, 0xabcdef, 511, 255, 8, -1);
+    check_fmt("%+.3e %g %G %.0f %10.4f %-10.2e|", -12345.678, 0.0001, 1e20, 2.5, -1.0 / 3, 6.02e23);
+    check_fmt("100%% %d%% %s", 50, "%d in a string");
+    check_fmt("%5s|%-5s|%.2s|%s|%s", "a", "b", "cdef", "", "utf8 \xe4\xb8\xad\xe6\x96\x87");
+    check_fmt("%d %i %+d % d %05d %-5d|", 0, -2147483647 - 1, 7, 7, -7, 7);
+    check_fmt("%p", (void*)&x);
+    check_fmt("%jd %td", (intmax_t)-77, (ptrdiff_t)-3);
+    check_fmt("I (%u) wifi: connected %d dBm, %s", 7u, -90, "second use, no format frame");
+}
+
+static void test_errors(void)
+{
+    uint8_t record[RECORD_MAX], frames[64];
+    char text[16];
+    uint32_t table[4] = { 0 };
+    long double ld = 1.5;
+
+    printf("unsupported format, truncation, small buffers, invalid records\n");
+    CHECK(encode(record, sizeof(record), "%Lf", ld) == -1);
+    CHECK(encode(record, sizeof(record), "%n", &text) == -1);
+    CHECK(encode(record, 8, "%s", "longer than the record") == -1);
+
+    // truncated text, snprintf return value
+    int len = encode(record, sizeof(record), "%s-%d", "0123456789abcdef", 42);
+    CHECK(rb_log_defer_decode(record, len, text, sizeof(text)) == 19);
+    CHECK(strcmp(text, "0123456789abcde") == 0);
+    CHECK(rb_log_defer_decode(record, len - 1, text, sizeof(text)) == -1);
+
+    // export buffer too small keeps the format unexported, next export brings the format frame
+    CHECK(rb_log_defer_export(table, 4, record, len, frames, 20) == -1);
+    int out = rb_log_defer_export(table, 4, record, len, frames, sizeof(frames));
+    CHECK(out > 0 && frames[0] == RB_LOG_DEFER_FRAME_FMT);
+    out = rb_log_defer_export(table, 4, record, len, frames, sizeof(frames));
+    CHECK(out > 0 && frames[0] == RB_LOG_DEFER_FRAME_RECORD);
+    int payload = frames[1] | (frames[2] << 8);
+    CHECK(rb_log_defer_decode_export("%s-%d", frames + RB_LOG_DEFER_FRAME_HEAD + 4, payload - 4, text, sizeof(text)) == 19);
+    CHECK(rb_log_defer_decode_export("%s-%d", frames + RB_LOG_DEFER_FRAME_HEAD + 4, payload - 5, text, sizeof(text)) == -1);
+    CHECK(rb_log_defer_decode_export("%d-%s", frames + RB_LOG_DEFER_FRAME_HEAD + 4, payload - 4, text, sizeof(text)) == -1);
+
+    // text message
+    out = rb_log_defer_export(table, 4, (const uint8_t*)"text\n", 5, frames, sizeof(frames));
+    CHECK(out == RB_LOG_DEFER_FRAME_HEAD + 5 && frames[0] == RB_LOG_DEFER_FRAME_TEXT);
+    CHECK(rb_log_defer_export(table, 4, (const uint8_t*)"text\n", 5, frames, 7) == -1);
+}
+
+// full table exports the format frame again
+static void test_table_full(void)
+{
+    static const char* fmts[] = { "a%d\n", "b%d\n", "c%d\n", "d%d\n" };
+    uint8_t record[64], frames[64];
+    uint32_t table[2] = { 0 };
+    int fmt_frames = 0;
+
+    printf("format table full\n");
+    for(int r = 0; r < 3; r++) {
+        for(int i = 0; i < 4; i++) {
+            int len = encode(record, sizeof(record), fmts[i], i);
+            CHECK(rb_log_defer_export(table, 2, record, len, frames, sizeof(frames)) > 0);
+            fmt_frames += frames[0] == RB_LOG_DEFER_FRAME_FMT;
+        }
+    }
+    CHECK(fmt_frames == 2 + 2 * 3);
+}
+
+// the host decoder prints the stream as the text log
+static void test_decode_tool(void)
+{
+    char cmd[256];
+
+    printf("rb_log_decode on the export stream\n");
+    fclose(s_stream);
+    fclose(s_text);
+    snprintf(cmd, sizeof(cmd), "%s < %s > %s", RB_LOG_DECODE, STREAM_PATH, DECODE_PATH);
+    CHECK(system(cmd) == 0);
+    snprintf(cmd, sizeof(cmd), "cmp -s %s %s", DECODE_PATH, TEXT_PATH);
+    CHECK(system(cmd) == 0);
+}
+
+int main(void)
+{
+    s_stream = fopen(STREAM_PATH, "wb");
+    s_text = fopen(TEXT_PATH, "wb");
+    if(s_stream == NULL || s_text == NULL) {
+        printf("open %s failed\n", STREAM_PATH);
+        return 1;
+    }
+    test_formats();
+    test_errors();
+    test_table_full();
+    test_decode_tool();
+    printf("%d messages: deferred record %.1f bytes, text %.1f bytes on average\n",
+           s_records, (double)s_record_bytes / s_records, (double)s_text_bytes / s_records);
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+// host test and multi producer benchmark of the rb_log staging buffer, see Makefile
+// each producer thread stands for one core with its own staging buffer, as the capture hook uses them
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include "rb_log.h"
+#include "rb_log_stage.h"
+
+#define MAX_PRODUCERS   (4)
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); __atomic_add_fetch(&s_fail, 1, __ATOMIC_RELAXED); } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// _rb_log_capture_vprintf without the scheduler suspend
+static int stage_printf(rb_log_stage_t* stage, const char* fmt, ...)
+{
+    int size = -1;
+    char* cache = rb_log_stage_reserve(stage, RB_LOG_CAPTURE_LINE_MAX);
+    if(cache) {
+        va_list args;
+        va_start(args, fmt);
+        size = vsnprintf(cache, RB_LOG_CAPTURE_LINE_MAX, fmt, args);
+        va_end(args);
+        if(size >= RB_LOG_CAPTURE_LINE_MAX) {
+            size = RB_LOG_CAPTURE_LINE_MAX - 1;
+        }
+        rb_log_stage_commit(stage, (size > 0) ? size : 0);
+    }
+    return size;
+}
+
+static void test_single(void)
+{
+    printf("reserve, commit, wrap, drop\n");
+    static uint8_t buff[1024];
+    rb_log_stage_t stage;
+    uint32_t len;
+    CHECK(rb_log_stage_init(&stage, buff, 32) == -1);
+    CHECK(rb_log_stage_init(&stage, buff, 1000) == -1);
+    CHECK(rb_log_stage_init(&stage, NULL, 1024) == -1);
+    CHECK(rb_log_stage_init(&stage, buff, 1024) == 0);
+    CHECK(rb_log_stage_peek(&stage, &len) == NULL);
+
+    // a reserve needs 4 + RB_LOG_CAPTURE_LINE_MAX bytes, whatever the line length
+    CHECK(stage_printf(&stage, "I (%d) %s", 10, "first") == 12);
+    char* msg = rb_log_stage_peek(&stage, &len);
+    CHECK(msg && len == 12 && strcmp(msg, "I (10) first") == 0);
+    rb_log_stage_pop(&stage);
+    CHECK(rb_log_stage_peek(&stage, &len) == NULL);
+    CHECK(stage_printf(&stage, "%0*d", RB_LOG_CAPTURE_LINE_MAX + 88, 7) == RB_LOG_CAPTURE_LINE_MAX - 1); // truncated, head at 536
+    CHECK(stage_printf(&stage, "%s", "") == -1 && stage.drop == 1); // 488 bytes at the end, 508 free
+    msg = rb_log_stage_peek(&stage, &len);
+    CHECK(msg && len == RB_LOG_CAPTURE_LINE_MAX - 1 && msg[len] == '\0' && msg[len - 1] == '0');
+    rb_log_stage_pop(&stage);
+
+    // the next reserve pads the end and wraps, the reader skips the pad
+    CHECK(stage_printf(&stage, "%s", "") == 0);
+    msg = rb_log_stage_peek(&stage, &len);
+    CHECK(msg && len == 0 && msg[0] == '\0' && (uint8_t*)msg == buff + 4);
+    rb_log_stage_pop(&stage);
+    CHECK(stage.head == stage.tail && stage.drop == 1);
+
+    // random lengths through a small buffer against a shadow queue
+    static char shadow[4096][RB_LOG_CAPTURE_LINE_MAX];
+    uint32_t w = 0, r = 0, drops = stage.drop;
+    for(int n = 0; n < 200000; n++) {
+        if(rnd() % 2) {
+            int k = rnd() % (RB_LOG_CAPTURE_LINE_MAX + 20), size;
+            char line[RB_LOG_CAPTURE_LINE_MAX + 32];
+            memset(line, 'a' + n % 26, k);
+            line[k] = '\0';
+            size = stage_printf(&stage, "%s", line);
+            if(size < 0) {
+                drops++;
+                CHECK(stage.drop == drops);
+                continue;
+            }
+            CHECK(size == (k < RB_LOG_CAPTURE_LINE_MAX ? k : RB_LOG_CAPTURE_LINE_MAX - 1));
+            memcpy(shadow[w++ % 4096], line, size);
+            shadow[(w - 1) % 4096][size] = '\0';
+        } else if((msg = rb_log_stage_peek(&stage, &len)) != NULL) {
+            CHECK(r < w && strcmp(msg, shadow[r % 4096]) == 0 && len == strlen(msg));
+            r++;
+            rb_log_stage_pop(&stage);
+        } else {
+            CHECK(r == w);
+        }
+        if(s_fail) {
+            return;
+        }
+    }
+}
+
+typedef struct {
+    rb_log_stage_t stage;
+    uint8_t* buff;
+    int id;
+    int retry; // wait and retry a full buffer instead of dropping
+    uint32_t count;
+    volatile int done;
+} producer_t;
+
+static producer_t s_producers[MAX_PRODUCERS];
+static int s_producer_num;
+
+static void* producer_task(void* arg)
+{
+    producer_t* p = arg;
+    for(uint32_t seq = 0; seq < p->count; seq++) {
+        while(stage_printf(&p->stage, "I (%u) core%d: seq %u heap %u %.*s", seq, p->id, seq, seq * 2654435761u, (int)(seq % 40),
+            "0123456789abcdefghijklmnopqrstuvwxyzABCDEF") < 0 && p->retry) {
+            nanosleep(&(struct timespec){ 0, 20000 }, NULL);
+        }
+    }
+    __atomic_store_n(&p->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+typedef struct {
+    uint64_t received;
+    uint64_t bytes;
+    int check;
+} consumer_t;
+
+// the capture task loop, checks each line and that a producer's lines arrive in order
+static void* consumer_task(void* arg)
+{
+    consumer_t* c = arg;
+    uint32_t next[MAX_PRODUCERS] = { 0 };
+    int all_done = 0;
+    while(!all_done) {
+        all_done = 1;
+        for(int i = 0; i < s_producer_num; i++) {
+            producer_t* p = &s_producers[i];
+            int done = __atomic_load_n(&p->done, __ATOMIC_ACQUIRE);
+            uint32_t len;
+            char* msg;
+            while((msg = rb_log_stage_peek(&p->stage, &len)) != NULL) {
+                if(c->check) {
+                    unsigned seq = 0, heap = 0;
+                    int id = -1, n = 0;
+                    CHECK(sscanf(msg, "I (%*u) core%d: seq %u heap %u %n", &id, &seq, &heap, &n) == 3);
+                    CHECK(id == p->id && (p->retry ? seq == next[i] : seq >= next[i]) && heap == seq * 2654435761u);
+                    CHECK(len == strlen(msg) && len - n == seq % 40);
+                    next[i] = seq + 1;
+                }
+                c->received++;
+                c->bytes += len;
+                rb_log_stage_pop(&p->stage);
+            }
+            all_done &= done && p->stage.head == p->stage.tail;
+        }
+    }
+    return NULL;
+}
+
+// returns producer seconds, received + dropped must cover every message
+static double run_capture(int producers, uint32_t count, uint32_t size, int retry, int check, uint64_t* drop)
+{
+    consumer_t c = { 0, 0, check };
+    pthread_t tp[MAX_PRODUCERS], tc;
+    s_producer_num = producers;
+    for(int i = 0; i < producers; i++) {
+        producer_t* p = &s_producers[i];
+        p->buff = malloc(size);
+        rb_log_stage_init(&p->stage, p->buff, size);
+        p->id = i;
+        p->retry = retry;
+        p->count = count;
+        p->done = 0;
+    }
+    double t = now_s();
+    pthread_create(&tc, NULL, consumer_task, &c);
+    for(int i = 0; i < producers; i++) {
+        pthread_create(&tp[i], NULL, producer_task, &s_producers[i]);
+    }
+    for(int i = 0; i < producers; i++) {
+        pthread_join(tp[i], NULL);
+    }
+    t = now_s() - t;
+    pthread_join(tc, NULL);
+    *drop = 0;
+    for(int i = 0; i < producers; i++) {
+        *drop += s_producers[i].stage.drop;
+        free(s_producers[i].buff);
+    }
+    // a retried message is counted in drop each time it did not fit
+    CHECK(retry ? c.received == (uint64_t)producers * count : c.received + *drop == (uint64_t)producers * count);
+    return t;
+}
+
+static void test_producers(void)
+{
+    printf("producers against one drain task, small buffers\n");
+    for(int producers = 1; producers <= MAX_PRODUCERS; producers *= 2) {
+        uint64_t drop;
+        run_capture(producers, 100000, 4096, 0, 1, &drop);
+        printf("  %d producers, 4 KB buffers: %llu of %u dropped\n", producers, (unsigned long long)drop, producers * 100000);
+        run_capture(producers, 100000, 4096, 1, 1, &drop);
+    }
+}
+
+// the direct path: measure, format, lock the shared ring, copy, one lock for every message
+typedef struct {
+    pthread_mutex_t lock;
+    uint8_t* buff;
+    uint32_t size, head, tail;
+    uint64_t drop;
+} locked_ring_t;
+
+static locked_ring_t s_ring;
+
+// -1 when the ring is full
+static int direct_printf(const char* fmt, ...)
+{
+    char cache[256];
+    va_list args;
+    va_start(args, fmt);
+    int size = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    va_start(args, fmt);
+    size = vsprintf(cache, fmt, args);
+    va_end(args);
+    pthread_mutex_lock(&s_ring.lock);
+    if(s_ring.size - (s_ring.head - s_ring.tail) < (uint32_t)size + 1) {
+        s_ring.drop++;
+        size = -1;
+    } else {
+        for(int i = 0; i <= size; i++) {
+            s_ring.buff[(s_ring.head + i) & (s_ring.size - 1)] = cache[i];
+        }
+        s_ring.head += size + 1;
+    }
+    pthread_mutex_unlock(&s_ring.lock);
+    return size;
+}
+
+static void* direct_producer(void* arg)
+{
+    producer_t* p = arg;
+    for(uint32_t seq = 0; seq < p->count; seq++) {
+        while(direct_printf("I (%u) core%d: seq %u heap %u %.*s", seq, p->id, seq, seq * 2654435761u, (int)(seq % 40),
+            "0123456789abcdefghijklmnopqrstuvwxyzABCDEF") < 0) {
+            nanosleep(&(struct timespec){ 0, 20000 }, NULL);
+        }
+    }
+    __atomic_store_n(&p->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void* direct_consumer(void* arg)
+{
+    while(1) {
+        int done = 1;
+        for(int i = 0; i < s_producer_num; i++) {
+            done &= __atomic_load_n(&s_producers[i].done, __ATOMIC_ACQUIRE);
+        }
+        pthread_mutex_lock(&s_ring.lock);
+        s_ring.tail = s_ring.head;
+        pthread_mutex_unlock(&s_ring.lock);
+        if(done) {
+            return NULL;
+        }
+    }
+}
+
+static double run_direct(int producers, uint32_t count, uint32_t size, uint64_t* drop)
+{
+    pthread_t tp[MAX_PRODUCERS], tc;
+    pthread_mutex_init(&s_ring.lock, NULL);
+    s_ring.buff = malloc(size);
+    s_ring.size = size;
+    s_ring.head = s_ring.tail = 0;
+    s_ring.drop = 0;
+    s_producer_num = producers;
+    for(int i = 0; i < producers; i++) {
+        s_producers[i].id = i;
+        s_producers[i].count = count;
+        s_producers[i].done = 0;
+    }
+    double t = now_s();
+    pthread_create(&tc, NULL, direct_consumer, NULL);
+    for(int i = 0; i < producers; i++) {
+        pthread_create(&tp[i], NULL, direct_producer, &s_producers[i]);
+    }
+    for(int i = 0; i < producers; i++) {
+        pthread_join(tp[i], NULL);
+    }
+    t = now_s() - t;
+    pthread_join(tc, NULL);
+    free(s_ring.buff);
+    pthread_mutex_destroy(&s_ring.lock);
+    *drop = s_ring.drop;
+    return t;
+}
+
+static void bench(void)
+{
+    enum { COUNT = 1000000, SIZE = 64 * 1024 };
+    for(int producers = 1; producers <= MAX_PRODUCERS; producers *= 2) {
+        uint64_t cdrop, ddrop;
+        double c = run_capture(producers, COUNT, SIZE, 1, 0, &cdrop);
+        double d = run_direct(producers, COUNT, SIZE, &ddrop);
+        printf("bench %d producers: staged %.2f M lines/s (%.1f full retries per 100), locked ring %.2f M lines/s (%.1f)\n",
+            producers, producers * (COUNT / 1e6) / c, 100.0 * cdrop / producers / COUNT,
+            producers * (COUNT / 1e6) / d, 100.0 * ddrop / producers / COUNT);
+    }
+}
+
+int main(void)
+{
+    test_single();
+    test_producers();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -2,6 +2,8 @@
 #define __RB_LOG_H__
 
 #include "stdio.h"
+#include "stddef.h"
+#include "stdint.h"
 
 // log debug enable
 #define RB_LOG_DEBUG_ENABLE  0
@@ -11,6 +13,30 @@
 #define RB_LOG_BUFF_PSRAM    1
 // log buffer size
 #define RB_LOG_BUFF_SIZE     (500 * 1024)
+// log buffer max message length, longer message is only output to uart
+#define RB_LOG_BUFF_MSG_MAX  (4 * 1024)
+// log capture with per-core staging buffer, format once, output to uart and buffer by rb_log task
+#define RB_LOG_CAPTURE_ENABLE    0
+// log capture staging buffer size per core, power of 2
+#define RB_LOG_CAPTURE_SIZE      (16 * 1024)
+// log capture max message length, longer message is truncated
+#define RB_LOG_CAPTURE_LINE_MAX  512
+// log deferred format, buffer keeps format pointer and raw arguments, format when drained
+#define RB_LOG_DEFER_ENABLE      0
+// log deferred format also output to uart, formatted in caller context, costs the format time deferring saves
+#define RB_LOG_DEFER_UART        0
+// log export format table size, formats exported once per stream, power of 2
+#define RB_LOG_EXPORT_TABLE_SIZE 256
+
+typedef struct {
+    char*  msg; // message in the ring buffer, '\0' terminated
+    size_t len; // message length without '\0'
+} rb_log_msg_t;
+
+// log export stream state, formats already exported, see rb_log/tools/rb_log_decode
+typedef struct {
+    uint32_t fmt_id[RB_LOG_EXPORT_TABLE_SIZE];
+} rb_log_export_t;
 
 #if __cplusplus
 extern "C" {
@@ -21,6 +47,12 @@ int rb_log_get_free_size(void);
 int rb_log_get_msg_num(void);
 char* rb_log_get_msg(void);
 int rb_log_free_msg(char* msg);
+int rb_log_acquire_batch(rb_log_msg_t* msgs, int max_num);
+int rb_log_release_batch(rb_log_msg_t* msgs, int num);
+int rb_log_get_drop_num(void);
+char* rb_log_msg_text(rb_log_msg_t* msg, char* buff, size_t size, size_t* len);
+void rb_log_export_begin(rb_log_export_t* exp);
+int rb_log_msg_export(rb_log_export_t* exp, rb_log_msg_t* msg, uint8_t* buff, size_t size);
 
 #if __cplusplus
 }
@@ -0,0 +1,42 @@
+#ifndef __RB_LOG_BATCH_H__
+#define __RB_LOG_BATCH_H__
+
+#include "stdint.h"
+#include "rb_log.h"
+
+// batch reader of the log byte ring buffer, no os dependency.
+// record: [uint16 len, little endian][msg]['\0'], len without '\0', written in one send.
+// a chunk is one contiguous read of the ring (xRingbufferReceiveUpTo), its whole records are handed out
+// in place. Only the record cut at the end of the storage is copied to the spill buffer and completed
+// from the next chunk. Single consumer, one chunk held at a time.
+
+// record header size
+#define RB_LOG_BATCH_HEAD           2
+// record size of a message
+#define RB_LOG_BATCH_RECORD(len)    (RB_LOG_BATCH_HEAD + (len) + 1)
+
+typedef struct {
+    uint8_t* chunk;      // bytes read from the ring, NULL when none is held
+    uint32_t chunk_len;
+    uint32_t chunk_read; // first byte not handed out
+    uint8_t* spill;      // record cut at the end of the storage
+    uint32_t spill_size;
+    uint32_t spill_len;
+    int      spill_out;  // spill record handed out and not released
+    uint32_t acquired;   // records handed out and not released
+} rb_log_batch_t;
+
+#if __cplusplus
+extern "C" {
+#endif
+
+int rb_log_batch_init(rb_log_batch_t* batch, uint8_t* spill, uint32_t spill_size);
+void rb_log_batch_head(uint8_t* rec, uint32_t len);
+void rb_log_batch_fill(rb_log_batch_t* batch, uint8_t* chunk, uint32_t len);
+int rb_log_batch_parse(rb_log_batch_t* batch, rb_log_msg_t* msgs, int max_num);
+uint8_t* rb_log_batch_release(rb_log_batch_t* batch);
+
+#if __cplusplus
+}
+#endif
+#endif // !__RB_LOG_BATCH_H__
@@ -0,0 +1,39 @@
+#ifndef __RB_LOG_DEFER_H__
+#define __RB_LOG_DEFER_H__
+
+#include "stdint.h"
+#include "stdarg.h"
+
+// deferred format log record: [0x00][format pointer][raw arguments], no os dependency.
+// format string must be static (ESP_LOGx literal in flash), string arguments are copied.
+
+// deferred record marker, text message never starts with '\0'
+#define RB_LOG_DEFER_MARKER  0x00
+
+// export stream for the host decoder rb_log/tools/rb_log_decode, little endian frames [type][u16 len][payload]:
+// 'F' format table entry, [u32 fmt id][format without '\0'], before the first record using it
+// 'D' deferred record, [u32 fmt id][args], each arg [tag][value]: 'i' int32, 'q' int64, 'd' double,
+//     'p' pointer as u64, 's' '\0' terminated string. '*' width and precision are 'i' before their value
+// 'T' text message
+#define RB_LOG_DEFER_FRAME_FMT      'F'
+#define RB_LOG_DEFER_FRAME_RECORD   'D'
+#define RB_LOG_DEFER_FRAME_TEXT     'T'
+#define RB_LOG_DEFER_FRAME_HEAD     3
+
+#if __cplusplus
+extern "C" {
+#endif
+
+int rb_log_defer_encode(uint8_t* buff, int len, const char* fmt, va_list args);
+int rb_log_defer_decode(const uint8_t* record, int record_len, char* buff, int len);
+
+// export frames of one message, table (table_size ids, power of 2, zeroed at start of the stream) keeps
+// the formats already exported. Returns bytes written, -1 if buff is too small or the record is invalid
+int rb_log_defer_export(uint32_t* table, int table_size, const uint8_t* record, int record_len, uint8_t* buff, int len);
+// text of an exported record payload after the fmt id, same return as snprintf, -1 if invalid
+int rb_log_defer_decode_export(const char* fmt, const uint8_t* args, int args_len, char* buff, int len);
+
+#if __cplusplus
+}
+#endif
+#endif // !__RB_LOG_DEFER_H__
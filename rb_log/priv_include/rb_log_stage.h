@@ -0,0 +1,30 @@
+#ifndef __RB_LOG_STAGE_H__
+#define __RB_LOG_STAGE_H__
+
+#include "stdint.h"
+
+// single producer single consumer log staging buffer.
+// record: [uint32 len][msg + '\0'][pad to 4 bytes], no os dependency.
+
+typedef struct {
+    uint8_t* buff;
+    uint32_t size; // power of 2
+    uint32_t head; // write position, updated by producer
+    uint32_t tail; // read position, updated by consumer
+    uint32_t drop; // dropped message number, updated by producer
+} rb_log_stage_t;
+
+#if __cplusplus
+extern "C" {
+#endif
+
+int rb_log_stage_init(rb_log_stage_t* stage, uint8_t* buff, uint32_t size);
+char* rb_log_stage_reserve(rb_log_stage_t* stage, uint32_t max_len);
+void rb_log_stage_commit(rb_log_stage_t* stage, uint32_t len);
+char* rb_log_stage_peek(rb_log_stage_t* stage, uint32_t* len);
+void rb_log_stage_pop(rb_log_stage_t* stage);
+
+#if __cplusplus
+}
+#endif
+#endif // !__RB_LOG_STAGE_H__
@@ -1,4 +1,8 @@
 #include "rb_log.h"
+#include "rb_log_stage.h"
+#include "rb_log_defer.h"
+#include "rb_log_batch.h"
+#include "string.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -6,6 +10,12 @@
 
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "esp_memory_utils.h"
+#else
+#include "soc/soc_memory_layout.h"
+#endif
 #include "driver/uart.h"
 
 // memory free
@@ -29,7 +39,23 @@ static bool s_debuge_enable = RB_LOG_DEBUG_ENABLE;
 // ring buffer write timeout
 #define RB_LOG_BUFF_WR_TIMEOUT     pdMS_TO_TICKS(50)
 
+// capture task stack size
+#define RB_LOG_CAPTURE_TASK_STACK  (4 * 1024)
+// capture task priority
+#define RB_LOG_CAPTURE_TASK_PRIO   5
+// capture task drain interval, when staging buffer is empty
+#define RB_LOG_CAPTURE_DRAIN_TIME  pdMS_TO_TICKS(10)
+
 static RingbufHandle_t s_rb_log = NULL;
+// batch reader of the byte ring buffer, records are handed out in place
+static rb_log_batch_t s_rb_log_batch;
+// messages written to the ring buffer, updated by any task
+static uint32_t s_rb_log_sent = 0;
+// messages acquired, updated by the reader
+static uint32_t s_rb_log_read = 0;
+#if RB_LOG_CAPTURE_ENABLE
+static rb_log_stage_t s_rb_log_stage[portNUM_PROCESSORS];
+#endif // RB_LOG_CAPTURE_ENABLE
 
 // static int _rb_log_prepare_buff(int size)
 // {
@@ -53,12 +79,35 @@ static RingbufHandle_t s_rb_log = NULL;
 //     return ret;
 // }
 
+// write record [len][msg]['\0'] to the ring buffer in one send, rec has RB_LOG_BATCH_HEAD bytes before the message.
+// a message longer than RB_LOG_BUFF_MSG_MAX is not buffered
+static void _rb_log_buff_send(uint8_t* rec, uint32_t len)
+{
+    uint32_t rec_len = RB_LOG_BATCH_RECORD(len);
+    if((len > RB_LOG_BUFF_MSG_MAX) || (rb_log_get_free_size() < rec_len)) {
+        return;
+    }
+    rb_log_batch_head(rec, len);
+    if(xRingbufferSend(s_rb_log, rec, rec_len, RB_LOG_BUFF_WR_TIMEOUT) == pdTRUE) {
+        __atomic_add_fetch(&s_rb_log_sent, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// release acquired records, give the chunk back to the ring buffer once all of it is handed out
+static void _rb_log_batch_release(void)
+{
+    uint8_t* done = rb_log_batch_release(&s_rb_log_batch);
+    if(done) {
+        vRingbufferReturnItem(s_rb_log, done);
+    }
+}
+
 static int _rb_log_vprintf(const char *fmt, va_list args)
 {
     int size = 0;
     int is_heap = 0;
     char* heap_cache = NULL;
-    char stack_cache[RB_LOG_CACHE_SIZE] = { 0 };
+    char stack_cache[RB_LOG_BATCH_HEAD + RB_LOG_CACHE_SIZE] = { 0 };
     int cache_size = RB_LOG_CACHE_SIZE;
     RB_LOG_ERROR_EXIT(s_rb_log == NULL, \
         "## rb log ring buffer is null!");
@@ -75,14 +124,16 @@ static int _rb_log_vprintf(const char *fmt, va_list args)
     }
     if(is_heap) {
 #if RB_LOG_BUFF_PSRAM
-        heap_cache = (char*)heap_caps_malloc(cache_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        heap_cache = (char*)heap_caps_malloc(RB_LOG_BATCH_HEAD + cache_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
 #else
-        heap_cache = (char*)malloc(cache_size);
+        heap_cache = (char*)malloc(RB_LOG_BATCH_HEAD + cache_size);
 #endif // RB_LOG_BUFF_PSRAM
         RB_LOG_ERROR_EXIT(heap_cache == NULL, \
             "## rb log heap cache malloc failed!");
     }
-    char* cache = is_heap ? heap_cache : stack_cache;
+    // record header room before the message
+    char* rec = is_heap ? heap_cache : stack_cache;
+    char* cache = rec + RB_LOG_BATCH_HEAD;
     size = vsprintf(cache, fmt, args);
 
     RB_LOG_ERROR_EXIT((size <= 0) || (size >= cache_size), \
@@ -91,11 +142,11 @@ static int _rb_log_vprintf(const char *fmt, va_list args)
     // ring buffer prepare
     // RB_LOG_ERROR_EXIT(_rb_log_prepare_buff(size) < 0,
     //     "## rb log preare buffer failed!");
-    RB_LOG_ERROR_EXIT((rb_log_get_free_size() + 8) < size, \
+    RB_LOG_ERROR_EXIT(rb_log_get_free_size() < RB_LOG_BATCH_RECORD(size), \
             "## rb log is full!");
 
     // write to ring buffer
-    xRingbufferSend(s_rb_log, cache, size + 1, RB_LOG_BUFF_WR_TIMEOUT);
+    _rb_log_buff_send((uint8_t*)rec, size);
 
     // write to uart [performance]
     // vprintf(fmt, args);
@@ -105,6 +156,106 @@ static int _rb_log_vprintf(const char *fmt, va_list args)
     return size;
 }
 
+#if RB_LOG_DEFER_ENABLE
+// keep format pointer and raw arguments, no format in caller context
+static int _rb_log_defer_vprintf(const char *fmt, va_list args)
+{
+    if(s_rb_log == NULL) {
+        return vprintf(fmt, args);
+    }
+    // only a format in flash rodata outlives the caller, a format built in ram is saved as text
+    if(!esp_ptr_in_drom(fmt)) {
+        return _rb_log_vprintf(fmt, args);
+    }
+    uint8_t rec[RB_LOG_BATCH_HEAD + RB_LOG_CACHE_SIZE];
+    uint8_t* cache = rec + RB_LOG_BATCH_HEAD;
+    int size = rb_log_defer_encode(cache, RB_LOG_CACHE_SIZE - 1, fmt, args);
+    if(size <= 0) { // unsupported format or too long, save as text
+        return _rb_log_vprintf(fmt, args);
+    }
+    cache[size] = '\0'; // record length is deferred record length, same as text message
+    _rb_log_buff_send(rec, size);
+#if RB_LOG_DEFER_UART
+    size = vprintf(fmt, args);
+#endif // RB_LOG_DEFER_UART
+    return size;
+}
+#endif // RB_LOG_DEFER_ENABLE
+
+#if RB_LOG_CAPTURE_ENABLE
+// format once into the staging buffer of current core, no malloc, no ring buffer lock
+static int _rb_log_capture_vprintf(const char *fmt, va_list args)
+{
+    int size = -1;
+    // scheduler suspended, the caller stay on this core, only one producer per staging buffer
+    vTaskSuspendAll();
+    rb_log_stage_t* stage = &s_rb_log_stage[xPortGetCoreID()];
+    char* cache = rb_log_stage_reserve(stage, RB_LOG_CAPTURE_LINE_MAX);
+    if(cache) {
+        size = vsnprintf(cache, RB_LOG_CAPTURE_LINE_MAX, fmt, args);
+        if(size >= RB_LOG_CAPTURE_LINE_MAX) {
+            size = RB_LOG_CAPTURE_LINE_MAX - 1; // truncated
+        }
+        rb_log_stage_commit(stage, (size > 0) ? size : 0);
+    }
+    xTaskResumeAll();
+    return size;
+}
+
+// output message to ring buffer and uart
+static void _rb_log_capture_output(char* msg, uint32_t len)
+{
+    uint8_t rec[RB_LOG_BATCH_HEAD + RB_LOG_CAPTURE_LINE_MAX];
+    if(len == 0) {
+        return;
+    }
+    memcpy(rec + RB_LOG_BATCH_HEAD, msg, len + 1);
+    _rb_log_buff_send(rec, len);
+    fwrite(msg, len, 1, stdout);
+}
+
+static void _rb_log_capture_task(void* arg)
+{
+    while(1) {
+        int is_idle = 1;
+        for(int i = 0; i < portNUM_PROCESSORS; i++) {
+            uint32_t len = 0;
+            char* msg = NULL;
+            while((msg = rb_log_stage_peek(&s_rb_log_stage[i], &len)) != NULL) {
+                _rb_log_capture_output(msg, len);
+                rb_log_stage_pop(&s_rb_log_stage[i]);
+                is_idle = 0;
+            }
+        }
+        if(is_idle) {
+            vTaskDelay(RB_LOG_CAPTURE_DRAIN_TIME);
+        }
+    }
+}
+
+static int _rb_log_capture_init(void)
+{
+    int ret = -1;
+    for(int i = 0; i < portNUM_PROCESSORS; i++) {
+#if RB_LOG_BUFF_PSRAM
+        uint8_t *buff_storage = (uint8_t *)heap_caps_malloc(RB_LOG_CAPTURE_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+        uint8_t *buff_storage = (uint8_t *)malloc(RB_LOG_CAPTURE_SIZE);
+#endif // RB_LOG_BUFF_PSRAM
+        if(rb_log_stage_init(&s_rb_log_stage[i], buff_storage, RB_LOG_CAPTURE_SIZE) != 0) {
+            printf("## rb log capture buffer create failed!");
+            return ret;
+        }
+    }
+    if(xTaskCreate(_rb_log_capture_task, "rb_log", RB_LOG_CAPTURE_TASK_STACK, NULL, RB_LOG_CAPTURE_TASK_PRIO, NULL) != pdPASS) {
+        printf("## rb log capture task create failed!");
+        return ret;
+    }
+    ret = 0;
+    return ret;
+}
+#endif // RB_LOG_CAPTURE_ENABLE
+
 int rb_log_init(void)
 {
     int ret = -1;
@@ -112,48 +263,71 @@ int rb_log_init(void)
 #if RB_LOG_BUFF_PSRAM
     StaticRingbuffer_t *buff_struct = (StaticRingbuffer_t *)heap_caps_malloc(sizeof(StaticRingbuffer_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     uint8_t *buff_storage = (uint8_t *)heap_caps_malloc(RB_LOG_BUFF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    s_rb_log = xRingbufferCreateStatic(RB_LOG_BUFF_SIZE, RINGBUF_TYPE_NOSPLIT, buff_storage, buff_struct);
+    s_rb_log = xRingbufferCreateStatic(RB_LOG_BUFF_SIZE, RINGBUF_TYPE_BYTEBUF, buff_storage, buff_struct);
 #else
     StaticRingbuffer_t *buff_struct = (StaticRingbuffer_t *)malloc(sizeof(StaticRingbuffer_t));
     uint8_t *buff_storage = (uint8_t *)malloc(RB_LOG_BUFF_SIZE);
-    s_rb_log = xRingbufferCreateStatic(RB_LOG_BUFF_SIZE, RINGBUF_TYPE_NOSPLIT, buff_storage, buff_struct);
+    s_rb_log = xRingbufferCreateStatic(RB_LOG_BUFF_SIZE, RINGBUF_TYPE_BYTEBUF, buff_storage, buff_struct);
 #endif // RB_LOG_BUFF_PSRAM
     if(s_rb_log == NULL) {
         printf("## rb log ring buffer create failed!");
+        RB_LOG_MEM_FREE(buff_struct);
+        RB_LOG_MEM_FREE(buff_storage);
+        return ret;
     }
+#if RB_LOG_BUFF_PSRAM
+    uint8_t *spill = (uint8_t *)heap_caps_malloc(RB_LOG_BATCH_RECORD(RB_LOG_BUFF_MSG_MAX), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    uint8_t *spill = (uint8_t *)malloc(RB_LOG_BATCH_RECORD(RB_LOG_BUFF_MSG_MAX));
+#endif // RB_LOG_BUFF_PSRAM
+    if(rb_log_batch_init(&s_rb_log_batch, spill, RB_LOG_BATCH_RECORD(RB_LOG_BUFF_MSG_MAX)) != 0) {
+        printf("## rb log batch spill buffer malloc failed!");
+        vRingbufferDelete(s_rb_log);
+        s_rb_log = NULL;
+        RB_LOG_MEM_FREE(buff_struct);
+        RB_LOG_MEM_FREE(buff_storage);
+        return ret;
+    }
+#if RB_LOG_DEFER_ENABLE
+    esp_log_set_vprintf(_rb_log_defer_vprintf);
+#elif RB_LOG_CAPTURE_ENABLE
+    if(_rb_log_capture_init() == 0) {
+        esp_log_set_vprintf(_rb_log_capture_vprintf);
+    } else {
+        esp_log_set_vprintf(_rb_log_vprintf);
+    }
+#else
     esp_log_set_vprintf(_rb_log_vprintf);
+#endif // RB_LOG_CAPTURE_ENABLE
 #endif // RB_LOG_BUFF_ENABLE
     ret = 0;
     return ret;
 }
 
+// messages written and not acquired yet, the byte ring buffer only counts bytes
 int rb_log_get_msg_num(void)
 {
-    UBaseType_t msg_num = 0;
+    int msg_num = 0;
     if(s_rb_log == NULL) {
         return msg_num;
     }
-    vRingbufferGetInfo(s_rb_log, NULL, NULL, NULL, NULL, &msg_num);
-    return msg_num;
+    msg_num = (int)(__atomic_load_n(&s_rb_log_sent, __ATOMIC_RELAXED) - s_rb_log_read);
+    return msg_num > 0 ? msg_num : 0;
 }
 
+// one message, in order with rb_log_acquire_batch, rb_log_free_msg releases it
 char* rb_log_get_msg(void)
 {
     char* msg = NULL;
 #if RB_LOG_BUFF_ENABLE
-    size_t msg_len = 0;
-    if(s_rb_log == NULL) {
-        return msg;
-    }
-    UBaseType_t msg_num = 0;
-    vRingbufferGetInfo(s_rb_log, NULL, NULL, NULL, NULL, &msg_num);
-    if(msg_num == 0) {
+    rb_log_msg_t item = { 0 };
+    if(rb_log_acquire_batch(&item, 1) != 1) {
 #if RB_LOG_DEBUG_ENABLE
         printf("## rb log message is empty!\n");
 #endif // RB_LOG_DEBUG_ENABLE
         return msg;
     }
-    msg = (char*)xRingbufferReceive(s_rb_log, &msg_len, RB_LOG_BUFF_RD_TIMEOUT);
+    msg = item.msg;
 #endif // RB_LOG_BUFF_ENABLE
     return msg;
 }
@@ -166,11 +340,112 @@ int rb_log_free_msg(char* msg)
         ret = -1;
         return ret;
     }
-    vRingbufferReturnItem(s_rb_log, (void*)msg);
+    _rb_log_batch_release();
 #endif // RB_LOG_BUFF_ENABLE
     return ret;
 }
 
+int rb_log_acquire_batch(rb_log_msg_t* msgs, int max_num)
+{
+    int num = 0;
+#if RB_LOG_BUFF_ENABLE
+    if((s_rb_log == NULL) || (msgs == NULL) || (max_num <= 0)) {
+        return num;
+    }
+    // no wait, one contiguous read of the byte ring buffer under one lock, its records are handed out
+    // in place until all of them are released. A chunk holding only the head of a record cut at the
+    // end of the storage is given back at once and the read goes on from the start
+    for(int i = 0; i < 2; i++) {
+        if(s_rb_log_batch.chunk == NULL) {
+            size_t len = 0;
+            uint8_t* data = (uint8_t*)xRingbufferReceiveUpTo(s_rb_log, &len, 0, RB_LOG_BUFF_SIZE);
+            if(data == NULL) {
+                break;
+            }
+            rb_log_batch_fill(&s_rb_log_batch, data, len);
+        }
+        num = rb_log_batch_parse(&s_rb_log_batch, msgs, max_num);
+        if(num || s_rb_log_batch.acquired) {
+            break;
+        }
+        uint8_t* done = rb_log_batch_release(&s_rb_log_batch);
+        if(done == NULL) {
+            break;
+        }
+        vRingbufferReturnItem(s_rb_log, done);
+    }
+    s_rb_log_read += num;
+#endif // RB_LOG_BUFF_ENABLE
+    return num;
+}
+
+// release all acquired messages
+int rb_log_release_batch(rb_log_msg_t* msgs, int num)
+{
+    int ret = 0;
+#if RB_LOG_BUFF_ENABLE
+    if((s_rb_log == NULL) || (msgs == NULL)) {
+        ret = -1;
+        return ret;
+    }
+    for(int i = 0; i < num; i++) {
+        msgs[i].msg = NULL;
+    }
+    _rb_log_batch_release();
+#endif // RB_LOG_BUFF_ENABLE
+    return ret;
+}
+
+int rb_log_get_drop_num(void)
+{
+    int drop_num = 0;
+#if RB_LOG_CAPTURE_ENABLE
+    for(int i = 0; i < portNUM_PROCESSORS; i++) {
+        drop_num += s_rb_log_stage[i].drop;
+    }
+#endif // RB_LOG_CAPTURE_ENABLE
+    return drop_num;
+}
+
+// message text, deferred message is formatted into buff, text message is returned directly
+char* rb_log_msg_text(rb_log_msg_t* msg, char* buff, size_t size, size_t* len)
+{
+    if((msg == NULL) || (msg->msg == NULL)) {
+        return NULL;
+    }
+    if(msg->len && (msg->msg[0] == RB_LOG_DEFER_MARKER)) {
+        int text_len = rb_log_defer_decode((uint8_t*)msg->msg, msg->len, buff, size);
+        if((buff == NULL) || (text_len < 0)) {
+            return NULL;
+        }
+        if(len) {
+            *len = (text_len < size) ? text_len : size - 1; // truncated
+        }
+        return buff;
+    }
+    if(len) {
+        *len = msg->len;
+    }
+    return msg->msg;
+}
+
+// start an export stream, formats are exported again
+void rb_log_export_begin(rb_log_export_t* exp)
+{
+    if(exp) {
+        memset(exp, 0, sizeof(rb_log_export_t));
+    }
+}
+
+// export frames of message, deferred message keeps raw arguments and is formatted by the host decoder
+int rb_log_msg_export(rb_log_export_t* exp, rb_log_msg_t* msg, uint8_t* buff, size_t size)
+{
+    if((exp == NULL) || (msg == NULL) || (msg->msg == NULL)) {
+        return -1;
+    }
+    return rb_log_defer_export(exp->fmt_id, RB_LOG_EXPORT_TABLE_SIZE, (uint8_t*)msg->msg, msg->len, buff, size);
+}
+
 //Ring buffer flags
 #define rbALLOW_SPLIT_FLAG          ( ( UBaseType_t ) 1 )   //The ring buffer allows items to be split
 #define rbBYTE_BUFFER_FLAG          ( ( UBaseType_t ) 2 )   //The ring buffer is a byte buffer
@@ -250,7 +525,9 @@ static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
 int rb_log_get_free_size(void)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)s_rb_log;
-    configASSERT(pxRingbuffer);
+    if(pxRingbuffer == NULL) {
+        return 0;
+    }
     int free_size = prvGetFreeSize(pxRingbuffer);
     return free_size;
 }
\ No newline at end of file
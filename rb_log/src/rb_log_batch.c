@@ -0,0 +1,121 @@
+#include "rb_log_batch.h"
+#include "stddef.h"
+#include "string.h"
+
+#define RB_LOG_BATCH_LEN(rec)   ((uint32_t)(rec)[0] | ((uint32_t)(rec)[1] << 8))
+
+int rb_log_batch_init(rb_log_batch_t* batch, uint8_t* spill, uint32_t spill_size)
+{
+    int ret = -1;
+    if((batch == NULL) || (spill == NULL) || (spill_size < RB_LOG_BATCH_RECORD(0))) {
+        return ret;
+    }
+    memset(batch, 0, sizeof(rb_log_batch_t));
+    batch->spill = spill;
+    batch->spill_size = spill_size;
+    ret = 0;
+    return ret;
+}
+
+// write record header, rec[RB_LOG_BATCH_HEAD] is the message
+void rb_log_batch_head(uint8_t* rec, uint32_t len)
+{
+    rec[0] = (uint8_t)len;
+    rec[1] = (uint8_t)(len >> 8);
+}
+
+// hold a chunk read from the ring, only when none is held
+void rb_log_batch_fill(rb_log_batch_t* batch, uint8_t* chunk, uint32_t len)
+{
+    batch->chunk = chunk;
+    batch->chunk_len = len;
+    batch->chunk_read = 0;
+}
+
+// copy chunk bytes to the spill record until it has need bytes
+static int _rb_log_batch_spill(rb_log_batch_t* batch, uint32_t need)
+{
+    uint32_t n = need - batch->spill_len;
+    if(n > batch->chunk_len - batch->chunk_read) {
+        n = batch->chunk_len - batch->chunk_read;
+    }
+    memcpy(batch->spill + batch->spill_len, batch->chunk + batch->chunk_read, n);
+    batch->spill_len += n;
+    batch->chunk_read += n;
+    return batch->spill_len == need;
+}
+
+// hand out whole records of the held chunk, the spill record first, returns message number
+int rb_log_batch_parse(rb_log_batch_t* batch, rb_log_msg_t* msgs, int max_num)
+{
+    int num = 0;
+    if((batch->chunk == NULL) || (max_num <= 0)) {
+        return num;
+    }
+    // rest of the record cut at the end of the storage is at the start of this chunk
+    if(batch->spill_len && !batch->spill_out) {
+        if((batch->spill_len >= RB_LOG_BATCH_HEAD) || _rb_log_batch_spill(batch, RB_LOG_BATCH_HEAD)) {
+            uint32_t len = RB_LOG_BATCH_LEN(batch->spill);
+            if(RB_LOG_BATCH_RECORD(len) > batch->spill_size) { // writer limit broken, drop it
+                batch->spill_len = 0;
+            } else if(_rb_log_batch_spill(batch, RB_LOG_BATCH_RECORD(len))) {
+                msgs[num].msg = (char*)batch->spill + RB_LOG_BATCH_HEAD;
+                msgs[num].len = len;
+                batch->spill_out = 1;
+                num++;
+            }
+        }
+        if(batch->spill_len && !batch->spill_out) {
+            return num;
+        }
+    }
+    while(num < max_num) {
+        uint32_t avail = batch->chunk_len - batch->chunk_read;
+        uint8_t* rec = batch->chunk + batch->chunk_read;
+        if(avail < RB_LOG_BATCH_HEAD) {
+            break;
+        }
+        uint32_t len = RB_LOG_BATCH_LEN(rec);
+        if(RB_LOG_BATCH_RECORD(len) > batch->spill_size) { // writer limit broken, drop the chunk
+            batch->chunk_read = batch->chunk_len;
+            break;
+        }
+        if(RB_LOG_BATCH_RECORD(len) > avail) {
+            break;
+        }
+        msgs[num].msg = (char*)rec + RB_LOG_BATCH_HEAD;
+        msgs[num].len = len;
+        batch->chunk_read += RB_LOG_BATCH_RECORD(len);
+        num++;
+    }
+    batch->acquired += num;
+    return num;
+}
+
+// release all handed out records, returns the chunk to give back to the ring once no whole record is left
+// in it, a cut record at its end moves to the spill buffer
+uint8_t* rb_log_batch_release(rb_log_batch_t* batch)
+{
+    uint8_t* done = NULL;
+    batch->acquired = 0;
+    if(batch->spill_out) {
+        batch->spill_out = 0;
+        batch->spill_len = 0;
+    }
+    if(batch->chunk == NULL) {
+        return done;
+    }
+    uint32_t rest = batch->chunk_len - batch->chunk_read;
+    uint8_t* rec = batch->chunk + batch->chunk_read;
+    if((rest >= RB_LOG_BATCH_HEAD) && (RB_LOG_BATCH_RECORD(RB_LOG_BATCH_LEN(rec)) <= rest)) {
+        return done;
+    }
+    if((rest > batch->spill_size - batch->spill_len) || (rest && batch->spill_len)) {
+        rest = 0; // cannot be a cut record, drop it
+    }
+    memcpy(batch->spill, rec, rest);
+    batch->spill_len = rest;
+    done = batch->chunk;
+    rb_log_batch_fill(batch, NULL, 0);
+    return done;
+}
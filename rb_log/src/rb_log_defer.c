@@ -0,0 +1,508 @@
+#include "rb_log_defer.h"
+#include "stdio.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+
+// conversion spec max length, "%-+ #0*.*lld"
+#define RB_LOG_DEFER_SPEC_SIZE  48
+
+typedef enum {
+    RB_LOG_DEFER_ARG_NONE = 0,  // %%
+    RB_LOG_DEFER_ARG_INT,       // int, long, size_t...
+    RB_LOG_DEFER_ARG_LLONG,     // long long, intmax_t
+    RB_LOG_DEFER_ARG_DOUBLE,    // double
+    RB_LOG_DEFER_ARG_STRING,    // char*
+    RB_LOG_DEFER_ARG_POINTER,   // void*
+    RB_LOG_DEFER_ARG_UNSUPPORT, // %n, %Lf...
+} rb_log_defer_arg_t;
+
+typedef struct {
+    const char* start;      // '%'
+    int         spec_len;   // length of conversion spec
+    int         width_arg;  // width is '*'
+    int         prec_arg;   // precision is '*'
+    int         has_prec;   // precision is set
+    int         length;     // 'h', 'l', 'L', 'z', 'j', 't', 'H'(hh), 'q'(ll)
+    rb_log_defer_arg_t type;
+} rb_log_defer_spec_t;
+
+// parse conversion spec at fmt[0] == '%'
+static int _rb_log_defer_parse(const char* fmt, rb_log_defer_spec_t* spec)
+{
+    const char* p = fmt + 1;
+    memset(spec, 0, sizeof(rb_log_defer_spec_t));
+    spec->start = fmt;
+    while(*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    if(*p == '*') {
+        spec->width_arg = 1;
+        p++;
+    } else {
+        while(*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if(*p == '.') {
+        spec->has_prec = 1;
+        p++;
+        if(*p == '*') {
+            spec->prec_arg = 1;
+            p++;
+        } else {
+            while(*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+    }
+    if(*p == 'h' || *p == 'l') {
+        spec->length = *p++;
+        if(*p == spec->length) {
+            spec->length = (spec->length == 'h') ? 'H' : 'q';
+            p++;
+        }
+    } else if(*p && strchr("Lzjt", *p)) {
+        spec->length = *p++;
+    }
+    switch(*p) {
+        case '%':
+            spec->type = RB_LOG_DEFER_ARG_NONE;
+            break;
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            spec->type = (spec->length == 'q' || spec->length == 'j') ? RB_LOG_DEFER_ARG_LLONG : RB_LOG_DEFER_ARG_INT;
+            if((spec->length == 'l' && sizeof(long) > sizeof(int)) || \
+               (spec->length == 'z' && sizeof(size_t) > sizeof(int)) || \
+               (spec->length == 't' && sizeof(ptrdiff_t) > sizeof(int))) {
+                spec->type = RB_LOG_DEFER_ARG_LLONG;
+            }
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec->type = (spec->length == 'L') ? RB_LOG_DEFER_ARG_UNSUPPORT : RB_LOG_DEFER_ARG_DOUBLE;
+            break;
+        case 's':
+            spec->type = (spec->length == 'l') ? RB_LOG_DEFER_ARG_UNSUPPORT : RB_LOG_DEFER_ARG_STRING;
+            break;
+        case 'p':
+            spec->type = RB_LOG_DEFER_ARG_POINTER;
+            break;
+        default:
+            spec->type = RB_LOG_DEFER_ARG_UNSUPPORT;
+            return -1;
+    }
+    spec->spec_len = p - fmt + 1;
+    return (spec->spec_len + 24 < RB_LOG_DEFER_SPEC_SIZE) ? 0 : -1; // room for '*' values
+}
+
+// spec string of printf, '*' replaced with the recorded values. tail replaces the length modifier and
+// conversion when set, prefix goes before '%'
+static void _rb_log_defer_spec_str(const rb_log_defer_spec_t* spec, int width, int prec, const char* prefix, const char* tail, char* out)
+{
+    int pos = 0, end = spec->spec_len;
+    if(tail) {
+        end -= 1 + ((spec->length == 'H' || spec->length == 'q') ? 2 : (spec->length ? 1 : 0));
+    }
+    if(prefix) {
+        pos += snprintf(out, RB_LOG_DEFER_SPEC_SIZE, "%s", prefix);
+    }
+    for(int i = 0; i < end; i++) {
+        if(spec->start[i] == '*') {
+            int star = (i && spec->start[i - 1] == '.') ? prec : width;
+            pos += snprintf(out + pos, RB_LOG_DEFER_SPEC_SIZE - pos, "%d", star);
+        } else {
+            out[pos++] = spec->start[i];
+        }
+    }
+    out[pos] = '\0';
+    if(tail) {
+        snprintf(out + pos, RB_LOG_DEFER_SPEC_SIZE - pos, "%s", tail);
+    }
+}
+
+// read integer argument with the length modifier
+static long long _rb_log_defer_va_int(rb_log_defer_spec_t* spec, va_list* args)
+{
+    switch(spec->length) {
+        case 'l': return va_arg(*args, long);
+        case 'q': return va_arg(*args, long long);
+        case 'z': return va_arg(*args, size_t);
+        case 'j': return va_arg(*args, long long);
+        case 't': return va_arg(*args, ptrdiff_t);
+        default:  return va_arg(*args, int);
+    }
+}
+
+#define RB_LOG_DEFER_PUT(val)   if(pos + (int)sizeof(val) > len) { \
+                                    return -1; \
+                                } \
+                                memcpy(buff + pos, &(val), sizeof(val)); \
+                                pos += sizeof(val);
+
+int rb_log_defer_encode(uint8_t* buff, int len, const char* fmt, va_list args)
+{
+    int pos = 0;
+    va_list ap;
+    rb_log_defer_spec_t spec;
+    if((buff == NULL) || (fmt == NULL) || (len < 1 + (int)sizeof(fmt))) {
+        return -1;
+    }
+    buff[pos++] = RB_LOG_DEFER_MARKER;
+    memcpy(buff + pos, &fmt, sizeof(fmt));
+    pos += sizeof(fmt);
+
+    va_copy(ap, args);
+    for(const char* p = fmt; *p; p++) {
+        if(*p != '%') {
+            continue;
+        }
+        if(_rb_log_defer_parse(p, &spec) != 0) {
+            va_end(ap);
+            return -1;
+        }
+        p += spec.spec_len - 1;
+        if(spec.width_arg) {
+            int width = va_arg(ap, int);
+            RB_LOG_DEFER_PUT(width);
+        }
+        if(spec.prec_arg) {
+            int prec = va_arg(ap, int);
+            RB_LOG_DEFER_PUT(prec);
+        }
+        if(spec.type == RB_LOG_DEFER_ARG_INT) {
+            int value = (int)_rb_log_defer_va_int(&spec, &ap);
+            RB_LOG_DEFER_PUT(value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_LLONG) {
+            long long value = _rb_log_defer_va_int(&spec, &ap);
+            RB_LOG_DEFER_PUT(value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_DOUBLE) {
+            double value = va_arg(ap, double);
+            RB_LOG_DEFER_PUT(value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_POINTER) {
+            void* value = va_arg(ap, void*);
+            RB_LOG_DEFER_PUT(value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_STRING) {
+            const char* str = va_arg(ap, const char*);
+            str = str ? str : "(null)";
+            int str_len = strlen(str); // precision is applied when decode
+            if(pos + str_len + 1 > len) {
+                va_end(ap);
+                return -1;
+            }
+            memcpy(buff + pos, str, str_len + 1);
+            pos += str_len + 1;
+        } else if(spec.type == RB_LOG_DEFER_ARG_UNSUPPORT) {
+            va_end(ap);
+            return -1;
+        }
+    }
+    va_end(ap);
+    return pos;
+}
+
+#define RB_LOG_DEFER_GET(val)   if(pos + (int)sizeof(val) > record_len) { \
+                                    return -1; \
+                                } \
+                                memcpy(&(val), record + pos, sizeof(val)); \
+                                pos += sizeof(val);
+
+int rb_log_defer_decode(const uint8_t* record, int record_len, char* buff, int len)
+{
+    int pos = 0, out = 0;
+    const char* fmt = NULL;
+    char spec_str[RB_LOG_DEFER_SPEC_SIZE];
+    rb_log_defer_spec_t spec;
+    if((record == NULL) || (buff == NULL) || (len <= 0) || (record_len < 1 + (int)sizeof(fmt))) {
+        return -1;
+    }
+    if(record[pos++] != RB_LOG_DEFER_MARKER) {
+        return -1;
+    }
+    memcpy(&fmt, record + pos, sizeof(fmt));
+    pos += sizeof(fmt);
+
+    buff[0] = '\0';
+    for(const char* p = fmt; *p; p++) {
+        int room = (out < len) ? len - out : 0;
+        char* dst = buff + ((out < len) ? out : len - 1);
+        if(*p != '%') {
+            if(room > 1) {
+                dst[0] = *p;
+                dst[1] = '\0';
+            }
+            out++;
+            continue;
+        }
+        if(_rb_log_defer_parse(p, &spec) != 0) {
+            return -1;
+        }
+        p += spec.spec_len - 1;
+        // rebuild spec, replace '*' with the recorded value
+        int width = 0, prec = 0;
+        if(spec.width_arg) {
+            RB_LOG_DEFER_GET(width);
+        }
+        if(spec.prec_arg) {
+            RB_LOG_DEFER_GET(prec);
+        }
+        _rb_log_defer_spec_str(&spec, width, prec, NULL, NULL, spec_str);
+
+        int n = 0;
+        if(spec.type == RB_LOG_DEFER_ARG_NONE) {
+            n = snprintf(dst, room, "%%");
+        } else if(spec.type == RB_LOG_DEFER_ARG_INT) {
+            int value = 0;
+            RB_LOG_DEFER_GET(value);
+            n = snprintf(dst, room, spec_str, value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_LLONG) {
+            long long value = 0;
+            RB_LOG_DEFER_GET(value);
+            n = snprintf(dst, room, spec_str, value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_DOUBLE) {
+            double value = 0;
+            RB_LOG_DEFER_GET(value);
+            n = snprintf(dst, room, spec_str, value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_POINTER) {
+            void* value = NULL;
+            RB_LOG_DEFER_GET(value);
+            n = snprintf(dst, room, spec_str, value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_STRING) {
+            const char* str = (const char*)record + pos;
+            int str_len = strnlen(str, record_len - pos);
+            if(pos + str_len + 1 > record_len) {
+                return -1;
+            }
+            pos += str_len + 1;
+            n = snprintf(dst, room, spec_str, str);
+        } else {
+            return -1;
+        }
+        out += (n > 0) ? n : 0;
+    }
+    return out;
+}
+
+// export record arg, tag and value
+#define RB_LOG_DEFER_EXPORT(tag, val)   if(out + 1 + (int)sizeof(val) > len) { \
+                                            return -1; \
+                                        } \
+                                        buff[out++] = (tag); \
+                                        memcpy(buff + out, &(val), sizeof(val)); \
+                                        out += sizeof(val);
+
+static void _rb_log_defer_frame_head(uint8_t* buff, uint8_t type, int len)
+{
+    buff[0] = type;
+    buff[1] = (uint8_t)len;
+    buff[2] = (uint8_t)(len >> 8);
+}
+
+// slot of id in table, or the empty slot to add it, -1 when full
+static int _rb_log_defer_table_slot(const uint32_t* table, int table_size, uint32_t id)
+{
+    uint32_t hash = (id >> 2) * 2654435761u;
+    for(int i = 0; i < table_size; i++) {
+        int slot = (hash + i) & (table_size - 1);
+        if(table[slot] == id || table[slot] == 0) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+int rb_log_defer_export(uint32_t* table, int table_size, const uint8_t* record, int record_len, uint8_t* buff, int len)
+{
+    int pos = 0, out = 0;
+    const char* fmt = NULL;
+    rb_log_defer_spec_t spec;
+    if((table == NULL) || (table_size <= 0) || (record == NULL) || (record_len < 0) || (buff == NULL)) {
+        return -1;
+    }
+    if((record_len == 0) || (record[0] != RB_LOG_DEFER_MARKER)) {
+        if((RB_LOG_DEFER_FRAME_HEAD + record_len > len) || (record_len > 0xFFFF)) {
+            return -1;
+        }
+        _rb_log_defer_frame_head(buff, RB_LOG_DEFER_FRAME_TEXT, record_len);
+        memcpy(buff + RB_LOG_DEFER_FRAME_HEAD, record, record_len);
+        return RB_LOG_DEFER_FRAME_HEAD + record_len;
+    }
+    if(record_len < 1 + (int)sizeof(fmt)) {
+        return -1;
+    }
+    pos++;
+    memcpy(&fmt, record + pos, sizeof(fmt));
+    pos += sizeof(fmt);
+
+    // format table entry, the first time the format is exported
+    uint32_t id = (uint32_t)(uintptr_t)fmt;
+    int slot = _rb_log_defer_table_slot(table, table_size, id);
+    if((slot < 0) || (table[slot] == 0)) {
+        int fmt_len = strlen(fmt);
+        if((RB_LOG_DEFER_FRAME_HEAD + sizeof(id) + fmt_len > (size_t)len) || (sizeof(id) + fmt_len > 0xFFFF)) {
+            return -1;
+        }
+        _rb_log_defer_frame_head(buff, RB_LOG_DEFER_FRAME_FMT, sizeof(id) + fmt_len);
+        memcpy(buff + RB_LOG_DEFER_FRAME_HEAD, &id, sizeof(id));
+        memcpy(buff + RB_LOG_DEFER_FRAME_HEAD + sizeof(id), fmt, fmt_len);
+        out = RB_LOG_DEFER_FRAME_HEAD + sizeof(id) + fmt_len;
+    }
+
+    int head = out;
+    out += RB_LOG_DEFER_FRAME_HEAD;
+    if(out + (int)sizeof(id) > len) {
+        return -1;
+    }
+    memcpy(buff + out, &id, sizeof(id));
+    out += sizeof(id);
+    for(const char* p = fmt; *p; p++) {
+        if(*p != '%') {
+            continue;
+        }
+        if(_rb_log_defer_parse(p, &spec) != 0) {
+            return -1;
+        }
+        p += spec.spec_len - 1;
+        if(spec.width_arg) {
+            int32_t width = 0;
+            RB_LOG_DEFER_GET(width);
+            RB_LOG_DEFER_EXPORT('i', width);
+        }
+        if(spec.prec_arg) {
+            int32_t prec = 0;
+            RB_LOG_DEFER_GET(prec);
+            RB_LOG_DEFER_EXPORT('i', prec);
+        }
+        if(spec.type == RB_LOG_DEFER_ARG_INT) {
+            int32_t value = 0;
+            RB_LOG_DEFER_GET(value);
+            RB_LOG_DEFER_EXPORT('i', value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_LLONG) {
+            int64_t value = 0;
+            RB_LOG_DEFER_GET(value);
+            RB_LOG_DEFER_EXPORT('q', value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_DOUBLE) {
+            double value = 0;
+            RB_LOG_DEFER_GET(value);
+            RB_LOG_DEFER_EXPORT('d', value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_POINTER) {
+            void* ptr = NULL;
+            RB_LOG_DEFER_GET(ptr);
+            uint64_t value = (uintptr_t)ptr;
+            RB_LOG_DEFER_EXPORT('p', value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_STRING) {
+            const char* str = (const char*)record + pos;
+            int str_len = strnlen(str, record_len - pos);
+            if((pos + str_len + 1 > record_len) || (out + 1 + str_len + 1 > len)) {
+                return -1;
+            }
+            buff[out++] = 's';
+            memcpy(buff + out, str, str_len + 1);
+            out += str_len + 1;
+            pos += str_len + 1;
+        }
+    }
+    if(out - head - RB_LOG_DEFER_FRAME_HEAD > 0xFFFF) {
+        return -1;
+    }
+    _rb_log_defer_frame_head(buff + head, RB_LOG_DEFER_FRAME_RECORD, out - head - RB_LOG_DEFER_FRAME_HEAD);
+    if(slot >= 0) {
+        table[slot] = id; // only once the format entry is part of a complete export
+    }
+    return out;
+}
+
+// exported arg with the expected tag
+#define RB_LOG_DEFER_GET_TAG(tag, val)  if((pos + 1 + (int)sizeof(val) > args_len) || (args[pos] != (tag))) { \
+                                            return -1; \
+                                        } \
+                                        memcpy(&(val), args + pos + 1, sizeof(val)); \
+                                        pos += 1 + sizeof(val);
+
+int rb_log_defer_decode_export(const char* fmt, const uint8_t* args, int args_len, char* buff, int len)
+{
+    int pos = 0, out = 0;
+    char spec_str[RB_LOG_DEFER_SPEC_SIZE];
+    rb_log_defer_spec_t spec;
+    if((fmt == NULL) || (args == NULL && args_len) || (buff == NULL) || (len <= 0)) {
+        return -1;
+    }
+
+    buff[0] = '\0';
+    for(const char* p = fmt; *p; p++) {
+        int room = (out < len) ? len - out : 0;
+        char* dst = buff + ((out < len) ? out : len - 1);
+        if(*p != '%') {
+            if(room > 1) {
+                dst[0] = *p;
+                dst[1] = '\0';
+            }
+            out++;
+            continue;
+        }
+        if(_rb_log_defer_parse(p, &spec) != 0) {
+            return -1;
+        }
+        p += spec.spec_len - 1;
+        int32_t width = 0, prec = 0;
+        if(spec.width_arg) {
+            RB_LOG_DEFER_GET_TAG('i', width);
+        }
+        if(spec.prec_arg) {
+            RB_LOG_DEFER_GET_TAG('i', prec);
+        }
+
+        // the exporting target decided the argument sizes, the tag tells them
+        char conv = spec.start[spec.spec_len - 1];
+        int n = 0;
+        if(spec.type == RB_LOG_DEFER_ARG_NONE) {
+            n = snprintf(dst, room, "%%");
+        } else if((spec.type == RB_LOG_DEFER_ARG_INT) || (spec.type == RB_LOG_DEFER_ARG_LLONG)) {
+            long long value = 0;
+            if((pos < args_len) && (args[pos] == 'i')) {
+                int32_t v32 = 0;
+                RB_LOG_DEFER_GET_TAG('i', v32);
+                value = (strchr("uxXo", conv) != NULL) ? (long long)(uint32_t)v32 : v32;
+            } else {
+                int64_t v64 = 0;
+                RB_LOG_DEFER_GET_TAG('q', v64);
+                value = v64;
+            }
+            if(conv == 'c') {
+                _rb_log_defer_spec_str(&spec, width, prec, NULL, "c", spec_str);
+                n = snprintf(dst, room, spec_str, (int)value);
+            } else {
+                char tail[4] = { 'l', 'l', conv, '\0' };
+                if(strchr("uxXo", conv)) {
+                    value = (spec.length == 'H') ? (uint8_t)value : (spec.length == 'h') ? (uint16_t)value : value;
+                } else {
+                    value = (spec.length == 'H') ? (int8_t)value : (spec.length == 'h') ? (int16_t)value : value;
+                }
+                _rb_log_defer_spec_str(&spec, width, prec, NULL, tail, spec_str);
+                n = snprintf(dst, room, spec_str, value);
+            }
+        } else if(spec.type == RB_LOG_DEFER_ARG_DOUBLE) {
+            double value = 0;
+            char tail[2] = { conv, '\0' };
+            RB_LOG_DEFER_GET_TAG('d', value);
+            _rb_log_defer_spec_str(&spec, width, prec, NULL, tail, spec_str);
+            n = snprintf(dst, room, spec_str, value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_POINTER) {
+            uint64_t value = 0;
+            RB_LOG_DEFER_GET_TAG('p', value);
+            _rb_log_defer_spec_str(&spec, width, prec, "0x", "llx", spec_str);
+            n = snprintf(dst, room, spec_str, (unsigned long long)value);
+        } else if(spec.type == RB_LOG_DEFER_ARG_STRING) {
+            const char* str = (const char*)args + pos + 1;
+            int str_len = (pos < args_len) ? strnlen(str, args_len - pos - 1) : 0;
+            if((pos + 1 + str_len + 1 > args_len) || (args[pos] != 's')) {
+                return -1;
+            }
+            pos += 1 + str_len + 1;
+            _rb_log_defer_spec_str(&spec, width, prec, NULL, "s", spec_str);
+            n = snprintf(dst, room, spec_str, str);
+        } else {
+            return -1;
+        }
+        out += (n > 0) ? n : 0;
+    }
+    return out;
+}
@@ -0,0 +1,90 @@
+#include "rb_log_stage.h"
+#include "stddef.h"
+
+// record header size
+#define RB_LOG_STAGE_HDR_SIZE       sizeof(uint32_t)
+// padding record, skip to the buffer start
+#define RB_LOG_STAGE_PAD            0xFFFFFFFF
+// record size, aligned to 4 bytes
+#define RB_LOG_STAGE_RECORD(len)    ((RB_LOG_STAGE_HDR_SIZE + (len) + 3) & ~3)
+
+#define RB_LOG_STAGE_LOAD(pos)      __atomic_load_n(&(pos), __ATOMIC_ACQUIRE)
+#define RB_LOG_STAGE_STORE(pos, v)  __atomic_store_n(&(pos), (v), __ATOMIC_RELEASE)
+
+int rb_log_stage_init(rb_log_stage_t* stage, uint8_t* buff, uint32_t size)
+{
+    int ret = -1;
+    if((stage == NULL) || (buff == NULL) || (size < 64) || (size & (size - 1))) {
+        return ret;
+    }
+    stage->buff = buff;
+    stage->size = size;
+    stage->head = 0;
+    stage->tail = 0;
+    stage->drop = 0;
+    ret = 0;
+    return ret;
+}
+
+// reserve contiguous space for max_len bytes (with '\0'), producer only
+char* rb_log_stage_reserve(rb_log_stage_t* stage, uint32_t max_len)
+{
+    uint32_t need = RB_LOG_STAGE_RECORD(max_len);
+    uint32_t head = stage->head;
+    uint32_t used = head - RB_LOG_STAGE_LOAD(stage->tail);
+    uint32_t offset = head & (stage->size - 1);
+    uint32_t contig = stage->size - offset;
+    if(contig < need) { // not enough space at the end, pad and wrap
+        if(stage->size - used < contig + need) {
+            stage->drop++;
+            return NULL;
+        }
+        *(uint32_t*)(stage->buff + offset) = RB_LOG_STAGE_PAD;
+        head += contig;
+        RB_LOG_STAGE_STORE(stage->head, head);
+        offset = 0;
+    } else if(stage->size - used < need) {
+        stage->drop++;
+        return NULL;
+    }
+    return (char*)(stage->buff + offset + RB_LOG_STAGE_HDR_SIZE);
+}
+
+// commit reserved space, len without '\0', producer only
+void rb_log_stage_commit(rb_log_stage_t* stage, uint32_t len)
+{
+    uint32_t head = stage->head;
+    uint32_t offset = head & (stage->size - 1);
+    *(uint32_t*)(stage->buff + offset) = len;
+    RB_LOG_STAGE_STORE(stage->head, head + RB_LOG_STAGE_RECORD(len + 1));
+}
+
+// peek oldest message, consumer only
+char* rb_log_stage_peek(rb_log_stage_t* stage, uint32_t* len)
+{
+    uint32_t tail = stage->tail;
+    while(tail != RB_LOG_STAGE_LOAD(stage->head)) {
+        uint32_t offset = tail & (stage->size - 1);
+        uint32_t hdr = *(uint32_t*)(stage->buff + offset);
+        if(hdr == RB_LOG_STAGE_PAD) {
+            tail += stage->size - offset;
+            RB_LOG_STAGE_STORE(stage->tail, tail);
+            continue;
+        }
+        if(len) {
+            *len = hdr;
+        }
+        return (char*)(stage->buff + offset + RB_LOG_STAGE_HDR_SIZE);
+    }
+    return NULL;
+}
+
+// release oldest message, consumer only
+void rb_log_stage_pop(rb_log_stage_t* stage)
+{
+    uint32_t len = 0;
+    if(rb_log_stage_peek(stage, &len) == NULL) {
+        return;
+    }
+    RB_LOG_STAGE_STORE(stage->tail, stage->tail + RB_LOG_STAGE_RECORD(len + 1));
+}
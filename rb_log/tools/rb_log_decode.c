@@ -0,0 +1,113 @@
+// host decoder of the rb_log export stream (rb_log_msg_export), prints the log text
+// make -C rb_log/tools, ./build/rb_log_decode [stream file], reads stdin without file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rb_log_defer.h"
+
+typedef struct {
+    uint32_t id;
+    char*    fmt;
+} fmt_entry_t;
+
+static fmt_entry_t* s_fmts;
+static int s_fmt_num;
+
+static const char* fmt_find(uint32_t id)
+{
+    for(int i = s_fmt_num - 1; i >= 0; i--) {
+        if(s_fmts[i].id == id) {
+            return s_fmts[i].fmt;
+        }
+    }
+    return NULL;
+}
+
+static int fmt_add(uint32_t id, const uint8_t* fmt, int len)
+{
+    fmt_entry_t* fmts = realloc(s_fmts, (s_fmt_num + 1) * sizeof(fmt_entry_t));
+    if(fmts == NULL) {
+        return -1;
+    }
+    s_fmts = fmts;
+    s_fmts[s_fmt_num].id = id;
+    s_fmts[s_fmt_num].fmt = malloc(len + 1);
+    if(s_fmts[s_fmt_num].fmt == NULL) {
+        return -1;
+    }
+    memcpy(s_fmts[s_fmt_num].fmt, fmt, len);
+    s_fmts[s_fmt_num].fmt[len] = '\0';
+    s_fmt_num++;
+    return 0;
+}
+
+static int print_record(const uint8_t* payload, int len)
+{
+    static char text[1024];
+    uint32_t id;
+    if(len < (int)sizeof(id)) {
+        return -1;
+    }
+    memcpy(&id, payload, sizeof(id));
+    const char* fmt = fmt_find(id);
+    if(fmt == NULL) {
+        printf("<rb_log_decode: unknown format 0x%08x>\n", (unsigned)id);
+        return 0;
+    }
+    int n = rb_log_defer_decode_export(fmt, payload + sizeof(id), len - sizeof(id), text, sizeof(text));
+    if(n < 0) {
+        printf("<rb_log_decode: invalid record of \"%s\">\n", fmt);
+        return 0;
+    }
+    if(n >= (int)sizeof(text)) {
+        char* big = malloc(n + 1);
+        if(big == NULL) {
+            return -1;
+        }
+        rb_log_defer_decode_export(fmt, payload + sizeof(id), len - sizeof(id), big, n + 1);
+        fwrite(big, 1, n, stdout);
+        free(big);
+        return 0;
+    }
+    fwrite(text, 1, n, stdout);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    static uint8_t payload[0xFFFF];
+    uint8_t head[RB_LOG_DEFER_FRAME_HEAD];
+    FILE* in = stdin;
+    int ret = 0;
+    if(argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    while(fread(head, 1, sizeof(head), in) == sizeof(head)) {
+        int len = head[1] | (head[2] << 8);
+        if(fread(payload, 1, len, in) != (size_t)len) {
+            fprintf(stderr, "rb_log_decode: truncated frame\n");
+            ret = 1;
+            break;
+        }
+        if(head[0] == RB_LOG_DEFER_FRAME_TEXT) {
+            fwrite(payload, 1, len, stdout);
+        } else if(head[0] == RB_LOG_DEFER_FRAME_FMT && len >= 4) {
+            uint32_t id;
+            memcpy(&id, payload, sizeof(id));
+            ret = fmt_add(id, payload + sizeof(id), len - sizeof(id));
+        } else if(head[0] == RB_LOG_DEFER_FRAME_RECORD) {
+            ret = print_record(payload, len);
+        } else {
+            fprintf(stderr, "rb_log_decode: unknown frame '%c'\n", head[0]);
+            ret = 1;
+        }
+        if(ret) {
+            break;
+        }
+    }
+    if(in != stdin) {
+        fclose(in);
+    }
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+// host fuzz and throughput test of sys_conv, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sys_conv.h"
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// character by character references, the behaviour the kernels must keep
+static int ref_hexchar(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int ref_hex2bin(const char *src, uint32_t slen, uint8_t *dst, uint32_t dsize)
+{
+    if(slen % 2 || slen / 2 > dsize) {
+        return -1;
+    }
+    for(uint32_t i = 0; i < slen / 2; i++) {
+        int h = ref_hexchar(src[2 * i]), l = ref_hexchar(src[2 * i + 1]);
+        if(h < 0 || l < 0) {
+            return -1;
+        }
+        dst[i] = (h << 4) | l;
+    }
+    return slen / 2;
+}
+
+static int ref_str2uint(const char *src, uint32_t slen, uint32_t *dst)
+{
+    unsigned long long v = 0;
+    if(slen == 0) {
+        return -1;
+    }
+    for(uint32_t i = 0; i < slen; i++) {
+        if(src[i] < '0' || src[i] > '9') {
+            return -1;
+        }
+        v = v * 10 + (src[i] - '0');
+        if(v > UINT32_MAX) {
+            return -1;
+        }
+    }
+    *dst = (uint32_t)v;
+    return 0;
+}
+
+static void test_hexchar(void)
+{
+    printf("hexchar\n");
+    for(int c = 0; c < 256; c++) {
+        CHECK(sys_conv_hexchar2int((char)c) == ref_hexchar((char)c));
+    }
+}
+
+static void test_hex_fuzz(void)
+{
+    printf("hex fuzz\n");
+    static const char digits[] = "0123456789abcdefABCDEF";
+    char hex[80], out[80];
+    uint8_t bin[40], ref[40];
+    for(int n = 0; n < 1000000; n++) {
+        uint32_t slen = rnd() % 70;
+        for(uint32_t i = 0; i < slen; i++) {
+            hex[i] = digits[rnd() % 22];
+        }
+        if(rnd() % 4 == 0 && slen) {
+            hex[rnd() % slen] = (char)(rnd() & 0xFF); // usually not a digit
+        }
+        uint32_t dsize = rnd() % 8 ? sizeof(bin) : rnd() % 36;
+        memset(bin, 0xAA, sizeof(bin));
+        memset(ref, 0xAA, sizeof(ref));
+        int r = sys_conv_hex2bin(hex, slen, bin, dsize);
+        int e = ref_hex2bin(hex, slen, ref, dsize);
+        CHECK(r == e);
+        if(r != e) {
+            printf("  hex2bin \"%.*s\" dsize %u: %d, expect %d\n", (int)slen, hex, dsize, r, e);
+            return;
+        }
+        if(r > 0) {
+            CHECK(memcmp(bin, ref, r) == 0);
+            // round trip, short destinations fail and never write past dsize
+            uint32_t size = rnd() % 2 ? (uint32_t)(2 * r + 1) : rnd() % (2 * r + 2);
+            memset(out, 0x55, sizeof(out));
+            int w = sys_conv_bin2hex(bin, r, out, size, rnd() % 2);
+            CHECK(w == (size >= (uint32_t)(2 * r) ? 2 * r : -1));
+            CHECK(out[size] == 0x55);
+            if(w > 0) {
+                CHECK(sys_conv_hex2bin(out, w, ref, sizeof(ref)) == r && memcmp(ref, bin, r) == 0);
+                CHECK(size == (uint32_t)w || out[w] == '\0');
+            }
+        }
+    }
+    CHECK(sys_conv_bin2hex((const uint8_t *)"\x01\xAB", 2, out, sizeof(out), 0) == 4 && strcmp(out, "01AB") == 0);
+    CHECK(sys_conv_bin2hex((const uint8_t *)"\x01\xAB", 2, out, sizeof(out), 1) == 4 && strcmp(out, "01ab") == 0);
+}
+
+static void test_uint_fuzz(void)
+{
+    printf("uint fuzz\n");
+    char str[40], ref[24];
+    for(int n = 0; n < 1000000; n++) {
+        uint32_t v = rnd();
+        v = (n % 3 == 0) ? v >> (rnd() % 32) : (n % 3 == 1) ? (v << 8) ^ rnd() : v;
+        int len = snprintf(ref, sizeof(ref), "%u", v);
+        uint32_t size = rnd() % 4 ? 24 : rnd() % 12;
+        memset(str, 0x55, sizeof(str));
+        int w = sys_conv_uint2str(v, str, size);
+        CHECK(w == (size >= (uint32_t)len + 1 ? len : -1));
+        CHECK(str[size] == 0x55);
+        if(w > 0) {
+            CHECK(strcmp(str, ref) == 0);
+        }
+
+        // leading zeros, trailing garbage, overflow
+        int zeros = rnd() % 4 == 0 ? rnd() % 4 : 0;
+        memset(str, '0', zeros);
+        memcpy(str + zeros, ref, len);
+        uint32_t slen = zeros + len;
+        if(rnd() % 8 == 0) {
+            str[rnd() % slen] = (char)(rnd() & 0xFF);
+        }
+        if(rnd() % 8 == 0) {
+            str[slen++] = '0' + rnd() % 10;
+        }
+        uint32_t a = 0x12345678, b = 0x12345678;
+        int r = sys_conv_str2uint(str, slen, &a);
+        int e = ref_str2uint(str, slen, &b);
+        CHECK(r == e && a == b);
+        if(r != e || a != b) {
+            printf("  str2uint \"%.*s\": %d %u, expect %d %u\n", (int)slen, str, r, a, e, b);
+            return;
+        }
+    }
+    uint32_t v;
+    CHECK(sys_conv_str2uint("4294967295", 10, &v) == 0 && v == UINT32_MAX);
+    CHECK(sys_conv_str2uint("4294967296", 10, &v) == -1);
+    CHECK(sys_conv_str2uint("", 0, &v) == -1);
+    CHECK(sys_conv_uint2str(0, str, 2) == 1 && strcmp(str, "0") == 0);
+}
+
+static void bench(void)
+{
+    enum { LEN = 4096, ROUNDS = 20000 };
+    static uint8_t bin[LEN];
+    static char hex[2 * LEN + 1];
+    for(int i = 0; i < LEN; i++) {
+        bin[i] = rnd();
+    }
+    double t = now_s();
+    for(int i = 0; i < ROUNDS; i++) {
+        sys_conv_bin2hex(bin, LEN, hex, sizeof(hex), i & 1);
+    }
+    double enc = now_s() - t;
+    t = now_s();
+    for(int i = 0; i < ROUNDS; i++) {
+        sys_conv_hex2bin(hex, 2 * LEN, bin, LEN);
+    }
+    double dec = now_s() - t;
+    t = now_s();
+    for(int i = 0; i < ROUNDS; i++) {
+        ref_hex2bin(hex, 2 * LEN, bin, LEN);
+    }
+    double ref = now_s() - t;
+    double mb = (double)LEN * ROUNDS / 1e6;
+    printf("bench hex encode %.0f MB/s, decode %.0f MB/s, per character decode %.0f MB/s\n", mb / enc, mb / dec, mb / ref);
+
+    enum { NUM = 4000000 };
+    char str[12];
+    uint32_t sum = 0, v;
+    t = now_s();
+    for(uint32_t i = 0; i < NUM; i++) {
+        sum += sys_conv_uint2str(i * 2654435761u, str, sizeof(str));
+    }
+    double fmt = now_s() - t;
+    t = now_s();
+    for(uint32_t i = 0; i < NUM; i++) {
+        int len = snprintf(str, sizeof(str), "%u", i * 2654435761u);
+        sys_conv_str2uint(str, len, &v);
+        sum += v;
+    }
+    double parse = now_s() - t;
+    printf("bench uint2str %.1f M/s, snprintf + str2uint %.1f M/s (%u)\n", NUM / fmt / 1e6, NUM / parse / 1e6, sum & 1);
+}
+
+int main(void)
+{
+    test_hexchar();
+    test_hex_fuzz();
+    test_uint_fuzz();
+    bench();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
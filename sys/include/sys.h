@@ -4,6 +4,7 @@
 #include "stdio.h"
 #include "stdint.h"
 #include "esp_log.h"
+#include "sys_conv.h"
 
 #define SYS_LOG_TARGET      ""
 #define LOGI(format, ...)   ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, SYS_LOG_TARGET, format, ##__VA_ARGS__)
@@ -26,6 +27,7 @@ uint64_t sys_ticks_us(void);
 void sys_restart(void);
 uint32_t sys_heap_size(void);
 
+// legacy conversions without destination size, see sys_conv.h for the bounds checked versions
 int sys_str2hex(char *src, int slen, uint8_t *dst);
 int sys_hex2str(char *src, uint32_t slen, char *dst, int lowercase);
 int sys_str2uint(char *src, uint32_t slen, uint32_t *dst);
@@ -0,0 +1,33 @@
+#ifndef __SYS_CONV_H__
+#define __SYS_CONV_H__
+
+#include "stdint.h"
+
+// plain C without ESP-IDF dependencies
+
+#if __cplusplus
+extern "C" {
+#endif
+
+// value of a hex digit, -1 if c is not a hex digit
+int sys_conv_hexchar2int(char c);
+
+// hex string -> bytes, returns bytes written (slen / 2),
+// -1 if slen is odd, a character is not a hex digit or dsize < slen / 2
+int sys_conv_hex2bin(const char *src, uint32_t slen, uint8_t *dst, uint32_t dsize);
+
+// bytes -> hex string, zero terminated if dsize > slen * 2, returns characters written (slen * 2),
+// -1 if dsize < slen * 2
+int sys_conv_bin2hex(const uint8_t *src, uint32_t slen, char *dst, uint32_t dsize, int lowercase);
+
+// decimal digits -> uint32, returns 0, -1 if empty, not a digit or overflow
+int sys_conv_str2uint(const char *src, uint32_t slen, uint32_t *dst);
+
+// uint32 -> zero terminated decimal string, returns characters written,
+// -1 if dsize is too small (11 bytes is always enough)
+int sys_conv_uint2str(uint32_t src, char *dst, uint32_t dsize);
+
+#if __cplusplus
+}
+#endif
+#endif // !__SYS_CONV_H__
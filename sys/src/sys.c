@@ -1,5 +1,7 @@
 #include "sys.h"
 
+#include "string.h"
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -72,81 +74,37 @@ uint32_t sys_heap_size(void)
 }
 int sys_str2hex(char *src, int slen, uint8_t *dst)
 {
-    int idx = 0;
-
-    if (slen % 2 != 0) {
+    if (slen < 0 || sys_conv_hex2bin(src, slen, dst, slen / 2) < 0) {
         return -1;
     }
-
-    for (idx = 0; idx < slen; idx += 2) {
-        if (src[idx] >= '0' && src[idx] <= '9') {
-            dst[idx / 2] = (src[idx] - '0') << 4;
-        } else if (src[idx] >= 'A' && src[idx] <= 'F') {
-            dst[idx / 2] = (src[idx] - 'A' + 0x0A) << 4;
-        } else if (src[idx] >= 'a' && src[idx] <= 'f') {
-            dst[idx / 2] = (src[idx] - 'a' + 0x0A) << 4;
-        }
-        if (src[idx + 1] >= '0' && src[idx + 1] <= '9') {
-            dst[idx / 2] |= (src[idx + 1] - '0');
-        } else if (src[idx + 1] >= 'A' && src[idx + 1] <= 'F') {
-            dst[idx / 2] |= (src[idx + 1] - 'A' + 0x0A);
-        } else if (src[idx + 1] >= 'a' && src[idx + 1] <= 'f') {
-            dst[idx / 2] |= (src[idx + 1] - 'a' + 0x0A);
-        }
-    }
-	return 0;
+    return 0;
 }
 
 int sys_hex2str(char *src, uint32_t slen, char *dst, int lowercase)
 {
-    char *upper = "0123456789ABCDEF";
-    char *lower = "0123456789abcdef";
-    char *encode = upper;
-    int i = 0, j = 0;
-
-    if (lowercase) {
-        encode = lower;
-    }
-
-    for (i = 0; i < slen; i++) {
-        dst[j++] = encode[(src[i] >> 4) & 0xf];
-        dst[j++] = encode[(src[i]) & 0xf];
+    if (sys_conv_bin2hex((uint8_t *)src, slen, dst, slen * 2, lowercase) < 0) {
+        return -1;
     }
-
     return 0;
 }
 
 int sys_str2uint(char *src, uint32_t slen, uint32_t *dst)
 {
-    uint32_t index = 0;
-    uint32_t temp = 0;
-
-    for (index = 0; index < slen; index++) {
-        if (src[index] < '0' || src[index] > '9') {
-            return -1;
-        }
-        temp = temp * 10 + src[index] - '0';
+    if (slen == 0) {
+        *dst = 0;
+        return 0;
     }
-    *dst = temp;
-
-    return 0;
+    return sys_conv_str2uint(src, slen, dst);
 }
 
 int sys_uint2str(uint32_t src, char *dst, uint32_t *dlen)
 {
-    uint32_t i = 0, j = 0;
-    char temp[10] = {0};
-
-    do {
-        temp[i++] = src % 10 + '0';
-    } while ((src /= 10) > 0);
-
-    do {
-        dst[--i] = temp[j++];
-    } while (i > 0);
+    char temp[11];
+    int len = sys_conv_uint2str(src, temp, sizeof(temp));
 
+    memcpy(dst, temp, len); // not zero terminated
     if (dlen) {
-        *dlen = j;
+        *dlen = len;
     }
 
     return 0;
@@ -0,0 +1,217 @@
+#include "sys_conv.h"
+
+#include "string.h"
+
+// 0xFF for characters that are not hex digits
+static const uint8_t s_hex_value[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static const char s_hex_upper[513] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static const char s_hex_lower[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+// "00" "01" ... "99"
+static const char s_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+int sys_conv_hexchar2int(char c)
+{
+    uint8_t v = s_hex_value[(uint8_t)c];
+    return (v == 0xFF) ? -1 : v;
+}
+
+int sys_conv_hex2bin(const char *src, uint32_t slen, uint8_t *dst, uint32_t dsize)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t n = slen / 2, i = 0;
+    uint8_t check = 0;
+
+    if ((slen % 2) || (n > dsize) || (n && (!src || !dst))) {
+        return -1;
+    }
+
+    // 8 bytes per step, invalid digits are 0xFF and show up in the high nibble of check
+    for (; i + 8 <= n; i += 8, s += 16) {
+        uint8_t h0 = s_hex_value[s[0]],  l0 = s_hex_value[s[1]];
+        uint8_t h1 = s_hex_value[s[2]],  l1 = s_hex_value[s[3]];
+        uint8_t h2 = s_hex_value[s[4]],  l2 = s_hex_value[s[5]];
+        uint8_t h3 = s_hex_value[s[6]],  l3 = s_hex_value[s[7]];
+        uint8_t h4 = s_hex_value[s[8]],  l4 = s_hex_value[s[9]];
+        uint8_t h5 = s_hex_value[s[10]], l5 = s_hex_value[s[11]];
+        uint8_t h6 = s_hex_value[s[12]], l6 = s_hex_value[s[13]];
+        uint8_t h7 = s_hex_value[s[14]], l7 = s_hex_value[s[15]];
+        check |= h0 | l0 | h1 | l1 | h2 | l2 | h3 | l3 | h4 | l4 | h5 | l5 | h6 | l6 | h7 | l7;
+        if (check & 0xF0) {
+            return -1;
+        }
+        dst[i]     = (h0 << 4) | l0;
+        dst[i + 1] = (h1 << 4) | l1;
+        dst[i + 2] = (h2 << 4) | l2;
+        dst[i + 3] = (h3 << 4) | l3;
+        dst[i + 4] = (h4 << 4) | l4;
+        dst[i + 5] = (h5 << 4) | l5;
+        dst[i + 6] = (h6 << 4) | l6;
+        dst[i + 7] = (h7 << 4) | l7;
+    }
+    for (; i < n; i++, s += 2) {
+        uint8_t h = s_hex_value[s[0]], l = s_hex_value[s[1]];
+        check |= h | l;
+        if (check & 0xF0) {
+            return -1;
+        }
+        dst[i] = (h << 4) | l;
+    }
+
+    return n;
+}
+
+int sys_conv_bin2hex(const uint8_t *src, uint32_t slen, char *dst, uint32_t dsize, int lowercase)
+{
+    const char *pairs = lowercase ? s_hex_lower : s_hex_upper;
+    uint32_t i = 0;
+    char *p = dst;
+
+    if (!dst || (slen > UINT32_MAX / 2) || (dsize < slen * 2) || (slen && !src)) {
+        return -1;
+    }
+
+    // 8 bytes per step, two characters per table entry
+    for (; i + 8 <= slen; i += 8, p += 16) {
+        memcpy(p,      pairs + src[i] * 2,     2);
+        memcpy(p + 2,  pairs + src[i + 1] * 2, 2);
+        memcpy(p + 4,  pairs + src[i + 2] * 2, 2);
+        memcpy(p + 6,  pairs + src[i + 3] * 2, 2);
+        memcpy(p + 8,  pairs + src[i + 4] * 2, 2);
+        memcpy(p + 10, pairs + src[i + 5] * 2, 2);
+        memcpy(p + 12, pairs + src[i + 6] * 2, 2);
+        memcpy(p + 14, pairs + src[i + 7] * 2, 2);
+    }
+    for (; i < slen; i++, p += 2) {
+        memcpy(p, pairs + src[i] * 2, 2);
+    }
+    if (dsize > slen * 2) {
+        *p = '\0';
+    }
+
+    return slen * 2;
+}
+
+// 4 ascii digits (first digit in the low byte) -> value, -1 if any is not a digit
+static int _sys_conv_parse4(const uint8_t *s)
+{
+    uint32_t v = (uint32_t)s[0] | ((uint32_t)s[1] << 8) | ((uint32_t)s[2] << 16) | ((uint32_t)s[3] << 24);
+    // every byte 0x30..0x39: high nibble 3, and still 3 after adding 6
+    if (((v & 0xF0F0F0F0) | (((v + 0x06060606) & 0xF0F0F0F0) >> 4)) != 0x33333333) {
+        return -1;
+    }
+    v -= 0x30303030;
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF;  // 2 digit pairs
+    return (v * 100 + (v >> 16)) & 0xFFFF; // 4 digits
+}
+
+int sys_conv_str2uint(const char *src, uint32_t slen, uint32_t *dst)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t value = 0, i = 0;
+    uint64_t wide;
+
+    if (!src || !dst || slen == 0) {
+        return -1;
+    }
+
+    // SWAR, 4 digits per step, 8 digits can not overflow
+    for (; i + 4 <= slen && i < 8; i += 4) {
+        int v = _sys_conv_parse4(s + i);
+        if (v < 0) {
+            return -1;
+        }
+        value = value * 10000 + v;
+    }
+    for (; i < slen && i < 8; i++) {
+        uint8_t d = s[i] - '0';
+        if (d > 9) {
+            return -1;
+        }
+        value = value * 10 + d;
+    }
+
+    // leading zeros may make the string longer than 10 digits
+    for (wide = value; i < slen; i++) {
+        uint8_t d = s[i] - '0';
+        if (d > 9) {
+            return -1;
+        }
+        wide = wide * 10 + d;
+        if (wide > UINT32_MAX) {
+            return -1;
+        }
+    }
+    *dst = (uint32_t)wide;
+
+    return 0;
+}
+
+int sys_conv_uint2str(uint32_t src, char *dst, uint32_t dsize)
+{
+    char temp[10];
+    char *p = temp + sizeof(temp);
+    uint32_t len = 0;
+
+    // two digits per step from the end
+    while (src >= 100) {
+        uint32_t r = src % 100;
+        src /= 100;
+        p -= 2;
+        memcpy(p, s_digit_pairs + r * 2, 2);
+    }
+    if (src >= 10) {
+        p -= 2;
+        memcpy(p, s_digit_pairs + src * 2, 2);
+    } else {
+        *--p = '0' + src;
+    }
+
+    len = temp + sizeof(temp) - p;
+    if (!dst || dsize < len + 1) {
+        return -1;
+    }
+    memcpy(dst, p, len);
+    dst[len] = '\0';
+
+    return len;
+}
@@ -0,0 +1,25 @@
+#pragma once
+// the audio_element calls tone_bank makes, a synchronous decoder provided by the test
+#include "esp_err.h"
+
+typedef uint32_t TickType_t;
+typedef struct audio_element* audio_element_handle_t;
+typedef struct {
+    int sample_rates;
+    int channels;
+    int bits;
+} audio_element_info_t;
+typedef esp_err_t (*stream_func)(audio_element_handle_t self, char* buffer, int len, TickType_t ticks_to_wait, void* context);
+
+enum { AEL_IO_DONE = -2, AEL_IO_FAIL = -1 };
+enum { AEL_STATE_RUNNING = 3, AEL_STATE_FINISHED = 6, AEL_STATE_ERROR = 7 };
+
+void audio_element_set_read_cb(audio_element_handle_t el, stream_func fn, void* context);
+void audio_element_set_write_cb(audio_element_handle_t el, stream_func fn, void* context);
+esp_err_t audio_element_run(audio_element_handle_t el);
+esp_err_t audio_element_resume(audio_element_handle_t el, float wait_for_rb_threshold, TickType_t timeout);
+esp_err_t audio_element_wait_for_stop_ms(audio_element_handle_t el, TickType_t ticks_to_wait);
+int audio_element_get_state(audio_element_handle_t el);
+esp_err_t audio_element_getinfo(audio_element_handle_t el, audio_element_info_t* info);
+esp_err_t audio_element_terminate(audio_element_handle_t el);
+esp_err_t audio_element_deinit(audio_element_handle_t el);
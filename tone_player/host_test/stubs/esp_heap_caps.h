@@ -0,0 +1,6 @@
+#pragma once
+#include <stdlib.h>
+#define MALLOC_CAP_SPIRAM               (1 << 10)
+#define MALLOC_CAP_8BIT                 (1 << 2)
+#define heap_caps_realloc(p, size, caps) realloc(p, size)
+#define heap_caps_free(p)               free(p)
@@ -0,0 +1,16 @@
+#pragma once
+// the partition is an image in memory, provided by the test
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct {
+    uint32_t size;
+} esp_partition_t;
+typedef uint32_t spi_flash_mmap_handle_t;
+#define ESP_PARTITION_TYPE_DATA     0x01
+#define SPI_FLASH_MMAP_DATA         0
+
+const esp_partition_t* esp_partition_find_first(int type, int subtype, const char* label);
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, uint32_t offset, uint32_t size, int memory,
+    const void** out_ptr, spi_flash_mmap_handle_t* out_handle);
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
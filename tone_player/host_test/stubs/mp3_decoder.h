@@ -0,0 +1,7 @@
+#pragma once
+#include "audio_element.h"
+typedef struct {
+    int out_rb_size;
+} mp3_decoder_cfg_t;
+#define DEFAULT_MP3_DECODER_CONFIG() { .out_rb_size = 8 * 1024 }
+audio_element_handle_t mp3_decoder_init(mp3_decoder_cfg_t* config);
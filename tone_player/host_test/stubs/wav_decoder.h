@@ -0,0 +1,7 @@
+#pragma once
+#include "audio_element.h"
+typedef struct {
+    int out_rb_size;
+} wav_decoder_cfg_t;
+#define DEFAULT_WAV_DECODER_CONFIG() { .out_rb_size = 8 * 1024 }
+audio_element_handle_t wav_decoder_init(wav_decoder_cfg_t* config);
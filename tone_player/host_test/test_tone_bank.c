@@ -0,0 +1,326 @@
+// host test of the tone bank parser and the cached pcm policy, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tone_bank.h"
+#include "esp_partition.h"
+#include "audio_element.h"
+#include "mp3_decoder.h"
+#include "wav_decoder.h"
+#include "crc.h"
+
+#define IMG_SIZE    (256 * 1024)
+#define ENTRY_SIZE  (64)            // tone_bank_entry_t
+#define APP_DESC    (256)
+
+static int s_fail;
+static uint32_t s_rand = 1;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+// the partition
+static uint8_t s_img[IMG_SIZE];
+static esp_partition_t s_part = { IMG_SIZE };
+static int s_mapped;
+
+const esp_partition_t* esp_partition_find_first(int type, int subtype, const char* label)
+{
+    return (subtype == TONE_BANK_SUBTYPE && strcmp(label, TONE_BANK_PARTITION) == 0) ? &s_part : NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, uint32_t offset, uint32_t size, int memory,
+    const void** out_ptr, spi_flash_mmap_handle_t* out_handle)
+{
+    *out_ptr = s_img + offset;
+    *out_handle = 1;
+    s_mapped++;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+    s_mapped--;
+}
+
+// a decoder that turns each input byte into s_dec.expand pcm bytes, run to the end in resume
+struct audio_element {
+    stream_func read, write;
+    void *read_ctx, *write_ctx;
+    int state;
+};
+
+static struct {
+    struct audio_element el;
+    uint32_t expand;
+    audio_element_info_t info;
+    int runs;
+    int live;
+} s_dec = { .expand = 8, .info = { 16000, 1, 16 } };
+
+static audio_element_handle_t dec_init(void)
+{
+    memset(&s_dec.el, 0, sizeof(s_dec.el));
+    s_dec.runs++;
+    s_dec.live++;
+    return &s_dec.el;
+}
+
+audio_element_handle_t mp3_decoder_init(mp3_decoder_cfg_t* config) { return dec_init(); }
+audio_element_handle_t wav_decoder_init(wav_decoder_cfg_t* config) { return dec_init(); }
+void audio_element_set_read_cb(audio_element_handle_t el, stream_func fn, void* context) { el->read = fn; el->read_ctx = context; }
+void audio_element_set_write_cb(audio_element_handle_t el, stream_func fn, void* context) { el->write = fn; el->write_ctx = context; }
+esp_err_t audio_element_run(audio_element_handle_t el) { return ESP_OK; }
+esp_err_t audio_element_wait_for_stop_ms(audio_element_handle_t el, TickType_t ticks_to_wait) { return ESP_OK; }
+int audio_element_get_state(audio_element_handle_t el) { return el->state; }
+esp_err_t audio_element_terminate(audio_element_handle_t el) { return ESP_OK; }
+esp_err_t audio_element_deinit(audio_element_handle_t el) { s_dec.live--; return ESP_OK; }
+
+esp_err_t audio_element_getinfo(audio_element_handle_t el, audio_element_info_t* info)
+{
+    *info = s_dec.info;
+    return ESP_OK;
+}
+
+esp_err_t audio_element_resume(audio_element_handle_t el, float wait_for_rb_threshold, TickType_t timeout)
+{
+    static char in[512], out[512 * 16];
+    int n;
+    el->state = AEL_STATE_RUNNING;
+    while((n = el->read(el, in, sizeof(in), 0, el->read_ctx)) > 0) {
+        for(uint32_t i = 0; i < n * s_dec.expand; i++) {
+            out[i] = in[i / s_dec.expand];
+        }
+        if(el->write(el, out, n * s_dec.expand, 0, el->write_ctx) < 0) {
+            el->state = AEL_STATE_ERROR;
+            return ESP_OK;
+        }
+    }
+    el->state = AEL_STATE_FINISHED;
+    return ESP_OK;
+}
+
+// a bin as mk_audio_tone.py packs it: header, app desc (format 1), file table, files, crc and tail (format 1)
+static uint32_t s_addr[TONE_TYPE_MAX];
+
+static uint32_t build(int format, const uint32_t* len, const uint8_t* type)
+{
+    memset(s_img, 0xFF, sizeof(s_img));
+    uint16_t tag = 0x2053, num = TONE_TYPE_MAX;
+    uint32_t fmt = format;
+    memcpy(s_img, &tag, 2);
+    memcpy(s_img + 2, &num, 2);
+    memcpy(s_img + 4, &fmt, 4);
+    uint32_t table = 8 + (format ? APP_DESC : 0);
+    memset(s_img + 8, 0, table - 8);
+    uint32_t addr = table + TONE_TYPE_MAX * ENTRY_SIZE;
+    for(int i = 0; i < TONE_TYPE_MAX; i++) {
+        uint8_t* e = s_img + table + i * ENTRY_SIZE;
+        memset(e, 0, ENTRY_SIZE);
+        e[0] = 0x28;
+        e[1] = i;
+        e[2] = type[i];
+        memcpy(e + 4, &addr, 4);
+        memcpy(e + 8, &len[i], 4);
+        s_addr[i] = addr;
+        for(uint32_t k = 0; k < len[i]; k++) {
+            s_img[addr + k] = rnd();
+        }
+        memset(s_img + addr + len[i], 0, ((len[i] + 3) & ~3) - len[i]);
+        addr += (len[i] + 3) & ~3;
+    }
+    if(format) {
+        uint32_t crc = crc32_ieee_update(CRC32_IEEE_INIT, s_img, addr);
+        uint16_t tail = 0xDFAC;
+        memcpy(s_img + addr, &crc, 4);
+        memcpy(s_img + addr + 4, &tail, 2);
+        addr += 6;
+    }
+    return addr;
+}
+
+static int read_file(const char* path, uint8_t* buf, uint32_t size)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == NULL) {
+        return -1;
+    }
+    int n = fread(buf, 1, size, f);
+    fclose(f);
+    return n;
+}
+
+static void test_shipped(void)
+{
+    printf("shipped audio_tone.bin\n");
+    static const char* music[TONE_TYPE_MAX] = { "../tools/music/sleep.mp3", "../tools/music/wakeup.mp3", "../tools/music/welcome.mp3" };
+    static uint8_t file[64 * 1024];
+    memset(s_img, 0xFF, sizeof(s_img));
+    int n = read_file("../audio_tone.bin", s_img, sizeof(s_img));
+    CHECK(n > 0);
+    CHECK(tone_bank_init() == ESP_OK && s_mapped == 1);
+    for(int t = 0; t < TONE_TYPE_MAX; t++) {
+        const tone_bank_file_t* f = tone_bank_get(t);
+        int len = read_file(music[t], file, sizeof(file));
+        CHECK(f && f->type == TONE_BANK_FILE_MP3 && (int)f->len == len && memcmp(f->data, file, len) == 0);
+    }
+    CHECK(tone_bank_get(TONE_TYPE_MAX) == NULL);
+    tone_bank_deinit();
+    CHECK(s_mapped == 0 && tone_bank_get(0) == NULL);
+}
+
+static void test_check(void)
+{
+    printf("header, file table, crc and tail checks\n");
+    uint32_t len[TONE_TYPE_MAX] = { 1000, 3001, 17 };
+    uint8_t type[TONE_TYPE_MAX] = { TONE_BANK_FILE_MP3, TONE_BANK_FILE_WAV, TONE_BANK_FILE_MP3 };
+    for(int format = 0; format <= 1; format++) {
+        uint32_t end = build(format, len, type);
+        CHECK(tone_bank_init() == ESP_OK);
+        for(int t = 0; t < TONE_TYPE_MAX; t++) {
+            const tone_bank_file_t* f = tone_bank_get(t);
+            CHECK(f && f->data == s_img + s_addr[t] && f->len == len[t] && f->type == type[t]);
+        }
+        tone_bank_deinit();
+
+        // each corruption is refused and leaves nothing mapped
+        uint32_t table = 8 + (format ? APP_DESC : 0);
+        struct { uint32_t off; uint8_t x; int format1_only; } bad[] = {
+            { 0, 0x01, 0 },                             // header tag
+            { 2, 0x01, 0 },                             // file number
+            { 4, 0x02, 0 },                             // format
+            { table, 0x01, 0 },                         // file tag
+            { table + ENTRY_SIZE + 1, 0x01, 0 },        // file index
+            { table + 2, 0x02, 0 },                     // file type
+            { table + 2 * ENTRY_SIZE + 7, 0x10, 0 },    // file address past the partition
+            { table + 2 * ENTRY_SIZE + 11, 0x10, 0 },   // file length past the partition
+            { s_addr[1] + 100, 0x01, 1 },               // file data, crc
+            { end - 6, 0x01, 1 },                       // crc
+            { end - 1, 0x01, 1 },                       // tail
+        };
+        for(uint32_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+            if(bad[i].format1_only && !format) {
+                continue;
+            }
+            s_img[bad[i].off] ^= bad[i].x;
+            CHECK(tone_bank_init() == ESP_FAIL && s_mapped == 0 && tone_bank_get(0) == NULL);
+            s_img[bad[i].off] ^= bad[i].x;
+        }
+        CHECK(tone_bank_init() == ESP_OK);
+        tone_bank_deinit();
+    }
+    // a table that does not fit in the partition
+    build(1, len, type);
+    s_part.size = 8 + APP_DESC + ENTRY_SIZE;
+    CHECK(tone_bank_init() == ESP_FAIL);
+    s_part.size = IMG_SIZE;
+}
+
+static int pcm_matches(tone_type_t t, uint32_t flen)
+{
+    const tone_bank_pcm_t* pcm = tone_bank_cached(t);
+    if(pcm == NULL || pcm->frames != flen * s_dec.expand / (2 * s_dec.info.channels)) {
+        return 0;
+    }
+    const uint8_t* p = (const uint8_t*)pcm->pcm;
+    for(uint32_t i = 0; i < flen * s_dec.expand; i++) {
+        if(p[i] != s_img[s_addr[t] + i / s_dec.expand]) {
+            return 0;
+        }
+    }
+    return pcm->rate == s_dec.info.sample_rates && pcm->bits == s_dec.info.bits && pcm->channels == s_dec.info.channels;
+}
+
+static void test_cache(void)
+{
+    printf("hits, decode into the cache, content\n");
+    uint32_t len[TONE_TYPE_MAX] = { 4000, 2001, 16 * 1024 + 1 };
+    uint8_t type[TONE_TYPE_MAX] = { TONE_BANK_FILE_MP3, TONE_BANK_FILE_WAV, TONE_BANK_FILE_MP3 };
+    build(1, len, type);
+    CHECK(tone_bank_init() == ESP_OK);
+    s_dec.runs = 0;
+    s_dec.expand = 8;
+    s_dec.info = (audio_element_info_t) { 22050, 2, 16 };
+
+    // cached on the TONE_BANK_CACHE_HITS-th play, then never asked again
+    for(int k = 1; k < TONE_BANK_CACHE_HITS; k++) {
+        CHECK(!tone_bank_hit(0));
+    }
+    CHECK(tone_bank_hit(0) && tone_bank_cached(0) == NULL);
+    CHECK(tone_bank_cache(0) == ESP_OK && pcm_matches(0, len[0]));
+    CHECK(!tone_bank_hit(0) && tone_bank_cache(0) == ESP_OK && s_dec.runs == 1);
+    CHECK(tone_bank_cache(1) == ESP_OK && pcm_matches(1, len[1]));
+
+    // 128 KB and one byte of pcm is too long for the cache, never decoded again
+    for(int k = 0; k < TONE_BANK_CACHE_HITS; k++) {
+        tone_bank_hit(2);
+    }
+    CHECK(tone_bank_cache(2) == ESP_ERR_NOT_SUPPORTED && tone_bank_cached(2) == NULL);
+    CHECK(!tone_bank_hit(2) && tone_bank_cache(2) == ESP_ERR_NOT_SUPPORTED && s_dec.runs == 3);
+    CHECK(s_dec.live == 0);
+    tone_bank_deinit();
+
+    // only 16 bits mono or stereo pcm is cached
+    build(1, len, type);
+    CHECK(tone_bank_init() == ESP_OK);
+    s_dec.info.bits = 24;
+    CHECK(tone_bank_cache(0) == ESP_ERR_NOT_SUPPORTED);
+    s_dec.info = (audio_element_info_t) { 16000, 1, 16 };
+    CHECK(tone_bank_cache(0) == ESP_ERR_NOT_SUPPORTED); // remembered
+    CHECK(tone_bank_cache(1) == ESP_OK && pcm_matches(1, len[1]));
+    CHECK(tone_bank_cache(TONE_TYPE_MAX) == ESP_ERR_INVALID_ARG && tone_bank_cached(TONE_TYPE_MAX) == NULL);
+    tone_bank_deinit();
+    CHECK(tone_bank_cached(1) == NULL && tone_bank_cache(1) == ESP_ERR_INVALID_ARG && !tone_bank_hit(1));
+}
+
+static void test_evict(void)
+{
+    printf("cache budget and eviction by plays\n");
+    // 120 KB of pcm each, two fit in the 256 KB budget
+    uint32_t len[TONE_TYPE_MAX] = { 15 * 1024, 15 * 1024, 15 * 1024 };
+    uint8_t type[TONE_TYPE_MAX] = { TONE_BANK_FILE_MP3, TONE_BANK_FILE_MP3, TONE_BANK_FILE_MP3 };
+    build(1, len, type);
+    CHECK(tone_bank_init() == ESP_OK);
+    s_dec.expand = 8;
+    s_dec.runs = 0;
+    int plays[TONE_TYPE_MAX] = { 2, 3, 4 };
+    for(int t = 0; t < 2; t++) {
+        for(int k = 0; k < plays[t]; k++) {
+            tone_bank_hit(t);
+        }
+        CHECK(tone_bank_cache(t) == ESP_OK);
+    }
+    // the most played one takes the place of the least played
+    for(int k = 0; k < plays[2]; k++) {
+        tone_bank_hit(2);
+    }
+    CHECK(tone_bank_cache(2) == ESP_OK && pcm_matches(2, len[2]));
+    CHECK(tone_bank_cached(0) == NULL && pcm_matches(1, len[1]));
+
+    // a prompt played no more than the cached ones does not evict them, and
+    // its size is known so it is not decoded again to find that out
+    tone_bank_hit(0); // 3 plays, as many as tone 1
+    int runs = s_dec.runs;
+    CHECK(tone_bank_cache(0) == ESP_ERR_NO_MEM && s_dec.runs == runs);
+    CHECK(tone_bank_cached(0) == NULL && tone_bank_cached(1) && tone_bank_cached(2));
+    tone_bank_hit(0);
+    tone_bank_hit(0); // 5 plays, more than both
+    CHECK(tone_bank_cache(0) == ESP_OK && s_dec.runs == runs + 1 && pcm_matches(0, len[0]));
+    CHECK(tone_bank_cached(1) == NULL && pcm_matches(2, len[2]));
+    tone_bank_deinit();
+}
+
+int main(void)
+{
+    test_shipped();
+    test_check();
+    test_cache();
+    test_evict();
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef __TONE_BANK_H__
+#define __TONE_BANK_H__
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
+#include "audio_tone_uri.h"
+
+// packed by tools/mk_audio_tone.py into the flash_tone partition
+#define TONE_BANK_PARTITION         "flash_tone"
+#define TONE_BANK_SUBTYPE           (0x27)
+
+// decoded pcm of frequently played short prompts is kept in psram
+#define TONE_BANK_CACHE_SIZE        (256 * 1024)    // all cached prompts
+#define TONE_BANK_CACHE_MAX_PCM     (128 * 1024)    // one prompt, longer ones always go through the decoder
+#define TONE_BANK_CACHE_HITS        (2)             // plays before a prompt is cached, 0: cache at init
+
+#if __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    TONE_BANK_FILE_MP3 = 0,
+    TONE_BANK_FILE_WAV = 1,
+} tone_bank_file_type_t;
+
+typedef struct {
+    const uint8_t*  data;   // mapped file in flash
+    uint32_t        len;
+    uint8_t         type;   // tone_bank_file_type_t
+} tone_bank_file_t;
+
+typedef struct {
+    const int16_t*  pcm;    // interleaved, in psram
+    uint32_t        frames;
+    int             rate;
+    int             bits;
+    int             channels;
+} tone_bank_pcm_t;
+
+// map the partition, check header, file table and crc once, index the files by tone_type_t
+esp_err_t tone_bank_init(void);
+void tone_bank_deinit(void);
+
+// O(1), NULL if the bank is not init or type is invalid
+const tone_bank_file_t* tone_bank_get(tone_type_t type);
+
+// count a play of type, true if it became worth caching
+bool tone_bank_hit(tone_type_t type);
+// decode type into the psram cache, evicting less played prompts if the cache is full
+esp_err_t tone_bank_cache(tone_type_t type);
+// NULL if type is not cached
+const tone_bank_pcm_t* tone_bank_cached(tone_type_t type);
+
+#if __cplusplus
+}
+#endif
+#endif // !__TONE_BANK_H__
@@ -20,6 +20,8 @@ bool tone_player_async_play(tone_type_t type);
 bool tone_player_stop(bool is_wait);
 bool tone_player_is_playing(void);
 bool tone_player_set_volume(int32_t volume);
+// microseconds from the last play request to its first sample, -1 before the first play
+int tone_player_get_latency_us(void);
 
 #if __cplusplus
 }
@@ -0,0 +1,326 @@
+#include "tone_bank.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include "audio_element.h"
+#include "mp3_decoder.h"
+#include "wav_decoder.h"
+#include "crc.h"
+
+static const char* TAG = "tone_bank";
+
+#define TONE_BANK_HEADER_TAG        (0x2053)
+#define TONE_BANK_FILE_TAG          (0x28)
+#define TONE_BANK_TAIL              (0xDFAC)
+#define TONE_BANK_APP_DESC_SIZE     (256)           // esp_app_desc_t behind the header in format 1
+#define TONE_BANK_DECODE_BUF_SIZE   (32 * 1024)     // first pcm buffer, doubled up to TONE_BANK_CACHE_MAX_PCM
+#define TONE_BANK_DECODE_TIMEOUT    (5000)
+
+// layout written by pack_tone_header / pack_tone_file_table of mk_audio_tone.py
+typedef struct __attribute__((packed)) {
+    uint16_t tag;
+    uint16_t file_num;
+    uint32_t format;
+} tone_bank_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  tag;
+    uint8_t  index;
+    uint8_t  type;
+    uint8_t  ver;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t rfu[12];
+    uint32_t info;
+} tone_bank_entry_t;
+
+typedef struct {
+    tone_bank_file_t    file;
+    tone_bank_pcm_t     pcm;        // pcm.pcm NULL: not cached
+    uint32_t            bytes;      // pcm size once decoded, kept after eviction
+    uint32_t            hits;
+    bool                no_cache;   // too long or not decodable, never retried
+} tone_bank_item_t;
+
+typedef struct {
+    spi_flash_mmap_handle_t mmap;
+    const uint8_t*          base;
+    uint32_t                size;
+    uint32_t                cache_bytes;
+    tone_bank_item_t        item[TONE_TYPE_MAX];
+    uint8_t                 is_init;
+} tone_bank_desc_t;
+
+static tone_bank_desc_t s_bank;
+
+static esp_err_t _tone_bank_check(void)
+{
+    const tone_bank_header_t* header = (const tone_bank_header_t*)s_bank.base;
+    if(header->tag != TONE_BANK_HEADER_TAG || header->file_num != TONE_TYPE_MAX || header->format > 1) {
+        ESP_LOGE(TAG, "tone bin header invalid, tag=0x%x, file_num=%d(%d), format=%d, please remake your tone file", header->tag, header->file_num, TONE_TYPE_MAX, header->format);
+        return ESP_FAIL;
+    }
+    uint32_t offset = sizeof(tone_bank_header_t) + ((header->format == 1) ? TONE_BANK_APP_DESC_SIZE : 0);
+    uint32_t table_end = offset + TONE_TYPE_MAX * sizeof(tone_bank_entry_t);
+    if(table_end > s_bank.size) {
+        ESP_LOGE(TAG, "tone bin file table out of partition");
+        return ESP_FAIL;
+    }
+
+    // files are stored by index, the table position is the tone_type_t
+    const tone_bank_entry_t* entry = (const tone_bank_entry_t*)(s_bank.base + offset);
+    uint32_t files_end = table_end;
+    for(int i = 0; i < TONE_TYPE_MAX; i++) {
+        if(entry[i].tag != TONE_BANK_FILE_TAG || entry[i].index != i || entry[i].type > TONE_BANK_FILE_WAV || \
+            entry[i].addr < table_end || entry[i].addr > s_bank.size || entry[i].len > s_bank.size - entry[i].addr) {
+            ESP_LOGE(TAG, "tone bin file %d invalid, tag=0x%x, index=%d, type=%d, addr=%d, len=%d", i, entry[i].tag, entry[i].index, entry[i].type, entry[i].addr, entry[i].len);
+            return ESP_FAIL;
+        }
+        s_bank.item[i].file.data = s_bank.base + entry[i].addr;
+        s_bank.item[i].file.len = entry[i].len;
+        s_bank.item[i].file.type = entry[i].type;
+        uint32_t end = entry[i].addr + ((entry[i].len + 3) & ~3);
+        files_end = (end > files_end) ? end : files_end;
+    }
+
+    if(header->format == 1) {
+        uint32_t crc = 0;
+        uint16_t tail = 0;
+        if(files_end + sizeof(crc) + sizeof(tail) > s_bank.size) {
+            ESP_LOGE(TAG, "tone bin crc out of partition");
+            return ESP_FAIL;
+        }
+        memcpy(&crc, s_bank.base + files_end, sizeof(crc));
+        memcpy(&tail, s_bank.base + files_end + sizeof(crc), sizeof(tail));
+        if(tail != TONE_BANK_TAIL) {
+            ESP_LOGE(TAG, "tone bin tail invalid, tail=0x%x", tail);
+            return ESP_FAIL;
+        }
+        int64_t start_us = esp_timer_get_time();
+        uint32_t calc = crc32_ieee_update(CRC32_IEEE_INIT, s_bank.base, files_end);
+        if(calc != crc) {
+            ESP_LOGE(TAG, "tone bin crc invalid, crc=0x%08x, calc=0x%08x", crc, calc);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "tone bin crc checked, %d bytes in %dus", files_end, (int)(esp_timer_get_time() - start_us));
+    }
+    return ESP_OK;
+}
+
+esp_err_t tone_bank_init(void)
+{
+    if(s_bank.is_init) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TONE_BANK_SUBTYPE, TONE_BANK_PARTITION);
+    if(partition == NULL) {
+        ESP_LOGE(TAG, "partition %s not found, see readme.md", TONE_BANK_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    const void* ptr = NULL;
+    if(esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &ptr, &s_bank.mmap) != ESP_OK) {
+        ESP_LOGE(TAG, "partition %s mmap failed", TONE_BANK_PARTITION);
+        return ESP_FAIL;
+    }
+    s_bank.base = (const uint8_t*)ptr;
+    s_bank.size = partition->size;
+    if(_tone_bank_check() != ESP_OK) {
+        spi_flash_munmap(s_bank.mmap);
+        memset(&s_bank, 0, sizeof(s_bank));
+        return ESP_FAIL;
+    }
+    s_bank.is_init = true;
+
+#if TONE_BANK_CACHE_HITS == 0
+    for(int i = 0; i < TONE_TYPE_MAX; i++) {
+        tone_bank_cache((tone_type_t)i);
+    }
+#endif
+    return ESP_OK;
+}
+
+void tone_bank_deinit(void)
+{
+    if(!s_bank.is_init) {
+        return;
+    }
+    for(int i = 0; i < TONE_TYPE_MAX; i++) {
+        heap_caps_free((void*)s_bank.item[i].pcm.pcm);
+    }
+    spi_flash_munmap(s_bank.mmap);
+    memset(&s_bank, 0, sizeof(s_bank));
+}
+
+const tone_bank_file_t* tone_bank_get(tone_type_t type)
+{
+    if(!s_bank.is_init || type >= TONE_TYPE_MAX) {
+        return NULL;
+    }
+    return &s_bank.item[type].file;
+}
+
+bool tone_bank_hit(tone_type_t type)
+{
+    if(!s_bank.is_init || type >= TONE_TYPE_MAX) {
+        return false;
+    }
+    tone_bank_item_t* item = &s_bank.item[type];
+    item->hits++;
+    return (item->pcm.pcm == NULL) && !item->no_cache && (item->hits >= TONE_BANK_CACHE_HITS);
+}
+
+const tone_bank_pcm_t* tone_bank_cached(tone_type_t type)
+{
+    if(!s_bank.is_init || type >= TONE_TYPE_MAX || s_bank.item[type].pcm.pcm == NULL) {
+        return NULL;
+    }
+    return &s_bank.item[type].pcm;
+}
+
+typedef struct {
+    const tone_bank_file_t* file;
+    uint32_t                pos;
+    uint8_t*                buf;
+    uint32_t                size;
+    uint32_t                len;
+} tone_bank_decode_t;
+
+static esp_err_t _tone_bank_decode_read(audio_element_handle_t self, char* buffer, int len, TickType_t ticks_to_wait, void* context)
+{
+    tone_bank_decode_t* dec = (tone_bank_decode_t*)context;
+    uint32_t left = dec->file->len - dec->pos;
+    if(left == 0) {
+        return AEL_IO_DONE;
+    }
+    len = ((uint32_t)len > left) ? (int)left : len;
+    memcpy(buffer, dec->file->data + dec->pos, len);
+    dec->pos += len;
+    return len;
+}
+
+static esp_err_t _tone_bank_decode_write(audio_element_handle_t self, char* buffer, int len, TickType_t ticks_to_wait, void* context)
+{
+    tone_bank_decode_t* dec = (tone_bank_decode_t*)context;
+    if(dec->len + len > dec->size) {
+        if(dec->len + len > TONE_BANK_CACHE_MAX_PCM) {
+            return AEL_IO_FAIL;
+        }
+        uint32_t size = dec->size ? dec->size : TONE_BANK_DECODE_BUF_SIZE;
+        while(size < dec->len + len) {
+            size *= 2;
+        }
+        size = (size > TONE_BANK_CACHE_MAX_PCM) ? TONE_BANK_CACHE_MAX_PCM : size;
+        uint8_t* buf = (uint8_t*)heap_caps_realloc(dec->buf, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if(buf == NULL) {
+            return AEL_IO_FAIL;
+        }
+        dec->buf = buf;
+        dec->size = size;
+    }
+    memcpy(dec->buf + dec->len, buffer, len);
+    dec->len += len;
+    return len;
+}
+
+// run a decoder element on its own, fed from the mapped file and writing into psram
+static esp_err_t _tone_bank_decode(tone_bank_item_t* item, tone_bank_decode_t* dec, audio_element_info_t* info)
+{
+    audio_element_handle_t decoder = NULL;
+    if(item->file.type == TONE_BANK_FILE_WAV) {
+        wav_decoder_cfg_t wav_cfg = DEFAULT_WAV_DECODER_CONFIG();
+        decoder = wav_decoder_init(&wav_cfg);
+    } else {
+        mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
+        decoder = mp3_decoder_init(&mp3_cfg);
+    }
+    if(decoder == NULL) {
+        ESP_LOGE(TAG, "(%s) decoder init failed!", __func__);
+        return ESP_FAIL;
+    }
+    dec->file = &item->file;
+    audio_element_set_read_cb(decoder, _tone_bank_decode_read, dec);
+    audio_element_set_write_cb(decoder, _tone_bank_decode_write, dec);
+
+    esp_err_t ret = ESP_FAIL;
+    if(audio_element_run(decoder) == ESP_OK && audio_element_resume(decoder, 0, 0) == ESP_OK) {
+        audio_element_wait_for_stop_ms(decoder, TONE_BANK_DECODE_TIMEOUT);
+        if(audio_element_get_state(decoder) == AEL_STATE_FINISHED) {
+            audio_element_getinfo(decoder, info);
+            ret = ESP_OK;
+        }
+    }
+    audio_element_terminate(decoder);
+    audio_element_deinit(decoder);
+    return ret;
+}
+
+// free the least played cached prompts that are played less than item until bytes fit
+static esp_err_t _tone_bank_make_room(tone_bank_item_t* item, uint32_t bytes)
+{
+    while(s_bank.cache_bytes + bytes > TONE_BANK_CACHE_SIZE) {
+        tone_bank_item_t* victim = NULL;
+        for(int i = 0; i < TONE_TYPE_MAX; i++) {
+            tone_bank_item_t* it = &s_bank.item[i];
+            if(it->pcm.pcm && it->hits < item->hits && (victim == NULL || it->hits < victim->hits)) {
+                victim = it;
+            }
+        }
+        if(victim == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        heap_caps_free((void*)victim->pcm.pcm);
+        victim->pcm.pcm = NULL;
+        s_bank.cache_bytes -= victim->bytes;
+        ESP_LOGI(TAG, "tone %d evicted, %d bytes", (int)(victim - s_bank.item), victim->bytes);
+    }
+    return ESP_OK;
+}
+
+esp_err_t tone_bank_cache(tone_type_t type)
+{
+    if(!s_bank.is_init || type >= TONE_TYPE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tone_bank_item_t* item = &s_bank.item[type];
+    if(item->pcm.pcm) {
+        return ESP_OK;
+    }
+    if(item->no_cache) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if(item->bytes && _tone_bank_make_room(item, item->bytes) != ESP_OK) {
+        return ESP_ERR_NO_MEM; // size known from an earlier decode, don't decode for nothing
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    tone_bank_decode_t dec = { 0 };
+    audio_element_info_t info = { 0 };
+    if(_tone_bank_decode(item, &dec, &info) != ESP_OK || dec.len == 0 || info.bits != 16 || info.channels < 1 || info.channels > 2) {
+        ESP_LOGW(TAG, "tone %d not cached, decoded=%d, bits=%d, channels=%d", type, dec.len, info.bits, info.channels);
+        heap_caps_free(dec.buf);
+        item->no_cache = true;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if(_tone_bank_make_room(item, dec.len) != ESP_OK) {
+        heap_caps_free(dec.buf);
+        item->bytes = dec.len;
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t* buf = (uint8_t*)heap_caps_realloc(dec.buf, dec.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    item->bytes = dec.len;
+    item->pcm.rate = info.sample_rates;
+    item->pcm.bits = info.bits;
+    item->pcm.channels = info.channels;
+    item->pcm.frames = dec.len / (info.bits / 8 * info.channels);
+    item->pcm.pcm = (const int16_t*)(buf ? buf : dec.buf);
+    s_bank.cache_bytes += dec.len;
+    ESP_LOGI(TAG, "tone %d cached, %d bytes, rate=%d, channels=%d, decoded in %dms, cache %d/%d", type, dec.len,
+        info.sample_rates, info.channels, (int)((esp_timer_get_time() - start_us) / 1000), s_bank.cache_bytes, TONE_BANK_CACHE_SIZE);
+    return ESP_OK;
+}
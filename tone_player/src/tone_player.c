@@ -1,7 +1,15 @@
 #include "tone_player.h"
 #include "audio_tone_uri.h"
+#include "tone_bank.h"
+
+#include <string.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2s.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
 
 #include "audio_element.h"
 #include "audio_idf_version.h"
@@ -16,13 +24,56 @@
 
 static const char* TAG = "tone_player";
 
+// tone player status
+#define TONE_PLAYER_STATUS_IDLE     (BIT0)  // no cached prompt queued or playing
+#define TONE_PLAYER_STATUS_STOP     (BIT1)  // cut the cached prompt short
+#define TONE_PLAYER_STATUS_EXIT     (BIT2)
+
+#define TONE_PLAYER_CHUNK_FRAMES    (256)   // frames per i2s write of a cached prompt
+#define TONE_PLAYER_QUEUE_LEN       (4)
+
+typedef enum {
+    TONE_PLAYER_CMD_PLAY,   // play the cached pcm
+    TONE_PLAYER_CMD_CACHE,  // decode into the cache
+    TONE_PLAYER_CMD_EXIT,
+} tone_player_cmd_t;
+
+typedef struct {
+    tone_player_cmd_t cmd;
+    tone_type_t type;
+} tone_player_msg_t;
+
 typedef struct {
     esp_audio_handle_t hd;
+    audio_element_handle_t i2s;     // writer of esp_audio, cached prompts go to its port while esp_audio is idle
+    i2s_stream_cfg_t i2s_cfg;
+    QueueHandle_t queue;
+    EventGroupHandle_t status;
+    int64_t play_us;                // last play request
+    volatile bool measure;          // waiting for the first sample of the last request
+    int latency_us;
     uint8_t is_init;
 } tone_player_desc_t;
 
 static tone_player_desc_t s_player_desc;
 
+static void tone_player_latency_done(const char* path)
+{
+    if(s_player_desc.measure) {
+        s_player_desc.measure = false;
+        s_player_desc.latency_us = (int)(esp_timer_get_time() - s_player_desc.play_us);
+        ESP_LOGI(TAG, "tone %s first sample after %dus", path, s_player_desc.latency_us);
+    }
+}
+
+static void tone_player_audio_cb(esp_audio_state_t* state, void* ctx)
+{
+    // esp_audio runs once the decoder reported the music info and the writer took the first block
+    if(state->status == AUDIO_STATUS_RUNNING) {
+        tone_player_latency_done("decoded");
+    }
+}
+
 static esp_audio_handle_t tone_player_setup_player(void)
 {
     esp_audio_cfg_t cfg = DEFAULT_ESP_AUDIO_CONFIG();
@@ -37,6 +88,7 @@ static esp_audio_handle_t tone_player_setup_player(void)
     cfg.vol_get = (audio_volume_get)audio_hal_get_volume;
     cfg.resample_rate = 48000;
     cfg.prefer_type = ESP_AUDIO_PREFER_MEM;
+    cfg.cb_func = tone_player_audio_cb;
 
     esp_audio_handle_t player = esp_audio_create(&cfg);
     audio_hal_ctrl_codec(board_handle->audio_hal, AUDIO_HAL_CODEC_MODE_BOTH, AUDIO_HAL_CTRL_START);
@@ -62,7 +114,9 @@ static esp_audio_handle_t tone_player_setup_player(void)
     i2s_writer.need_expand = (CODEC_ADC_BITS_PER_SAMPLE != I2S_BITS_PER_SAMPLE_16BIT);
 #endif
     i2s_writer.type = AUDIO_STREAM_WRITER;
-    esp_audio_output_stream_add(player, i2s_stream_init(&i2s_writer));
+    s_player_desc.i2s_cfg = i2s_writer;
+    s_player_desc.i2s = i2s_stream_init(&i2s_writer);
+    esp_audio_output_stream_add(player, s_player_desc.i2s);
 
     // Set default volume
     esp_audio_vol_set(player, TONE_PLAYER_DEF_VOLUME);
@@ -72,27 +126,193 @@ static esp_audio_handle_t tone_player_setup_player(void)
     return player;
 }
 
-bool tone_player_init(void)
+static bool tone_player_audio_running(void)
 {
-    if(get_tone_uri_num() != TONE_TYPE_MAX) {
-        ESP_LOGE(TAG, "please remake your tone file, see readme.md");
+    esp_audio_state_t state;
+    return esp_audio_state_get(s_player_desc.hd, &state) == ESP_OK && state.status == AUDIO_STATUS_RUNNING;
+}
+
+// frames of the cached pcm format, expanded to the i2s bits if the writer needs it, as i2s_stream does
+static void tone_player_i2s_write(const tone_bank_pcm_t* pcm, const void* data, uint32_t frames)
+{
+    size_t written = 0;
+    size_t size = frames * pcm->channels * (pcm->bits / 8);
+    i2s_stream_cfg_t* cfg = &s_player_desc.i2s_cfg;
+    if(cfg->need_expand) {
+        i2s_write_expand(cfg->i2s_port, data, size, pcm->bits, cfg->i2s_config.bits_per_sample, &written, portMAX_DELAY);
+    } else {
+        i2s_write(cfg->i2s_port, data, size, &written, portMAX_DELAY);
+    }
+}
+
+// write the cached pcm to the i2s port of esp_audio, no flash read, no decoder
+static void tone_player_play_cached(const tone_bank_pcm_t* pcm)
+{
+    int16_t buf[TONE_PLAYER_CHUNK_FRAMES * 2];
+    // the format the decoder path would set, i2s_stream keeps the writer bits when it needs expand
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(s_player_desc.i2s, &info);
+    i2s_stream_set_clk(s_player_desc.i2s, pcm->rate, pcm->bits, pcm->channels);
+    const int16_t* src = pcm->pcm;
+    uint32_t left = pcm->frames;
+    while(left && !(xEventGroupGetBits(s_player_desc.status) & TONE_PLAYER_STATUS_STOP)) {
+        uint32_t frames = (left > TONE_PLAYER_CHUNK_FRAMES) ? TONE_PLAYER_CHUNK_FRAMES : left;
+        tone_player_i2s_write(pcm, src, frames);
+        tone_player_latency_done("cached");
+        src += frames * pcm->channels;
+        left -= frames;
+    }
+    if(left) {
+        i2s_zero_dma_buffer(s_player_desc.i2s_cfg.i2s_port);
+    } else {
+        // push the tail out of the dma buffers before the clock changes back
+        memset(buf, 0, sizeof(buf));
+        int frames = s_player_desc.i2s_cfg.i2s_config.dma_buf_count * s_player_desc.i2s_cfg.i2s_config.dma_buf_len;
+        for(; frames > 0; frames -= TONE_PLAYER_CHUNK_FRAMES) {
+            tone_player_i2s_write(pcm, buf, (frames > TONE_PLAYER_CHUNK_FRAMES) ? TONE_PLAYER_CHUNK_FRAMES : frames);
+        }
+    }
+    // back to the format of the last decoded play
+    i2s_stream_set_clk(s_player_desc.i2s, info.sample_rates, info.bits, info.channels);
+}
+
+static void tone_player_task(void* arg)
+{
+    tone_player_msg_t msg;
+    while(1) {
+        if(xQueueReceive(s_player_desc.queue, &msg, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if(msg.cmd == TONE_PLAYER_CMD_EXIT) {
+            break;
+        } else if(msg.cmd == TONE_PLAYER_CMD_CACHE) {
+            tone_bank_cache(msg.type);
+            continue;
+        }
+        const tone_bank_pcm_t* pcm = tone_bank_cached(msg.type);
+        if(pcm) {
+            tone_player_play_cached(pcm);
+        } else { // evicted after the request was queued
+            esp_audio_play(s_player_desc.hd, AUDIO_CODEC_TYPE_DECODER, tone_uri[msg.type], 0);
+        }
+        xEventGroupSetBits(s_player_desc.status, TONE_PLAYER_STATUS_IDLE);
+    }
+    xEventGroupSetBits(s_player_desc.status, TONE_PLAYER_STATUS_IDLE | TONE_PLAYER_STATUS_EXIT);
+    vTaskDelete(NULL);
+}
+
+static bool tone_player_post(tone_player_cmd_t cmd, tone_type_t type)
+{
+    tone_player_msg_t msg = { .cmd = cmd, .type = type };
+    if(cmd == TONE_PLAYER_CMD_PLAY) {
+        xEventGroupClearBits(s_player_desc.status, TONE_PLAYER_STATUS_IDLE);
+    }
+    if(xQueueSend(s_player_desc.queue, &msg, 0) != pdTRUE) {
+        ESP_LOGE(TAG, "tone player queue full");
+        if(cmd == TONE_PLAYER_CMD_PLAY) {
+            xEventGroupSetBits(s_player_desc.status, TONE_PLAYER_STATUS_IDLE);
+        }
+        return false;
+    }
+    return true;
+}
+
+// cut (or wait for) the cached prompt queued or playing
+static void tone_player_stop_cached(bool is_wait)
+{
+    if(!is_wait) {
+        xEventGroupSetBits(s_player_desc.status, TONE_PLAYER_STATUS_STOP);
+    }
+    xEventGroupWaitBits(s_player_desc.status, TONE_PLAYER_STATUS_IDLE, pdFALSE, pdFALSE, portMAX_DELAY);
+    xEventGroupClearBits(s_player_desc.status, TONE_PLAYER_STATUS_STOP);
+}
+
+static bool tone_player_play(tone_type_t type, bool sync)
+{
+    if(type >= TONE_TYPE_MAX) {
+        ESP_LOGE(TAG, "tone type is invalid");
         return false;
     }
 
+    if(s_player_desc.hd == NULL) {
+        ESP_LOGE(TAG, "tone player is not init");
+        return false;
+    }
+
+    tone_player_stop_cached(false);
+    s_player_desc.play_us = esp_timer_get_time();
+    s_player_desc.measure = true;
+    bool cache = tone_bank_hit(type);
+    bool ret = false;
+    if(tone_bank_cached(type)) {
+        if(tone_player_audio_running()) {
+            esp_audio_stop(s_player_desc.hd, TERMINATION_TYPE_NOW);
+        }
+        ret = tone_player_post(TONE_PLAYER_CMD_PLAY, type);
+        if(ret && sync) {
+            tone_player_stop_cached(true);
+        }
+    } else if(sync) {
+        ret = esp_audio_sync_play(s_player_desc.hd, tone_uri[type], 0) == ESP_OK ? true : false;
+    } else {
+        ret = esp_audio_play(s_player_desc.hd, AUDIO_CODEC_TYPE_DECODER, tone_uri[type], 0) == ESP_OK ? true : false;
+    }
+    if(cache) {
+        tone_player_post(TONE_PLAYER_CMD_CACHE, type);
+    }
+    return ret;
+}
+
+bool tone_player_init(void)
+{
     if(s_player_desc.is_init) {
         ESP_LOGW(TAG, "tone player is already init");
         return true;
     }
 
+    // the bin must hold one file per tone_type_t
+    if(tone_bank_init() != ESP_OK) {
+        ESP_LOGE(TAG, "please remake your tone file, see readme.md");
+        return false;
+    }
+
+    s_player_desc.status = xEventGroupCreate();
+    s_player_desc.queue = xQueueCreate(TONE_PLAYER_QUEUE_LEN, sizeof(tone_player_msg_t));
+    if(s_player_desc.status == NULL || s_player_desc.queue == NULL) {
+        ESP_LOGE(TAG, "tone player queue create failed");
+        goto _failed;
+    }
+    xEventGroupSetBits(s_player_desc.status, TONE_PLAYER_STATUS_IDLE);
+    s_player_desc.latency_us = -1;
+
     s_player_desc.hd = tone_player_setup_player();
-    if(s_player_desc.hd) {
+    if(s_player_desc.hd == NULL) {
         ESP_LOGE(TAG, "tone player setup failed");
-        return false;
+        goto _failed;
+    }
+
+    if(xTaskCreate(tone_player_task, "tone_player", 4096, NULL, 18, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "tone player task create failed");
+        goto _failed;
     }
 
     s_player_desc.is_init = true;
     ESP_LOGI(TAG, "tone player init success");
     return true;
+
+_failed:
+    if(s_player_desc.hd) {
+        esp_audio_destroy(s_player_desc.hd);
+    }
+    if(s_player_desc.queue) {
+        vQueueDelete(s_player_desc.queue);
+    }
+    if(s_player_desc.status) {
+        vEventGroupDelete(s_player_desc.status);
+    }
+    tone_bank_deinit();
+    memset(&s_player_desc, 0, sizeof(s_player_desc));
+    return false;
 }
 
 bool tone_player_deinit(void)
@@ -102,48 +322,34 @@ bool tone_player_deinit(void)
         return false;
     }
 
+    tone_player_stop_cached(false);
+    tone_player_msg_t msg = { .cmd = TONE_PLAYER_CMD_EXIT };
+    xQueueSend(s_player_desc.queue, &msg, portMAX_DELAY);
+    xEventGroupWaitBits(s_player_desc.status, TONE_PLAYER_STATUS_EXIT, pdFALSE, pdFALSE, portMAX_DELAY);
+    vQueueDelete(s_player_desc.queue);
+    vEventGroupDelete(s_player_desc.status);
+
     if(s_player_desc.hd) {
         esp_audio_destroy(s_player_desc.hd);
         ESP_LOGI(TAG, "tone player destory success");
         s_player_desc.hd = NULL;
     }
 
-    s_player_desc.is_init = false; 
+    tone_bank_deinit();
+    memset(&s_player_desc, 0, sizeof(s_player_desc));
     return true;
 }
 
 // block until play finish
 bool tone_player_sync_play(tone_type_t type)
 {
-    if(type >= TONE_TYPE_MAX) {
-        ESP_LOGE(TAG, "tone type is invalid");
-        return false;
-    }
-
-    if(s_player_desc.hd == NULL) {
-        ESP_LOGE(TAG, "tone player is not init");
-        return false;
-    }
-
-    extern const char* tone_uri[];
-    return esp_audio_sync_play(s_player_desc.hd, tone_uri[type], 0) == ESP_OK ? true : false;
+    return tone_player_play(type, true);
 }
 
 // not block
 bool tone_player_async_play(tone_type_t type)
 {
-    if(type >= TONE_TYPE_MAX) {
-        ESP_LOGE(TAG, "tone type is invalid");
-        return false;
-    }
-
-    if(s_player_desc.hd == NULL) {
-        ESP_LOGE(TAG, "tone player is not init");
-        return false;
-    }
-
-    extern const char* tone_uri[];
-    return esp_audio_play(s_player_desc.hd, AUDIO_CODEC_TYPE_DECODER, tone_uri[type], 0) == ESP_OK ? true : false;
+    return tone_player_play(type, false);
 }
 
 bool tone_player_stop(bool is_wait)
@@ -153,6 +359,7 @@ bool tone_player_stop(bool is_wait)
         return false;
     }
 
+    tone_player_stop_cached(is_wait);
     return esp_audio_stop(s_player_desc.hd, is_wait ? TERMINATION_TYPE_DONE : TERMINATION_TYPE_NOW) == ESP_OK ? true : false;
 }
 
@@ -163,16 +370,22 @@ bool tone_player_is_playing(void)
         return true;
     }
 
+    if(!(xEventGroupGetBits(s_player_desc.status) & TONE_PLAYER_STATUS_IDLE)) {
+        return true;
+    }
+
     esp_audio_state_t state;
     if(esp_audio_state_get(s_player_desc.hd, &state) != ESP_OK) {
         ESP_LOGE(TAG, "get audio state failed");
         return true;
     }
 
-    if(state.status == AUDIO_STATUS_RUNNING) {
-        return false;
-    }
-    return true;
+    return state.status == AUDIO_STATUS_RUNNING;
+}
+
+int tone_player_get_latency_us(void)
+{
+    return s_player_desc.latency_us;
 }
 
 bool tone_player_set_volume(int32_t volume)
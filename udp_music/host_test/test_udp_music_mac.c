@@ -0,0 +1,258 @@
+// host test of the "mac" (gzip json) and "mac_bin" target lists, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "udp_music_mac.h"
+#include "base64.h"
+#include "esp_log.h"
+
+#define LIST_MAX    (3000)
+#define JSON_MAX    (LIST_MAX * 24 + 4096)
+
+static int s_fail;
+static uint32_t s_rand = 11;
+static int s_mallocs;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+void* __real_malloc(size_t size);
+void* __wrap_malloc(size_t size)
+{
+    s_mallocs++;
+    return __real_malloc(size);
+}
+
+static uint32_t rnd(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int mac_cmp(const void* a, const void* b)
+{
+    return memcmp(a, b, 6);
+}
+
+// distinct random macs, sorted
+static void make_macs(uint8_t (*macs)[6], int num)
+{
+    for(int i = 0; i < num; i++) {
+        for(int j = 0; j < 6; j++) {
+            macs[i][j] = rnd();
+        }
+        macs[i][5] = i; // the low bits keep them distinct
+        macs[i][4] = i >> 8;
+    }
+    qsort(macs, num, 6, mac_cmp);
+}
+
+// json array in the sender styles: lower or upper case, ':' '-' or no separator, other strings between
+static size_t make_json(char* json, uint8_t (*macs)[6], int num)
+{
+    size_t len = sprintf(json, "[");
+    for(int i = 0; i < num; i++) {
+        const char* hex = (i % 3) ? "%02x" : "%02X";
+        const char* sep = (i % 4 == 1) ? ":" : (i % 4 == 2) ? "-" : "";
+        if(i % 50 == 7) {
+            len += sprintf(json + len, "\"not a mac\",\"0123456789abc\",\"\\\"%02x\",", macs[i][0]);
+        }
+        len += sprintf(json + len, "%s\"", i ? "," : "");
+        for(int j = 0; j < 6; j++) {
+            len += sprintf(json + len, hex, macs[i][j]);
+            len += sprintf(json + len, "%s", j < 5 ? sep : "");
+        }
+        len += sprintf(json + len, "\"");
+    }
+    len += sprintf(json + len, "]");
+    return len;
+}
+
+static size_t gzip(const char* src, size_t len, uint8_t* dst, size_t size)
+{
+    z_stream z = { 0 };
+    deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    z.next_in = (Bytef*)src;
+    z.avail_in = len;
+    z.next_out = dst;
+    z.avail_out = size;
+    CHECK(deflate(&z, Z_FINISH) == Z_STREAM_END);
+    size_t out = z.total_out;
+    deflateEnd(&z);
+    return out;
+}
+
+// the first len gzip bytes inflate to text containing str
+static int gz_prefix_has(const uint8_t* gz, size_t len, const char* str)
+{
+    static char out[JSON_MAX];
+    z_stream z = { 0 };
+    inflateInit2(&z, 15 + 16);
+    z.next_in = (Bytef*)gz;
+    z.avail_in = len;
+    z.next_out = (Bytef*)out;
+    z.avail_out = sizeof(out) - 1;
+    inflate(&z, Z_SYNC_FLUSH);
+    out[z.total_out] = '\0';
+    inflateEnd(&z);
+    return strstr(out, str) != NULL;
+}
+
+static char* b64(const uint8_t* src, size_t len)
+{
+    size_t olen = 0;
+    base64_encode(NULL, 0, &olen, src, len);
+    char* dst = __real_malloc(olen + 1);
+    CHECK(base64_encode((uint8_t*)dst, olen + 1, &olen, src, len) == 0);
+    dst[olen] = '\0';
+    return dst;
+}
+
+static void test_parse(void)
+{
+    static const uint8_t ref[6] = { 0xe4, 0xb0, 0x63, 0x85, 0xe7, 0x50 };
+    static const char* good[] = { "e4b06385e750", "E4:B0:63:85:E7:50", "e4-b0-63-85-e7-50", "e4b0:6385-e750" };
+    static const char* bad[] = { "", "e4b06385e75", "e4b06385e7500", "e4b06385e75g", "e4 b0 63 85 e7 50" };
+    uint8_t mac[6];
+
+    printf("own mac parse\n");
+    for(size_t i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+        CHECK(udp_music_mac_parse(good[i], strlen(good[i]), mac) == ESP_OK);
+        CHECK(memcmp(mac, ref, 6) == 0);
+    }
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        CHECK(udp_music_mac_parse(bad[i], strlen(bad[i]), mac) == ESP_FAIL);
+    }
+}
+
+static void test_gzip_list(int num)
+{
+    static uint8_t macs[LIST_MAX + 1][6];
+    static char json[JSON_MAX];
+    static uint8_t gz[JSON_MAX + 1024];
+    uint8_t other[6];
+    int fail0 = s_fail;
+
+    make_macs(macs, num + 1);
+    memcpy(other, macs[num / 2], 6); // sorted order is kept, the one left out is not in the list
+    memmove(macs[num / 2], macs[num / 2 + 1], (num - num / 2) * 6);
+    size_t json_len = make_json(json, macs, num);
+    size_t gz_len = gzip(json, json_len, gz, sizeof(gz));
+    char* list = b64(gz, gz_len);
+
+    s_mallocs = 0;
+    int idx[] = { 0, 1, num / 3, num / 2, num - 2, num - 1 };
+    for(size_t i = 0; i < sizeof(idx) / sizeof(idx[0]); i++) {
+        CHECK(udp_music_mac_match(list, macs[idx[i]]) == ESP_OK);
+    }
+    CHECK(udp_music_mac_match(list, other) == ESP_FAIL);
+    CHECK(s_mallocs == 0);
+    double t = now_s();
+    int n;
+    for(n = 0; now_s() - t < 0.2; n++) {
+        udp_music_mac_match(list, other);
+    }
+    double scan_ms = (now_s() - t) * 1000 / n;
+
+    // a truncated list never matches the one left out, the last mac only if its whole string was inflated
+    stub_log_quiet = 1;
+    size_t list_len = strlen(list);
+    const char* end = strrchr(json, ',') ? strrchr(json, ',') + 1 : json + 1;
+    char last[32] = { 0 };
+    memcpy(last, end, json + json_len - 1 - end); // quoted last mac without ']'
+    for(int r = 0; r < 40; r++) {
+        size_t cut = (r < 8) ? list_len - 1 - r : rnd() % list_len;
+        size_t gz_cut = (cut / 4 * 3 < gz_len) ? cut / 4 * 3 : gz_len;
+        char saved = list[cut];
+        list[cut] = '\0';
+        CHECK(udp_music_mac_match(list, other) == ESP_FAIL);
+        CHECK(udp_music_mac_match(list, macs[num - 1]) == ESP_FAIL || gz_prefix_has(gz, gz_cut, last));
+        list[cut] = saved;
+    }
+    // gzip cut inside the data or the trailer, re-encoded as valid base64
+    for(int r = 0; r < 20; r++) {
+        size_t cut = (r < 8) ? gz_len - 1 - r : rnd() % gz_len;
+        char* part = b64(gz, cut);
+        CHECK(udp_music_mac_match(part, other) == ESP_FAIL);
+        CHECK(udp_music_mac_match(part, macs[num - 1]) == ESP_FAIL || gz_prefix_has(gz, cut, last));
+        CHECK(udp_music_mac_match(part, macs[0]) == ESP_FAIL || cut > 10);
+        free(part);
+    }
+    // invalid digit and flipped gzip byte
+    list[list_len / 2] = '*';
+    CHECK(udp_music_mac_match(list, macs[num - 1]) == ESP_FAIL);
+    gz[gz_len - 5] ^= 1; // ISIZE
+    char* bad = b64(gz, gz_len);
+    CHECK(udp_music_mac_match(bad, other) == ESP_FAIL);
+    free(bad);
+    stub_log_quiet = 0;
+    printf("  mac %d macs: %zu digits, full scan %.2f ms%s\n", num, list_len, scan_ms, s_fail == fail0 ? "" : " FAILED");
+    free(list);
+}
+
+static void test_bin_list(int num)
+{
+    static uint8_t macs[LIST_MAX + 1][6];
+    uint8_t other[6];
+    int fail0 = s_fail;
+
+    make_macs(macs, num + 1);
+    memcpy(other, macs[num / 2], 6);
+    memmove(macs[num / 2], macs[num / 2 + 1], (num - num / 2) * 6);
+    char* list = b64((uint8_t*)macs, num * 6);
+    size_t list_len = strlen(list);
+    CHECK(list_len == (size_t)num * 8);
+
+    s_mallocs = 0;
+    for(int i = 0; i < num; i++) {
+        CHECK(udp_music_mac_bin_match(list, macs[i]) == ESP_OK);
+    }
+    CHECK(udp_music_mac_bin_match(list, other) == ESP_FAIL);
+    for(int r = 0; r < 200; r++) {
+        uint8_t mac[6];
+        for(int j = 0; j < 6; j++) {
+            mac[j] = rnd();
+        }
+        CHECK(udp_music_mac_bin_match(list, mac) == (bsearch(mac, macs, num, 6, mac_cmp) ? ESP_OK : ESP_FAIL));
+    }
+    CHECK(s_mallocs == 0);
+
+    // truncated: a partial mac is rejected, whole macs cut off are not found
+    stub_log_quiet = 1;
+    for(size_t cut = list_len - 9; cut < list_len; cut++) {
+        char saved = list[cut];
+        list[cut] = '\0';
+        CHECK(udp_music_mac_bin_match(list, macs[0]) == ((cut % 8) ? ESP_FAIL : ESP_OK));
+        CHECK(udp_music_mac_bin_match(list, macs[num - 1]) == ESP_FAIL);
+        list[cut] = saved;
+    }
+    CHECK(udp_music_mac_bin_match("", macs[0]) == ESP_FAIL);
+    list[(num / 2) * 8 + 3] = '*';
+    CHECK(udp_music_mac_bin_match(list, other) == ESP_FAIL);
+    stub_log_quiet = 0;
+    printf("  mac_bin %d macs: %zu digits%s\n", num, list_len, s_fail == fail0 ? "" : " FAILED");
+    free(list);
+}
+
+int main(void)
+{
+    test_parse();
+    printf("gzip json list: members, others, truncated and corrupt input, no heap\n");
+    test_gzip_list(2);
+    test_gzip_list(100);
+    test_gzip_list(LIST_MAX);
+    printf("binary list: members, others, truncated and corrupt input, no heap\n");
+    test_bin_list(1);
+    test_bin_list(100);
+    test_bin_list(LIST_MAX);
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -13,10 +13,8 @@
 #define UDP_MUSIC_MSG_BUF_RECV_TIMEOUT   50
 // udp music message send timeout [ms]
 #define UDP_MUSIC_MSG_BUF_SEND_TIMEOUT   0
-// udp music base64 buffer size
-#define UDP_MUSIC_BASE64_BUF_SIZE        1024 * 2
-// udp music gzip buffer size
-#define UDP_MUSIC_GZIP_BUF_SIZE          1024 * 20
+// udp music mac list base64 digits decoded per chunk, multiple of 4
+#define UDP_MUSIC_MAC_CHUNK_SIZE         256
 // udp music player timeout [ms]
 #define UDP_MUSIC_PLAYER_TIMEOUT         3000
 // udp music player idle buffer size
@@ -25,6 +23,13 @@
 #define UDP_MUSIC_PLAYER_MAX_BUF_SIZE    320 * 1024
 // udp music player max bit rate
 #define UDP_MUSIC_PLAYER_MAX_BIT_RATE    512000
+// udp music player socket receive buffer size, needs CONFIG_LWIP_SO_RCVBUF
+#define UDP_MUSIC_PLAYER_RCVBUF_SIZE     16 * 1024
+// udp music player keeps the pipeline (ring buffer, i2s, board) between tracks of the same stream layout
+// for this long after a track [ms], then releases it. 0: release at the end of every track
+#define UDP_MUSIC_PLAYER_WARM_TIME       5000
+// udp music player buffer fill report period [ms]
+#define UDP_MUSIC_PLAYER_SYNC_PERIOD     5000
 
 typedef enum {
     UDP_MUSIC_EVENT_TYPE_START,
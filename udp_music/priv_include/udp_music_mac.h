@@ -0,0 +1,25 @@
+#ifndef __UDP_MUSIC_MAC_H__
+#define __UDP_MUSIC_MAC_H__
+
+#include "stdint.h"
+#include "esp_err.h"
+
+// target mac lists of the start/stop commands, no os dependency.
+// "mac": base64(gzip(json array of mac strings)), "mac_bin": base64 of the ascending sorted 6 bytes macs.
+// no heap, the gzip list streams through one static inflate state, call from one task only.
+
+#if __cplusplus
+extern "C" {
+#endif
+
+// mac string as 6 bytes, ':' and '-' separators are skipped, ESP_FAIL if it is not 12 hex digits
+esp_err_t udp_music_mac_parse(const char* str, uint32_t len, uint8_t mac[6]);
+// ESP_OK if self is in the "mac" list, ESP_FAIL if not or the list is invalid or truncated before a match
+esp_err_t udp_music_mac_match(const char* gzip_mac, const uint8_t self[6]);
+// ESP_OK if self is in the "mac_bin" list, ESP_FAIL if not or the list is invalid
+esp_err_t udp_music_mac_bin_match(const char* bin_mac, const uint8_t self[6]);
+
+#if __cplusplus
+}
+#endif
+#endif // !__UDP_MUSIC_MAC_H__
@@ -1,4 +1,5 @@
 #include "udp_music.h"
+#include "udp_music_mac.h"
 #include "string.h"
 #include "stdint.h"
 
@@ -7,7 +8,6 @@
 #include "FreeRTOS/semphr.h"
 #include "FreeRTOS/event_groups.h"
 #include "freertos/ringbuf.h"
-#include "mbedtls/base64.h"
 #include "cJSON.h"
 
 #include "esp_log.h"
@@ -17,8 +17,6 @@
 #include "sys/types.h"
 #include "sys/socket.h"
 
-#include "mbedtls/base64.h"
-#include "gzip_inflate.h"
 #include "udp_stream.h"
 
 #include "audio_common.h"
@@ -29,6 +27,8 @@
 #include "wav_decoder.h"
 #include "pcm_decoder.h"
 #include "audio_pipeline.h"
+#include "audio_event_iface.h"
+#include "esp_timer.h"
 
 static const char *TAG = "udp_music";
 
@@ -47,6 +47,51 @@ static esp_err_t udp_music_proto_start_handler(cJSON* root);
 static esp_err_t udp_music_proto_stop_handler(cJSON* root);
 static esp_err_t udp_music_proto_status_handler(cJSON* root);
 static esp_err_t _udp_music_proto_notify_status(int code, char* msg);
+// per track measurements: start latency, player loop wakeups and cpu time of the player task
+typedef struct {
+    int64_t     start_us;
+    int         setup_ms;
+    int         first_frame_ms; // -1: nothing decoded
+    uint32_t    wakeups;
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    uint64_t    task_time;      // run time counter units, summed per sample so the 32 bits counters may wrap
+    uint64_t    total_time;
+    uint32_t    task_last;
+    uint32_t    total_last;
+#endif
+} udp_music_player_perf_t;
+
+static void _udp_music_perf_sample(udp_music_player_perf_t* perf, bool first)
+{
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    TaskStatus_t status;
+    vTaskGetInfo(NULL, &status, pdFALSE, eRunning);
+    uint32_t task = (uint32_t)status.ulRunTimeCounter;
+    uint32_t total = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+    if(!first) {
+        perf->task_time += (uint32_t)(task - perf->task_last);
+        perf->total_time += (uint32_t)(total - perf->total_last);
+    }
+    perf->task_last = task;
+    perf->total_last = total;
+#endif
+}
+
+static void _udp_music_perf_log(udp_music_player_perf_t* perf)
+{
+    _udp_music_perf_sample(perf, false);
+    int64_t play_ms = (esp_timer_get_time() - perf->start_us) / 1000;
+    printf("## udp music player setup=%dms, first frame=%dms, wakeups=%d in %dms", perf->setup_ms, perf->first_frame_ms,
+        (int)perf->wakeups, (int)play_ms);
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    if(perf->total_time) {
+        printf(", player cpu=%d.%02d%%", (int)(perf->task_time * 100 / perf->total_time), (int)(perf->task_time * 10000 / perf->total_time % 100));
+    }
+#endif
+    printf("\n");
+}
+
+static void _udp_music_player_wakeup(void);
 
 // music player status
 #define UDP_MUSIC_STATUS_START  (BIT0)
@@ -68,6 +113,8 @@ typedef struct {
     int       bit_rate;
     int       buff_size;
     int       fill_size;
+    int       frame; // 0:raw datagram, 1:sequence/timestamp header, reordered by the udp_stream jitter buffer
+    int       fec; // 0:off, 2~16: one XOR parity datagram per fec datagrams, needs frame
 } udp_music_play_t;
 
 typedef struct {
@@ -83,6 +130,7 @@ typedef struct {
     udp_music_get_volume_t get_volume;
     udp_music_event_cb_t event_cb;
     EventGroupHandle_t  status;
+    audio_event_iface_handle_t player_evt; // listener of the running player, woken on stop/break
 } udp_music_desc_t;
 
 static udp_music_desc_t s_desc;
@@ -541,6 +589,7 @@ esp_err_t udp_music_stop(uint32_t timeout)
 {
     ESP_LOGW(TAG, "udp music stop, timeout=%d", timeout);
     _udp_music_set_status(UDP_MUSIC_STATUS_STOP, true);
+    _udp_music_player_wakeup();
     return udp_music_wait_idle(timeout);
 }
 
@@ -660,34 +709,260 @@ static void udp_msg_task(void* arg)
     vTaskDelete(NULL);
 }
 
-static esp_err_t _udp_music_pipline_break(audio_pipeline_handle_t pipline, audio_element_handle_t i2s_stream)
+// pipeline kept between tracks, only rebuilt when the stream layout changes
+typedef struct {
+    audio_board_handle_t        board;
+    audio_pipeline_handle_t     pipeline;
+    audio_element_handle_t      udp_stream;
+    audio_element_handle_t      decoder_stream;
+    audio_element_handle_t      i2s_stream;
+    audio_event_iface_handle_t  evt;
+    udp_music_addr_t            addr; // udp_stream keeps a pointer to addr.ip
+    udp_music_play_t            play; // stream layout the pipeline was built for
+} udp_music_player_t;
+
+static void _udp_music_player_wakeup(void)
+{
+    _udp_music_lock();
+    if(s_desc.player_evt) {
+        audio_event_iface_msg_t msg = { 0 };
+        audio_event_iface_cmd(s_desc.player_evt, &msg);
+    }
+    _udp_music_unlock();
+}
+
+static void _udp_music_player_destroy(udp_music_player_t* player)
 {
-    if(pipline == NULL || i2s_stream == NULL) {
+    _udp_music_lock();
+    s_desc.player_evt = NULL;
+    _udp_music_unlock();
+    if(player->pipeline) {
+        audio_pipeline_stop(player->pipeline);
+        audio_pipeline_wait_for_stop(player->pipeline);
+        audio_pipeline_terminate(player->pipeline);
+        audio_pipeline_remove_listener(player->pipeline);
+        audio_pipeline_unregister(player->pipeline, player->udp_stream);
+        audio_pipeline_unregister(player->pipeline, player->decoder_stream);
+        audio_pipeline_unregister(player->pipeline, player->i2s_stream);
+        audio_pipeline_deinit(player->pipeline);
+    }
+    if(player->evt) {
+        audio_event_iface_destroy(player->evt);
+    }
+    if(player->udp_stream) {
+        audio_element_deinit(player->udp_stream);
+    }
+    if(player->decoder_stream) {
+        audio_element_deinit(player->decoder_stream);
+    }
+    if(player->i2s_stream) {
+        audio_element_deinit(player->i2s_stream);
+    }
+    if(player->board) {
+        audio_board_deinit(player->board);
+    }
+    memset(player, 0, sizeof(udp_music_player_t));
+}
+
+static bool _udp_music_player_reusable(udp_music_player_t* player, udp_music_addr_t* addr, udp_music_play_t* play)
+{
+    // rate and channel only need a new i2s clock, bits also picks the conceal mode of the udp stream
+    return player->pipeline && (player->play.format == play->format) && (player->play.frame == play->frame) && \
+        (player->play.fec == play->fec) && (player->play.bit_rate == play->bit_rate) && (player->play.bits == play->bits) && \
+        (strcmp(player->addr.ip, addr->ip) == 0) && (player->addr.port == addr->port);
+}
+
+static esp_err_t _udp_music_player_create(udp_music_player_t* player, udp_music_addr_t* addr, udp_music_play_t* play)
+{
+    player->addr = *addr;
+    player->play = *play;
+    player->board = audio_board_init();
+    if(player->board == NULL) {
+        ESP_LOGE(TAG, "(%s) audio board init failed!", __func__);
+        _udp_music_proto_notify_status(1, "播放器初始化失败");
         return ESP_FAIL;
     }
-    audio_pipeline_stop(pipline);
-    audio_pipeline_wait_for_stop(pipline);
-    audio_pipeline_reset_elements(pipline);
-    audio_pipeline_reset_ringbuffer(pipline);
-    udp_music_play_t play = _udp_music_get_play_info();
-    i2s_stream_set_clk(i2s_stream, play.rate, play.bits, play.channel);
-    audio_pipeline_run(pipline);
+    audio_hal_ctrl_codec(player->board->audio_hal, AUDIO_HAL_CODEC_MODE_BOTH, AUDIO_HAL_CTRL_START);
+    audio_hal_enable_pa(player->board->audio_hal, false);
+
+    udp_stream_cfg_t udp_cfg = UDP_STREAM_CFG_DEFAULT();
+    udp_cfg.task_core = 1;
+    udp_cfg.task_prio = 21;
+    udp_cfg.host = player->addr.ip;
+    udp_cfg.port = player->addr.port;
+    udp_cfg.use_mreq = _udp_music_is_multicast_ip(player->addr.ip) == ESP_OK;
+    udp_cfg.timeout_ms = UDP_MUSIC_PLAYER_TIMEOUT;
+    udp_cfg.out_rb_size = play->buff_size;
+    udp_cfg.batch_read = true;
+    udp_cfg.rcvbuf_size = UDP_MUSIC_PLAYER_RCVBUF_SIZE;
+    udp_cfg.framing = play->frame == 1;
+    udp_cfg.fec_group = play->fec;
+    if(play->format == 0) { // mp3 frames span datagrams, skip lost ones and let the decoder resync
+        udp_cfg.conceal = UDP_JITTER_CONCEAL_NONE;
+    } else {
+        udp_cfg.conceal = (play->bits == 16) ? UDP_JITTER_CONCEAL_FADE : UDP_JITTER_CONCEAL_REPEAT;
+    }
+    player->udp_stream = udp_stream_init(&udp_cfg);
+    if(player->udp_stream == NULL) {
+        ESP_LOGE(TAG, "(%s) udp stream init failed!", __func__);
+        _udp_music_proto_notify_status(1, "reader创建失败");
+        return ESP_FAIL;
+    }
+    if(play->format == 1) { // wav
+        wav_decoder_cfg_t wav_cfg = DEFAULT_WAV_DECODER_CONFIG();
+        wav_cfg.task_core = 1;
+        wav_cfg.task_prio = 22;
+        player->decoder_stream = wav_decoder_init(&wav_cfg);
+    } else if(play->format == 2) { // pcm
+        pcm_decoder_cfg_t pcm_cfg = DEFAULT_PCM_DECODER_CONFIG();
+        pcm_cfg.task_core = 1;
+        pcm_cfg.task_prio = 22;
+        player->decoder_stream = pcm_decoder_init(&pcm_cfg);
+    } else { // mp3
+        mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
+        mp3_cfg.task_core = 1;
+        mp3_cfg.task_prio = 22;
+        player->decoder_stream = mp3_decoder_init(&mp3_cfg);
+    }
+    if(player->decoder_stream == NULL) {
+        ESP_LOGE(TAG, "(%s) decoder init failed!", __func__);
+        _udp_music_proto_notify_status(1, "decoder创建失败");
+        return ESP_FAIL;
+    }
+
+    i2s_stream_cfg_t i2s_cfg = I2S_STREAM_CFG_DEFAULT();
+    i2s_cfg.task_core = 1;
+    i2s_cfg.task_prio = 23;
+    i2s_cfg.type = AUDIO_STREAM_WRITER;
+    i2s_cfg.i2s_config.sample_rate = play->rate;
+    i2s_cfg.i2s_config.channel_format = (play->channel == 2) ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_LEFT;
+    i2s_cfg.i2s_config.bits_per_sample = play->bits;
+    player->i2s_stream = i2s_stream_init(&i2s_cfg);
+    if(player->i2s_stream == NULL) {
+        ESP_LOGE(TAG, "(%s) i2s stream init failed!", __func__);
+        _udp_music_proto_notify_status(1, "writer创建失败");
+        return ESP_FAIL;
+    }
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    player->pipeline = audio_pipeline_init(&pipeline_cfg);
+    if(player->pipeline == NULL) {
+        ESP_LOGE(TAG, "(%s) pipeline init failed!", __func__);
+        _udp_music_proto_notify_status(1, "pipeline创建失败");
+        return ESP_FAIL;
+    }
+    audio_pipeline_register(player->pipeline, player->udp_stream, "udp_stream");
+    audio_pipeline_register(player->pipeline, player->decoder_stream, "decoder_stream");
+    audio_pipeline_register(player->pipeline, player->i2s_stream, "i2s_stream");
+
+    const char *link_tag[3] = {"udp_stream", "decoder_stream", "i2s_stream"};
+    if(audio_pipeline_link(player->pipeline, &link_tag[0], 3) != ESP_OK) {
+        ESP_LOGE(TAG, "(%s) pipeline link failed!", __func__);
+        _udp_music_proto_notify_status(1, "pipeline连接失败");
+        return ESP_FAIL;
+    }
+
+    // element status reports and stop/break wakeups arrive here
+    audio_event_iface_cfg_t evt_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+    player->evt = audio_event_iface_init(&evt_cfg);
+    if(player->evt == NULL) {
+        ESP_LOGE(TAG, "(%s) event iface init failed!", __func__);
+        _udp_music_proto_notify_status(1, "pipeline创建失败");
+        return ESP_FAIL;
+    }
+    audio_pipeline_set_listener(player->pipeline, player->evt);
+    _udp_music_lock();
+    s_desc.player_evt = player->evt;
+    _udp_music_unlock();
     return ESP_OK;
 }
 
+// reuse the stopped pipeline of the previous track, rebuild it when the layout changed or it is cold
+static esp_err_t _udp_music_player_start(udp_music_player_t* player, udp_music_addr_t* addr, udp_music_play_t* play)
+{
+    if(_udp_music_player_reusable(player, addr, play)) {
+        audio_event_iface_msg_t msg = { 0 };
+        while(audio_event_iface_listen(player->evt, &msg, 0) == ESP_OK); // reports of the previous track
+        audio_pipeline_reset_elements(player->pipeline);
+        audio_pipeline_reset_ringbuffer(player->pipeline);
+        i2s_stream_set_clk(player->i2s_stream, play->rate, play->bits, play->channel);
+        player->play = *play;
+    } else {
+        _udp_music_player_destroy(player);
+        if(_udp_music_player_create(player, addr, play) != ESP_OK) {
+            _udp_music_player_destroy(player);
+            return ESP_FAIL;
+        }
+    }
+    audio_hal_set_volume(player->board->audio_hal, _udp_music_get_volume());
+    if(audio_pipeline_run(player->pipeline) != ESP_OK) {
+        ESP_LOGE(TAG, "(%s) pipeline run failed!", __func__);
+        _udp_music_proto_notify_status(1, "pipeline启动失败");
+        _udp_music_player_destroy(player);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void _udp_music_player_stop(udp_music_player_t* player)
+{
+    if(player->pipeline == NULL) {
+        return;
+    }
+    audio_hal_enable_pa(player->board->audio_hal, false);
+    audio_pipeline_stop(player->pipeline);
+    audio_pipeline_wait_for_stop(player->pipeline);
+#if !UDP_MUSIC_PLAYER_WARM_TIME
+    _udp_music_player_destroy(player);
+#endif
+}
+
+// 0: keep playing, 1: track finished or stopped, 2: break for a higher level start
+static int _udp_music_player_check(udp_music_player_t* player)
+{
+    if(_udp_music_get_status(UDP_MUSIC_STATUS_BREAK, 0) == ESP_OK) {
+        printf("udp music player break\n");
+        return 2;
+    }
+    if(_udp_music_get_status(UDP_MUSIC_STATUS_STOP, 0) == ESP_OK) {
+        printf("udp music player stop\n");
+        return 1;
+    }
+    audio_element_state_t state = audio_element_get_state(player->i2s_stream);
+    if(state >= AEL_STATE_STOPPED) {
+        printf("i2s stream stop, state = %d\n", state);
+        return 1;
+    }
+    state = audio_element_get_state(player->udp_stream);
+    if(state >= AEL_STATE_ERROR) {
+        printf("udp stream stop, state = %d\n", state);
+        return 1;
+    }
+    return 0;
+}
+
 static void udp_player_task(void* arg)
 {
     ESP_LOGI(TAG, "udp music player task start!");
-    esp_err_t err = ESP_OK;
+    udp_music_player_t player = { 0 };
     while(1) {
         _udp_music_set_status(UDP_MUSIC_STATUS_STOP, false);
         _udp_music_set_status(UDP_MUSIC_STATUS_BUSY, false);
-        if(_udp_music_get_status(UDP_MUSIC_STATUS_START, portMAX_DELAY) != ESP_OK) {
-            ESP_LOGE(TAG, "udp music get start failed!");
+        // a warm pipeline is released when no start arrives in time
+        uint32_t wait = player.pipeline ? UDP_MUSIC_PLAYER_WARM_TIME : portMAX_DELAY;
+        if(_udp_music_get_status(UDP_MUSIC_STATUS_START, wait) != ESP_OK) {
+            if(player.pipeline) {
+                ESP_LOGI(TAG, "udp music player idle, release the warm pipeline");
+                _udp_music_player_destroy(&player);
+            } else {
+                ESP_LOGE(TAG, "udp music get start failed!");
+            }
             continue;
         }
+        udp_music_player_perf_t perf = { .start_us = esp_timer_get_time(), .first_frame_ms = -1 };
         _udp_music_set_status(UDP_MUSIC_STATUS_BUSY, true);
         _udp_music_set_status(UDP_MUSIC_STATUS_STOP, false);
+        _udp_music_set_status(UDP_MUSIC_STATUS_BREAK, false);
         _udp_music_set_status(UDP_MUSIC_STATUS_START, false);
         udp_music_addr_t addr = { 0 };
         _udp_music_get_music_addr(addr.ip, &addr.port);
@@ -711,161 +986,58 @@ static void udp_player_task(void* arg)
             _udp_music_proto_notify_status(1, res);
             continue;
         }
-        
-        _udp_music_proto_notify_status(0, "资源初始化");
-
-        audio_element_handle_t udp_stream = NULL, decoder_stream = NULL, i2s_stream = NULL;
-        audio_pipeline_handle_t pipeline = NULL;
-        audio_board_handle_t board_handle = audio_board_init();
-        if(board_handle == NULL) {
-            ESP_LOGE(TAG, "(%s) audio board init failed!", __func__);
-            _udp_music_proto_notify_status(1, "播放器初始化失败");
-            goto _finish;
-        }
-        audio_hal_ctrl_codec(board_handle->audio_hal, AUDIO_HAL_CODEC_MODE_BOTH, AUDIO_HAL_CTRL_START);
-        audio_hal_enable_pa(board_handle->audio_hal, false);
-        audio_hal_set_volume(board_handle->audio_hal, _udp_music_get_volume());
-
-        udp_stream_cfg_t udp_cfg = UDP_STREAM_CFG_DEFAULT();
-        udp_cfg.task_core = 1;
-        udp_cfg.task_prio = 21;
-        udp_cfg.host = addr.ip;
-        udp_cfg.port = addr.port;
-        udp_cfg.use_mreq = _udp_music_is_multicast_ip(addr.ip) == ESP_OK;
-        udp_cfg.timeout_ms = UDP_MUSIC_PLAYER_TIMEOUT;
-        udp_cfg.out_rb_size = play.buff_size;
-        udp_stream = udp_stream_init(&udp_cfg);
-        if(udp_stream == NULL) {
-            ESP_LOGE(TAG, "(%s) udp stream init failed!", __func__);
-            _udp_music_proto_notify_status(1, "reader创建失败");
-            goto _finish;
-        }
-        if(play.format == 1) { // wav
-            wav_decoder_cfg_t wav_cfg = DEFAULT_WAV_DECODER_CONFIG();
-            wav_cfg.task_core = 1;
-            wav_cfg.task_core = 22;
-            decoder_stream = wav_decoder_init(&wav_cfg);
-        } else if(play.format == 2) { // pcm
-            pcm_decoder_cfg_t pcm_cfg = DEFAULT_PCM_DECODER_CONFIG();
-            pcm_cfg.task_core = 1;
-            pcm_cfg.task_prio = 22;
-            decoder_stream = pcm_decoder_init(&pcm_cfg);
-        } else { // mp3
-            mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
-            mp3_cfg.task_core = 1;
-            mp3_cfg.task_prio = 22;
-            decoder_stream = mp3_decoder_init(&mp3_cfg);
-        }
-        if(decoder_stream == NULL) {
-            ESP_LOGE(TAG, "(%s) decoder init failed!", __func__);
-            _udp_music_proto_notify_status(1, "decoder创建失败");
-            goto _finish;
-        }
-
-        i2s_stream_cfg_t i2s_cfg = I2S_STREAM_CFG_DEFAULT();
-        i2s_cfg.task_core = 1; 
-        i2s_cfg.task_prio = 23;
-        i2s_cfg.type = AUDIO_STREAM_WRITER;
-        i2s_cfg.i2s_config.sample_rate = play.rate;
-        i2s_cfg.i2s_config.channel_format = (play.channel == 2) ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_LEFT;
-        i2s_cfg.i2s_config.bits_per_sample = play.bits;
-        i2s_stream = i2s_stream_init(&i2s_cfg);
-        if(i2s_stream == NULL) {
-            ESP_LOGE(TAG, "(%s) i2s stream init failed!", __func__);
-            _udp_music_proto_notify_status(1, "writer创建失败");
-            goto _finish;
-        }
 
-        audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
-        pipeline = audio_pipeline_init(&pipeline_cfg);
-        if(pipeline == NULL) {
-            ESP_LOGE(TAG, "(%s) pipeline init failed!", __func__);
-            _udp_music_proto_notify_status(1, "pipeline创建失败");
-            goto _finish;
-        }
-        audio_pipeline_register(pipeline, udp_stream, "udp_stream");
-        audio_pipeline_register(pipeline, decoder_stream, "decoder_stream");
-        audio_pipeline_register(pipeline, i2s_stream, "i2s_stream");
-
-        const char *link_tag[3] = {"udp_stream", "decoder_stream", "i2s_stream"};
-        err = audio_pipeline_link(pipeline, &link_tag[0], 3);
-        if(err != ESP_OK) {
-            ESP_LOGE(TAG, "(%s) pipeline link failed!", __func__);
-            _udp_music_proto_notify_status(1, "pipeline连接失败");
-            goto _finish;
-        }
-        err = audio_pipeline_run(pipeline);
-        if(err != ESP_OK) {
-            ESP_LOGE(TAG, "(%s) pipeline run failed!", __func__);
-            _udp_music_proto_notify_status(1, "pipeline启动失败");
-            goto _finish;
+        _udp_music_proto_notify_status(0, "资源初始化");
+        bool warm = _udp_music_player_reusable(&player, &addr, &play);
+        if(_udp_music_player_start(&player, &addr, &play) != ESP_OK) {
+            _udp_music_event_cb(UDP_MUSIC_EVENT_TYPE_STOP, NULL);
+            continue;
         }
+        perf.setup_ms = (esp_timer_get_time() - perf.start_us) / 1000;
+        ESP_LOGI(TAG, "udp music player %s start, setup=%dms", warm ? "warm" : "cold", perf.setup_ms);
+        _udp_music_perf_sample(&perf, true);
 
         _udp_music_proto_notify_status(0, "正在播放");
-        audio_hal_enable_pa(board_handle->audio_hal, true);
-        audio_element_state_t state = AEL_STATE_NONE;
-        uint32_t state_ticks = 0;
-        while (1) {
-            if(_udp_music_get_status(UDP_MUSIC_STATUS_BREAK, 0) == ESP_OK) {
-                audio_hal_enable_pa(board_handle->audio_hal, false);
-                _udp_music_pipline_break(pipeline, i2s_stream);
-                audio_hal_enable_pa(board_handle->audio_hal, true);
-                _udp_music_set_status(UDP_MUSIC_STATUS_BREAK, false);
+        audio_hal_enable_pa(player.board->audio_hal, true);
+        bool first_frame = true;
+        int result = 0;
+        TickType_t sync_ticks = xTaskGetTickCount();
+        while((result = _udp_music_player_check(&player)) == 0) {
+            // sleep until an element reports, stop/break wakes the listener up or the next sync is due
+            TickType_t elapsed = xTaskGetTickCount() - sync_ticks;
+            TickType_t period = pdMS_TO_TICKS(UDP_MUSIC_PLAYER_SYNC_PERIOD);
+            audio_event_iface_msg_t msg = { 0 };
+            bool got = audio_event_iface_listen(player.evt, &msg, elapsed < period ? period - elapsed : 0) == ESP_OK;
+            perf.wakeups++;
+            if(got) {
+                if(first_frame && (msg.source == (void*)player.decoder_stream) && (msg.cmd == AEL_MSG_CMD_REPORT_MUSIC_INFO)) {
+                    perf.first_frame_ms = (esp_timer_get_time() - perf.start_us) / 1000;
+                    ESP_LOGI(TAG, "udp music player first frame %dms after start", perf.first_frame_ms);
+                    first_frame = false;
+                }
                 continue;
             }
-            state = audio_element_get_state(i2s_stream);
-            if(state >= AEL_STATE_STOPPED) {
-                printf("i2s stream stop, state = %d\n", state);
-                break;
-            }
-            state = audio_element_get_state(udp_stream);
-            if(state >= AEL_STATE_ERROR) {
-                printf("udp stream stop, state = %d\n", state);
-                break;
-            }
-            if(_udp_music_get_status(UDP_MUSIC_STATUS_STOP, 0) == ESP_OK) {
-                printf("udp music player stop\n");
-                break;
-            }
-            state_ticks++;
-            if((state_ticks % 5000) == 0) {
-                _udp_music_set_status(UDP_MUSIC_STATUS_SYNC, true);
-                play.fill_size = rb_bytes_filled(audio_element_get_output_ringbuf(udp_stream));
-                _udp_music_set_play_info(play);
-            }
-            vTaskDelay(1);
+            _udp_music_perf_sample(&perf, false);
+            _udp_music_set_status(UDP_MUSIC_STATUS_SYNC, true);
+            play.fill_size = rb_bytes_filled(audio_element_get_output_ringbuf(player.udp_stream));
+            _udp_music_set_play_info(play);
+            sync_ticks = xTaskGetTickCount();
         }
-        audio_hal_enable_pa(board_handle->audio_hal, false);
-        _udp_music_proto_notify_status(0, "播放结束");
-
-        if(udp_stream) {
-            printf("## udp stream read num=%d, read bytes=%d\n", udp_stream_get_read_num(udp_stream), udp_stream_get_read_bytes(udp_stream));
+        if(result == 1) {
+            _udp_music_proto_notify_status(0, "播放结束");
         }
+        _udp_music_perf_log(&perf);
 
-    _finish:
-        if(pipeline) {
-            audio_pipeline_stop(pipeline);
-            audio_pipeline_wait_for_stop(pipeline);
-            audio_pipeline_terminate(pipeline);
-            audio_pipeline_unregister(pipeline, udp_stream);
-            audio_pipeline_unregister(pipeline, decoder_stream);
-            audio_pipeline_unregister(pipeline, i2s_stream);
-            audio_pipeline_deinit(pipeline);
-        }
-        if(udp_stream) {
-            audio_element_deinit(udp_stream);
-        }
-        if(decoder_stream) {
-            audio_element_deinit(decoder_stream);
-        }
-        if(i2s_stream) {
-            audio_element_deinit(i2s_stream);
-        }
-        if(board_handle) {
-            audio_board_deinit(board_handle);
+        printf("## udp stream read num=%d, read bytes=%d, read calls=%d, rate=%d/s, latency=%dus\n", udp_stream_get_read_num(player.udp_stream), udp_stream_get_read_bytes(player.udp_stream),
+            udp_stream_get_read_call_num(player.udp_stream), udp_stream_get_datagram_rate(player.udp_stream), udp_stream_get_read_latency_us(player.udp_stream));
+        if(play.frame) {
+            printf("## udp stream lost=%d, late=%d, reorder=%d, conceal=%d, recover=%d, jitter=%dms\n", udp_stream_get_lost_num(player.udp_stream), udp_stream_get_late_num(player.udp_stream),
+                udp_stream_get_reorder_num(player.udp_stream), udp_stream_get_conceal_num(player.udp_stream), udp_stream_get_recover_num(player.udp_stream), udp_stream_get_jitter_ms(player.udp_stream));
         }
+        _udp_music_player_stop(&player);
         _udp_music_event_cb(UDP_MUSIC_EVENT_TYPE_STOP, NULL);
     }
+    _udp_music_player_destroy(&player);
     ESP_LOGW(TAG, "udp music player task exit!");
     vTaskDelete(NULL);
 }
@@ -958,69 +1130,29 @@ static esp_err_t _udp_music_proto_update_send_addr(cJSON* root)
     return ESP_OK;
 }
 
-static esp_err_t _udp_music_proto_mac_match(char* list)
-{
-    if(list == NULL) {
-        return ESP_FAIL;
-    }
-    cJSON* root = cJSON_Parse(list);
-    if(cJSON_IsArray(root) && cJSON_GetArraySize(root)) {
-        for(int i = 0; i < cJSON_GetArraySize(root); i++) {
-            char* mac = cJSON_GetStringValue(cJSON_GetArrayItem(root, i));
-            if(mac && strcmp(mac, _udp_music_get_mac()) == 0) {
-                cJSON_Delete(root);
-                ESP_LOGI(TAG, "mac match success.");
-                return ESP_OK;
-            }
-        }
-    }
-    cJSON_Delete(root);
-    ESP_LOGE(TAG, "(%s), mac match failed!", _udp_music_get_mac());
-    return ESP_FAIL;
-}
-
 static esp_err_t _udp_music_proto_mac_match_success(cJSON* root)
 {
-    esp_err_t ret = ESP_FAIL;
     if(root == NULL) {
-        return ret;
+        return ESP_FAIL;
     }
-    char* gzip_mac = cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetObjectItem(cJSON_GetObjectItem(root, "params"), "music"), "mac"));
-    if(gzip_mac == NULL) {
+    cJSON* music = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "params"), "music");
+    char* bin_mac = cJSON_GetStringValue(cJSON_GetObjectItem(music, "mac_bin"));
+    char* gzip_mac = cJSON_GetStringValue(cJSON_GetObjectItem(music, "mac"));
+    if(bin_mac == NULL && gzip_mac == NULL) {
         ESP_LOGE(TAG, "udp music mac is null!");
-        return ret;
-    }
-    int in_size = UDP_MUSIC_BASE64_BUF_SIZE;
-    int out_size = UDP_MUSIC_GZIP_BUF_SIZE;
-#if UDP_MUSIC_GZIP_BUF_PSRAM
-    uint8_t* in = (uint8_t*)heap_caps_malloc(in_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    uint8_t* out = (uint8_t*)heap_caps_malloc(out_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-#else
-    uint8_t* in = (uint8_t*)malloc(in_size);
-    uint8_t* out = (uint8_t*)malloc(out_size);
-#endif // UDP_MUSIC_GZIP_BUF_PSRAM
-    if(in == NULL || out == NULL) {
-        ESP_LOGE(TAG, "udp music gzip memory malloc failed!");
-        goto _exit;
-    }
-    int in_len = 0;
-    if(mbedtls_base64_decode(in, (size_t)in_size, (size_t*)&in_len, (uint8_t*)gzip_mac, (size_t)strlen(gzip_mac)) != 0) {
-        ESP_LOGE(TAG, "udp music gzip base64 decode failed, in: %s", gzip_mac);
-        goto _exit;
-    }
-    if(gzip_inflate(in, in_len, out, &out_size) != ESP_OK) {
-        ESP_LOGE(TAG, "udp music gzip inflate failed, in: %s", gzip_mac);
-        goto _exit;
+        return ESP_FAIL;
     }
-    out[out_size] = '\0'; // make string
-    // ESP_LOGI(TAG, "udp music gzip inflate success, mac list: %s", out);
-    ret = _udp_music_proto_mac_match((char*)out);
-_exit:
-    if(in) {
-        free(in);
+    char* self_str = _udp_music_get_mac();
+    uint8_t self[6];
+    if(udp_music_mac_parse(self_str, strlen(self_str), self) != ESP_OK) {
+        ESP_LOGE(TAG, "(%s), mac invalid!", self_str);
+        return ESP_FAIL;
     }
-    if(out) {
-        free(out);
+    esp_err_t ret = bin_mac ? udp_music_mac_bin_match(bin_mac, self) : udp_music_mac_match(gzip_mac, self);
+    if(ret == ESP_OK) {
+        ESP_LOGI(TAG, "mac match success.");
+    } else {
+        ESP_LOGE(TAG, "(%s), mac match failed!", self_str);
     }
     return ret;
 }
@@ -1143,6 +1275,16 @@ static esp_err_t udp_music_proto_start_handler(cJSON* root)
         return _udp_music_proto_response(root, UDP_MUSIC_PROTO_START, 1, "bit_rate不支持");
     }
     buff_size = UDP_MUSIC_PLAYER_MAX_BUF_SIZE + UDP_MUSIC_PLAYER_IDLE_BUF_SIZE;
+    cJSON* frame_item = cJSON_GetObjectItem(music, "frame"); // optional
+    int frame = cJSON_IsNumber(frame_item) ? frame_item->valueint : 0;
+    if(frame != 0 && frame != 1) {
+        return _udp_music_proto_response(root, UDP_MUSIC_PROTO_START, 1, "frame字段有误");
+    }
+    cJSON* fec_item = cJSON_GetObjectItem(music, "fec"); // optional
+    int fec = cJSON_IsNumber(fec_item) ? fec_item->valueint : 0;
+    if((fec != 0) && ((frame != 1) || (fec < UDP_FEC_MIN_GROUP) || (fec > UDP_FEC_MAX_GROUP))) {
+        return _udp_music_proto_response(root, UDP_MUSIC_PROTO_START, 1, "fec字段有误");
+    }
     int task_level = cJSON_GetNumberValue(cJSON_GetObjectItem(root, "task_level"));
     if(_udp_music_task_level_valid(task_level) != ESP_OK) {
         return _udp_music_proto_response(root, UDP_MUSIC_PROTO_START, 1, "task_level字段有误");
@@ -1161,9 +1303,10 @@ static esp_err_t udp_music_proto_start_handler(cJSON* root)
     _udp_music_proto_update_send_addr(root); // update send addr
     _udp_music_set_task_level(task_level); // set task level
     _udp_music_set_task_id(cJSON_GetStringValue(cJSON_GetObjectItem(root, "task_id")));
-    udp_music_play_t play = { .format = format, .rate = rate, .channel = channel, .bits = bits, .bit_rate = bit_rate, .buff_size = buff_size };
+    udp_music_play_t play = { .format = format, .rate = rate, .channel = channel, .bits = bits, .bit_rate = bit_rate, .buff_size = buff_size, .frame = frame, .fec = fec };
     _udp_music_set_play_info(play); // update play info
     _udp_music_set_status(UDP_MUSIC_STATUS_START, true);
+    _udp_music_player_wakeup(); // a pending break ends the current track
 
     return _udp_music_proto_response(root, UDP_MUSIC_PROTO_START, 0, "成功");
 }
@@ -1181,6 +1324,7 @@ static esp_err_t udp_music_proto_stop_handler(cJSON* root)
     }
 
     _udp_music_set_status(UDP_MUSIC_STATUS_STOP, true);
+    _udp_music_player_wakeup();
 
     // response
     return _udp_music_proto_response(root, UDP_MUSIC_PROTO_STOP, 0, "成功");
@@ -0,0 +1,144 @@
+#include "udp_music_mac.h"
+#include "udp_music.h"
+#include "string.h"
+#include "stdbool.h"
+
+#include "esp_log.h"
+
+#include "base64.h"
+#include "sys_conv.h"
+#include "gzip_inflate.h"
+
+static const char *TAG = "udp_music";
+
+// tokenizer state of the inflated json mac array, fed in arbitrary chunks
+typedef struct {
+    uint8_t     self[6];
+    uint8_t     mac[6];
+    int         nibbles;    // -1: current string is not a mac
+    bool        in_string;
+    bool        escape;
+    bool        matched;
+} udp_music_mac_match_t;
+
+// inflate window and state, ~43KB, kept static so matching a list never depends on a free heap block
+static gzip_inflate_t s_udp_music_mac_inflate;
+
+esp_err_t udp_music_mac_parse(const char* str, uint32_t len, uint8_t mac[6])
+{
+    int nibbles = 0;
+    for(uint32_t i = 0; i < len; i++) {
+        if(str[i] == ':' || str[i] == '-') {
+            continue;
+        }
+        int v = sys_conv_hexchar2int(str[i]);
+        if(v < 0 || nibbles >= 12) {
+            return ESP_FAIL;
+        }
+        mac[nibbles / 2] = (nibbles & 1) ? (mac[nibbles / 2] | v) : (v << 4);
+        nibbles++;
+    }
+    return (nibbles == 12) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t _udp_music_mac_match_out(uint8_t* data, uint32_t len, void* user_ctx)
+{
+    udp_music_mac_match_t* match = (udp_music_mac_match_t*)user_ctx;
+    for(uint32_t i = 0; i < len && !match->matched; i++) {
+        char c = (char)data[i];
+        if(!match->in_string) {
+            if(c == '"') {
+                match->in_string = true;
+                match->nibbles = 0;
+            }
+            continue;
+        }
+        if(match->escape) {
+            match->escape = false;
+            match->nibbles = -1;
+        } else if(c == '\\') {
+            match->escape = true;
+        } else if(c == '"') {
+            match->in_string = false;
+            match->matched = (match->nibbles == 12) && (memcmp(match->mac, match->self, 6) == 0);
+        } else if(match->nibbles >= 0 && c != ':' && c != '-') {
+            int v = sys_conv_hexchar2int(c);
+            if(v < 0 || match->nibbles >= 12) {
+                match->nibbles = -1;
+            } else {
+                int n = match->nibbles++;
+                match->mac[n / 2] = (n & 1) ? (match->mac[n / 2] | v) : (v << 4);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+// decoded, inflated and matched chunk by chunk, stops at the first match
+esp_err_t udp_music_mac_match(const char* gzip_mac, const uint8_t self[6])
+{
+    udp_music_mac_match_t match = { 0 };
+    gzip_inflate_handle_t inflate = &s_udp_music_mac_inflate;
+    if(gzip_mac == NULL || self == NULL) {
+        return ESP_FAIL;
+    }
+    memcpy(match.self, self, 6);
+    gzip_inflate_reset(inflate, _udp_music_mac_match_out, &match);
+    base64_dec_ctx dec;
+    base64_dec_init(&dec);
+    uint8_t buf[UDP_MUSIC_MAC_CHUNK_SIZE / 4 * 3];
+    size_t left = strlen(gzip_mac);
+    const uint8_t* src = (const uint8_t*)gzip_mac;
+    while(left && !match.matched) {
+        size_t n = (left < UDP_MUSIC_MAC_CHUNK_SIZE) ? left : UDP_MUSIC_MAC_CHUNK_SIZE;
+        size_t out_len = 0;
+        if(base64_dec_update(&dec, buf, sizeof(buf), &out_len, src, n) != 0) {
+            ESP_LOGE(TAG, "udp music mac base64 decode failed!");
+            return ESP_FAIL;
+        }
+        if(gzip_inflate_write(inflate, buf, out_len) != ESP_OK) {
+            ESP_LOGE(TAG, "udp music mac inflate failed!");
+            return ESP_FAIL;
+        }
+        src += n;
+        left -= n;
+    }
+    if(!match.matched && ((base64_dec_finish(&dec) != 0) || (gzip_inflate_finish(inflate) != ESP_OK))) {
+        ESP_LOGE(TAG, "udp music mac list truncated!");
+        return ESP_FAIL;
+    }
+    return match.matched ? ESP_OK : ESP_FAIL;
+}
+
+// every mac is 8 digits without padding, binary searched in place without decoding the whole list
+esp_err_t udp_music_mac_bin_match(const char* bin_mac, const uint8_t self[6])
+{
+    if(bin_mac == NULL || self == NULL) {
+        return ESP_FAIL;
+    }
+    size_t len = strlen(bin_mac);
+    if(len % 8) {
+        ESP_LOGE(TAG, "udp music mac_bin length invalid, len: %d", (int)len);
+        return ESP_FAIL;
+    }
+    size_t lo = 0, hi = len / 8;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint8_t mac[6];
+        size_t out_len = 0;
+        if(base64_decode(mac, sizeof(mac), &out_len, (const uint8_t*)bin_mac + mid * 8, 8) != 0 || out_len != 6) {
+            ESP_LOGE(TAG, "udp music mac_bin base64 decode failed!");
+            return ESP_FAIL;
+        }
+        int cmp = memcmp(mac, self, 6);
+        if(cmp == 0) {
+            return ESP_OK;
+        }
+        if(cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return ESP_FAIL;
+}
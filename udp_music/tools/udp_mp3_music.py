@@ -5,6 +5,7 @@ import json
 import gzip
 import base64
 import os
+import argparse
 from mutagen.mp3 import MP3
 
 def compress_mac_list(mac_list):
@@ -16,6 +17,43 @@ def compress_mac_list(mac_list):
     base64_str = base64.b64encode(compressed).decode('utf-8')
     return base64_str
 
+def pack_mac_list(mac_list):
+    # 每个MAC 6字节升序排列后转base64, 每个MAC正好8个字符, 接收端二分查找
+    macs = sorted(set(bytes.fromhex(mac.replace(':', '').replace('-', '')) for mac in mac_list))
+    return base64.b64encode(b''.join(macs)).decode('utf-8')
+
+# 帧头: 版本(0x80) | 类型 | 序号(16位) | 发送时间ms(32位), 大端
+FRAME_HEADER = struct.Struct('!BBHI')
+
+def pack_frame(seq, data, frame_type=0, flags=0):
+    ts = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    return FRAME_HEADER.pack(0x80 | flags, frame_type, seq & 0xFFFF, ts) + data
+
+class XorFec:
+    # 每group个数据包发送一个异或校验包, 接收端可恢复组内任意一个丢包
+    # 校验包: 类型1, 序号为组内首包序号, flags为组大小, 数据为长度异或(2字节) + 数据异或(按最长补零)
+    def __init__(self, group):
+        self.group = group
+        self.packets = []
+        self.base = 0
+
+    def add(self, seq, data):
+        if not self.packets:
+            self.base = seq
+        self.packets.append(data)
+        if len(self.packets) < self.group:
+            return None
+        size = max(len(p) for p in self.packets)
+        parity = bytearray(size)
+        len_xor = 0
+        for p in self.packets:
+            len_xor ^= len(p)
+            for i, b in enumerate(p):
+                parity[i] ^= b
+        count = len(self.packets)
+        self.packets = []
+        return pack_frame(self.base, struct.pack('!H', len_xor) + bytes(parity), 1, count)
+
 def send_start_multicast(multicast_group, port, json_data):
     # 创建UDP socket
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
@@ -38,7 +76,7 @@ def send_start_multicast(multicast_group, port, json_data):
         sock.close()
 
 
-def send_mp3_multicast(filename, multicast_group, port, chunk_size, cache_size, frame_delay):
+def send_mp3_multicast(filename, multicast_group, port, chunk_size, cache_size, frame_delay, framing=False, fec_group=0):
     # 创建UDP socket
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
     
@@ -48,6 +86,8 @@ def send_mp3_multicast(filename, multicast_group, port, chunk_size, cache_size,
     
     try:
         w_len = 0
+        seq = 0
+        fec = XorFec(fec_group) if framing and fec_group else None
         with open(filename, 'rb') as f:
             while True:
                 # 读取数据块
@@ -56,7 +96,14 @@ def send_mp3_multicast(filename, multicast_group, port, chunk_size, cache_size,
                     break
                     
                 # 发送数据到组播地址
-                sock.sendto(data, (multicast_group, port))
+                if framing:
+                    sock.sendto(pack_frame(seq, data), (multicast_group, port))
+                    parity = fec.add(seq, data) if fec else None
+                    if parity:
+                        sock.sendto(parity, (multicast_group, port))
+                    seq += 1
+                else:
+                    sock.sendto(data, (multicast_group, port))
                 
                 w_len += len(data)
                 if w_len > cache_size: # mp3
@@ -79,6 +126,15 @@ if __name__ == "__main__":
     #             "3c8427f2fcf0", "3c8427f0b3a0"]
     
     mac_list = ["e4b06385e750"]
+    # 新协议字段默认关闭, 与旧固件兼容, 接收端固件支持时再打开
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--framing", action="store_true", help="带序号帧头, 接收端重排并隐藏丢包")
+    parser.add_argument("--fec", type=int, default=0, help="每N个包一个校验包(8: 冗余12.5%%), 2~16, 需要--framing")
+    parser.add_argument("--mac-bin", action="store_true", help="mac_bin字段发送二进制MAC列表, 代替gzip的mac字段")
+    args = parser.parse_args()
+    FRAMING = args.framing
+    FEC_GROUP = args.fec if args.framing else 0
+    MAC_BINARY = args.mac_bin
     
     MP3_FILE = "lu.mp3"
     
@@ -95,8 +151,8 @@ if __name__ == "__main__":
     print(f"声道数: {audio.info.channels}")
     print(f"比特率: {audio.info.bitrate}")
     
-    # 压缩MAC列表
-    compressed_mac = compress_mac_list(mac_list)
+    # MAC列表
+    mac_field = ("mac_bin", pack_mac_list(mac_list)) if MAC_BINARY else ("mac", compress_mac_list(mac_list))
     
     # 构建JSON数据
     start_json = {
@@ -111,7 +167,9 @@ if __name__ == "__main__":
                 "channel": audio.info.channels,  # 声道数
                 "bits": 16,  # MP3通常是16位
                 "bit_rate": audio.info.bitrate,  # 比特率
-                "mac": compressed_mac
+                mac_field[0]: mac_field[1],
+                "frame": 1 if FRAMING else 0,
+                "fec": FEC_GROUP if FRAMING else 0
             },
             "response": {
                 "ip": "192.168.1.121",
@@ -136,5 +194,5 @@ if __name__ == "__main__":
     frame_delay = (audio.info.length - 15) * 1.0 / ((file_size - cache_size) / 512.0) #实际, 略快于5秒, 防止后续播放断断续续
     print(f"缓冲数据: {cache_size}字节, 帧间间隔: {frame_delay:.4f}秒")
     print(f"开始发送MP3文件到 {MULTICAST_GROUP}:{PORT}")
-    send_mp3_multicast(MP3_FILE, MULTICAST_GROUP, PORT, 512, cache_size, frame_delay)
+    send_mp3_multicast(MP3_FILE, MULTICAST_GROUP, PORT, 512, cache_size, frame_delay, FRAMING, FEC_GROUP)
     print("发送完成") 
\ No newline at end of file
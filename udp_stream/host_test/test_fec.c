@@ -0,0 +1,151 @@
+// host test of the udp_fec parity and its recovery in udp_jitter, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "udp_jitter.h"
+#include "udp_fec.h"
+#include "test_net.h"
+
+#define GROUP   (4)
+
+static int s_fail;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static int put(udp_jitter_handle_t jitter, uint16_t seq, uint32_t now)
+{
+    uint8_t buf[UDP_FRAME_HEADER_SIZE + TEST_NET_PAYLOAD];
+    int len = test_net_media(seq, seq * 20, buf);
+    return udp_jitter_put(jitter, buf, len, now);
+}
+
+// parity of the group starting at base
+static int put_parity(udp_jitter_handle_t jitter, uint16_t base, uint32_t now)
+{
+    udp_fec_enc_t enc;
+    udp_fec_enc_init(&enc, GROUP);
+    uint8_t buf[UDP_FRAME_HEADER_SIZE + UDP_FEC_PARITY_HEADER_SIZE + TEST_NET_PAYLOAD];
+    for(int i = 0; i < GROUP; i++) {
+        int len = test_net_media(base + i, (base + i) * 20, buf);
+        udp_fec_enc_add(&enc, base + i, buf + UDP_FRAME_HEADER_SIZE, len - UDP_FRAME_HEADER_SIZE);
+    }
+    int len = udp_fec_enc_pack(&enc, (base + GROUP - 1) * 20, buf, sizeof(buf));
+    return udp_jitter_put(jitter, buf, len, now);
+}
+
+static int get(udp_jitter_handle_t jitter, uint32_t now)
+{
+    uint8_t out[TEST_NET_PAYLOAD];
+    int len = udp_jitter_get(jitter, out, sizeof(out), now);
+    return len > 0 ? test_net_payload_seq(out, len) : -1;
+}
+
+static udp_jitter_handle_t create(void)
+{
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    cfg.fec_group = GROUP;
+    return udp_jitter_create(&cfg);
+}
+
+static void test_reorder_not_rebuilt(void)
+{
+    printf("reordered packet after its parity\n");
+    udp_jitter_handle_t jitter = create();
+    CHECK(put(jitter, 0, 0) == 0);
+    CHECK(put(jitter, 1, 20) == 0);
+    CHECK(put(jitter, 3, 60) == 0);
+    CHECK(put_parity(jitter, 0, 61) == 0);
+    CHECK(get(jitter, 61) == 0);
+    CHECK(get(jitter, 61) == 1);
+    CHECK(get(jitter, 61) == -1);   // 2 is missing but not lost yet, the parity is kept
+    CHECK(put(jitter, 2, 70) == 0);
+    CHECK(get(jitter, 70) == 2);
+    CHECK(get(jitter, 70) == 3);
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.recovered == 0 && stats.reordered == 1 && stats.duplicated == 0 && stats.lost == 0);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_loss_rebuilt(void)
+{
+    printf("lost packet rebuilt, original late\n");
+    udp_jitter_handle_t jitter = create();
+    CHECK(put(jitter, 0, 0) == 0);
+    CHECK(put(jitter, 1, 20) == 0);
+    CHECK(put(jitter, 3, 60) == 0);
+    CHECK(put_parity(jitter, 0, 61) == 0);
+    CHECK(get(jitter, 61) == 0);
+    CHECK(get(jitter, 61) == 1);
+    CHECK(get(jitter, 61) == -1);
+    int wait = udp_jitter_wait_ms(jitter, 61);
+    CHECK(wait > 200);              // the parity wait covers the group
+    CHECK(get(jitter, 61 + wait) == 2);
+    CHECK(get(jitter, 61 + wait) == 3);
+    CHECK(put(jitter, 2, 61 + wait) == -1);
+    CHECK(put(jitter, 4, 80 + wait) == 0);
+    CHECK(get(jitter, 80 + wait) == 4);
+    CHECK(put(jitter, 2, 81 + wait) == -1);
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.recovered == 1 && stats.lost == 0 && stats.duplicated == 2 && stats.late == 0);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_two_lost(void)
+{
+    printf("two lost in a group\n");
+    udp_jitter_handle_t jitter = create();
+    CHECK(put(jitter, 0, 0) == 0);
+    CHECK(put(jitter, 3, 60) == 0);
+    CHECK(put_parity(jitter, 0, 61) == 0);
+    CHECK(get(jitter, 61) == 0);
+    CHECK(get(jitter, 1000) == 3);  // no concealment, 1 and 2 are skipped
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.recovered == 0 && stats.lost == 2);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_network(double loss, int jitter_ms, int group)
+{
+    printf("network, loss %.0f%%, jitter %dms, group %d\n", loss * 100, jitter_ms, group);
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    cfg.fec_group = group;
+    udp_jitter_handle_t jitter = udp_jitter_create(&cfg);
+    test_net_t net;
+    test_net_init(&net, 10000, 20, loss, jitter_ms, group, 1);
+    test_net_result_t res;
+    test_net_run(&net, jitter, &res);
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    printf("  sent %d, dropped %d, played %d, lost %u, recovered %u, late %u, duplicated %u, depth %u, first frame %dms\n",
+        net.sent, net.dropped, res.played, stats.lost, stats.recovered, stats.late, stats.duplicated, stats.depth, res.first_ms);
+    CHECK(res.out_of_order == 0 && res.corrupt == 0);
+    // the first packet plays at once, the depth adapts afterwards
+    CHECK(res.first_ms >= 0 && res.first_ms <= net.interval);
+    CHECK(res.played + (int)stats.lost == net.sent);
+    CHECK((int)stats.parity <= net.parity);
+    // every dropped packet is rebuilt or lost, a rebuilt one that still arrives is a duplicate
+    CHECK(stats.lost + stats.recovered == net.dropped + stats.late + stats.duplicated);
+    if(loss == 0) {
+        CHECK(stats.recovered == 0 && stats.lost == 0);
+    } else {
+        // single losses are repaired, what remains is mostly two losses in one group
+        CHECK(stats.lost < net.dropped * group * (group + 1) * loss + 5);
+    }
+    udp_jitter_destroy(jitter);
+    test_net_free(&net);
+}
+
+int main(void)
+{
+    test_reorder_not_rebuilt();
+    test_loss_rebuilt();
+    test_two_lost();
+    test_network(0, 60, 4);
+    test_network(0.02, 20, 4);
+    test_network(0.05, 60, 8);
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+// host test of the udp_jitter reorder buffer, see Makefile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "udp_jitter.h"
+#include "test_net.h"
+
+static int s_fail;
+
+#define CHECK(cond) do { if(!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } } while(0)
+
+static int put(udp_jitter_handle_t jitter, uint16_t seq, uint32_t ts, uint32_t now)
+{
+    uint8_t buf[UDP_FRAME_HEADER_SIZE + TEST_NET_PAYLOAD];
+    int len = test_net_media(seq, ts, buf);
+    return udp_jitter_put(jitter, buf, len, now);
+}
+
+// payload sequence of the next frame, -1: nothing ready
+static int get(udp_jitter_handle_t jitter, uint32_t now)
+{
+    uint8_t out[TEST_NET_PAYLOAD];
+    int len = udp_jitter_get(jitter, out, sizeof(out), now);
+    return len > 0 ? test_net_payload_seq(out, len) : -1;
+}
+
+static void test_in_order(void)
+{
+    printf("in order\n");
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    udp_jitter_handle_t jitter = udp_jitter_create(&cfg);
+    for(int i = 0; i < 100; i++) {
+        CHECK(put(jitter, 65500 + i, i * 20, i * 20) == 0); // wraps the 16 bits sequence
+        CHECK(get(jitter, i * 20) == (uint16_t)(65500 + i));
+    }
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.received == 100 && stats.lost == 0 && stats.reordered == 0);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_reorder_duplicate(void)
+{
+    printf("reorder, duplicate\n");
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    udp_jitter_handle_t jitter = udp_jitter_create(&cfg);
+    CHECK(put(jitter, 0, 0, 0) == 0);
+    CHECK(put(jitter, 2, 40, 40) == 0);
+    CHECK(get(jitter, 40) == 0);
+    CHECK(get(jitter, 40) == -1);       // 1 is missing, the buffer waits
+    CHECK(put(jitter, 1, 20, 45) == 0);
+    CHECK(put(jitter, 1, 20, 46) == -1); // duplicate
+    CHECK(get(jitter, 46) == 1);
+    CHECK(get(jitter, 46) == 2);
+    CHECK(put(jitter, 0, 0, 50) == -1);  // late
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.reordered == 1 && stats.duplicated == 1 && stats.late == 1 && stats.lost == 0);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_loss_conceal(void)
+{
+    printf("loss, conceal\n");
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    cfg.conceal = UDP_JITTER_CONCEAL_REPEAT;
+    udp_jitter_handle_t jitter = udp_jitter_create(&cfg);
+    CHECK(put(jitter, 0, 0, 0) == 0);
+    CHECK(get(jitter, 0) == 0);
+    CHECK(put(jitter, 2, 40, 40) == 0);
+    CHECK(get(jitter, 40) == -1);
+    CHECK(udp_jitter_wait_ms(jitter, 40) == cfg.max_delay_ms);
+    CHECK(get(jitter, 40 + cfg.max_delay_ms) == 0); // 1 declared lost, frame 0 repeated
+    CHECK(get(jitter, 40 + cfg.max_delay_ms) == 2);
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.lost == 1 && stats.concealed == 1);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_resync(void)
+{
+    printf("resync\n");
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    udp_jitter_handle_t jitter = udp_jitter_create(&cfg);
+    CHECK(put(jitter, 0, 0, 0) == 0);
+    CHECK(get(jitter, 0) == 0);
+    CHECK(put(jitter, 30000, 20, 20) == -1); // one far packet is dropped
+    CHECK(put(jitter, 30001, 40, 40) == 0);  // the second one restarts the stream
+    CHECK(get(jitter, 40) == 30001);
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    CHECK(stats.resync == 1);
+    udp_jitter_destroy(jitter);
+}
+
+static void test_network(double loss, int jitter_ms)
+{
+    printf("network, loss %.0f%%, jitter %dms\n", loss * 100, jitter_ms);
+    udp_jitter_cfg_t cfg = UDP_JITTER_CFG_DEFAULT();
+    udp_jitter_handle_t jitter = udp_jitter_create(&cfg);
+    test_net_t net;
+    test_net_init(&net, 10000, 20, loss, jitter_ms, 0, 1);
+    test_net_result_t res;
+    test_net_run(&net, jitter, &res);
+    udp_jitter_stats_t stats;
+    udp_jitter_get_stats(jitter, &stats);
+    printf("  sent %d, dropped %d, played %d, lost %u, late %u, reordered %u, depth %u, jitter %ums, first frame %dms\n",
+        net.sent, net.dropped, res.played, stats.lost, stats.late, stats.reordered, stats.depth, stats.jitter_ms, res.first_ms);
+    CHECK(res.out_of_order == 0 && res.corrupt == 0);
+    // the first packet plays at once, the depth adapts afterwards
+    CHECK(res.first_ms >= 0 && res.first_ms <= net.interval);
+    CHECK(res.played + (int)stats.lost == net.sent);
+    // a packet declared lost before it arrived is lost and late
+    CHECK(stats.lost == net.dropped + stats.late && stats.duplicated == 0);
+    CHECK((int)stats.late <= net.dropped / 2 + 5);
+    udp_jitter_destroy(jitter);
+    test_net_free(&net);
+}
+
+int main(void)
+{
+    test_in_order();
+    test_reorder_duplicate();
+    test_loss_conceal();
+    test_resync();
+    test_network(0, 0);
+    test_network(0.02, 20);
+    test_network(0.05, 60);
+    printf(s_fail ? "%d FAILED\n" : "all passed\n", s_fail);
+    return s_fail ? 1 : 0;
+}
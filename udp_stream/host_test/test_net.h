@@ -0,0 +1,160 @@
+#ifndef __TEST_NET_H__
+#define __TEST_NET_H__
+
+// lossy, jittery network between a udp_fec sender and a udp_jitter reader, host tests only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "udp_jitter.h"
+#include "udp_fec.h"
+
+#define TEST_NET_PAYLOAD    (160)
+
+typedef struct {
+    uint32_t    send;       // ms
+    uint32_t    arrival;    // ms, 0xffffffff: dropped
+    int         len;
+    uint8_t     data[UDP_FRAME_HEADER_SIZE + UDP_FEC_PARITY_HEADER_SIZE + TEST_NET_PAYLOAD];
+} test_net_packet_t;
+
+typedef struct {
+    test_net_packet_t   *packets;
+    int                 num;
+    int                 sent;       // media packets
+    int                 dropped;    // media packets dropped by the network
+    int                 parity;
+    int                 interval;
+    uint32_t            rand;
+} test_net_t;
+
+typedef struct {
+    int played;
+    int out_of_order;
+    int corrupt;
+    int first_ms;   // first arrival to the first played frame, the jitter buffer share of start latency
+} test_net_result_t;
+
+static inline uint32_t test_net_rand(test_net_t *net)
+{
+    net->rand = net->rand * 1103515245u + 12345u;
+    return net->rand >> 8;
+}
+
+// media payload: 16 bits sequence + bytes derived from it, the length varies with the sequence
+static inline int test_net_media(uint16_t seq, uint32_t ts, uint8_t *buf)
+{
+    udp_frame_t frame = { .flags = 0, .type = UDP_FRAME_TYPE_MEDIA, .seq = seq, .ts = ts };
+    udp_frame_pack(&frame, buf, UDP_FRAME_HEADER_SIZE);
+    uint8_t *payload = buf + UDP_FRAME_HEADER_SIZE;
+    int len = TEST_NET_PAYLOAD - seq % 61;
+    payload[0] = seq >> 8;
+    payload[1] = seq;
+    for(int i = 2; i < len; i++) {
+        payload[i] = (uint8_t)(seq * 7 + i);
+    }
+    return UDP_FRAME_HEADER_SIZE + len;
+}
+
+// sequence of a payload built by test_net_media, -2 if it is corrupt
+static inline int test_net_payload_seq(const uint8_t *payload, int len)
+{
+    uint16_t seq = (payload[0] << 8) | payload[1];
+    if(len != TEST_NET_PAYLOAD - seq % 61) {
+        return -2;
+    }
+    for(int i = 2; i < len; i++) {
+        if(payload[i] != (uint8_t)(seq * 7 + i)) {
+            return -2;
+        }
+    }
+    return seq;
+}
+
+static inline void test_net_send(test_net_t *net, const uint8_t *data, int len, uint32_t send, double loss, int jitter_ms, int media)
+{
+    test_net_packet_t *p = &net->packets[net->num++];
+    memcpy(p->data, data, len);
+    p->len = len;
+    p->send = send;
+    if((test_net_rand(net) % 10000) < loss * 10000) {
+        p->arrival = 0xffffffff;
+        net->dropped += media;
+    } else {
+        p->arrival = send + (jitter_ms ? test_net_rand(net) % (jitter_ms + 1) : 0);
+    }
+}
+
+static inline int test_net_cmp(const void *a, const void *b)
+{
+    const test_net_packet_t *pa = a, *pb = b;
+    if(pa->arrival != pb->arrival) {
+        return pa->arrival < pb->arrival ? -1 : 1;
+    }
+    return pa->send < pb->send ? -1 : (pa->send > pb->send);
+}
+
+// count media packets every interval ms, a parity after every fec_group of them (0: none)
+static inline void test_net_init(test_net_t *net, int count, int interval, double loss, int jitter_ms, int fec_group, uint32_t seed)
+{
+    memset(net, 0, sizeof(*net));
+    net->packets = calloc(2 * count + 1, sizeof(test_net_packet_t));
+    net->interval = interval;
+    net->rand = seed;
+    udp_fec_enc_t enc;
+    udp_fec_enc_init(&enc, fec_group);
+    uint8_t buf[sizeof(net->packets[0].data)];
+    for(int i = 0; i < count; i++) {
+        uint32_t ts = i * interval;
+        int len = test_net_media(i, ts, buf);
+        // the reader starts at the first packet it sees, anything before it would be late,
+        // and a lost tail is never declared lost
+        int edge = i == 0 || i == count - 1;
+        test_net_send(net, buf, len, ts, edge ? 0 : loss, i == 0 ? 0 : jitter_ms, 1);
+        net->sent++;
+        if(fec_group && udp_fec_enc_add(&enc, i, buf + UDP_FRAME_HEADER_SIZE, len - UDP_FRAME_HEADER_SIZE)) {
+            len = udp_fec_enc_pack(&enc, ts, buf, sizeof(buf));
+            test_net_send(net, buf, len, ts, loss, jitter_ms, 0);
+            net->parity++;
+        }
+    }
+    // stable, equal arrivals keep the send order
+    qsort(net->packets, net->num, sizeof(test_net_packet_t), test_net_cmp);
+}
+
+static inline void test_net_free(test_net_t *net)
+{
+    free(net->packets);
+}
+
+// deliver the packets at their arrival time, drain every ready frame each ms
+static inline void test_net_run(test_net_t *net, udp_jitter_handle_t jitter, test_net_result_t *res)
+{
+    memset(res, 0, sizeof(*res));
+    int last = -1, next = 0;
+    res->first_ms = -1;
+    uint32_t end = net->sent * net->interval + 2000;
+    uint8_t out[TEST_NET_PAYLOAD];
+    for(uint32_t now = 0; now < end; now++) {
+        for(; next < net->num && net->packets[next].arrival <= now; next++) {
+            udp_jitter_put(jitter, net->packets[next].data, net->packets[next].len, now);
+        }
+        int len;
+        while((len = udp_jitter_get(jitter, out, sizeof(out), now)) > 0) {
+            int seq = test_net_payload_seq(out, len);
+            if(seq < 0) {
+                res->corrupt++;
+                continue;
+            }
+            if(seq <= last) {
+                res->out_of_order++;
+            }
+            last = seq;
+            if(res->played++ == 0) {
+                res->first_ms = now - net->packets[0].arrival;
+            }
+        }
+    }
+}
+
+#endif // __TEST_NET_H__
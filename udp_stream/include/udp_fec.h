@@ -0,0 +1,47 @@
+#ifndef __UDP_FEC_H__
+#define __UDP_FEC_H__
+
+#include <stdint.h>
+#include "udp_jitter.h"
+
+// plain C without ESP-IDF dependencies
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * XOR parity over groups of framed media datagrams, sent after the last packet of each group
+ *
+ * header: type UDP_FRAME_TYPE_FEC, seq = first media sequence of the group, flags = group size
+ * payload: XOR of the payload lengths (2 bytes, big endian) + XOR of the payloads, zero padded to the longest
+ *
+ * any single loss in a group is rebuilt by the udp_jitter reader, overhead is 1 / group
+ */
+#define UDP_FEC_MIN_GROUP           (2)
+#define UDP_FEC_MAX_GROUP           (16)
+#define UDP_FEC_PARITY_HEADER_SIZE  (2)
+
+typedef struct {
+    uint8_t     group;      // media packets per parity packet, 0: off
+    uint8_t     count;      // media packets in the current group
+    uint16_t    base;       // first sequence number of the current group
+    uint16_t    len;        // longest payload in the current group
+    uint16_t    len_xor;
+    uint8_t     parity[UDP_FRAME_MAX_PAYLOAD];
+} udp_fec_enc_t;
+
+// group 0 disables parity, returns 0, -1 if group is out of range
+int udp_fec_enc_init(udp_fec_enc_t *enc, int group);
+// add a media payload, returns 1 when the group is complete and its parity datagram should be sent, 0 otherwise
+int udp_fec_enc_add(udp_fec_enc_t *enc, uint16_t seq, const uint8_t *data, int len);
+// parity datagram of the completed group, starts the next group, returns datagram size, -1 if size is too small
+int udp_fec_enc_pack(udp_fec_enc_t *enc, uint32_t ts, uint8_t *buf, int size);
+
+// dst ^= src
+void udp_fec_xor(uint8_t *dst, const uint8_t *src, int len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __UDP_FEC_H__
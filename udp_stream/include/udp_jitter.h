@@ -0,0 +1,104 @@
+#ifndef __UDP_JITTER_H__
+#define __UDP_JITTER_H__
+
+#include <stdint.h>
+
+// plain C without ESP-IDF dependencies, the clock is passed in so the logic can run on a host
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * RTP-like framing header, big endian, in front of every datagram when framing is enabled
+ *
+ *  0        1        2        3        4                                 8
+ * +--------+--------+--------+--------+--------+--------+--------+--------+
+ * |V|flags |  type  |    sequence     |       timestamp (sender ms)       |
+ * +--------+--------+--------+--------+--------+--------+--------+--------+
+ */
+#define UDP_FRAME_VERSION           (0x80)
+#define UDP_FRAME_VERSION_MASK      (0xC0)
+#define UDP_FRAME_HEADER_SIZE       (8)
+#define UDP_FRAME_MAX_SIZE          (1472)  // ethernet MTU - IP - UDP header
+#define UDP_FRAME_MAX_PAYLOAD       (UDP_FRAME_MAX_SIZE - UDP_FRAME_HEADER_SIZE - 2)  // parity datagrams carry 2 more bytes
+
+typedef enum {
+    UDP_FRAME_TYPE_MEDIA = 0,
+    UDP_FRAME_TYPE_FEC,             // XOR parity, see udp_fec.h
+    UDP_FRAME_TYPE_MAX,
+} udp_frame_type_t;
+
+typedef struct {
+    uint8_t     flags;  // low 6 bits, type specific
+    uint8_t     type;
+    uint16_t    seq;
+    uint32_t    ts;     // sender clock in ms
+} udp_frame_t;
+
+// write the header to buf, returns UDP_FRAME_HEADER_SIZE, -1 if size is too small
+int udp_frame_pack(const udp_frame_t *frame, uint8_t *buf, int size);
+// read the header from a datagram, returns UDP_FRAME_HEADER_SIZE, -1 if it is not a framed datagram
+int udp_frame_parse(const uint8_t *buf, int len, udp_frame_t *frame);
+
+typedef enum {
+    UDP_JITTER_CONCEAL_NONE = 0,    // skip lost frames, for compressed streams
+    UDP_JITTER_CONCEAL_REPEAT,      // repeat the last frame
+    UDP_JITTER_CONCEAL_FADE,        // fade the last frame out to silence, 16 bits PCM only
+} udp_jitter_conceal_t;
+
+typedef struct {
+    int                     slots;          // reorder window in packets, rounded up to a power of 2
+    int                     max_payload;    // largest payload kept per slot
+    int                     min_depth;      // packets held after a gap before it is declared lost
+    int                     max_depth;      // upper bound of the adaptive depth, less than slots
+    int                     max_delay_ms;   // a gap is declared lost when the packet after it waited this long, plus fec_group sender intervals with parity
+    int                     fec_group;      // largest parity group accepted, a gap is rebuilt from it when it would be declared lost, 0: parity ignored
+    udp_jitter_conceal_t    conceal;
+} udp_jitter_cfg_t;
+
+#define UDP_JITTER_CFG_DEFAULT() {              \
+    .slots         = 32,                        \
+    .max_payload   = UDP_FRAME_MAX_PAYLOAD,     \
+    .min_depth     = 2,                         \
+    .max_depth     = 16,                        \
+    .max_delay_ms  = 200,                       \
+    .fec_group     = 0,                         \
+    .conceal       = UDP_JITTER_CONCEAL_NONE,   \
+}
+
+typedef struct {
+    uint32_t    received;   // media packets accepted
+    uint32_t    lost;       // sequence numbers never received
+    uint32_t    late;       // packets received after their slot was played or declared lost
+    uint32_t    reordered;  // packets received after a higher sequence number
+    uint32_t    duplicated; // including originals of recovered packets
+    uint32_t    concealed;  // frames generated for lost packets
+    uint32_t    parity;     // parity packets received
+    uint32_t    recovered;  // lost packets rebuilt from parity
+    uint32_t    resync;     // sequence jumps larger than the window, e.g. sender restart
+    uint32_t    jitter_ms;  // RFC 3550 interarrival jitter
+    uint32_t    depth;      // current adaptive depth in packets
+} udp_jitter_stats_t;
+
+typedef struct udp_jitter* udp_jitter_handle_t;
+
+udp_jitter_handle_t udp_jitter_create(const udp_jitter_cfg_t *cfg);
+void udp_jitter_destroy(udp_jitter_handle_t handle);
+void udp_jitter_reset(udp_jitter_handle_t handle);
+
+// queue a framed datagram, returns 0, -1 if it is invalid, late or duplicated
+int udp_jitter_put(udp_jitter_handle_t handle, const uint8_t *data, int len, uint32_t now_ms);
+// next frame in sequence order or a concealment frame, returns payload bytes written,
+// 0 if nothing is ready yet, -1 if size is smaller than the frame
+int udp_jitter_get(udp_jitter_handle_t handle, uint8_t *out, int size, uint32_t now_ms);
+// packets waiting in the buffer
+int udp_jitter_count(udp_jitter_handle_t handle);
+// ms until the gap in front of the buffered packets times out, -1 if nothing is waiting on a gap
+int udp_jitter_wait_ms(udp_jitter_handle_t handle, uint32_t now_ms);
+void udp_jitter_get_stats(udp_jitter_handle_t handle, udp_jitter_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __UDP_JITTER_H__
@@ -4,6 +4,8 @@
 #include "audio_error.h"
 #include "audio_element.h"
 #include "esp_transport.h"
+#include "udp_jitter.h"
+#include "udp_fec.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +47,12 @@ typedef struct {
     bool                        ext_stack;          /*!< Allocate stack on extern ram */
     udp_stream_event_handle_cb  event_handler;      /*!< UDP stream event callback*/
     void                        *event_ctx;         /*!< User context*/
+    bool                        framing;            /*!< Sequence/timestamp header on every datagram, the reader reorders through a jitter buffer */
+    udp_jitter_conceal_t        conceal;            /*!< Reader concealment of lost datagrams when framing */
+    int                         jitter_delay_ms;    /*!< Reader max wait for a missing datagram when framing */
+    int                         fec_group;          /*!< XOR parity datagram every fec_group datagrams when framing (2 ~ 16), 0: off */
+    bool                        batch_read;         /*!< Reader drains queued datagrams into one element read, each up to UDP_FRAME_MAX_SIZE bytes */
+    int                         rcvbuf_size;        /*!< Reader socket receive buffer (SO_RCVBUF), 0: lwIP default */
 } udp_stream_cfg_t;
 
 #define UDP_STREAM_DEFAULT_PORT             (8080)
@@ -56,6 +64,8 @@ typedef struct {
 
 #define UDP_SERVER_DEFAULT_RESPONSE_LENGTH  (512)
 
+#define UDP_STREAM_JITTER_DELAY_MS          (200)
+
 #define UDP_STREAM_CFG_DEFAULT() {              \
     .type          = AUDIO_STREAM_READER,       \
     .timeout_ms    = 30 * 1000,                 \
@@ -69,13 +79,34 @@ typedef struct {
     .ext_stack     = true,                      \
     .event_handler = NULL,                      \
     .event_ctx     = NULL,                      \
+    .framing       = false,                     \
+    .conceal       = UDP_JITTER_CONCEAL_NONE,   \
+    .jitter_delay_ms = UDP_STREAM_JITTER_DELAY_MS, \
+    .fec_group     = 0,                         \
+    .batch_read    = false,                     \
+    .rcvbuf_size   = 0,                         \
 }
 
 audio_element_handle_t udp_stream_init(udp_stream_cfg_t *config);
+// read and write statistics are cumulative over opens of the element
+// datagrams received
 int udp_stream_get_read_num(audio_element_handle_t el);
+// element reads, each one ring buffer write, read_num / read_call_num datagrams per batch
+int udp_stream_get_read_call_num(audio_element_handle_t el);
+// datagrams per second over the last second
+int udp_stream_get_datagram_rate(audio_element_handle_t el);
+// average delay from the first datagram of a read to its hand off
+int udp_stream_get_read_latency_us(audio_element_handle_t el);
 int udp_stream_get_write_num(audio_element_handle_t el);
 int udp_stream_get_read_bytes(audio_element_handle_t el);
 int udp_stream_get_write_bytes(audio_element_handle_t el);
+// framing reader only, 0 otherwise
+int udp_stream_get_lost_num(audio_element_handle_t el);
+int udp_stream_get_late_num(audio_element_handle_t el);
+int udp_stream_get_reorder_num(audio_element_handle_t el);
+int udp_stream_get_conceal_num(audio_element_handle_t el);
+int udp_stream_get_recover_num(audio_element_handle_t el);
+int udp_stream_get_jitter_ms(audio_element_handle_t el);
 
 #ifdef __cplusplus
 }
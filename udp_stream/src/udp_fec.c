@@ -0,0 +1,66 @@
+#include <string.h>
+#include "udp_fec.h"
+
+void udp_fec_xor(uint8_t *dst, const uint8_t *src, int len)
+{
+    int i = 0;
+    // word at a time, memcpy keeps unaligned payloads safe
+    for(; i + 4 <= len; i += 4) {
+        uint32_t a, b;
+        memcpy(&a, dst + i, 4);
+        memcpy(&b, src + i, 4);
+        a ^= b;
+        memcpy(dst + i, &a, 4);
+    }
+    for(; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+int udp_fec_enc_init(udp_fec_enc_t *enc, int group)
+{
+    if(enc == NULL || (group != 0 && (group < UDP_FEC_MIN_GROUP || group > UDP_FEC_MAX_GROUP))) {
+        return -1;
+    }
+    enc->group = group;
+    enc->count = 0;
+    enc->len = 0;
+    enc->len_xor = 0;
+    return 0;
+}
+
+int udp_fec_enc_add(udp_fec_enc_t *enc, uint16_t seq, const uint8_t *data, int len)
+{
+    if(enc == NULL || enc->group == 0 || len <= 0 || len > UDP_FRAME_MAX_PAYLOAD) {
+        return 0;
+    }
+    if(enc->count == 0) {
+        enc->base = seq;
+        enc->len = 0;
+        enc->len_xor = 0;
+    }
+    if(len > enc->len) {
+        // zero the newly covered tail, shorter payloads are zero padded
+        memset(enc->parity + enc->len, 0, len - enc->len);
+        enc->len = len;
+    }
+    udp_fec_xor(enc->parity, data, len);
+    enc->len_xor ^= len;
+    enc->count++;
+    return enc->count >= enc->group;
+}
+
+int udp_fec_enc_pack(udp_fec_enc_t *enc, uint32_t ts, uint8_t *buf, int size)
+{
+    int total = UDP_FRAME_HEADER_SIZE + UDP_FEC_PARITY_HEADER_SIZE + enc->len;
+    if(enc->count == 0 || size < total) {
+        return -1;
+    }
+    udp_frame_t frame = { .flags = enc->count, .type = UDP_FRAME_TYPE_FEC, .seq = enc->base, .ts = ts };
+    udp_frame_pack(&frame, buf, size);
+    buf[UDP_FRAME_HEADER_SIZE] = enc->len_xor >> 8;
+    buf[UDP_FRAME_HEADER_SIZE + 1] = enc->len_xor;
+    memcpy(buf + UDP_FRAME_HEADER_SIZE + UDP_FEC_PARITY_HEADER_SIZE, enc->parity, enc->len);
+    enc->count = 0;
+    return total;
+}
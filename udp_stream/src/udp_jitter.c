@@ -0,0 +1,501 @@
+#include <stdlib.h>
+#include <string.h>
+#include "udp_jitter.h"
+#include "udp_fec.h"
+
+#define UDP_JITTER_PARITY_NUM   (4)
+
+typedef enum {
+    UDP_JITTER_SLOT_EMPTY = 0,
+    UDP_JITTER_SLOT_QUEUED,
+    UDP_JITTER_SLOT_PLAYED,     // payload kept until the slot is reused, parity groups may still need it
+} udp_jitter_slot_state_t;
+
+typedef struct {
+    uint16_t    seq;
+    uint16_t    len;
+    uint8_t     state;
+    uint8_t     recovered;  // rebuilt from parity, the original may still arrive
+    uint32_t    ts;
+    uint32_t    arrival;
+} udp_jitter_slot_t;
+
+typedef struct {
+    uint8_t     group;      // 0: unused
+    uint16_t    base;
+    uint16_t    len;
+    uint16_t    len_xor;
+    uint32_t    ts;
+    uint8_t     *data;
+} udp_jitter_parity_t;
+
+struct udp_jitter {
+    udp_jitter_cfg_t    cfg;
+    uint16_t            mask;
+    udp_jitter_slot_t   *slots;
+    uint8_t             *payload;       // slots * max_payload
+    uint8_t             *last;          // last played frame, source of concealment
+    udp_jitter_parity_t parity[UDP_JITTER_PARITY_NUM];
+    uint8_t             *parity_data;   // UDP_JITTER_PARITY_NUM * max_payload
+    int                 last_len;
+    int                 count;
+    uint8_t             started;
+    uint8_t             concealing;
+    uint8_t             probing;
+    uint16_t            next_seq;       // next sequence number to play
+    uint16_t            high_seq;       // highest sequence number received
+    uint16_t            probe_seq;      // last out of window sequence number
+    uint16_t            prev_seq;
+    uint32_t            prev_ts;
+    int32_t             prev_transit;
+    uint32_t            jitter_q4;      // ms << 4
+    uint32_t            interval_q4;    // ms << 4, sender interval between consecutive packets
+    uint32_t            reorder;        // largest reorder distance seen recently
+    uint32_t            in_order;
+    udp_jitter_stats_t  stats;
+};
+
+int udp_frame_pack(const udp_frame_t *frame, uint8_t *buf, int size)
+{
+    if(frame == NULL || buf == NULL || size < UDP_FRAME_HEADER_SIZE) {
+        return -1;
+    }
+    buf[0] = UDP_FRAME_VERSION | (frame->flags & ~UDP_FRAME_VERSION_MASK);
+    buf[1] = frame->type;
+    buf[2] = frame->seq >> 8;
+    buf[3] = frame->seq;
+    buf[4] = frame->ts >> 24;
+    buf[5] = frame->ts >> 16;
+    buf[6] = frame->ts >> 8;
+    buf[7] = frame->ts;
+    return UDP_FRAME_HEADER_SIZE;
+}
+
+int udp_frame_parse(const uint8_t *buf, int len, udp_frame_t *frame)
+{
+    if(buf == NULL || frame == NULL || len < UDP_FRAME_HEADER_SIZE) {
+        return -1;
+    }
+    if((buf[0] & UDP_FRAME_VERSION_MASK) != UDP_FRAME_VERSION || buf[1] >= UDP_FRAME_TYPE_MAX) {
+        return -1;
+    }
+    frame->flags = buf[0] & ~UDP_FRAME_VERSION_MASK;
+    frame->type = buf[1];
+    frame->seq = (buf[2] << 8) | buf[3];
+    frame->ts = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | buf[7];
+    return UDP_FRAME_HEADER_SIZE;
+}
+
+static void _udp_jitter_update_depth(udp_jitter_handle_t handle)
+{
+    uint32_t depth = handle->reorder + 1;
+    if(handle->cfg.fec_group) {
+        // a gap at the start of a group is repaired once the parity after its last packet arrives
+        depth += handle->cfg.fec_group;
+    }
+    if(handle->interval_q4) {
+        // hold about twice the jitter, in packets
+        uint32_t jitter = (2 * handle->jitter_q4 + handle->interval_q4 - 1) / handle->interval_q4;
+        if(jitter > depth) {
+            depth = jitter;
+        }
+    }
+    if(depth < (uint32_t)handle->cfg.min_depth) {
+        depth = handle->cfg.min_depth;
+    }
+    if(depth > (uint32_t)(handle->cfg.max_depth + handle->cfg.fec_group)) {
+        depth = handle->cfg.max_depth + handle->cfg.fec_group;
+    }
+    handle->stats.depth = depth;
+}
+
+static void _udp_jitter_update_timing(udp_jitter_handle_t handle, const udp_frame_t *frame, uint32_t now_ms)
+{
+    // RFC 3550 A.8, transit differences cancel the unknown clock offset
+    int32_t transit = (int32_t)(now_ms - frame->ts);
+    if(handle->stats.received > 1) {
+        int32_t d = transit - handle->prev_transit;
+        if(d < 0) {
+            d = -d;
+        }
+        handle->jitter_q4 += d - ((handle->jitter_q4 + 8) >> 4);
+        handle->stats.jitter_ms = handle->jitter_q4 >> 4;
+        if(frame->seq == (uint16_t)(handle->prev_seq + 1)) {
+            uint32_t step = frame->ts - handle->prev_ts;
+            if(handle->interval_q4 == 0) {
+                handle->interval_q4 = step << 4;
+            } else if(step < 0x10000) {
+                handle->interval_q4 += step - ((handle->interval_q4 + 8) >> 4);
+            }
+        }
+    }
+    handle->prev_transit = transit;
+    handle->prev_seq = frame->seq;
+    handle->prev_ts = frame->ts;
+}
+
+static void _udp_jitter_restart(udp_jitter_handle_t handle, uint16_t seq)
+{
+    for(int i = 0; i <= handle->mask; i++) {
+        handle->slots[i].state = UDP_JITTER_SLOT_EMPTY;
+    }
+    for(int i = 0; i < UDP_JITTER_PARITY_NUM; i++) {
+        handle->parity[i].group = 0;
+    }
+    handle->count = 0;
+    handle->next_seq = seq;
+    handle->high_seq = seq;
+    handle->probing = 0;
+    handle->started = 1;
+}
+
+udp_jitter_handle_t udp_jitter_create(const udp_jitter_cfg_t *cfg)
+{
+    if(cfg == NULL || cfg->max_payload <= 0 || cfg->max_payload > 0xFFFF || cfg->min_depth < 1 || cfg->max_depth < cfg->min_depth || \
+        (cfg->fec_group && (cfg->fec_group < UDP_FEC_MIN_GROUP || cfg->fec_group > UDP_FEC_MAX_GROUP))) {
+        return NULL;
+    }
+    int slots = 2;
+    // played packets of a parity group must stay in the window behind the depth
+    while(slots < cfg->slots || slots <= cfg->max_depth + 2 * cfg->fec_group) {
+        slots <<= 1;
+    }
+    if(slots > 0x4000) {
+        return NULL;
+    }
+    udp_jitter_handle_t handle = calloc(1, sizeof(struct udp_jitter));
+    if(handle == NULL) {
+        return NULL;
+    }
+    handle->cfg = *cfg;
+    handle->cfg.slots = slots;
+    handle->mask = slots - 1;
+    handle->slots = calloc(slots, sizeof(udp_jitter_slot_t));
+    handle->payload = malloc((size_t)slots * cfg->max_payload);
+    handle->last = malloc(cfg->max_payload);
+    handle->parity_data = malloc(UDP_JITTER_PARITY_NUM * cfg->max_payload);
+    if(handle->slots == NULL || handle->payload == NULL || handle->last == NULL || handle->parity_data == NULL) {
+        udp_jitter_destroy(handle);
+        return NULL;
+    }
+    for(int i = 0; i < UDP_JITTER_PARITY_NUM; i++) {
+        handle->parity[i].data = handle->parity_data + i * cfg->max_payload;
+    }
+    udp_jitter_reset(handle);
+    return handle;
+}
+
+void udp_jitter_destroy(udp_jitter_handle_t handle)
+{
+    if(handle) {
+        free(handle->slots);
+        free(handle->payload);
+        free(handle->last);
+        free(handle->parity_data);
+        free(handle);
+    }
+}
+
+void udp_jitter_reset(udp_jitter_handle_t handle)
+{
+    if(handle == NULL) {
+        return;
+    }
+    _udp_jitter_restart(handle, 0);
+    handle->started = 0;
+    handle->concealing = 0;
+    handle->last_len = 0;
+    handle->jitter_q4 = 0;
+    handle->interval_q4 = 0;
+    handle->reorder = 0;
+    handle->in_order = 0;
+    memset(&handle->stats, 0, sizeof(handle->stats));
+    _udp_jitter_update_depth(handle);
+}
+
+static uint8_t *_udp_jitter_payload(udp_jitter_handle_t handle, uint16_t seq)
+{
+    return handle->payload + (seq & handle->mask) * handle->cfg.max_payload;
+}
+
+static void _udp_jitter_insert(udp_jitter_handle_t handle, uint16_t seq, uint32_t ts, const uint8_t *data, int len, uint32_t now_ms)
+{
+    udp_jitter_slot_t *slot = &handle->slots[seq & handle->mask];
+    slot->state = UDP_JITTER_SLOT_QUEUED;
+    slot->recovered = 0;
+    slot->seq = seq;
+    slot->len = len;
+    slot->ts = ts;
+    slot->arrival = now_ms;
+    memcpy(_udp_jitter_payload(handle, seq), data, len);
+    handle->count++;
+}
+
+// rebuild seq from a parity group in which it is the only missing packet, returns 1 when it is queued
+static int _udp_jitter_recover(udp_jitter_handle_t handle, uint16_t seq, uint32_t now_ms)
+{
+    for(int p = 0; p < UDP_JITTER_PARITY_NUM; p++) {
+        udp_jitter_parity_t *parity = &handle->parity[p];
+        if(parity->group == 0 || (uint16_t)(seq - parity->base) >= parity->group) {
+            continue;
+        }
+        int complete = 1;
+        for(int i = 0; i < parity->group && complete; i++) {
+            uint16_t member = parity->base + i;
+            udp_jitter_slot_t *slot = &handle->slots[member & handle->mask];
+            if(member != seq && (slot->state == UDP_JITTER_SLOT_EMPTY || slot->seq != member)) {
+                complete = 0; // two or more lost
+            }
+        }
+        if(!complete) {
+            continue;
+        }
+        uint16_t len = parity->len_xor;
+        uint8_t *data = parity->data;
+        for(int i = 0; i < parity->group; i++) {
+            uint16_t member = parity->base + i;
+            if(member != seq) {
+                udp_jitter_slot_t *slot = &handle->slots[member & handle->mask];
+                udp_fec_xor(data, _udp_jitter_payload(handle, member), slot->len);
+                len ^= slot->len;
+            }
+        }
+        parity->group = 0; // the xor above consumed the parity
+        if(len == 0 || len > parity->len) {
+            continue; // inconsistent group
+        }
+        _udp_jitter_insert(handle, seq, parity->ts, data, len, now_ms);
+        handle->slots[seq & handle->mask].recovered = 1;
+        if((int16_t)(seq - handle->high_seq) > 0) {
+            handle->high_seq = seq;
+        }
+        handle->stats.recovered++;
+        return 1;
+    }
+    return 0;
+}
+
+static int _udp_jitter_put_parity(udp_jitter_handle_t handle, const udp_frame_t *frame, const uint8_t *data, int len, uint32_t now_ms)
+{
+    len -= UDP_FEC_PARITY_HEADER_SIZE;
+    if(!handle->started || frame->flags < UDP_FEC_MIN_GROUP || frame->flags > handle->cfg.fec_group || len <= 0 || len > handle->cfg.max_payload) {
+        return -1;
+    }
+    // members behind next_seq are matched against played payloads, stale slots fail the sequence check
+    int16_t d = (int16_t)(frame->seq - handle->next_seq);
+    if(d + frame->flags <= 0 || d >= handle->cfg.slots) {
+        return -1; // group already played, nothing left to repair
+    }
+    udp_jitter_parity_t *parity = &handle->parity[0];
+    for(int i = 0; i < UDP_JITTER_PARITY_NUM; i++) {
+        udp_jitter_parity_t *p = &handle->parity[i];
+        if(p->group == 0 || (int16_t)(p->base + p->group - handle->next_seq) <= 0) {
+            parity = p; // unused, or its group is played
+            break;
+        }
+        if((int16_t)(handle->parity[i].base - parity->base) < 0) {
+            parity = &handle->parity[i]; // all busy, replace the oldest group
+        }
+    }
+    parity->group = frame->flags;
+    parity->base = frame->seq;
+    parity->ts = frame->ts;
+    parity->len = len;
+    parity->len_xor = (data[0] << 8) | data[1];
+    memcpy(parity->data, data + UDP_FEC_PARITY_HEADER_SIZE, len);
+    handle->stats.parity++;
+    // kept until a gap of the group is about to be declared lost, a reordered packet may still fill it
+    return 0;
+}
+
+int udp_jitter_put(udp_jitter_handle_t handle, const uint8_t *data, int len, uint32_t now_ms)
+{
+    udp_frame_t frame;
+    if(handle == NULL || udp_frame_parse(data, len, &frame) < 0) {
+        return -1;
+    }
+    data += UDP_FRAME_HEADER_SIZE;
+    len -= UDP_FRAME_HEADER_SIZE;
+    if(frame.type == UDP_FRAME_TYPE_FEC) {
+        return _udp_jitter_put_parity(handle, &frame, data, len, now_ms);
+    }
+    if(len <= 0 || len > handle->cfg.max_payload) {
+        return -1;
+    }
+    if(!handle->started) {
+        _udp_jitter_restart(handle, frame.seq);
+    }
+    int16_t d = (int16_t)(frame.seq - handle->next_seq);
+    if(d < -handle->cfg.slots || d >= handle->cfg.slots) {
+        // far outside the window, restart on two consecutive packets (RFC 3550 A.1 probation)
+        if(!handle->probing || frame.seq != (uint16_t)(handle->probe_seq + 1)) {
+            handle->probing = 1;
+            handle->probe_seq = frame.seq;
+            handle->stats.late++;
+            return -1;
+        }
+        _udp_jitter_restart(handle, frame.seq);
+        handle->stats.resync++;
+        d = 0;
+    }
+    handle->probing = 0;
+    udp_jitter_slot_t *slot = &handle->slots[frame.seq & handle->mask];
+    if(slot->state != UDP_JITTER_SLOT_EMPTY && slot->seq == frame.seq && slot->recovered) {
+        handle->stats.duplicated++; // the parity already rebuilt it
+        return -1;
+    }
+    if(d < 0) {
+        handle->stats.late++;
+        return -1;
+    }
+    if(slot->state == UDP_JITTER_SLOT_QUEUED) {
+        handle->stats.duplicated++;
+        return -1;
+    }
+    _udp_jitter_insert(handle, frame.seq, frame.ts, data, len, now_ms);
+    handle->stats.received++;
+
+    int16_t behind = (int16_t)(handle->high_seq - frame.seq);
+    if(behind > 0) {
+        handle->stats.reordered++;
+        if((uint32_t)behind > handle->reorder) {
+            handle->reorder = behind;
+        }
+        handle->in_order = 0;
+    } else {
+        handle->high_seq = frame.seq;
+        // let the depth shrink back once reordering stops
+        if(++handle->in_order >= 64 && handle->reorder) {
+            handle->reorder--;
+            handle->in_order = 0;
+        }
+    }
+    _udp_jitter_update_timing(handle, &frame, now_ms);
+    _udp_jitter_update_depth(handle);
+    return 0;
+}
+
+static void _udp_jitter_fade(uint8_t *data, int len, int fade_in)
+{
+    int n = len / 2;
+    for(int i = 0; i < n; i++) {
+        int32_t gain = fade_in ? (i << 15) / n : ((n - i) << 15) / n;
+        int16_t s = (int16_t)(data[2 * i] | (data[2 * i + 1] << 8));
+        s = (int16_t)((s * gain) >> 15);
+        data[2 * i] = s;
+        data[2 * i + 1] = s >> 8;
+    }
+}
+
+static int _udp_jitter_conceal(udp_jitter_handle_t handle, uint8_t *out, int size)
+{
+    if(handle->cfg.conceal == UDP_JITTER_CONCEAL_NONE || handle->last_len == 0) {
+        return 0;
+    }
+    if(size < handle->last_len) {
+        return -1;
+    }
+    int len = handle->last_len;
+    if(handle->cfg.conceal == UDP_JITTER_CONCEAL_REPEAT) {
+        memcpy(out, handle->last, len);
+    } else if(handle->concealing) {
+        memset(out, 0, len);
+    } else {
+        memcpy(out, handle->last, len);
+        _udp_jitter_fade(out, len, 0);
+    }
+    handle->concealing = 1;
+    handle->stats.concealed++;
+    return len;
+}
+
+// with parity the wait also covers the rest of a group, its parity follows the last packet
+static int32_t _udp_jitter_max_delay(udp_jitter_handle_t handle)
+{
+    return handle->cfg.max_delay_ms + handle->cfg.fec_group * (handle->interval_q4 >> 4);
+}
+
+// slot of the first buffered packet after next_seq, NULL if the buffer is empty
+static udp_jitter_slot_t *_udp_jitter_first(udp_jitter_handle_t handle)
+{
+    if(handle->count == 0) {
+        return NULL;
+    }
+    for(uint16_t seq = handle->next_seq; seq != (uint16_t)(handle->high_seq + 1); seq++) {
+        udp_jitter_slot_t *slot = &handle->slots[seq & handle->mask];
+        if(slot->state == UDP_JITTER_SLOT_QUEUED && slot->seq == seq) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+int udp_jitter_get(udp_jitter_handle_t handle, uint8_t *out, int size, uint32_t now_ms)
+{
+    if(handle == NULL || out == NULL || !handle->started) {
+        return handle ? 0 : -1;
+    }
+    while(handle->count) {
+        udp_jitter_slot_t *slot = &handle->slots[handle->next_seq & handle->mask];
+        if(slot->state == UDP_JITTER_SLOT_QUEUED && slot->seq == handle->next_seq) {
+            if(size < slot->len) {
+                return -1;
+            }
+            int len = slot->len;
+            memcpy(out, _udp_jitter_payload(handle, handle->next_seq), len);
+            slot->state = UDP_JITTER_SLOT_PLAYED;
+            handle->count--;
+            handle->next_seq++;
+            if(handle->concealing && handle->cfg.conceal == UDP_JITTER_CONCEAL_FADE) {
+                _udp_jitter_fade(out, len, 1);
+            }
+            handle->concealing = 0;
+            if(handle->cfg.conceal != UDP_JITTER_CONCEAL_NONE) {
+                memcpy(handle->last, out, len);
+                handle->last_len = len;
+            }
+            return len;
+        }
+        // gap in front, wait for the missing packet until the buffer is deep enough or the wait is too long
+        int ahead = (uint16_t)(handle->high_seq - handle->next_seq);
+        udp_jitter_slot_t *first = _udp_jitter_first(handle);
+        if(ahead < (int)handle->stats.depth && first && (int32_t)(now_ms - first->arrival) < _udp_jitter_max_delay(handle)) {
+            return 0;
+        }
+        if(handle->cfg.fec_group && _udp_jitter_recover(handle, handle->next_seq, now_ms)) {
+            continue;
+        }
+        handle->stats.lost++;
+        handle->next_seq++;
+        int len = _udp_jitter_conceal(handle, out, size);
+        if(len != 0) {
+            return len;
+        }
+    }
+    return 0;
+}
+
+int udp_jitter_count(udp_jitter_handle_t handle)
+{
+    return handle ? handle->count : 0;
+}
+
+int udp_jitter_wait_ms(udp_jitter_handle_t handle, uint32_t now_ms)
+{
+    udp_jitter_slot_t *first = handle ? _udp_jitter_first(handle) : NULL;
+    if(first == NULL) {
+        return -1;
+    }
+    if(first->seq == handle->next_seq) {
+        return 0;
+    }
+    int32_t wait = _udp_jitter_max_delay(handle) - (int32_t)(now_ms - first->arrival);
+    return wait > 0 ? wait : 0;
+}
+
+void udp_jitter_get_stats(udp_jitter_handle_t handle, udp_jitter_stats_t *stats)
+{
+    if(handle && stats) {
+        *stats = handle->stats;
+    }
+}
@@ -4,6 +4,7 @@
 #include "sys/socket.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "audio_mem.h"
 #include "udp_stream.h"
 
@@ -25,6 +26,18 @@ typedef struct udp_stream {
     int                           timeout_ms;
     udp_stream_event_handle_cb    hook;
     void                          *ctx;
+    bool                          framing;
+    uint16_t                      seq;
+    uint8_t                       *frame;     // one framed datagram
+    udp_fec_enc_t                 *fec;       // framing writer with parity only
+    udp_jitter_handle_t           jitter;     // framing reader only
+    bool                          batch_read;
+    int                           rcvbuf_size;
+    int                           read_calls; // element reads, one ring buffer write each
+    int                           rate;       // datagrams per second
+    int                           rate_num;
+    int64_t                       rate_start_us;
+    int32_t                       latency_us; // us << 4
 } udp_stream_t;
 
 static int _get_socket_error_code_reason(const char *str, int sockfd)
@@ -102,6 +115,12 @@ static esp_err_t _udp_open(audio_element_handle_t self)
         _get_socket_error_code_reason(__func__, sock);
         goto _exit;
     }
+    if(udp->rcvbuf_size > 0) {
+        // needs CONFIG_LWIP_SO_RCVBUF, the datagram count is also bounded by CONFIG_LWIP_UDP_RECVMBOX_SIZE
+        if(setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &udp->rcvbuf_size, sizeof(udp->rcvbuf_size)) < 0) {
+            ESP_LOGW(TAG, "(%s) (%d) set recv buffer %d failed", __func__, sock, udp->rcvbuf_size);
+        }
+    }
     if(udp->use_mreq) {
         memset(&udp->mreq, 0, sizeof(udp->mreq));
         udp->mreq.imr_multiaddr.s_addr = inet_addr(udp->host);
@@ -114,6 +133,15 @@ static esp_err_t _udp_open(audio_element_handle_t self)
     }
     udp->sock = sock;
     udp->is_open = true;
+    udp->seq = 0;
+    // counters are cumulative like write_num / write_bytes, only the rate window restarts
+    udp->rate = 0;
+    udp->rate_num = udp->read_num;
+    udp->rate_start_us = esp_timer_get_time();
+    udp_jitter_reset(udp->jitter);
+    if (udp->fec) {
+        udp_fec_enc_init(udp->fec, udp->fec->group);
+    }
     ESP_LOGI(TAG, "udp open success, sock:%d, port:%d", sock, udp->port);
     _dispatch_event(self, udp, NULL, 0, UDP_STREAM_STATE_OPEN);
     return ESP_OK;
@@ -124,10 +152,105 @@ _exit:
     return ESP_FAIL;
 }
 
+static uint32_t _udp_time_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void _udp_read_stat(udp_stream_t *udp, int64_t first_us)
+{
+    int64_t now = esp_timer_get_time();
+    udp->read_calls++;
+    // batching delay of the first datagram, smoothed over 16 reads
+    udp->latency_us += (int32_t)(now - first_us) - (udp->latency_us >> 4);
+    if (now - udp->rate_start_us >= 1000000) {
+        udp->rate = (int64_t)(udp->read_num - udp->rate_num) * 1000000 / (now - udp->rate_start_us);
+        udp->rate_num = udp->read_num;
+        udp->rate_start_us = now;
+    }
+}
+
+// next payloads in sequence order, waits for a missing datagram no longer than the jitter delay
+static int _udp_read_frame(udp_stream_t *udp, char *buffer, int len, int64_t *first_us)
+{
+    int total = 0;
+    while (1) {
+        uint32_t now = _udp_time_ms();
+        int flen = udp_jitter_get(udp->jitter, (uint8_t *)buffer + total, len - total, now);
+        if (flen < 0) {
+            if (total > 0) {
+                return total;
+            }
+            ESP_LOGE(TAG, "read buffer %d too small", len);
+            errno = EMSGSIZE;
+            return -1;
+        }
+        if (flen > 0) {
+            if (total == 0) {
+                *first_us = esp_timer_get_time();
+            }
+            total += flen;
+            if (!udp->batch_read || len - total < UDP_FRAME_MAX_PAYLOAD) {
+                return total;
+            }
+            continue;
+        }
+        int flags = 0;
+        if (total > 0) {
+            flags = MSG_DONTWAIT; // batch, only drain what is already queued
+        } else {
+            int wait_ms = udp_jitter_wait_ms(udp->jitter, now);
+            if (wait_ms >= 0) {
+                fd_set rfds;
+                FD_ZERO(&rfds);
+                FD_SET(udp->sock, &rfds);
+                struct timeval timeout = { .tv_sec = wait_ms / 1000, .tv_usec = (wait_ms % 1000) * 1000 };
+                int ret = select(udp->sock + 1, &rfds, NULL, NULL, &timeout);
+                if (ret < 0) {
+                    return -1;
+                }
+                if (ret == 0) {
+                    continue; // gap expired, conceal or skip it
+                }
+            }
+        }
+        int rlen = recv(udp->sock, udp->frame, UDP_FRAME_MAX_SIZE, flags);
+        if (rlen < 0) {
+            return total > 0 ? total : rlen;
+        }
+        udp->read_num++;
+        if (udp_jitter_put(udp->jitter, udp->frame, rlen, _udp_time_ms()) < 0) {
+            ESP_LOGD(TAG, "drop datagram, len=%d", rlen);
+        }
+    }
+}
+
+// first datagram waits up to the receive timeout, then drain the queued ones while a
+// UDP_FRAME_MAX_SIZE datagram still fits, so none of them is truncated
+static int _udp_read_batch(udp_stream_t *udp, char *buffer, int len, int64_t *first_us)
+{
+    int total = recv(udp->sock, buffer, len, 0);
+    if (total < 0) {
+        return total;
+    }
+    *first_us = esp_timer_get_time();
+    udp->read_num++;
+    while (udp->batch_read && len - total >= UDP_FRAME_MAX_SIZE) {
+        int rlen = recv(udp->sock, buffer + total, len - total, MSG_DONTWAIT);
+        if (rlen < 0) {
+            break; // EAGAIN when drained, a real error shows up on the next blocking recv
+        }
+        total += rlen;
+        udp->read_num++;
+    }
+    return total;
+}
+
 static esp_err_t _udp_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(self);
-    int rlen = recv(udp->sock, buffer, len, 0);
+    int64_t first_us = 0;
+    int rlen = udp->jitter ? _udp_read_frame(udp, buffer, len, &first_us) : _udp_read_batch(udp, buffer, len, &first_us);
     if (rlen < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             ESP_LOGW(TAG, "read timeout");
@@ -138,17 +261,43 @@ static esp_err_t _udp_read(audio_element_handle_t self, char *buffer, int len, T
         _dispatch_event(self, udp, &reason, sizeof(reason), UDP_STREAM_STATE_ERROR);
         return ESP_FAIL;
     }
-    udp->read_num++;
+    _udp_read_stat(udp, first_us);
     udp->read_bytes += rlen;
     audio_element_update_byte_pos(self, rlen);
     ESP_LOGD(TAG, "read len=%d, rlen=%d", len, rlen);
     return rlen;
 }
 
+// split into framed datagrams, returns payload bytes sent
+static int _udp_write_frame(udp_stream_t *udp, char *buffer, int len)
+{
+    int wlen = 0;
+    udp_frame_t frame = { .type = UDP_FRAME_TYPE_MEDIA };
+    while (wlen < len) {
+        int plen = len - wlen > UDP_FRAME_MAX_PAYLOAD ? UDP_FRAME_MAX_PAYLOAD : len - wlen;
+        frame.seq = udp->seq;
+        frame.ts = _udp_time_ms();
+        udp_frame_pack(&frame, udp->frame, UDP_FRAME_HEADER_SIZE);
+        memcpy(udp->frame + UDP_FRAME_HEADER_SIZE, buffer + wlen, plen);
+        if (sendto(udp->sock, udp->frame, UDP_FRAME_HEADER_SIZE + plen, 0, (struct sockaddr *)&udp->addr, sizeof(udp->addr)) < 0) {
+            return -1;
+        }
+        if (udp_fec_enc_add(udp->fec, udp->seq, (uint8_t *)buffer + wlen, plen)) {
+            int flen = udp_fec_enc_pack(udp->fec, frame.ts, udp->frame, UDP_FRAME_MAX_SIZE);
+            if (sendto(udp->sock, udp->frame, flen, 0, (struct sockaddr *)&udp->addr, sizeof(udp->addr)) < 0) {
+                return -1;
+            }
+        }
+        udp->seq++;
+        wlen += plen;
+    }
+    return wlen;
+}
+
 static esp_err_t _udp_write(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(self);
-    int wlen = sendto(udp->sock, buffer, len, 0, (struct sockaddr *)&udp->addr, sizeof(udp->addr));
+    int wlen = udp->framing ? _udp_write_frame(udp, buffer, len) : sendto(udp->sock, buffer, len, 0, (struct sockaddr *)&udp->addr, sizeof(udp->addr));
     printf("sendto %d bytes\n", wlen);
     if (wlen < 0) {
         int reason = _get_socket_error_code_reason(__func__, udp->sock);
@@ -201,6 +350,9 @@ static esp_err_t _udp_destroy(audio_element_handle_t self)
 
     udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(self);
     AUDIO_NULL_CHECK(TAG, udp, return ESP_FAIL);
+    udp_jitter_destroy(udp->jitter);
+    audio_free(udp->fec);
+    audio_free(udp->frame);
     audio_free(udp);
     return ESP_OK;
 }
@@ -208,6 +360,10 @@ static esp_err_t _udp_destroy(audio_element_handle_t self)
 audio_element_handle_t udp_stream_init(udp_stream_cfg_t *config)
 {
     AUDIO_NULL_CHECK(TAG, config, return NULL);
+    if (config->framing && config->fec_group && (config->fec_group < UDP_FEC_MIN_GROUP || config->fec_group > UDP_FEC_MAX_GROUP)) {
+        ESP_LOGE(TAG, "invalid fec group %d, expect 0 or %d ~ %d", config->fec_group, UDP_FEC_MIN_GROUP, UDP_FEC_MAX_GROUP);
+        return NULL;
+    }
 
     audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
     audio_element_handle_t el;
@@ -239,6 +395,27 @@ audio_element_handle_t udp_stream_init(udp_stream_cfg_t *config)
             udp->ctx = config->event_ctx;
         }
     }
+    udp->framing = config->framing;
+    udp->batch_read = config->batch_read;
+    udp->rcvbuf_size = config->rcvbuf_size;
+    if (udp->framing) {
+        udp->frame = audio_malloc(UDP_FRAME_MAX_SIZE);
+        AUDIO_MEM_CHECK(TAG, udp->frame, goto _udp_init_exit);
+        if (config->type == AUDIO_STREAM_READER) {
+            udp_jitter_cfg_t jitter_cfg = UDP_JITTER_CFG_DEFAULT();
+            jitter_cfg.conceal = config->conceal;
+            if (config->jitter_delay_ms > 0) {
+                jitter_cfg.max_delay_ms = config->jitter_delay_ms;
+            }
+            jitter_cfg.fec_group = config->fec_group;
+            udp->jitter = udp_jitter_create(&jitter_cfg);
+            AUDIO_MEM_CHECK(TAG, udp->jitter, goto _udp_init_exit);
+        } else if (config->fec_group) {
+            udp->fec = audio_calloc(1, sizeof(udp_fec_enc_t));
+            AUDIO_MEM_CHECK(TAG, udp->fec, goto _udp_init_exit);
+            udp_fec_enc_init(udp->fec, config->fec_group);
+        }
+    }
 
     if (config->type == AUDIO_STREAM_WRITER) {
         cfg.write = _udp_write;
@@ -252,6 +429,9 @@ audio_element_handle_t udp_stream_init(udp_stream_cfg_t *config)
 
     return el;
 _udp_init_exit:
+    udp_jitter_destroy(udp->jitter);
+    audio_free(udp->fec);
+    audio_free(udp->frame);
     audio_free(udp);
     return NULL;
 }
@@ -266,6 +446,36 @@ int udp_stream_get_read_num(audio_element_handle_t el)
     return num;
 }
 
+int udp_stream_get_read_call_num(audio_element_handle_t el)
+{
+    int num = 0;
+    udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(el);
+    if(udp) {
+        num = udp->read_calls;
+    }
+    return num;
+}
+
+int udp_stream_get_datagram_rate(audio_element_handle_t el)
+{
+    int rate = 0;
+    udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(el);
+    if(udp) {
+        rate = udp->rate;
+    }
+    return rate;
+}
+
+int udp_stream_get_read_latency_us(audio_element_handle_t el)
+{
+    int latency = 0;
+    udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(el);
+    if(udp) {
+        latency = udp->latency_us >> 4;
+    }
+    return latency;
+}
+
 int udp_stream_get_write_num(audio_element_handle_t el)
 {
     int num = 0;
@@ -295,3 +505,54 @@ int udp_stream_get_write_bytes(audio_element_handle_t el)
     }
     return bytes;
 }
+
+static void _udp_jitter_stat(audio_element_handle_t el, udp_jitter_stats_t *stats)
+{
+    memset(stats, 0, sizeof(udp_jitter_stats_t));
+    udp_stream_t *udp = (udp_stream_t *)audio_element_getdata(el);
+    if(udp) {
+        udp_jitter_get_stats(udp->jitter, stats);
+    }
+}
+
+int udp_stream_get_lost_num(audio_element_handle_t el)
+{
+    udp_jitter_stats_t stats;
+    _udp_jitter_stat(el, &stats);
+    return stats.lost;
+}
+
+int udp_stream_get_late_num(audio_element_handle_t el)
+{
+    udp_jitter_stats_t stats;
+    _udp_jitter_stat(el, &stats);
+    return stats.late;
+}
+
+int udp_stream_get_reorder_num(audio_element_handle_t el)
+{
+    udp_jitter_stats_t stats;
+    _udp_jitter_stat(el, &stats);
+    return stats.reordered;
+}
+
+int udp_stream_get_conceal_num(audio_element_handle_t el)
+{
+    udp_jitter_stats_t stats;
+    _udp_jitter_stat(el, &stats);
+    return stats.concealed;
+}
+
+int udp_stream_get_recover_num(audio_element_handle_t el)
+{
+    udp_jitter_stats_t stats;
+    _udp_jitter_stat(el, &stats);
+    return stats.recovered;
+}
+
+int udp_stream_get_jitter_ms(audio_element_handle_t el)
+{
+    udp_jitter_stats_t stats;
+    _udp_jitter_stat(el, &stats);
+    return stats.jitter_ms;
+}